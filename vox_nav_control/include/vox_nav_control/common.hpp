@@ -23,6 +23,12 @@
 #include <geometry_msgs/msg/twist.hpp>
 
 #include <Eigen/Eigen>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
 #include <ompl/geometric/PathGeometric.h>
 #include <ompl/base/SpaceInformation.h>
 #include <ompl/base/spaces/ReedsSheppStateSpace.h>
@@ -147,6 +153,16 @@ namespace vox_nav_control
       double robot_radius;
       double obstacle_cost;
       bool full_ackerman;
+      // warm start solver from previous solution shifted by one step (CasADi only)
+      bool warm_start;
+      // code generate and compile NLP functions, cached in codegen_directory (CasADi only)
+      bool codegen;
+      std::string codegen_directory;
+      // real-time iteration, one SQP step per cycle with preparation phase run after the
+      // command is published
+      bool rti;
+      // sparse QP solver of RTI step, a CasADi conic plugin, "qrqp" or "osqp" (CasADi only)
+      std::string rti_qp_solver;
 
       // Assign meaningful default values to this parameters
       Parameters()
@@ -171,7 +187,70 @@ namespace vox_nav_control
         max_obstacles(1),
         robot_radius(0.5),
         obstacle_cost(1.0),
-        full_ackerman(false) {}
+        full_ackerman(false),
+        warm_start(true),
+        codegen(false),
+        codegen_directory("/tmp/vox_nav_mpc_casadi_codegen"),
+        rti(false),
+        rti_qp_solver("qrqp") {}
+    };
+
+    /**
+     * @brief Latency samples of a solver phase, keeps last capacity samples in a preallocated
+     * ring buffer and reports their distribution
+     *
+     */
+    class LatencyStats
+    {
+    public:
+      explicit LatencyStats(size_t capacity = 1000)
+      : samples_(std::max<size_t>(capacity, 1)),
+        sorted_(samples_.size()),
+        next_(0),
+        count_(0) {}
+
+      void add(double ms)
+      {
+        samples_[next_] = ms;
+        next_ = (next_ + 1) % samples_.size();
+        count_ = std::min(count_ + 1, samples_.size());
+      }
+
+      void reset()
+      {
+        next_ = 0;
+        count_ = 0;
+      }
+
+      size_t count() const {return count_;}
+
+      /**
+       * @brief p50, p90, p99 and max of samples as a printable string
+       *
+       * @return std::string
+       */
+      std::string summary()
+      {
+        if (count_ == 0) {
+          return "no samples";
+        }
+        std::copy(samples_.begin(), samples_.begin() + count_, sorted_.begin());
+        std::sort(sorted_.begin(), sorted_.begin() + count_);
+        auto percentile = [this](double p) {
+            return sorted_[static_cast<size_t>(p * (count_ - 1) + 0.5)];
+          };
+        char buffer[128];
+        std::snprintf(
+          buffer, sizeof(buffer), "p50 %.3f p90 %.3f p99 %.3f max %.3f ms (%zu samples)",
+          percentile(0.5), percentile(0.9), percentile(0.99), sorted_[count_ - 1], count_);
+        return buffer;
+      }
+
+    private:
+      std::vector<double> samples_;
+      std::vector<double> sorted_;
+      size_t next_;
+      size_t count_;
     };
 
     static int nearestStateIndex(
@@ -179,7 +258,7 @@ namespace vox_nav_control
       const geometry_msgs::msg::PoseStamped & curr_robot_pose)
     {
       int closest_state_index = -1;
-      int closest_state_distance = 10000.0;
+      double closest_state_distance = std::numeric_limits<double>::max();
       for (int i = 0; i < reference_traj.poses.size(); i++) {
 
         double curr_distance =
@@ -290,6 +369,252 @@ namespace vox_nav_control
       return interpolated_reference_states;
     }
 
+    /**
+     * @brief Reference path prepared once per plan for the control loop. Positions, yaw and
+     * cumulative arc length of poses are cached, nearest pose is searched in a window around the
+     * last matched index, with a full scan on the first query or when the match is at the edge of
+     * the window or farther from it than half the window extent (robot is outside of it).
+     *
+     */
+    class ReferencePath
+    {
+    public:
+      explicit ReferencePath(int search_window = 50)
+      : search_window_(std::max(1, search_window)),
+        last_index_(-1) {}
+
+      ReferencePath(const nav_msgs::msg::Path & path, int search_window = 50)
+      : ReferencePath(search_window)
+      {
+        setPath(path);
+      }
+
+      void setPath(const nav_msgs::msg::Path & path)
+      {
+        const size_t n = path.poses.size();
+        x_.resize(n);
+        y_.resize(n);
+        z_.resize(n);
+        yaw_.resize(n);
+        arc_length_.resize(n);
+        double roll, pitch;
+        for (size_t i = 0; i < n; i++) {
+          x_[i] = path.poses[i].pose.position.x;
+          y_[i] = path.poses[i].pose.position.y;
+          z_[i] = path.poses[i].pose.position.z;
+          vox_nav_utilities::getRPYfromMsgQuaternion(
+            path.poses[i].pose.orientation, roll, pitch, yaw_[i]);
+          arc_length_[i] = i == 0 ? 0.0 : arc_length_[i - 1] + std::hypot(
+            std::hypot(x_[i] - x_[i - 1], y_[i] - y_[i - 1]), z_[i] - z_[i - 1]);
+        }
+        last_index_ = -1;
+      }
+
+      /**
+       * @brief Index of pose nearest to given pose, -1 if path is empty
+       *
+       * @param pose
+       * @return int
+       */
+      int nearestStateIndex(const geometry_msgs::msg::PoseStamped & pose)
+      {
+        const int n = size();
+        if (n == 0) {
+          return -1;
+        }
+        const double px = pose.pose.position.x;
+        const double py = pose.pose.position.y;
+        const double pz = pose.pose.position.z;
+        if (last_index_ >= 0) {
+          int begin = std::max(0, last_index_ - search_window_);
+          int end = std::min(n - 1, last_index_ + search_window_);
+          int index = nearestInRange(px, py, pz, begin, end);
+          // robot is farther from the match than half the window extent, it may be anywhere
+          double half_span = (arc_length_[end] - arc_length_[begin]) / 2.0;
+          if ((index > begin || begin == 0) && (index < end || end == n - 1) &&
+            squaredDistance(index, px, py, pz) <= half_span * half_span)
+          {
+            last_index_ = index;
+            return index;
+          }
+        }
+        last_index_ = nearestInRange(px, py, pz, 0, n - 1);
+        return last_index_;
+      }
+
+      /**
+       * @brief Index of first pose whose arc length from path start is at least s,
+       * last index if s is beyond path length
+       *
+       * @param s
+       * @return int
+       */
+      int indexAtArcLength(double s) const
+      {
+        auto it = std::lower_bound(arc_length_.begin(), arc_length_.end(), s);
+        if (it == arc_length_.end()) {
+          return size() - 1;
+        }
+        return static_cast<int>(it - arc_length_.begin());
+      }
+
+      /**
+       * @brief Largest absolute curvature (yaw change per arc length) of path from index begin
+       * up to distance along it. Poses closer than 1 cm are merged, so that duplicate poses do
+       * not blow curvature up
+       *
+       * @param begin
+       * @param distance
+       * @return double 1/m
+       */
+      double maxCurvature(int begin, double distance) const
+      {
+        double max_curvature = 0.0;
+        if (begin < 0 || begin >= size()) {
+          return max_curvature;
+        }
+        const double s_end = arc_length_[begin] + distance;
+        int from = begin;
+        for (int i = begin + 1; i < size() && arc_length_[from] < s_end; i++) {
+          double ds = arc_length_[i] - arc_length_[from];
+          if (ds < 0.01) {
+            continue;
+          }
+          double dyaw = std::atan2(std::sin(yaw_[i] - yaw_[from]), std::cos(yaw_[i] - yaw_[from]));
+          max_curvature = std::max(max_curvature, std::abs(dyaw) / ds);
+          from = i;
+        }
+        return max_curvature;
+      }
+
+      int size() const {return static_cast<int>(x_.size());}
+      bool empty() const {return x_.empty();}
+      double length() const {return arc_length_.empty() ? 0.0 : arc_length_.back();}
+      double x(int i) const {return x_[i];}
+      double y(int i) const {return y_[i];}
+      double z(int i) const {return z_[i];}
+      double yaw(int i) const {return yaw_[i];}
+      double arcLength(int i) const {return arc_length_[i];}
+
+    private:
+      double squaredDistance(int i, double px, double py, double pz) const
+      {
+        double dx = x_[i] - px, dy = y_[i] - py, dz = z_[i] - pz;
+        return dx * dx + dy * dy + dz * dz;
+      }
+
+      int nearestInRange(double px, double py, double pz, int begin, int end) const
+      {
+        int closest_state_index = begin;
+        double closest_state_distance = std::numeric_limits<double>::max();
+        for (int i = begin; i <= end; i++) {
+          double curr_distance = squaredDistance(i, px, py, pz);
+          if (curr_distance < closest_state_distance) {
+            closest_state_distance = curr_distance;
+            closest_state_index = i;
+          }
+        }
+        return closest_state_index;
+      }
+
+      std::vector<double> x_;
+      std::vector<double> y_;
+      std::vector<double> z_;
+      std::vector<double> yaw_;
+      std::vector<double> arc_length_;
+      int search_window_;
+      int last_index_;
+    };
+
+    /**
+     * @brief Interpolate N reference states up to look ahead distance on a ReferencePath.
+     * Local goal is found by arc length, the N states are sampled evenly along the reference
+     * between nearest pose and local goal. When the robot is closer than N poses to local goal,
+     * states are interpolated from robot to local goal in the SE2 space of si (SE2, Dubins or
+     * Reeds-Shepp), as before. Nothing is allocated on the path following branch once
+     * interpolated_reference_states has reached size N.
+     *
+     * @param curr_robot_pose
+     * @param mpc_parameters
+     * @param reference_path
+     * @param global_plan_look_ahead_distance
+     * @param si space information of ref_traj_se2_space
+     * @param interpolated_reference_states out: N states
+     */
+    static void getLocalInterpolatedReferenceStates(
+      const geometry_msgs::msg::PoseStamped & curr_robot_pose,
+      const Parameters & mpc_parameters,
+      ReferencePath & reference_path,
+      const double global_plan_look_ahead_distance,
+      const std::shared_ptr<ompl::base::SpaceInformation> & si,
+      std::vector<States> & interpolated_reference_states)
+    {
+      const int N = std::max(mpc_parameters.N, 1);
+      interpolated_reference_states.resize(N);
+      int nearsest_traj_state_index = reference_path.nearestStateIndex(curr_robot_pose);
+      if (nearsest_traj_state_index < 0) {
+        return;
+      }
+      int local_goal_state_index = reference_path.indexAtArcLength(
+        reference_path.arcLength(nearsest_traj_state_index) + global_plan_look_ahead_distance);
+
+      auto wrap = [](double angle) {
+          return std::atan2(std::sin(angle), std::cos(angle));
+        };
+
+      if (local_goal_state_index - nearsest_traj_state_index < N) {
+        // Too close to local goal, interpolate from robot to it with OMPL
+        double void_var, yaw;
+        vox_nav_utilities::getRPYfromMsgQuaternion(
+          curr_robot_pose.pose.orientation, void_var, void_var, yaw);
+        ompl::base::ScopedState<ompl::base::SE2StateSpace>
+        robot_state(si->getStateSpace()),
+        ompl_local_goal_state(si->getStateSpace()),
+        interpolated_state(si->getStateSpace());
+        robot_state->setXY(curr_robot_pose.pose.position.x, curr_robot_pose.pose.position.y);
+        robot_state->setYaw(yaw);
+        ompl_local_goal_state->setXY(
+          reference_path.x(local_goal_state_index), reference_path.y(local_goal_state_index));
+        ompl_local_goal_state->setYaw(reference_path.yaw(local_goal_state_index));
+        for (int i = 0; i < N; i++) {
+          double t = N > 1 ? static_cast<double>(i) / (N - 1) : 1.0;
+          si->getStateSpace()->interpolate(
+            robot_state.get(), ompl_local_goal_state.get(), t, interpolated_state.get());
+          auto & state = interpolated_reference_states[i];
+          state.x = interpolated_state->getX();
+          state.y = interpolated_state->getY();
+          state.psi = interpolated_state->getYaw();
+          state.v = mpc_parameters.V_MAX;
+        }
+        return;
+      }
+
+      // Sample evenly in arc length along the reference between nearest pose and local goal
+      const double s_begin = reference_path.arcLength(nearsest_traj_state_index);
+      const double s_end = reference_path.arcLength(local_goal_state_index);
+      int segment = nearsest_traj_state_index;
+      for (int i = 0; i < N; i++) {
+        double s = N > 1 ? s_begin + (s_end - s_begin) * i / (N - 1) : s_end;
+        while (segment < local_goal_state_index - 1 && reference_path.arcLength(segment + 1) < s) {
+          segment++;
+        }
+        double segment_length = reference_path.arcLength(segment + 1) -
+          reference_path.arcLength(segment);
+        double t = segment_length > 0.0 ?
+          std::min(1.0, std::max(0.0, (s - reference_path.arcLength(segment)) / segment_length)) :
+          0.0;
+        auto & state = interpolated_reference_states[i];
+        state.x = reference_path.x(segment) +
+          t * (reference_path.x(segment + 1) - reference_path.x(segment));
+        state.y = reference_path.y(segment) +
+          t * (reference_path.y(segment + 1) - reference_path.y(segment));
+        state.psi = wrap(
+          reference_path.yaw(segment) +
+          t * wrap(reference_path.yaw(segment + 1) - reference_path.yaw(segment)));
+        state.v = mpc_parameters.V_MAX;
+      }
+    }
+
     static void publishTrajStates(
       const std::vector<States> & interpolated_reference_states,
       const std_msgs::msg::ColorRGBA & color,
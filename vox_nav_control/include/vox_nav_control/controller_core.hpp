@@ -76,6 +76,14 @@ namespace vox_nav_control
     virtual geometry_msgs::msg::Twist computeHeadingCorrectionCommands(
       geometry_msgs::msg::PoseStamped curr_robot_pose) = 0;
 
+    /**
+     * @brief Called right after the command of computeVelocityCommands is published.
+     * Controllers that split their work into preparation and feedback phases (e.g. real-time
+     * iteration MPC) prepare next cycle here, so that it is not between pose and command
+     *
+     */
+    virtual void prepareNextCycle() {}
+
   };
 
 }  // namespace vox_nav_control
@@ -0,0 +1,74 @@
+// Copyright (c) 2022 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_CONTROL__MPC_CONTROLLER_ACADO__ACADO_SOLVER_BANK_HPP_
+#define VOX_NAV_CONTROL__MPC_CONTROLLER_ACADO__ACADO_SOLVER_BANK_HPP_
+
+#include <string>
+#include <vector>
+
+namespace vox_nav_control
+{
+  namespace mpc_controller_acado
+  {
+
+/**
+ * @brief Handle to one generated ACADO solver, its dimensions, the arrays of its
+ * ACADOvariables and its entry points. Generated solvers all use the same global symbol names,
+ * so this is the only way solvers of the bank are accessed; it does not include any generated
+ * header and can be used for solvers of any size.
+ *
+ */
+    struct AcadoSolver
+    {
+      // "default" for solver in auto_gen, n<N>_dt<DT in ms> for solvers of the bank
+      std::string name;
+      int N;
+      int NX;
+      int NU;
+      int NY;
+      int NYN;
+      int NOD;
+      double DT;
+      // arrays of ACADOvariables of solver
+      double * x;
+      double * u;
+      double * y;
+      double * yN;
+      double * od;
+      double * W;
+      double * WN;
+      double * x0;
+      int (* initializeSolver)();
+      int (* preparationStep)();
+      int (* feedbackStep)();
+      void (* shiftStates)(int strategy, double * x_end, double * u_end);
+      void (* shiftControls)(double * u_end);
+      // zeros ACADOvariables and ACADOworkspace of solver
+      void (* resetMemory)();
+    };
+
+/**
+ * @brief Solvers of the bank compiled in to this build, generated by mpc_controller_acado_code_gen
+ * in to auto_gen_bank/n<N>_dt<DT in ms>. Each is a library with hidden symbols exporting only
+ * solver_bank::n<N>_dt<DT in ms>::getSolver(). Empty if no bank was generated.
+ *
+ * @return std::vector<AcadoSolver>
+ */
+    std::vector<AcadoSolver> getAcadoSolverBank();
+
+  }  // namespace mpc_controller_acado
+}  // namespace vox_nav_control
+
+#endif  // VOX_NAV_CONTROL__MPC_CONTROLLER_ACADO__ACADO_SOLVER_BANK_HPP_
@@ -15,6 +15,7 @@
 #include <rclcpp/rclcpp.hpp>
 #include <vox_nav_control/common.hpp>
 #include <vox_nav_control/controller_core.hpp>
+#include <vox_nav_control/mpc_controller_acado/acado_solver_bank.hpp>
 #include <vox_nav_utilities/tf_helpers.hpp>
 #include <vox_nav_msgs/msg/object_array.hpp>
 
@@ -100,6 +101,13 @@ namespace vox_nav_control
         geometry_msgs::msg::PoseStamped curr_robot_pose)
       override;
 
+      /**
+       * @brief In RTI mode, shifts solution one step and runs acado_preparationStep, so that
+       * next cycle only runs acado_feedbackStep
+       *
+       */
+      void prepareNextCycle() override;
+
       /**
        * @brief
        *
@@ -163,9 +171,35 @@ namespace vox_nav_control
        */
       std::vector<vox_nav_control::common::States> getPredictedStatesFromAcado();
 
+      /**
+       * @brief Pick solver of the bank for given speed and path curvature ahead. Among solvers
+       * whose DT is fine enough for the curvature, the one with shortest N whose horizon spans
+       * solver_bank_preview_distance_ is preferred, otherwise the one with longest horizon.
+       * Solver is switched once it has been picked for solver_bank_switch_cycles_ cycles
+       *
+       * @param speed m/s
+       * @param curvature 1/m
+       * @param curr_states
+       */
+      void selectSolver(
+        double speed, double curvature, const vox_nav_control::common::States & curr_states);
+
+      /**
+       * @brief Make solvers_[index] the active solver, its memory is reinitialized with
+       * current state, and mpc_parameters_ N and DT are set to its ones
+       *
+       * @param index
+       * @param curr_states
+       */
+      void activateSolver(int index, const vox_nav_control::common::States & curr_states);
+
     private:
       // Given refernce traj to follow, this is set got from planner
       nav_msgs::msg::Path reference_traj_;
+      // reference_traj_ prepared for nearest state search and interpolation
+      vox_nav_control::common::ReferencePath reference_path_;
+      // local reference states fed to MPC, reused every control cycle
+      std::vector<vox_nav_control::common::States> local_reference_states_;
       // computed velocities as result of MPC
       geometry_msgs::msg::Twist computed_velocity_;
       // MPC core controller object
@@ -196,6 +230,26 @@ namespace vox_nav_control
       double rho_;
       ompl::base::SpaceInformationPtr state_space_information_;
 
+      // whether acado_preparationStep was run by prepareNextCycle since last feedback step
+      bool acado_prepared_;
+
+      // solvers_[0] is solver in auto_gen, rest is the bank if solver_bank is set
+      std::vector<AcadoSolver> solvers_;
+      // active one, all ACADO calls go through it
+      AcadoSolver solver_;
+      int active_solver_;
+      // solver picked by selectSolver in last candidate_cycles_ cycles
+      int candidate_solver_;
+      int candidate_cycles_;
+      bool use_solver_bank_;
+      // horizon N * DT should span this distance at current speed
+      double solver_bank_preview_distance_;
+      // max heading change of reference within one DT
+      double solver_bank_max_heading_step_;
+      int solver_bank_switch_cycles_;
+      // time from new state to control input, and of RTI preparation after it
+      vox_nav_control::common::LatencyStats feedback_latency_;
+      vox_nav_control::common::LatencyStats preparation_latency_;
     };
 
   } // namespace mpc_controller_acado
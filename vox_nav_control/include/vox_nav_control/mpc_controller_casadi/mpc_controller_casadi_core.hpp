@@ -24,6 +24,7 @@
 
 #include <vector>
 #include <memory>
+#include <string>
 #include <chrono>
 #include <Eigen/Eigen>
 #include <vox_nav_control/common.hpp>
@@ -61,15 +62,21 @@ namespace vox_nav_control
       {
         // whether the found solution was optimal
         bool is_optimal;
+        // whether solver was initialized from previous solution
+        bool is_warm_started;
+        // IPOPT iterations
+        int iterations;
         // Execution ime took by solver in milliseconds
-        int solve_time_ms;
+        double solve_time_ms;
         // computed control input as result of optimal control
         vox_nav_control::common::ControlInput control_input;
         // actual states that are going to be achieved in the time horizon
         std::vector<vox_nav_control::common::States> actual_computed_states;
         SolutionResult()
         : is_optimal(false),
-          solve_time_ms(0)
+          is_warm_started(false),
+          iterations(0),
+          solve_time_ms(0.0)
         {}
       };
 
@@ -163,7 +170,118 @@ namespace vox_nav_control
        */
       SolutionResult solve(const std::vector<vox_nav_control::common::Ellipsoid> & obstacles);
 
+      /**
+       * @brief drop previous solution and multipliers, next solve starts cold from same initial
+       * guess as first one. Call this when the reference changes discontinuously, e.g. on a new plan
+       *
+       */
+      void resetWarmStart();
+
+      /**
+       * @brief RTI preparation phase, linearizes constraints around previous solution shifted
+       * by one step, so that next solve only evaluates residuals at new state and solves one QP.
+       * Call it after command of a solve has been sent. No-op unless RTI is used
+       *
+       * @return double time it took in milliseconds
+       */
+      double prepare();
+
     private:
+      /**
+       * @brief set previous solution shifted by one step as initial guess of primal variables,
+       * and previous dual variables shifted by one step as initial guess of multipliers
+       *
+       */
+      void setWarmStart();
+
+      /**
+       * @brief set all states, control inputs and slack variables in horizon to zero as initial
+       * guess of primal variables
+       *
+       */
+      void setDefaultInitialGuess();
+
+      /**
+       * @brief Create an IPOPT solver on the NLP of Opti problem, or on compiled library if there
+       * is one, with warm start options, which make IPOPT use initial guess of multipliers. Opti
+       * and compiled solver solve cold, as these options are fixed once a solver is created.
+       *
+       * @param opts solver options given to Opti
+       * @return true
+       * @return false if solver could not be created
+       */
+      bool setupWarmSolver(const casadi::Dict & opts);
+
+      /**
+       * @brief NLP of Opti problem as a function of concatenated variables and parameters
+       *
+       * @return casadi::Function
+       */
+      casadi::Function nlpOracle();
+
+      /**
+       * @brief Code generate NLP functions of the Opti problem (objective, constraints and their
+       * derivatives) to C, compile them to a shared library in params_.codegen_directory and
+       * create an IPOPT solver on it. Library is cached by a hash of the NLP, so later runs
+       * with same problem load it directly.
+       *
+       * @param opts solver options given to Opti
+       * @return true
+       * @return false if code generation, compilation or loading failed
+       */
+      bool setupCompiledSolver(const casadi::Dict & opts);
+
+      /**
+       * @brief Solve with an NLP solver created on nlpOracle() from current parameter values and
+       * initial guess, previous multipliers are given if warm started
+       *
+       * @param solver
+       * @param is_warm_started
+       * @param z_mpc
+       * @param u_mpc
+       * @param sl_mpc
+       * @param lam_g
+       * @return true if solution is optimal
+       */
+      bool solveNlp(
+        const casadi::Function & solver, bool is_warm_started,
+        casadi::DM & z_mpc, casadi::DM & u_mpc, casadi::DM & sl_mpc, casadi::DM & lam_g);
+
+      /**
+       * @brief Create functions mapping between Opti variables/parameters and NLP vectors, and
+       * bounds of constraints
+       *
+       */
+      void setupNlpFunctions();
+
+      /**
+       * @brief Concatenated current parameter values
+       *
+       * @return casadi::DM
+       */
+      casadi::DM packParameters();
+
+      /**
+       * @brief Create constraint Jacobian, residual and constant Hessian functions of RTI step
+       * and a sparse QP solver (params_.rti_qp_solver) for it
+       *
+       * @return true
+       * @return false if QP solver plugin is not available or setup failed
+       */
+      bool setupRTI();
+
+      /**
+       * @brief RTI feedback phase, one QP step from prepared linearization
+       *
+       * @param z_mpc
+       * @param u_mpc
+       * @param sl_mpc
+       * @param lam_g
+       * @return true if QP was solved
+       */
+      bool solveRTI(
+        casadi::DM & z_mpc, casadi::DM & u_mpc, casadi::DM & sl_mpc, casadi::DM & lam_g);
+
       std::shared_ptr<casadi::Opti> opti_;
       // used to slice casadi matrixes
       casadi::Slice slice_all_;
@@ -216,6 +334,51 @@ namespace vox_nav_control
       casadi::MX angle_obs_;
       bool initial_solution_found_;
 
+      // previous solution, used to warm start next solve
+      bool has_previous_solution_;
+      casadi::DM previous_z_mpc_;
+      casadi::DM previous_u_mpc_;
+      casadi::DM previous_sl_mpc_;
+      casadi::DM previous_lam_g_;
+      // row of previous_lam_g_ each constraint row takes its warm start multiplier from
+      std::vector<casadi_int> lam_g_shift_index_;
+      // current state as set by updateCurrentStates, first state of warm start
+      casadi::DM curr_states_;
+      // values of parameters and initial guesses, compiled solver is called without Opti
+      casadi::DM u_prev_value_;
+      casadi::DM z_ref_value_;
+      casadi::DM z_obs_value_;
+      casadi::DM z_init_value_;
+      casadi::DM u_init_value_;
+      casadi::DM sl_init_value_;
+      casadi::DM lam_g_init_value_;
+
+      // null unless params_.codegen is set and compiled solver could be set up
+      casadi::Function compiled_solver_;
+      // shared library of compiled_solver_, empty if there is none
+      std::string compiled_library_;
+      // IPOPT with warm start options for solves with a previous solution, null unless
+      // params_.warm_start is set
+      casadi::Function warm_solver_;
+      // map between Opti variables/parameters and concatenated NLP vectors
+      casadi::Function pack_x_function_;
+      casadi::Function unpack_x_function_;
+      casadi::Function pack_p_function_;
+      // lbg, ubg of NLP given parameters
+      casadi::Function bounds_function_;
+
+      // tracking, input rate and slack terms of cost, their Hessian is used in RTI QP
+      casadi::MX quadratic_cost_;
+      // null unless params_.rti is set and RTI could be set up
+      casadi::Function rti_qp_solver_;
+      casadi::Function rti_jac_g_function_;
+      casadi::Function rti_residual_function_;
+      casadi::DM rti_hessian_;
+      // linearization point and constraint Jacobian at it, set by prepare()
+      casadi::DM rti_x_lin_;
+      casadi::DM rti_jac_g_;
+      bool rti_prepared_;
+
     };
   } // namespace mpc_controller_casadi
 }  // namespace vox_nav_control
@@ -95,6 +95,12 @@ namespace vox_nav_control
         geometry_msgs::msg::PoseStamped curr_robot_pose)
       override;
 
+      /**
+       * @brief Runs RTI preparation phase of next solve, if RTI is used
+       *
+       */
+      void prepareNextCycle() override;
+
       /**
        * @brief
        *
@@ -102,6 +108,13 @@ namespace vox_nav_control
        */
       void obstacleTracksCallback(const vox_nav_msgs::msg::ObjectArray::SharedPtr msg);
 
+      /**
+       * @brief Accumulate iterations and latency of a solve and log them
+       *
+       * @param res
+       */
+      void reportSolveStats(const MPCControllerCasadiCore::SolutionResult & res);
+
       /**
        * @brief Convert ROS msg type of ObjectsArray to vector of Ellipsoid to feed to MPC controller
        *
@@ -115,6 +128,10 @@ namespace vox_nav_control
     private:
       // Given refernce traj to follow, this is set got from planner
       nav_msgs::msg::Path reference_traj_;
+      // reference_traj_ prepared for nearest state search and interpolation
+      vox_nav_control::common::ReferencePath reference_path_;
+      // local reference states fed to MPC, reused every control cycle
+      std::vector<vox_nav_control::common::States> local_reference_states_;
       // computed velocities as result of MPC
       geometry_msgs::msg::Twist computed_velocity_;
       // MPC core controller object
@@ -144,6 +161,22 @@ namespace vox_nav_control
       ompl::base::SpaceInformationPtr state_space_information_;
 
       bool solved_at_least_once_;
+
+      // solver statistics since last plan
+      struct SolveStats
+      {
+        int cycles;
+        int warm_started_cycles;
+        long total_iterations;
+        SolveStats()
+        : cycles(0),
+          warm_started_cycles(0),
+          total_iterations(0) {}
+      };
+      SolveStats solve_stats_;
+      // time from new state to control input (solve), and of RTI preparation after it
+      vox_nav_control::common::LatencyStats feedback_latency_;
+      vox_nav_control::common::LatencyStats preparation_latency_;
     };
 
   } // namespace mpc_controller_casadi
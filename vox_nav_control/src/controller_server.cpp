@@ -158,6 +158,8 @@ namespace vox_nav_control
     geometry_msgs::msg::Twist computed_velocity_commands;
     // set Plan
     controller_->setPlan(goal->path);
+    // nearest pose search on a windowed reference, built once per goal
+    vox_nav_control::common::ReferencePath reference_path(goal->path);
 
     rclcpp::WallRate rate(controller_frequency_);
 
@@ -183,9 +185,7 @@ namespace vox_nav_control
       vox_nav_utilities::getCurrentPose(
         curr_robot_pose, *tf_buffer_, "map", "base_link", transform_timeout_);
 
-      int nearest_traj_pose_index = vox_nav_control::common::nearestStateIndex(
-        goal->path,
-        curr_robot_pose);
+      int nearest_traj_pose_index = reference_path.nearestStateIndex(curr_robot_pose);
       curr_robot_pose.pose.position.z = goal->path.poses[nearest_traj_pose_index].pose.position.z;
 
       auto & clock = *this->get_clock();
@@ -261,6 +261,7 @@ namespace vox_nav_control
       feedback->speed = computed_velocity_commands.linear.x;
       goal_handle->publish_feedback(feedback);
       cmd_vel_publisher_->publish(computed_velocity_commands);
+      controller_->prepareNextCycle();
       // If loop is slower than expected , notify
       auto cycle_duration = steady_clock_.now() - loop_start_time;
       if (controller_duration_ && cycle_duration.seconds() > controller_duration_) {
@@ -0,0 +1,86 @@
+// Copyright (c) 2022 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Compiled once for each solver of the bank, together with its generated code, with
+ * VOX_NAV_ACADO_SOLVER_NAME (n<N>_dt<DT in ms>) and VOX_NAV_ACADO_SOLVER_DT_MS defined.
+ * The library is built with hidden visibility, so the solver memory below and all ACADO and
+ * qpOASES symbols stay local to it; only the namespaced getSolver() is exported.
+ */
+
+#include <acado_common.h>
+
+#include <cstring>
+#include <type_traits>
+
+#include "vox_nav_control/mpc_controller_acado/acado_solver_bank.hpp"
+
+#define VOX_NAV_ACADO_STRINGIFY_(x) #x
+#define VOX_NAV_ACADO_STRINGIFY(x) VOX_NAV_ACADO_STRINGIFY_(x)
+
+static_assert(
+  std::is_same<real_t, double>::value, "AcadoSolver expects solvers generated with double");
+
+/* Global variables used by the solver. */
+ACADOvariables acadoVariables;
+ACADOworkspace acadoWorkspace;
+
+namespace vox_nav_control
+{
+  namespace mpc_controller_acado
+  {
+    namespace solver_bank
+    {
+      namespace VOX_NAV_ACADO_SOLVER_NAME
+      {
+        namespace
+        {
+          void resetMemory()
+          {
+            memset(&acadoWorkspace, 0, sizeof(acadoWorkspace));
+            memset(&acadoVariables, 0, sizeof(acadoVariables));
+          }
+        }  // namespace
+
+        __attribute__((visibility("default"))) AcadoSolver getSolver()
+        {
+          AcadoSolver solver;
+          solver.name = VOX_NAV_ACADO_STRINGIFY(VOX_NAV_ACADO_SOLVER_NAME);
+          solver.N = ACADO_N;
+          solver.NX = ACADO_NX;
+          solver.NU = ACADO_NU;
+          solver.NY = ACADO_NY;
+          solver.NYN = ACADO_NYN;
+          solver.NOD = ACADO_NOD;
+          solver.DT = VOX_NAV_ACADO_SOLVER_DT_MS / 1000.0;
+          solver.x = acadoVariables.x;
+          solver.u = acadoVariables.u;
+          solver.y = acadoVariables.y;
+          solver.yN = acadoVariables.yN;
+          solver.od = acadoVariables.od;
+          solver.W = acadoVariables.W;
+          solver.WN = acadoVariables.WN;
+          solver.x0 = acadoVariables.x0;
+          solver.initializeSolver = acado_initializeSolver;
+          solver.preparationStep = acado_preparationStep;
+          solver.feedbackStep = acado_feedbackStep;
+          solver.shiftStates = acado_shiftStates;
+          solver.shiftControls = acado_shiftControls;
+          solver.resetMemory = resetMemory;
+          return solver;
+        }
+      }  // namespace VOX_NAV_ACADO_SOLVER_NAME
+    }  // namespace solver_bank
+  }  // namespace mpc_controller_acado
+}  // namespace vox_nav_control
@@ -20,15 +20,19 @@
 #include <stdio.h>
 #include <rclcpp/rclcpp.hpp>
 
-int main(int argc, char ** argv)
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Parameters of MPC problem other than horizon N and step size DT
+ *
+ */
+struct CodeGenParameters
 {
-
-  rclcpp::init(argc, argv);
-
-  int N;
   int Ni;
   int max_obstacles; // should be the nearest ones
-  double DT;
   double L_F;
   double L_R;
   double min_acc_dv;
@@ -37,54 +41,34 @@ int main(int argc, char ** argv)
   double max_df_dv;
   double robot_radius;
   bool full_ackerman;
-
-  auto node = std::make_shared<rclcpp::Node>("vox_nav_controller_server_rclcpp_node");
-
-  RCLCPP_INFO(node->get_logger(), "Trying to acquire paramaters for %s", node->get_name());
-
-  std::string plugin_name = "MPCControllerAcadoROS";
-  node->declare_parameter("robot_radius", 0.8);
-  node->declare_parameter(plugin_name + ".N", 10);
-  node->declare_parameter(plugin_name + ".Ni", 1);
-  node->declare_parameter(plugin_name + ".max_obstacles", 1);
-  node->declare_parameter(plugin_name + ".DT", 0.1);
-  node->declare_parameter(plugin_name + ".L_F", 0.66);
-  node->declare_parameter(plugin_name + ".L_R", 0.66);
-  node->declare_parameter(plugin_name + ".A_MIN", -1.0);
-  node->declare_parameter(plugin_name + ".A_MAX", 1.0);
-  node->declare_parameter(plugin_name + ".DF_MIN", -0.5);
-  node->declare_parameter(plugin_name + ".DF_MAX", 0.5);
-  node->declare_parameter(plugin_name + ".full_ackerman", true);
-
-  node->get_parameter("robot_radius", robot_radius);
-  node->get_parameter(plugin_name + ".N", N);
-  node->get_parameter(plugin_name + ".Ni", Ni);
-  node->get_parameter(plugin_name + ".max_obstacles", max_obstacles);
-  node->get_parameter(plugin_name + ".DT", DT);
-  node->get_parameter(plugin_name + ".L_F", L_F);
-  node->get_parameter(plugin_name + ".L_R", L_R);
-  node->get_parameter(plugin_name + ".A_MIN", min_acc_dv);
-  node->get_parameter(plugin_name + ".A_MAX", max_acc_dv);
-  node->get_parameter(plugin_name + ".DF_MIN", min_df_dv);
-  node->get_parameter(plugin_name + ".DF_MAX", max_df_dv);
-  node->get_parameter(plugin_name + ".full_ackerman", full_ackerman);
-
-
-  RCLCPP_INFO(node->get_logger(), "Generating acado code with following parameters");
-
-  RCLCPP_INFO_STREAM(node->get_logger(), "robot_radius " << robot_radius);
-  RCLCPP_INFO_STREAM(node->get_logger(), "N " << N);
-  RCLCPP_INFO_STREAM(node->get_logger(), "Ni " << Ni);
-  RCLCPP_INFO_STREAM(node->get_logger(), "max_obstacles " << max_obstacles);
-  RCLCPP_INFO_STREAM(node->get_logger(), "DT " << DT);
-  RCLCPP_INFO_STREAM(node->get_logger(), "L_F " << L_F);
-  RCLCPP_INFO_STREAM(node->get_logger(), "L_R " << L_R);
-  RCLCPP_INFO_STREAM(node->get_logger(), "A_MIN " << min_acc_dv);
-  RCLCPP_INFO_STREAM(node->get_logger(), "A_MAX " << max_acc_dv);
-  RCLCPP_INFO_STREAM(node->get_logger(), "DF_MIN " << min_df_dv);
-  RCLCPP_INFO_STREAM(node->get_logger(), "DF_MAX " << max_df_dv);
-  RCLCPP_INFO_STREAM(node->get_logger(), "full_ackerman " << full_ackerman);
-
+};
+
+/**
+ * @brief Generate ACADO solver code of MPC problem with given horizon and step size
+ *
+ * @param params
+ * @param N
+ * @param DT
+ * @param export_path directory generated code is dumped to, created if missing
+ * @return true
+ * @return false if code export failed
+ */
+bool generateSolver(
+  const CodeGenParameters & params, int N, double DT, const std::string & export_path)
+{
+  const int Ni = params.Ni;
+  const int max_obstacles = params.max_obstacles;
+  const double L_F = params.L_F;
+  const double L_R = params.L_R;
+  const double min_acc_dv = params.min_acc_dv;
+  const double max_acc_dv = params.max_acc_dv;
+  const double min_df_dv = params.min_df_dv;
+  const double max_df_dv = params.max_df_dv;
+  const double robot_radius = params.robot_radius;
+  const bool full_ackerman = params.full_ackerman;
+
+  // symbolic variables are counted globally, every solver has to start from a clean state
+  ACADO::clearAllStaticCounters();
 
   // INTRODUCE THE VARIABLES (acadoVariables.x):
   // -------------------------
@@ -184,21 +168,111 @@ int main(int argc, char ** argv)
   mpc.set(CG_USE_VARIABLE_WEIGHTING_MATRIX, YES);
   mpc.set(FIX_INITIAL_STATE, YES);
 
+  std::filesystem::create_directories(export_path);
+  if (mpc.exportCode(export_path.c_str()) != ACADO::SUCCESSFUL_RETURN) {
+    return false;
+  }
+  mpc.printDimensionsQP();
+  return true;
+}
+
+int main(int argc, char ** argv)
+{
+
+  rclcpp::init(argc, argv);
+
+  int N;
+  double DT;
+  CodeGenParameters params;
+  std::vector<int64_t> solver_bank_N;
+  std::vector<double> solver_bank_DT;
+
+  auto node = std::make_shared<rclcpp::Node>("vox_nav_controller_server_rclcpp_node");
+
+  RCLCPP_INFO(node->get_logger(), "Trying to acquire paramaters for %s", node->get_name());
+
+  std::string plugin_name = "MPCControllerAcadoROS";
+  node->declare_parameter("robot_radius", 0.8);
+  node->declare_parameter(plugin_name + ".N", 10);
+  node->declare_parameter(plugin_name + ".Ni", 1);
+  node->declare_parameter(plugin_name + ".max_obstacles", 1);
+  node->declare_parameter(plugin_name + ".DT", 0.1);
+  node->declare_parameter(plugin_name + ".L_F", 0.66);
+  node->declare_parameter(plugin_name + ".L_R", 0.66);
+  node->declare_parameter(plugin_name + ".A_MIN", -1.0);
+  node->declare_parameter(plugin_name + ".A_MAX", 1.0);
+  node->declare_parameter(plugin_name + ".DF_MIN", -0.5);
+  node->declare_parameter(plugin_name + ".DF_MAX", 0.5);
+  node->declare_parameter(plugin_name + ".full_ackerman", true);
+  node->declare_parameter(plugin_name + ".solver_bank_N", std::vector<int64_t>());
+  node->declare_parameter(plugin_name + ".solver_bank_DT", std::vector<double>());
+
+  node->get_parameter("robot_radius", params.robot_radius);
+  node->get_parameter(plugin_name + ".N", N);
+  node->get_parameter(plugin_name + ".Ni", params.Ni);
+  node->get_parameter(plugin_name + ".max_obstacles", params.max_obstacles);
+  node->get_parameter(plugin_name + ".DT", DT);
+  node->get_parameter(plugin_name + ".L_F", params.L_F);
+  node->get_parameter(plugin_name + ".L_R", params.L_R);
+  node->get_parameter(plugin_name + ".A_MIN", params.min_acc_dv);
+  node->get_parameter(plugin_name + ".A_MAX", params.max_acc_dv);
+  node->get_parameter(plugin_name + ".DF_MIN", params.min_df_dv);
+  node->get_parameter(plugin_name + ".DF_MAX", params.max_df_dv);
+  node->get_parameter(plugin_name + ".full_ackerman", params.full_ackerman);
+  node->get_parameter(plugin_name + ".solver_bank_N", solver_bank_N);
+  node->get_parameter(plugin_name + ".solver_bank_DT", solver_bank_DT);
+
+
+  RCLCPP_INFO(node->get_logger(), "Generating acado code with following parameters");
+
+  RCLCPP_INFO_STREAM(node->get_logger(), "robot_radius " << params.robot_radius);
+  RCLCPP_INFO_STREAM(node->get_logger(), "N " << N);
+  RCLCPP_INFO_STREAM(node->get_logger(), "Ni " << params.Ni);
+  RCLCPP_INFO_STREAM(node->get_logger(), "max_obstacles " << params.max_obstacles);
+  RCLCPP_INFO_STREAM(node->get_logger(), "DT " << DT);
+  RCLCPP_INFO_STREAM(node->get_logger(), "L_F " << params.L_F);
+  RCLCPP_INFO_STREAM(node->get_logger(), "L_R " << params.L_R);
+  RCLCPP_INFO_STREAM(node->get_logger(), "A_MIN " << params.min_acc_dv);
+  RCLCPP_INFO_STREAM(node->get_logger(), "A_MAX " << params.max_acc_dv);
+  RCLCPP_INFO_STREAM(node->get_logger(), "DF_MIN " << params.min_df_dv);
+  RCLCPP_INFO_STREAM(node->get_logger(), "DF_MAX " << params.max_df_dv);
+  RCLCPP_INFO_STREAM(node->get_logger(), "full_ackerman " << params.full_ackerman);
+
   std::string home = std::getenv("HOME");
   std::string full_path = home +
     "/colcon_ws/src/vox_nav/vox_nav_control/include/vox_nav_control/mpc_controller_acado/auto_gen";
 
-  if (mpc.exportCode(full_path.c_str()) != ACADO::SUCCESSFUL_RETURN) {
+  if (!generateSolver(params, N, DT, full_path)) {
     exit(EXIT_FAILURE);
   }
 
-  mpc.printDimensionsQP();
-
   RCLCPP_INFO(
     node->get_logger(),
     "Dumped auto generated code to: %s, Note that it needs to be under ::vox_nav/vox_nav_control/include/vox_nav_control/mpc_controller_acado/auto_gen::",
     full_path.c_str()
   );
 
+  // Bank of solvers the controller can switch between at runtime, each (N, DT) pair is
+  // generated in to auto_gen_bank/n<N>_dt<DT in ms>. Bank is regenerated as a whole, so that
+  // solvers removed from parameters are not built anymore
+  if (solver_bank_N.size() != solver_bank_DT.size()) {
+    RCLCPP_ERROR(
+      node->get_logger(), "solver_bank_N and solver_bank_DT must have same size, %d vs %d",
+      static_cast<int>(solver_bank_N.size()), static_cast<int>(solver_bank_DT.size()));
+    exit(EXIT_FAILURE);
+  }
+  std::string bank_path = full_path + "_bank";
+  std::filesystem::remove_all(bank_path);
+  for (size_t i = 0; i < solver_bank_N.size(); i++) {
+    std::string name = "n" + std::to_string(solver_bank_N[i]) + "_dt" +
+      std::to_string(static_cast<int>(std::round(solver_bank_DT[i] * 1000.0)));
+    std::string solver_path = bank_path + "/" + name;
+    if (!generateSolver(params, solver_bank_N[i], solver_bank_DT[i], solver_path)) {
+      exit(EXIT_FAILURE);
+    }
+    RCLCPP_INFO(
+      node->get_logger(), "Dumped solver bank entry %s to: %s", name.c_str(), solver_path.c_str());
+  }
+
   return EXIT_SUCCESS;
 }
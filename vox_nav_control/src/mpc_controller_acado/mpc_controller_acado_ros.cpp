@@ -16,6 +16,10 @@
 #include <vox_nav_control/mpc_controller_acado/mpc_controller_acado_ros.hpp>
 #include <pluginlib/class_list_macros.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <string>
@@ -28,7 +32,50 @@ namespace vox_nav_control
 {
   namespace mpc_controller_acado
   {
+    namespace
+    {
+      void resetDefaultSolverMemory()
+      {
+        memset(&acadoWorkspace, 0, sizeof(acadoWorkspace));
+        memset(&acadoVariables, 0, sizeof(acadoVariables));
+      }
+
+      // Solver generated in to auto_gen, linked through mpc_solver_acado
+      AcadoSolver getDefaultSolver(double DT)
+      {
+        AcadoSolver solver;
+        solver.name = "default";
+        solver.N = ACADO_N;
+        solver.NX = ACADO_NX;
+        solver.NU = ACADO_NU;
+        solver.NY = ACADO_NY;
+        solver.NYN = ACADO_NYN;
+        solver.NOD = ACADO_NOD;
+        solver.DT = DT;
+        solver.x = acadoVariables.x;
+        solver.u = acadoVariables.u;
+        solver.y = acadoVariables.y;
+        solver.yN = acadoVariables.yN;
+        solver.od = acadoVariables.od;
+        solver.W = acadoVariables.W;
+        solver.WN = acadoVariables.WN;
+        solver.x0 = acadoVariables.x0;
+        solver.initializeSolver = acado_initializeSolver;
+        solver.preparationStep = acado_preparationStep;
+        solver.feedbackStep = acado_feedbackStep;
+        solver.shiftStates = acado_shiftStates;
+        solver.shiftControls = acado_shiftControls;
+        solver.resetMemory = resetDefaultSolverMemory;
+        return solver;
+      }
+    }  // namespace
+
     MPCControllerAcadoROS::MPCControllerAcadoROS()
+    : acado_prepared_(false),
+      active_solver_(0),
+      candidate_solver_(0),
+      candidate_cycles_(0),
+      use_solver_bank_(false)
     {
     }
 
@@ -64,6 +111,11 @@ namespace vox_nav_control
       parent->declare_parameter(plugin_name + ".params_configured", false);
       parent->declare_parameter(plugin_name + ".max_obstacles", 1);
       parent->declare_parameter(plugin_name + ".full_ackerman", false);
+      parent->declare_parameter(plugin_name + ".rti", false);
+      parent->declare_parameter(plugin_name + ".solver_bank", false);
+      parent->declare_parameter(plugin_name + ".solver_bank_preview_distance", 4.0);
+      parent->declare_parameter(plugin_name + ".solver_bank_max_heading_step", 0.2);
+      parent->declare_parameter(plugin_name + ".solver_bank_switch_cycles", 10);
 
       parent->get_parameter("global_plan_look_ahead_distance", global_plan_look_ahead_distance_);
       parent->get_parameter("ref_traj_se2_space", selected_se2_space_name_);
@@ -89,6 +141,14 @@ namespace vox_nav_control
       parent->get_parameter(plugin_name + ".params_configured", mpc_parameters_.params_configured);
       parent->get_parameter(plugin_name + ".max_obstacles", mpc_parameters_.max_obstacles);
       parent->get_parameter(plugin_name + ".full_ackerman", mpc_parameters_.full_ackerman);
+      parent->get_parameter(plugin_name + ".rti", mpc_parameters_.rti);
+      parent->get_parameter(plugin_name + ".solver_bank", use_solver_bank_);
+      parent->get_parameter(
+        plugin_name + ".solver_bank_preview_distance", solver_bank_preview_distance_);
+      parent->get_parameter(
+        plugin_name + ".solver_bank_max_heading_step", solver_bank_max_heading_step_);
+      parent->get_parameter(
+        plugin_name + ".solver_bank_switch_cycles", solver_bank_switch_cycles_);
 
       interpolated_local_reference_traj_publisher_ =
         parent->create_publisher<visualization_msgs::msg::MarkerArray>(
@@ -102,6 +162,29 @@ namespace vox_nav_control
         "/vox_nav/tracking/objects", rclcpp::SystemDefaultsQoS(),
         std::bind(&MPCControllerAcadoROS::obstacleTracksCallback, this, std::placeholders::_1));
 
+      // Solver in auto_gen is the default one, bank solvers are optional alternatives
+      solvers_.clear();
+      solvers_.push_back(getDefaultSolver(mpc_parameters_.DT));
+      if (use_solver_bank_) {
+        for (auto && solver : getAcadoSolverBank()) {
+          RCLCPP_INFO(
+            parent_->get_logger(), "ACADO solver bank entry %s, N %d, DT %.3f",
+            solver.name.c_str(), solver.N, solver.DT);
+          solvers_.push_back(solver);
+        }
+        if (solvers_.size() < 2) {
+          RCLCPP_WARN(
+            parent_->get_logger(), "solver_bank is set but no solver bank was built, "
+            "generate one with solver_bank_N and solver_bank_DT");
+        }
+      }
+      solver_ = solvers_[0];
+      active_solver_ = 0;
+      candidate_solver_ = 0;
+      candidate_cycles_ = 0;
+      // horizon of local reference has to match the solver
+      mpc_parameters_.N = solver_.N;
+
       //Sets initial states, inputs to zeros and makes solver ready
       initAcadoStuff();
 
@@ -152,11 +235,21 @@ namespace vox_nav_control
       curr_states.psi = robot_psi;
       curr_states.v = curr_robot_speed;
 
+      if (solvers_.size() > 1) {
+        int nearest_state_index = reference_path_.nearestStateIndex(curr_robot_pose);
+        selectSolver(
+          computed_velocity_.linear.x,
+          reference_path_.maxCurvature(nearest_state_index, global_plan_look_ahead_distance_),
+          curr_states);
+      }
+
       // We will interpolate mpc_parameters_.N traj points in the look ahead distance
-      std::vector<vox_nav_control::common::States> local_interpolated_reference_states =
-        getLocalInterpolatedReferenceStates(
-        curr_robot_pose, mpc_parameters_, reference_traj_,
-        global_plan_look_ahead_distance_, state_space_information_);
+      std::vector<vox_nav_control::common::States> & local_interpolated_reference_states =
+        local_reference_states_;
+      vox_nav_control::common::getLocalInterpolatedReferenceStates(
+        curr_robot_pose, mpc_parameters_, reference_path_,
+        global_plan_look_ahead_distance_, state_space_information_,
+        local_interpolated_reference_states);
 
       // There is a limit of number of obstacles we can handle,
       // There will be always a fixed amount of obstacles
@@ -177,15 +270,29 @@ namespace vox_nav_control
       // update current states
       updateCurrentStates(curr_states);
 
-      // prepare acado for a step
-      acado_preparationStep();
-      auto ret = acado_feedbackStep();
+      // prepare acado for a step, in RTI mode this was done after previous command was sent
+      auto start = std::chrono::high_resolution_clock::now();
+      if (!mpc_parameters_.rti || !acado_prepared_) {
+        solver_.preparationStep();
+      }
+      acado_prepared_ = false;
+      auto ret = solver_.feedbackStep();
+      auto end = std::chrono::high_resolution_clock::now();
+      feedback_latency_.add(std::chrono::duration<double, std::milli>(end - start).count());
+      RCLCPP_INFO_THROTTLE(
+        parent_->get_logger(), *parent_->get_clock(), 2000,
+        "ACADO %s feedback %s, preparation %s", mpc_parameters_.rti ? "RTI" : "SQP",
+        feedback_latency_.summary().c_str(), preparation_latency_.summary().c_str());
 
       // if debug mode print predicted states and controls from acado
       if (mpc_parameters_.debug_mode) {
-        std::cout << "Return code from acado_feedbackStep(): " << ret << std::endl;
-        acado_printDifferentialVariables();
-        acado_printControlVariables();
+        std::cout << "Return code from acado_feedbackStep() of " << solver_.name << ": " << ret <<
+          std::endl;
+        // print functions are only available for solver in auto_gen
+        if (active_solver_ == 0) {
+          acado_printDifferentialVariables();
+          acado_printControlVariables();
+        }
       }
 
       // now lets retrieve computed controls and apply
@@ -203,8 +310,7 @@ namespace vox_nav_control
         RCLCPP_WARN(parent_->get_logger(), "NAN or Invalid Control outputs from Acado!");
         // Reset The Controller
         // Reset all solver memory
-        memset(&acadoWorkspace, 0, sizeof(acadoWorkspace));
-        memset(&acadoVariables, 0, sizeof(acadoVariables));
+        solver_.resetMemory();
         initAcadoStuff();
         initAcadoWeights();
         // reset all control inputs as they are invalid
@@ -222,8 +328,8 @@ namespace vox_nav_control
         setRefrenceStates(
           local_interpolated_reference_states, trimmed_N_obstacles, computed_controls);
         updateCurrentStates(curr_states);
-        acado_preparationStep();
-        acado_feedbackStep();
+        solver_.preparationStep();
+        solver_.feedbackStep();
       }
 
       //  The control output is acceleration but we need to publish speed
@@ -293,10 +399,12 @@ namespace vox_nav_control
       curr_states.psi = robot_psi;
       curr_states.v = curr_robot_speed;   // ????
 
-      std::vector<vox_nav_control::common::States> local_interpolated_reference_states =
-        getLocalInterpolatedReferenceStates(
-        curr_robot_pose, mpc_parameters_, reference_traj_,
-        global_plan_look_ahead_distance_, state_space_information_);
+      std::vector<vox_nav_control::common::States> & local_interpolated_reference_states =
+        local_reference_states_;
+      vox_nav_control::common::getLocalInterpolatedReferenceStates(
+        curr_robot_pose, mpc_parameters_, reference_path_,
+        global_plan_look_ahead_distance_, state_space_information_,
+        local_interpolated_reference_states);
 
       std::lock_guard<std::mutex> guard(obstacle_tracks_mutex_);
       vox_nav_msgs::msg::ObjectArray trimmed_N_obstacles =
@@ -310,15 +418,20 @@ namespace vox_nav_control
         previous_control_);
       updateCurrentStates(curr_states);
 
-      acado_preparationStep();
-      auto ret = acado_feedbackStep();
+      solver_.preparationStep();
+      acado_prepared_ = false;
+      auto ret = solver_.feedbackStep();
 
       auto obstacles = trackMsg2Ellipsoids(obstacle_tracks_);
 
       if (mpc_parameters_.debug_mode) {
-        std::cout << "Return code from acado_feedbackStep(): " << ret << std::endl;
-        acado_printDifferentialVariables();
-        acado_printControlVariables();
+        std::cout << "Return code from acado_feedbackStep() of " << solver_.name << ": " << ret <<
+          std::endl;
+        // print functions are only available for solver in auto_gen
+        if (active_solver_ == 0) {
+          acado_printDifferentialVariables();
+          acado_printControlVariables();
+        }
       }
 
       std::vector<vox_nav_control::common::ControlInput> computed_controls =
@@ -335,8 +448,7 @@ namespace vox_nav_control
         RCLCPP_WARN(parent_->get_logger(), "NAN or Invalid Control outputs from Acado!");
         // Reset The Controller
         // Reset all solver memory
-        memset(&acadoWorkspace, 0, sizeof(acadoWorkspace));
-        memset(&acadoVariables, 0, sizeof(acadoVariables));
+        solver_.resetMemory();
         initAcadoStuff();
         initAcadoWeights();
         // reset all control inputs as they are invalid
@@ -354,8 +466,8 @@ namespace vox_nav_control
         setRefrenceStates(
           local_interpolated_reference_states, trimmed_N_obstacles, computed_controls);
         updateCurrentStates(curr_states);
-        acado_preparationStep();
-        acado_feedbackStep();
+        solver_.preparationStep();
+        solver_.feedbackStep();
       }
 
       //  The control output is acceleration but we need to publish speed
@@ -382,6 +494,26 @@ namespace vox_nav_control
     void MPCControllerAcadoROS::setPlan(const nav_msgs::msg::Path & path)
     {
       reference_traj_ = path;
+      reference_path_.setPath(path);
+      acado_prepared_ = false;
+      feedback_latency_.reset();
+      preparation_latency_.reset();
+    }
+
+    void MPCControllerAcadoROS::prepareNextCycle()
+    {
+      if (!mpc_parameters_.rti) {
+        return;
+      }
+      auto start = std::chrono::high_resolution_clock::now();
+      // previous solution shifted by one step is linearization point of next QP, last interval
+      // is repeated. References and obstacles are the ones of last cycle
+      solver_.shiftStates(2, nullptr, nullptr);
+      solver_.shiftControls(nullptr);
+      solver_.preparationStep();
+      acado_prepared_ = true;
+      auto end = std::chrono::high_resolution_clock::now();
+      preparation_latency_.add(std::chrono::duration<double, std::milli>(end - start).count());
     }
 
     void MPCControllerAcadoROS::obstacleTracksCallback(
@@ -428,30 +560,115 @@ namespace vox_nav_control
     void MPCControllerAcadoROS::initAcadoStuff()
     {
       // Initialize the solver.
-      acado_initializeSolver();
+      solver_.initializeSolver();
       // Initialize the states and controls.
-      for (int i = 0; i < ACADO_NX * (ACADO_N + 1); ++i) {
-        acadoVariables.x[i] = 0.0;
-      }
-      for (int i = 0; i < ACADO_NU * ACADO_N; ++i) {
-        acadoVariables.u[i] = 0.0;
+      for (int i = 0; i < solver_.NX * (solver_.N + 1); ++i) {
+        solver_.x[i] = 0.0;
       }
-      for (int i = 0; i < ACADO_NY * ACADO_N; ++i) {
-        acadoVariables.y[i] = 0.0;
+      for (int i = 0; i < solver_.NU * solver_.N; ++i) {
+        solver_.u[i] = 0.0;
       }
-      for (int i = 0; i < ACADO_NYN; ++i) {
-        acadoVariables.yN[i] = 0.0;
+      for (int i = 0; i < solver_.NY * solver_.N; ++i) {
+        solver_.y[i] = 0.0;
       }
-      for (int i = 0; i < ACADO_N; i++) {
-        previous_control_.push_back(vox_nav_control::common::ControlInput());
+      for (int i = 0; i < solver_.NYN; ++i) {
+        solver_.yN[i] = 0.0;
       }
+      previous_control_.assign(solver_.N, vox_nav_control::common::ControlInput());
 
-      for (size_t i = 0; i < ACADO_NOD * (ACADO_N + 1); i++) {
-        acadoVariables.od[i] = 0.0;
+      for (int i = 0; i < solver_.NOD * (solver_.N + 1); i++) {
+        solver_.od[i] = 0.0;
       }
 
       // Prepare first step
-      acado_preparationStep();
+      solver_.preparationStep();
+    }
+
+    void MPCControllerAcadoROS::selectSolver(
+      double speed, double curvature, const vox_nav_control::common::States & curr_states)
+    {
+      // horizon should span preview distance at current speed, robot is assumed to move at
+      // least at a tenth of V_MAX so that the requirement stays finite
+      speed = std::max(std::abs(speed), 0.1 * mpc_parameters_.V_MAX);
+      const double required_horizon = solver_bank_preview_distance_ / speed;
+      // reference heading should not turn more than max heading step within one DT
+      double max_dt = std::numeric_limits<double>::max();
+      if (curvature > 0.0) {
+        max_dt = solver_bank_max_heading_step_ / (speed * curvature);
+      }
+      double min_dt = std::numeric_limits<double>::max();
+      for (auto && solver : solvers_) {
+        min_dt = std::min(min_dt, solver.DT);
+      }
+      max_dt = std::max(max_dt, min_dt);
+
+      // shortest N that covers required horizon, otherwise longest horizon
+      int selected = -1;
+      for (int i = 0; i < static_cast<int>(solvers_.size()); i++) {
+        const auto & solver = solvers_[i];
+        if (solver.DT > max_dt + 1e-9) {
+          continue;
+        }
+        if (selected < 0) {
+          selected = i;
+          continue;
+        }
+        const auto & best = solvers_[selected];
+        double horizon = solver.N * solver.DT;
+        double best_horizon = best.N * best.DT;
+        bool covers = horizon >= required_horizon;
+        bool best_covers = best_horizon >= required_horizon;
+        if (covers && !best_covers) {
+          selected = i;
+        } else if (covers && best_covers) {
+          if (solver.N < best.N || (solver.N == best.N && horizon > best_horizon)) {
+            selected = i;
+          }
+        } else if (!covers && !best_covers && horizon > best_horizon) {
+          selected = i;
+        }
+      }
+
+      // switch only once same solver has been selected for a while
+      if (selected < 0 || selected == active_solver_) {
+        candidate_cycles_ = 0;
+        return;
+      }
+      if (selected != candidate_solver_) {
+        candidate_solver_ = selected;
+        candidate_cycles_ = 0;
+      }
+      if (++candidate_cycles_ < solver_bank_switch_cycles_) {
+        return;
+      }
+      RCLCPP_INFO(
+        parent_->get_logger(),
+        "Switching ACADO solver %s -> %s, speed %.2f m/s, curvature %.3f 1/m",
+        solver_.name.c_str(), solvers_[selected].name.c_str(), speed, curvature);
+      activateSolver(selected, curr_states);
+      candidate_cycles_ = 0;
+    }
+
+    void MPCControllerAcadoROS::activateSolver(
+      int index, const vox_nav_control::common::States & curr_states)
+    {
+      solver_ = solvers_[index];
+      active_solver_ = index;
+      mpc_parameters_.N = solver_.N;
+      mpc_parameters_.DT = solver_.DT;
+
+      // memory of this solver is stale since it was last active
+      solver_.resetMemory();
+      initAcadoStuff();
+      initAcadoWeights();
+      // start from current state instead of zeros
+      for (int i = 0; i < solver_.N + 1; i++) {
+        solver_.x[i * solver_.NX + vox_nav_control::common::STATE_ENUM::kX] = curr_states.x;
+        solver_.x[i * solver_.NX + vox_nav_control::common::STATE_ENUM::kY] = curr_states.y;
+        solver_.x[i * solver_.NX + vox_nav_control::common::STATE_ENUM::kPsi] = curr_states.psi;
+        solver_.x[i * solver_.NX + vox_nav_control::common::STATE_ENUM::kV] = curr_states.v;
+      }
+      acado_prepared_ = false;
     }
 
     void MPCControllerAcadoROS::initAcadoWeights()
@@ -464,20 +681,20 @@ namespace vox_nav_control
       double w_acc = mpc_parameters_.R[vox_nav_control::common::INPUT_ENUM::kacc];
       double w_df = mpc_parameters_.R[vox_nav_control::common::INPUT_ENUM::kdf];
 
-      acadoVariables.WN[0 + ACADO_NYN * 0] = w_x;
-      acadoVariables.WN[1 + ACADO_NYN * 1] = w_y;
-      acadoVariables.WN[2 + ACADO_NYN * 2] = w_yaw;
-      acadoVariables.WN[3 + ACADO_NYN * 3] = w_vel;
+      solver_.WN[0 + solver_.NYN * 0] = w_x;
+      solver_.WN[1 + solver_.NYN * 1] = w_y;
+      solver_.WN[2 + solver_.NYN * 2] = w_yaw;
+      solver_.WN[3 + solver_.NYN * 3] = w_vel;
 
-      for (int i = 0; i < ACADO_N; i++) {
+      for (int i = 0; i < solver_.N; i++) {
         // Setup diagonal entries
-        acadoVariables.W[ACADO_NY * ACADO_NY * i + (ACADO_NY + 1) * 0] = w_x;
-        acadoVariables.W[ACADO_NY * ACADO_NY * i + (ACADO_NY + 1) * 1] = w_y;
-        acadoVariables.W[ACADO_NY * ACADO_NY * i + (ACADO_NY + 1) * 2] = w_yaw;
-        acadoVariables.W[ACADO_NY * ACADO_NY * i + (ACADO_NY + 1) * 3] = w_vel;
-        acadoVariables.W[ACADO_NY * ACADO_NY * i + (ACADO_NY + 1) * 4] = w_acc;
-        acadoVariables.W[ACADO_NY * ACADO_NY * i + (ACADO_NY + 1) * 5] = w_df;
-        acadoVariables.W[ACADO_NY * ACADO_NY * i + (ACADO_NY + 1) * 6] = w_obs;
+        solver_.W[solver_.NY * solver_.NY * i + (solver_.NY + 1) * 0] = w_x;
+        solver_.W[solver_.NY * solver_.NY * i + (solver_.NY + 1) * 1] = w_y;
+        solver_.W[solver_.NY * solver_.NY * i + (solver_.NY + 1) * 2] = w_yaw;
+        solver_.W[solver_.NY * solver_.NY * i + (solver_.NY + 1) * 3] = w_vel;
+        solver_.W[solver_.NY * solver_.NY * i + (solver_.NY + 1) * 4] = w_acc;
+        solver_.W[solver_.NY * solver_.NY * i + (solver_.NY + 1) * 5] = w_df;
+        solver_.W[solver_.NY * solver_.NY * i + (solver_.NY + 1) * 6] = w_obs;
       }
     }
 
@@ -486,55 +703,55 @@ namespace vox_nav_control
       const vox_nav_msgs::msg::ObjectArray & obstacle_tracks,
       const std::vector<vox_nav_control::common::ControlInput> & prev_controls)
     {
-      for (int i = 0; i < ACADO_NY * ACADO_N; ++i) {
-        int state = i % ACADO_NY;
-        int index = i / ACADO_NY;
+      for (int i = 0; i < solver_.NY * solver_.N; ++i) {
+        int state = i % solver_.NY;
+        int index = i / solver_.NY;
         if (state == vox_nav_control::common::STATE_ENUM::kX) {
-          acadoVariables.y[i] = ref_states[index].x;
+          solver_.y[i] = ref_states[index].x;
         } else if (state == vox_nav_control::common::STATE_ENUM::kY) {
-          acadoVariables.y[i] = ref_states[index].y;
+          solver_.y[i] = ref_states[index].y;
         } else if (state == vox_nav_control::common::STATE_ENUM::kPsi) {
-          acadoVariables.y[i] = ref_states[index].psi;
+          solver_.y[i] = ref_states[index].psi;
         } else if (state == vox_nav_control::common::STATE_ENUM::kV) {
-          acadoVariables.y[i] = ref_states[index].v;
+          solver_.y[i] = ref_states[index].v;
         } else if (state == 4) {
-          acadoVariables.y[i] = prev_controls.begin()->acc;
+          solver_.y[i] = prev_controls.begin()->acc;
         } else if (state == 5) {
-          acadoVariables.y[i] = prev_controls.begin()->df;
+          solver_.y[i] = prev_controls.begin()->df;
         }
       }
 
       // Set the Terminal Reference
-      for (int i = 0; i < ACADO_NYN; ++i) {
+      for (int i = 0; i < solver_.NYN; ++i) {
         auto index = ref_states.size() - 1;
         if (i == vox_nav_control::common::STATE_ENUM::kX) {
-          acadoVariables.yN[i] = ref_states[index].x;
+          solver_.yN[i] = ref_states[index].x;
         } else if (i == vox_nav_control::common::STATE_ENUM::kY) {
-          acadoVariables.yN[i] = ref_states[index].y;
+          solver_.yN[i] = ref_states[index].y;
         } else if (i == vox_nav_control::common::STATE_ENUM::kPsi) {
-          acadoVariables.yN[i] = ref_states[index].psi;
+          solver_.yN[i] = ref_states[index].psi;
         } else if (i == vox_nav_control::common::STATE_ENUM::kV) {
-          acadoVariables.yN[i] = ref_states[index].v;
+          solver_.yN[i] = ref_states[index].v;
         }
       }
 
       // Set the obstacles , Ellipeses
-      for (int i = 0; i < (ACADO_N + 1); ++i) {
+      for (int i = 0; i < (solver_.N + 1); ++i) {
         for (int o = 0; o < obstacle_tracks.objects.size(); o++) {
-          int h_index = (i * ACADO_NOD) + (4 * o + 0);
-          int k_index = (i * ACADO_NOD) + (4 * o + 1);
-          int a_index = (i * ACADO_NOD) + (4 * o + 2);
-          int b_index = (i * ACADO_NOD) + (4 * o + 3);
-          acadoVariables.od[h_index] = obstacle_tracks.objects[o].world_pose.point.x;
-          acadoVariables.od[k_index] = obstacle_tracks.objects[o].world_pose.point.y;
-          acadoVariables.od[a_index] = obstacle_tracks.objects[o].length;
-          acadoVariables.od[b_index] = obstacle_tracks.objects[o].width;
+          int h_index = (i * solver_.NOD) + (4 * o + 0);
+          int k_index = (i * solver_.NOD) + (4 * o + 1);
+          int a_index = (i * solver_.NOD) + (4 * o + 2);
+          int b_index = (i * solver_.NOD) + (4 * o + 3);
+          solver_.od[h_index] = obstacle_tracks.objects[o].world_pose.point.x;
+          solver_.od[k_index] = obstacle_tracks.objects[o].world_pose.point.y;
+          solver_.od[a_index] = obstacle_tracks.objects[o].length;
+          solver_.od[b_index] = obstacle_tracks.objects[o].width;
         }
       }
 
       /*for (size_t i = 0; i < 17; i++) {
         for (size_t j = 0; j < 12; j++) {
-          std::cout << acadoVariables.od[(i * 12 ) + j] << " ";
+          std::cout << solver_.od[(i * 12 ) + j] << " ";
         }
         std::cout << std::endl;
       }*/
@@ -544,24 +761,24 @@ namespace vox_nav_control
     void MPCControllerAcadoROS::updateCurrentStates(vox_nav_control::common::States curr_states)
     {
       // MPC: set the current state feedback
-      acadoVariables.x0[0] = curr_states.x;
-      acadoVariables.x0[1] = curr_states.y;
-      acadoVariables.x0[2] = curr_states.psi;
-      acadoVariables.x0[3] = curr_states.v;
+      solver_.x0[0] = curr_states.x;
+      solver_.x0[1] = curr_states.y;
+      solver_.x0[2] = curr_states.psi;
+      solver_.x0[3] = curr_states.v;
     }
 
     std::vector<vox_nav_control::common::ControlInput> MPCControllerAcadoROS::
     getPredictedControlsFromAcado()
     {
       std::vector<vox_nav_control::common::ControlInput> computed_controls;
-      real_t * u = acado_getVariablesU();
-      for (int i = 0; i < ACADO_N; ++i) {
+      double * u = solver_.u;
+      for (int i = 0; i < solver_.N; ++i) {
         vox_nav_control::common::ControlInput curr;
-        for (int j = 0; j < ACADO_NU; ++j) {
+        for (int j = 0; j < solver_.NU; ++j) {
           if (j == 0) {
-            curr.acc = (double)u[i * ACADO_NU + j];
+            curr.acc = (double)u[i * solver_.NU + j];
           } else {
-            curr.df = (double)u[i * ACADO_NU + j];
+            curr.df = (double)u[i * solver_.NU + j];
           }
         }
         computed_controls.push_back(curr);
@@ -572,19 +789,19 @@ namespace vox_nav_control
     std::vector<vox_nav_control::common::States> MPCControllerAcadoROS::getPredictedStatesFromAcado()
     {
       std::vector<vox_nav_control::common::States> computed_states;
-      real_t * x = acado_getVariablesX();
-      for (int i = 0; i < ACADO_N; ++i) {
+      double * x = solver_.x;
+      for (int i = 0; i < solver_.N; ++i) {
         vox_nav_control::common::States curr;
-        for (int j = 0; j < ACADO_NX; ++j) {
+        for (int j = 0; j < solver_.NX; ++j) {
 
           if (j == vox_nav_control::common::STATE_ENUM::kX) {
-            curr.x = (double)x[i * ACADO_NX + j];
+            curr.x = (double)x[i * solver_.NX + j];
           } else if (j == vox_nav_control::common::STATE_ENUM::kY) {
-            curr.y = (double)x[i * ACADO_NX + j];
+            curr.y = (double)x[i * solver_.NX + j];
           } else if (j == vox_nav_control::common::STATE_ENUM::kPsi) {
-            curr.psi = (double)x[i * ACADO_NX + j];
+            curr.psi = (double)x[i * solver_.NX + j];
           } else {
-            curr.v = (double)x[i * ACADO_NX + j];
+            curr.v = (double)x[i * solver_.NX + j];
           }
         }
         computed_states.push_back(curr);
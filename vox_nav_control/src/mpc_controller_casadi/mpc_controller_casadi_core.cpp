@@ -18,7 +18,19 @@
 
 #include <vox_nav_control/mpc_controller_casadi/mpc_controller_casadi_core.hpp>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <memory>
+#include <random>
+#include <string>
+#include <system_error>
 #include <vector>
 
 namespace vox_nav_control
@@ -30,6 +42,8 @@ namespace vox_nav_control
     {
 
       initial_solution_found_ = false;
+      has_previous_solution_ = false;
+      rti_prepared_ = false;
       params_ = params;
       opti_ = std::make_shared<casadi::Opti>();
 
@@ -69,6 +83,16 @@ namespace vox_nav_control
       sl_acc_dv_ = sl_dv_(slice_all_, 0);
       sl_df_dv_ = sl_dv_(slice_all_, 1);
 
+      // numeric values of parameters and initial guesses, kept next to Opti's own copies as
+      // compiled solver is called without Opti
+      curr_states_ = casadi::DM::zeros(4, 1);
+      u_prev_value_ = casadi::DM::zeros(2, 1);
+      z_ref_value_ = casadi::DM::zeros(params_.N, 4);
+      z_obs_value_ = casadi::DM::zeros(params_.max_obstacles, 5);
+      z_init_value_ = casadi::DM::zeros(params_.N + 1, 4);
+      u_init_value_ = casadi::DM::zeros(params_.N, 2);
+      sl_init_value_ = casadi::DM::zeros(params_.N, 2);
+
       // Add cost and constraints to optimal control problem
       addConstraints();
       addCost(params_.Q, params_.R);
@@ -89,26 +113,12 @@ namespace vox_nav_control
         mock_reference_state);
       updateReferences(mock_reference_states);
 
-      // Initialize actual states in horizon and set them all to zeros
-      vox_nav_control::common::States initial_actual_state;
-      std::vector<vox_nav_control::common::States> initial_actual_states(params_.N + 1,
-        initial_actual_state);
-      initializeActualStates(initial_actual_states);
-
       // Kind of a test, just set previous control inputs to zeros
       vox_nav_control::common::ControlInput previous_control_input;
       updatePreviousControlInput(previous_control_input);
 
-      // initiazlize actual control inputs , all zeros
-      vox_nav_control::common::ControlInput initial_actual_control_input;
-      std::vector<vox_nav_control::common::ControlInput> initial_actual_control_inputs(params_.N,
-        initial_actual_control_input);
-      initializeActualControlInputs(initial_actual_control_inputs);
-
-      // Initialize slack variables, set them to zeros
-      SlackVars slack_vars;
-      std::vector<SlackVars> initial_slack_vars(params_.N, slack_vars);
-      initializeSlackVars(initial_slack_vars);
+      // Initialize actual states, control inputs and slack variables in horizon, all zeros
+      setDefaultInitialGuess();
 
       // set print level to zeros.
       casadi::Dict opts = {
@@ -118,25 +128,34 @@ namespace vox_nav_control
         {"print_time", false}};
 
       opti_->solver("ipopt", opts);
+      if (params_.rti && !setupRTI()) {
+        std::cerr << "MPC CONTROL: Could not set up RTI, solving to convergence." << std::endl;
+      }
+      if (params_.codegen && rti_qp_solver_.is_null() && !setupCompiledSolver(opts)) {
+        std::cerr << "MPC CONTROL: Could not set up compiled solver, solving through Opti." <<
+          std::endl;
+      }
+      if (params_.warm_start && rti_qp_solver_.is_null() && !setupWarmSolver(opts)) {
+        std::cerr << "MPC CONTROL: Could not set up warm started solver, warm starting only " <<
+          "primal variables." << std::endl;
+      }
 
       // This needs to be called at least once , then we can retrieve opti->debug() information
       std::vector<vox_nav_control::common::Ellipsoid> no_obstackles;
       solve(no_obstackles);
+      // solution of this mock problem is not a useful initial guess for real one
+      resetWarmStart();
 
       if (params_.debug_mode) {
         std::cout << "State Weight Matrix Q_: \n" << Q_ << std::endl;
         std::cout << "Control Weight Matrix R_: \n" << R_ << std::endl;
-        std::cout << "Initial States z_curr_: \n" << opti_->debug().value(z_curr_) << std::endl;
-        std::cout << "Initial Refernce Traj states z_ref_: \n" << opti_->debug().value(z_ref_) <<
-          std::endl;
-        std::cout << "Initial Obstacles z_obs_: \n" << opti_->debug().value(z_obs_) <<
-          std::endl;
-        std::cout << "Initial Actual Traj states z_dv_: \n" << opti_->debug().value(z_dv_) <<
-          std::endl;
-        std::cout << "Initial Control inputs u_dv_: \n" << opti_->debug().value(u_dv_) << std::endl;
-        std::cout << "Previous Control inputs u_prev_: \n" << opti_->debug().value(u_prev_) <<
-          std::endl;
-        std::cout << "Initial Slack Vars sl_dv_: \n" << opti_->debug().value(sl_dv_) << std::endl;
+        std::cout << "Initial States z_curr_: \n" << curr_states_ << std::endl;
+        std::cout << "Initial Refernce Traj states z_ref_: \n" << z_ref_value_ << std::endl;
+        std::cout << "Initial Obstacles z_obs_: \n" << z_obs_value_ << std::endl;
+        std::cout << "Initial Actual Traj states z_dv_: \n" << z_init_value_ << std::endl;
+        std::cout << "Initial Control inputs u_dv_: \n" << u_init_value_ << std::endl;
+        std::cout << "Previous Control inputs u_prev_: \n" << u_prev_value_ << std::endl;
+        std::cout << "Initial Slack Vars sl_dv_: \n" << sl_init_value_ << std::endl;
         std::cout << "Constructed MPC controller instance." << std::endl;
       }
       if (!params_.params_configured) {
@@ -152,8 +171,29 @@ namespace vox_nav_control
 
     void MPCControllerCasadiCore::addConstraints()
     {
+      // Rows added since last call belong to given number of consecutive horizon steps with
+      // same number of rows each. Multiplier of a row is taken from same row one step later
+      // on warm start, last step repeats itself
+      lam_g_shift_index_.clear();
+      auto add_shift_index = [this](int steps) {
+          steps = std::max(1, steps);
+          const casadi_int begin = lam_g_shift_index_.size();
+          const casadi_int rows = opti_->ng() - begin;
+          const casadi_int rows_per_step = rows / steps;
+          // rows not evenly split over steps are kept in place
+          const bool shift = rows_per_step > 0 && rows_per_step * steps == rows;
+          for (casadi_int r = 0; r < rows; r++) {
+            if (shift && r / rows_per_step + 1 < steps) {
+              lam_g_shift_index_.push_back(begin + r + rows_per_step);
+            } else {
+              lam_g_shift_index_.push_back(begin + r);
+            }
+          }
+        };
+
       //  State Bound Constraints
       opti_->subject_to(opti_->bounded(params_.V_MIN, v_dv_, params_.V_MAX));
+      add_shift_index(params_.N + 1);
 
 
       // state dynamics constraints
@@ -180,15 +220,19 @@ namespace vox_nav_control
           v_dv_(i) + params_.DT * acc_dv_(i));
 
       }
+      add_shift_index(params_.N);
 
       //  Input Bound Constraints
       opti_->subject_to(opti_->bounded(params_.A_MIN, acc_dv_, params_.A_MAX));
+      add_shift_index(params_.N);
       opti_->subject_to(opti_->bounded(params_.DF_MIN, df_dv_, params_.DF_MAX));
+      add_shift_index(params_.N);
 
       opti_->subject_to(x_dv_(0) == z_curr_(0));
       opti_->subject_to(y_dv_(0) == z_curr_(1));
       opti_->subject_to(psi_dv_(0) == z_curr_(2));
       opti_->subject_to(v_dv_(0) == z_curr_(3));
+      add_shift_index(1);
 
       //  Input Rate Bound Constraints
       opti_->subject_to(
@@ -216,10 +260,13 @@ namespace vox_nav_control
             df_dv_(i + 1) - df_dv_(i),
             params_.DF_DOT_MAX * params_.DT + sl_df_dv_(i + 1)));
       }
+      add_shift_index(params_.N);
 
       //  Other Constraints
       opti_->subject_to(0 <= sl_df_dv_);
+      add_shift_index(params_.N);
       opti_->subject_to(0 <= sl_acc_dv_);
+      add_shift_index(params_.N);
 
 
     }
@@ -249,6 +296,7 @@ namespace vox_nav_control
       }
       // slack cost
       cost += (casadi::MX::sum1(sl_df_dv_) + casadi::MX::sum1(sl_acc_dv_));
+      quadratic_cost_ = cost;
 
       casadi::MX obstacle_cost = 0.0;
       for (int o = 0; o < params_.max_obstacles; o++) {
@@ -274,27 +322,67 @@ namespace vox_nav_control
       const std::vector<vox_nav_control::common::Ellipsoid> & obstacles)
     {
       bool is_solution_optimal(false);
+      const bool use_rti = !rti_qp_solver_.is_null();
+      bool is_warm_started = (params_.warm_start || use_rti) && has_previous_solution_;
+      if (is_warm_started && !use_rti) {
+        setWarmStart();
+      }
 
       auto start = std::chrono::high_resolution_clock::now();
-      casadi::native_DM u_mpc, z_mpc, sl_mpc, z_ref;
-      try {
-        auto sol = opti_->solve();
-        u_mpc = sol.value(u_dv_);
-        z_mpc = sol.value(z_dv_);
-        sl_mpc = sol.value(sl_dv_);
-        z_ref = sol.value(z_ref_);
-        is_solution_optimal = true;
+      casadi::native_DM u_mpc, z_mpc, sl_mpc, lam_g;
+      casadi::Dict stats;
+      if (use_rti) {
+        // only feedback phase if prepare() was called after last solve
+        if (!rti_prepared_) {
+          prepare();
+        }
+        is_solution_optimal = solveRTI(z_mpc, u_mpc, sl_mpc, lam_g);
+        stats = rti_qp_solver_.stats();
+        rti_prepared_ = false;
+      } else if (is_warm_started && !warm_solver_.is_null()) {
+        is_solution_optimal = solveNlp(warm_solver_, true, z_mpc, u_mpc, sl_mpc, lam_g);
+        stats = warm_solver_.stats();
+      } else if (compiled_solver_.is_null()) {
+        try {
+          auto sol = opti_->solve();
+          u_mpc = sol.value(u_dv_);
+          z_mpc = sol.value(z_dv_);
+          sl_mpc = sol.value(sl_dv_);
+          lam_g = sol.value(opti_->lam_g());
+          is_solution_optimal = true;
+        } catch (const std::exception & e) {
+          u_mpc = opti_->debug().value(u_dv_);
+          z_mpc = opti_->debug().value(z_dv_);
+          sl_mpc = opti_->debug().value(sl_dv_);
+        }
+        stats = opti_->stats();
+      } else {
+        is_solution_optimal = solveNlp(
+          compiled_solver_, is_warm_started, z_mpc, u_mpc, sl_mpc, lam_g);
+        stats = compiled_solver_.stats();
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      double execution_time = std::chrono::duration<double, std::milli>(end - start).count();
+
+      if (is_solution_optimal) {
         initial_solution_found_ = true;
-      } catch (const std::exception & e) {
+        if (params_.warm_start || use_rti) {
+          previous_z_mpc_ = z_mpc;
+          previous_u_mpc_ = u_mpc;
+          previous_sl_mpc_ = sl_mpc;
+          previous_lam_g_ = lam_g;
+          has_previous_solution_ = true;
+        }
+      } else {
         std::cerr << "MPC CONTROL: NON OPTIMAL SOLUTION FOUND!" << '\n';
-        u_mpc = opti_->debug().value(u_dv_);
-        z_mpc = opti_->debug().value(z_dv_);
-        sl_mpc = opti_->debug().value(sl_dv_);
-        z_ref = opti_->debug().value(z_ref_);
+        // do not start next solve from a failed one
+        resetWarmStart();
+      }
+
+      int iterations = 0;
+      if (stats.count("iter_count")) {
+        iterations = stats.at("iter_count").to_int();
       }
-      auto end = std::chrono::high_resolution_clock::now();
-      auto execution_time =
-        std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
       // get actual_computed_states
       std::vector<vox_nav_control::common::States> actual_computed_states;
@@ -314,18 +402,19 @@ namespace vox_nav_control
       SolutionResult result;
       result.solve_time_ms = execution_time;
       result.is_optimal = is_solution_optimal;
+      result.is_warm_started = is_warm_started;
+      result.iterations = iterations;
       result.control_input = control_input;
       result.actual_computed_states = actual_computed_states;
 
       if (params_.debug_mode) {
-        std::cout << "Current States z_curr_: \n " << opti_->debug().value(z_curr_) << std::endl;
-        std::cout << "Refernce Traj states z_ref_: \n" << opti_->debug().value(z_ref_) <<
-          std::endl;
-        std::cout << "Actual Traj states z_dv_: \n" << opti_->debug().value(z_dv_) << std::endl;
-        std::cout << "Control inputs u_dv_: \n" << opti_->debug().value(u_dv_) << std::endl;
-        std::cout << "Previous Control inputs u_prev_: \n" << opti_->debug().value(u_prev_) <<
-          std::endl;
-        std::cout << "Solve took: " << execution_time << " ms" << std::endl;
+        std::cout << "Current States z_curr_: \n " << curr_states_ << std::endl;
+        std::cout << "Refernce Traj states z_ref_: \n" << z_ref_value_ << std::endl;
+        std::cout << "Actual Traj states z_dv_: \n" << z_mpc << std::endl;
+        std::cout << "Control inputs u_dv_: \n" << u_mpc << std::endl;
+        std::cout << "Previous Control inputs u_prev_: \n" << u_prev_value_ << std::endl;
+        std::cout << "Solve took: " << execution_time << " ms, " << iterations << " iterations" <<
+          (is_warm_started ? " (warm started)" : "") << std::endl;
         std::cout << "acceleration cmd " << result.control_input.acc << std::endl;
         std::cout << "steering angle " << result.control_input.df << std::endl;
       }
@@ -333,9 +422,360 @@ namespace vox_nav_control
       return result;
     }
 
+    void MPCControllerCasadiCore::resetWarmStart()
+    {
+      has_previous_solution_ = false;
+      rti_prepared_ = false;
+      previous_lam_g_ = casadi::DM();
+      lam_g_init_value_ = casadi::DM();
+      // Opti keeps initial values of last solve, start next one from same guess as first solve
+      setDefaultInitialGuess();
+      opti_->set_initial(opti_->lam_g(), casadi::DM::zeros(opti_->ng(), 1));
+    }
+
+    void MPCControllerCasadiCore::setDefaultInitialGuess()
+    {
+      vox_nav_control::common::States initial_actual_state;
+      std::vector<vox_nav_control::common::States> initial_actual_states(params_.N + 1,
+        initial_actual_state);
+      initializeActualStates(initial_actual_states);
+
+      vox_nav_control::common::ControlInput initial_actual_control_input;
+      std::vector<vox_nav_control::common::ControlInput> initial_actual_control_inputs(params_.N,
+        initial_actual_control_input);
+      initializeActualControlInputs(initial_actual_control_inputs);
+
+      SlackVars slack_vars;
+      std::vector<SlackVars> initial_slack_vars(params_.N, slack_vars);
+      initializeSlackVars(initial_slack_vars);
+    }
+
+    double MPCControllerCasadiCore::prepare()
+    {
+      if (rti_qp_solver_.is_null()) {
+        return 0.0;
+      }
+      auto start = std::chrono::high_resolution_clock::now();
+      try {
+        // linearize around previous solution shifted by one step, or on a cold start around
+        // current state held over the horizon, linearizing at origin gives a poor first QP
+        if (has_previous_solution_) {
+          setWarmStart();
+        } else if (curr_states_.numel() == 4) {
+          for (int i = 0; i < params_.N + 1; i++) {
+            z_init_value_(i, slice_all_) = curr_states_.T();
+          }
+        }
+        rti_x_lin_ = pack_x_function_(
+          std::vector<casadi::DM>{z_init_value_, u_init_value_, sl_init_value_}).at(0);
+        rti_jac_g_ =
+          rti_jac_g_function_(std::vector<casadi::DM>{rti_x_lin_, packParameters()}).at(0);
+        rti_prepared_ = true;
+      } catch (const std::exception & e) {
+        std::cerr << "MPC CONTROL: " << e.what() << std::endl;
+        rti_prepared_ = false;
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    void MPCControllerCasadiCore::setWarmStart()
+    {
+      // shift one step ahead, last step is repeated
+      casadi::DM z_init = previous_z_mpc_;
+      casadi::DM u_init = previous_u_mpc_;
+      casadi::DM sl_init = previous_sl_mpc_;
+      for (int i = 0; i < params_.N; i++) {
+        z_init(i, slice_all_) = previous_z_mpc_(i + 1, slice_all_);
+      }
+      for (int i = 0; i < params_.N - 1; i++) {
+        u_init(i, slice_all_) = previous_u_mpc_(i + 1, slice_all_);
+        sl_init(i, slice_all_) = previous_sl_mpc_(i + 1, slice_all_);
+      }
+      // first state is constrained to current state anyways
+      z_init(0, slice_all_) = curr_states_.T();
+
+      // multipliers are shifted one step ahead like primal variables, see addConstraints
+      std::vector<double> previous_lam_g = previous_lam_g_.get_elements();
+      if (lam_g_shift_index_.size() == previous_lam_g.size()) {
+        std::vector<double> lam_g_init(previous_lam_g.size());
+        for (size_t r = 0; r < lam_g_init.size(); r++) {
+          lam_g_init[r] = previous_lam_g[lam_g_shift_index_[r]];
+        }
+        lam_g_init_value_ = casadi::DM(lam_g_init);
+      } else {
+        lam_g_init_value_ = previous_lam_g_;
+      }
+
+      z_init_value_ = z_init;
+      u_init_value_ = u_init;
+      sl_init_value_ = sl_init;
+      if (!warm_solver_.is_null() || !compiled_solver_.is_null() || !rti_qp_solver_.is_null()) {
+        // warm started, compiled and RTI solvers take these and lam_g_init_value_ directly
+        return;
+      }
+      opti_->set_initial(z_dv_, z_init);
+      opti_->set_initial(u_dv_, u_init);
+      opti_->set_initial(sl_dv_, sl_init);
+      opti_->set_initial(opti_->lam_g(), lam_g_init_value_);
+    }
+
+    bool MPCControllerCasadiCore::setupCompiledSolver(const casadi::Dict & opts)
+    {
+      namespace fs = std::filesystem;
+      try {
+        casadi::Function oracle = nlpOracle();
+        setupNlpFunctions();
+
+        // The library is named after a hash of serialized NLP, so it is rebuilt whenever
+        // horizon, weights, limits or the problem formulation change
+        std::string serialized = oracle.serialize();
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : serialized) {
+          hash = (hash ^ c) * 1099511628211ULL;
+        }
+        char hash_hex[17];
+        std::snprintf(hash_hex, sizeof(hash_hex), "%016llx", static_cast<unsigned long long>(hash));
+        const std::string name = std::string("mpc_casadi_nlp_") + hash_hex;
+        const fs::path directory(params_.codegen_directory);
+        const fs::path library = directory / (name + ".so");
+
+        if (!fs::exists(library)) {
+          std::cout << "MPC CONTROL: Generating and compiling " << library << " ..." << std::endl;
+          fs::create_directories(directory);
+          casadi::Function solver = casadi::nlpsol("solver", "ipopt", oracle, opts);
+          // sources and library are built under names unique to this process and attempt, so
+          // that concurrent builds of same NLP never write the same files, and a failed one
+          // never leaves a broken library in cache. Only the atomic rename is shared
+          std::random_device random_device;
+          const std::string build_name = name + "_" + std::to_string(getpid()) + "_" +
+            std::to_string(random_device());
+          // oracle and its derivatives used by IPOPT (nlp_f, nlp_grad_f, nlp_jac_g, nlp_hess_l ...)
+          casadi::CodeGenerator generator(build_name + ".c");
+          generator.add(oracle);
+          for (auto && function_name : solver.get_function()) {
+            generator.add(solver.get_function(function_name));
+          }
+          generator.generate((directory / "").string());
+          const fs::path source = directory / (build_name + ".c");
+          const fs::path temporary = directory / (build_name + ".so.tmp");
+          // compiler is run without a shell, so paths need no quoting
+          std::vector<std::string> command =
+          {"gcc", "-fPIC", "-shared", "-O3", source.string(), "-o", temporary.string()};
+          std::vector<char *> argv;
+          for (auto && arg : command) {
+            argv.push_back(const_cast<char *>(arg.c_str()));
+          }
+          argv.push_back(nullptr);
+          bool compiled = false;
+          pid_t pid = fork();
+          if (pid == 0) {
+            execvp(argv[0], argv.data());
+            _exit(127);
+          } else if (pid > 0) {
+            int status = 0;
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+            }
+            compiled = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+          }
+          std::error_code error;
+          fs::remove(source, error);
+          if (!compiled) {
+            fs::remove(temporary, error);
+            std::cerr << "MPC CONTROL: Compilation of " << source << " failed" << std::endl;
+            return false;
+          }
+          fs::rename(temporary, library, error);
+          if (error) {
+            std::cerr << "MPC CONTROL: Could not move " << temporary << " to " << library <<
+              ": " << error.message() << std::endl;
+            fs::remove(temporary, error);
+            return false;
+          }
+        }
+
+        casadi::Dict compiled_opts = opts;
+        // external functions cannot be expanded
+        compiled_opts.erase("expand");
+        compiled_solver_ = casadi::nlpsol("solver", "ipopt", library.string(), compiled_opts);
+        compiled_library_ = library.string();
+        std::cout << "MPC CONTROL: Using compiled solver " << library << std::endl;
+      } catch (const std::exception & e) {
+        std::cerr << "MPC CONTROL: " << e.what() << std::endl;
+        compiled_solver_ = casadi::Function();
+        compiled_library_.clear();
+        return false;
+      }
+      return true;
+    }
+
+    bool MPCControllerCasadiCore::setupWarmSolver(const casadi::Dict & opts)
+    {
+      try {
+        casadi::Dict warm_opts = opts;
+        // use given primal and dual initial guess as is, with only small push from bounds
+        warm_opts["ipopt.warm_start_init_point"] = "yes";
+        warm_opts["ipopt.warm_start_bound_push"] = 1e-6;
+        warm_opts["ipopt.warm_start_slack_bound_push"] = 1e-6;
+        warm_opts["ipopt.warm_start_mult_bound_push"] = 1e-6;
+        warm_opts["ipopt.mu_init"] = 1e-3;
+        if (compiled_library_.empty()) {
+          setupNlpFunctions();
+          warm_solver_ = casadi::nlpsol("warm_solver", "ipopt", nlpOracle(), warm_opts);
+        } else {
+          // external functions cannot be expanded
+          warm_opts.erase("expand");
+          warm_solver_ = casadi::nlpsol("warm_solver", "ipopt", compiled_library_, warm_opts);
+        }
+      } catch (const std::exception & e) {
+        std::cerr << "MPC CONTROL: " << e.what() << std::endl;
+        warm_solver_ = casadi::Function();
+        return false;
+      }
+      return true;
+    }
+
+    casadi::Function MPCControllerCasadiCore::nlpOracle()
+    {
+      // Same NLP as Opti passes to its solver, variables and parameters are concatenated
+      // in order of declaration
+      casadi::MXDict nlp = {
+        {"x", opti_->x()}, {"p", opti_->p()}, {"f", opti_->f()}, {"g", opti_->g()}};
+      return casadi::Function("nlp", nlp, {"x", "p"}, {"f", "g"}).expand();
+    }
+
+    void MPCControllerCasadiCore::setupNlpFunctions()
+    {
+      pack_x_function_ = casadi::Function("pack_x", {z_dv_, u_dv_, sl_dv_}, {opti_->x()});
+      unpack_x_function_ = casadi::Function("unpack_x", {opti_->x()}, {z_dv_, u_dv_, sl_dv_});
+      pack_p_function_ =
+        casadi::Function("pack_p", {u_prev_, z_curr_, z_ref_, z_obs_}, {opti_->p()});
+      bounds_function_ =
+        casadi::Function("bounds", {opti_->p()}, {opti_->lbg(), opti_->ubg()});
+    }
+
+    casadi::DM MPCControllerCasadiCore::packParameters()
+    {
+      return pack_p_function_(
+        std::vector<casadi::DM>{u_prev_value_, curr_states_, z_ref_value_, z_obs_value_}).at(0);
+    }
+
+    bool MPCControllerCasadiCore::setupRTI()
+    {
+      try {
+        setupNlpFunctions();
+        casadi::MX x = opti_->x();
+        casadi::MX p = opti_->p();
+        rti_jac_g_function_ = casadi::Function(
+          "rti_jac_g", {x, p}, {casadi::MX::jacobian(opti_->g(), x)}).expand();
+        rti_residual_function_ = casadi::Function(
+          "rti_residual", {x, p}, {opti_->g(), casadi::MX::gradient(opti_->f(), x)}).expand();
+
+        // Hessian of tracking, input rate and slack costs is constant. Curvature of obstacle
+        // cost and dynamics is dropped (Gauss-Newton like), they enter through gradient and
+        // Jacobian only, which keeps the QP convex
+        casadi::Function hessian(
+          "rti_hessian", {x, p}, {casadi::MX::hessian(quadratic_cost_, x)});
+        rti_hessian_ = hessian(
+          std::vector<casadi::DM>{
+            casadi::DM::zeros(x.size1(), 1), casadi::DM::zeros(p.size1(), 1)}).at(0) +
+          1e-6 * casadi::DM::eye(x.size1());
+
+        casadi::Dict qp_opts = {{"error_on_fail", false}};
+        if (params_.rti_qp_solver == "qrqp") {
+          qp_opts["print_iter"] = false;
+          qp_opts["print_header"] = false;
+        } else if (params_.rti_qp_solver == "osqp") {
+          qp_opts["osqp"] = casadi::Dict({{"verbose", false}});
+        }
+        rti_qp_solver_ = casadi::conic(
+          "rti_qp", params_.rti_qp_solver,
+          {{"h", rti_hessian_.sparsity()}, {"a", rti_jac_g_function_.sparsity_out(0)}},
+          qp_opts);
+        std::cout << "MPC CONTROL: Using RTI with " << params_.rti_qp_solver << std::endl;
+      } catch (const std::exception & e) {
+        std::cerr << "MPC CONTROL: " << e.what() << std::endl;
+        rti_qp_solver_ = casadi::Function();
+        return false;
+      }
+      return true;
+    }
+
+    bool MPCControllerCasadiCore::solveRTI(
+      casadi::DM & z_mpc, casadi::DM & u_mpc, casadi::DM & sl_mpc, casadi::DM & lam_g)
+    {
+      try {
+        // residuals depend on current state, references and obstacles, so they are the only
+        // functions evaluated after new state has arrived
+        casadi::DM p = packParameters();
+        std::vector<casadi::DM> residual =
+          rti_residual_function_(std::vector<casadi::DM>{rti_x_lin_, p});
+        std::vector<casadi::DM> bounds = bounds_function_(std::vector<casadi::DM>{p});
+        casadi::DMDict arg = {
+          {"h", rti_hessian_},
+          {"g", residual.at(1)},
+          {"a", rti_jac_g_},
+          {"lba", bounds.at(0) - residual.at(0)},
+          {"uba", bounds.at(1) - residual.at(0)}};
+        if (has_previous_solution_) {
+          arg["lam_a0"] = lam_g_init_value_;
+        }
+        casadi::DMDict res = rti_qp_solver_(arg);
+        std::vector<casadi::DM> x =
+          unpack_x_function_(std::vector<casadi::DM>{rti_x_lin_ + res.at("x")});
+        z_mpc = x.at(0);
+        u_mpc = x.at(1);
+        sl_mpc = x.at(2);
+        lam_g = res.at("lam_a");
+        casadi::Dict stats = rti_qp_solver_.stats();
+        return stats.count("success") && stats.at("success").to_bool();
+      } catch (const std::exception & e) {
+        std::cerr << "MPC CONTROL: " << e.what() << std::endl;
+        z_mpc = z_init_value_;
+        u_mpc = u_init_value_;
+        sl_mpc = sl_init_value_;
+        return false;
+      }
+    }
+
+    bool MPCControllerCasadiCore::solveNlp(
+      const casadi::Function & solver, bool is_warm_started,
+      casadi::DM & z_mpc, casadi::DM & u_mpc, casadi::DM & sl_mpc, casadi::DM & lam_g)
+    {
+      try {
+        casadi::DM p = packParameters();
+        std::vector<casadi::DM> bounds = bounds_function_(std::vector<casadi::DM>{p});
+        casadi::DMDict arg = {
+          {"x0", pack_x_function_(
+              std::vector<casadi::DM>{z_init_value_, u_init_value_, sl_init_value_}).at(0)},
+          {"p", p},
+          {"lbg", bounds.at(0)},
+          {"ubg", bounds.at(1)}};
+        if (is_warm_started) {
+          arg["lam_g0"] = lam_g_init_value_;
+        }
+        casadi::DMDict res = solver(arg);
+        std::vector<casadi::DM> x = unpack_x_function_(std::vector<casadi::DM>{res.at("x")});
+        z_mpc = x.at(0);
+        u_mpc = x.at(1);
+        sl_mpc = x.at(2);
+        lam_g = res.at("lam_g");
+        casadi::Dict stats = solver.stats();
+        return stats.count("success") && stats.at("success").to_bool();
+      } catch (const std::exception & e) {
+        std::cerr << "MPC CONTROL: " << e.what() << std::endl;
+        z_mpc = z_init_value_;
+        u_mpc = u_init_value_;
+        sl_mpc = sl_init_value_;
+        return false;
+      }
+    }
+
     void MPCControllerCasadiCore::updateCurrentStates(vox_nav_control::common::States curr_states)
     {
-      opti_->set_value(z_curr_, {curr_states.x, curr_states.y, curr_states.psi, curr_states.v});
+      curr_states_ = casadi::DM(
+        std::vector<double>({curr_states.x, curr_states.y, curr_states.psi, curr_states.v}));
+      opti_->set_value(z_curr_, curr_states_);
     }
 
     void MPCControllerCasadiCore::updateReferences(
@@ -352,6 +792,10 @@ namespace vox_nav_control
       opti_->set_value(y_ref_, y_ref);
       opti_->set_value(psi_ref_, psi_ref);
       opti_->set_value(v_ref_, v_ref);
+      z_ref_value_(slice_all_, 0) = casadi::DM(x_ref);
+      z_ref_value_(slice_all_, 1) = casadi::DM(y_ref);
+      z_ref_value_(slice_all_, 2) = casadi::DM(psi_ref);
+      z_ref_value_(slice_all_, 3) = casadi::DM(v_ref);
     }
 
     void MPCControllerCasadiCore::updateObstacles(
@@ -371,12 +815,19 @@ namespace vox_nav_control
       opti_->set_value(a_obs_, a);
       opti_->set_value(b_obs_, b);
       opti_->set_value(angle_obs_, angle);
+      z_obs_value_(slice_all_, 0) = casadi::DM(i);
+      z_obs_value_(slice_all_, 1) = casadi::DM(h);
+      z_obs_value_(slice_all_, 2) = casadi::DM(a);
+      z_obs_value_(slice_all_, 3) = casadi::DM(b);
+      z_obs_value_(slice_all_, 4) = casadi::DM(angle);
     }
 
     void MPCControllerCasadiCore::updatePreviousControlInput(
       vox_nav_control::common::ControlInput previous_control_input)
     {
-      opti_->set_value(u_prev_, {previous_control_input.acc, previous_control_input.df});
+      u_prev_value_ = casadi::DM(
+        std::vector<double>({previous_control_input.acc, previous_control_input.df}));
+      opti_->set_value(u_prev_, u_prev_value_);
     }
 
     void MPCControllerCasadiCore::initializeSlackVars(
@@ -389,6 +840,8 @@ namespace vox_nav_control
       }
       opti_->set_initial(sl_dv_(slice_all_, 0), sl_acc_dv);
       opti_->set_initial(sl_dv_(slice_all_, 1), sl_df_dv);
+      sl_init_value_(slice_all_, 0) = casadi::DM(sl_acc_dv);
+      sl_init_value_(slice_all_, 1) = casadi::DM(sl_df_dv);
     }
 
     void MPCControllerCasadiCore::initializeActualControlInputs(
@@ -401,6 +854,8 @@ namespace vox_nav_control
       }
       opti_->set_initial(u_dv_(slice_all_, 0), initial_acc_dv);
       opti_->set_initial(u_dv_(slice_all_, 1), initial_df_dv);
+      u_init_value_(slice_all_, 0) = casadi::DM(initial_acc_dv);
+      u_init_value_(slice_all_, 1) = casadi::DM(initial_df_dv);
     }
 
     void MPCControllerCasadiCore::initializeActualStates(
@@ -417,6 +872,10 @@ namespace vox_nav_control
       opti_->set_initial(y_dv_, y_dv);
       opti_->set_initial(psi_dv_, psi_dv);
       opti_->set_initial(v_dv_, v_dv);
+      z_init_value_(slice_all_, 0) = casadi::DM(x_dv);
+      z_init_value_(slice_all_, 1) = casadi::DM(y_dv);
+      z_init_value_(slice_all_, 2) = casadi::DM(psi_dv);
+      z_init_value_(slice_all_, 3) = casadi::DM(v_dv);
     }
 
   }   // namespace mpc_controller_casadi
@@ -16,6 +16,7 @@
 #include <vox_nav_control/mpc_controller_casadi/mpc_controller_casadi_ros.hpp>
 #include <pluginlib/class_list_macros.hpp>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <string>
@@ -60,6 +61,12 @@ namespace vox_nav_control
       parent->declare_parameter(plugin_name + ".params_configured", false);
       parent->declare_parameter(plugin_name + ".max_obstacles", 1);
       parent->declare_parameter(plugin_name + ".obstacle_cost", 1.0);
+      parent->declare_parameter(plugin_name + ".warm_start", true);
+      parent->declare_parameter(plugin_name + ".codegen", false);
+      parent->declare_parameter(
+        plugin_name + ".codegen_directory", mpc_parameters_.codegen_directory);
+      parent->declare_parameter(plugin_name + ".rti", false);
+      parent->declare_parameter(plugin_name + ".rti_qp_solver", mpc_parameters_.rti_qp_solver);
 
 
       parent->get_parameter("global_plan_look_ahead_distance", global_plan_look_ahead_distance_);
@@ -86,6 +93,12 @@ namespace vox_nav_control
       parent->get_parameter(plugin_name + ".params_configured", mpc_parameters_.params_configured);
       parent->get_parameter(plugin_name + ".max_obstacles", mpc_parameters_.max_obstacles);
       parent->get_parameter(plugin_name + ".obstacle_cost", mpc_parameters_.obstacle_cost);
+      parent->get_parameter(plugin_name + ".warm_start", mpc_parameters_.warm_start);
+      parent->get_parameter(plugin_name + ".codegen", mpc_parameters_.codegen);
+      parent->get_parameter(
+        plugin_name + ".codegen_directory", mpc_parameters_.codegen_directory);
+      parent->get_parameter(plugin_name + ".rti", mpc_parameters_.rti);
+      parent->get_parameter(plugin_name + ".rti_qp_solver", mpc_parameters_.rti_qp_solver);
 
 
       interpolated_local_reference_traj_publisher_ =
@@ -137,10 +150,12 @@ namespace vox_nav_control
       curr_states.psi = robot_psi;
       curr_states.v = 0.0;
 
-      std::vector<vox_nav_control::common::States> local_interpolated_reference_states =
-        vox_nav_control::common::getLocalInterpolatedReferenceStates(
-        curr_robot_pose, mpc_parameters_, reference_traj_,
-        global_plan_look_ahead_distance_, state_space_information_);
+      std::vector<vox_nav_control::common::States> & local_interpolated_reference_states =
+        local_reference_states_;
+      vox_nav_control::common::getLocalInterpolatedReferenceStates(
+        curr_robot_pose, mpc_parameters_, reference_path_,
+        global_plan_look_ahead_distance_, state_space_information_,
+        local_interpolated_reference_states);
 
       // There is a limit of number of obstacles we can handle,
       // There will be always a fixed amount of obstacles
@@ -159,6 +174,7 @@ namespace vox_nav_control
       auto obstacles = trackMsg2Ellipsoids(trimmed_N_obstacles, curr_robot_pose);
       mpc_controller_->updateObstacles(obstacles);
       MPCControllerCasadiCore::SolutionResult res = mpc_controller_->solve(obstacles);
+      reportSolveStats(res);
 
       // distance from rear to front axle(m)
       double rear_axle_tofront_dist = mpc_parameters_.L_R + mpc_parameters_.L_F;
@@ -203,10 +219,12 @@ namespace vox_nav_control
       curr_states.psi = robot_psi;
       curr_states.v = 0.0;
 
-      std::vector<vox_nav_control::common::States> local_interpolated_reference_states =
-        vox_nav_control::common::getLocalInterpolatedReferenceStates(
-        curr_robot_pose, mpc_parameters_, reference_traj_,
-        global_plan_look_ahead_distance_, state_space_information_);
+      std::vector<vox_nav_control::common::States> & local_interpolated_reference_states =
+        local_reference_states_;
+      vox_nav_control::common::getLocalInterpolatedReferenceStates(
+        curr_robot_pose, mpc_parameters_, reference_path_,
+        global_plan_look_ahead_distance_, state_space_information_,
+        local_interpolated_reference_states);
 
       mpc_controller_->updateCurrentStates(curr_states);
       mpc_controller_->updateReferences(local_interpolated_reference_states);
@@ -215,6 +233,7 @@ namespace vox_nav_control
       std::lock_guard<std::mutex> guard(obstacle_tracks_mutex_);
       auto obstacles = trackMsg2Ellipsoids(obstacle_tracks_, curr_robot_pose);
       MPCControllerCasadiCore::SolutionResult res = mpc_controller_->solve(obstacles);
+      reportSolveStats(res);
 
       computed_velocity_.linear.x = 0;
       computed_velocity_.angular.z += res.control_input.df * (mpc_parameters_.DT);
@@ -229,6 +248,39 @@ namespace vox_nav_control
     void MPCControllerCasadiROS::setPlan(const nav_msgs::msg::Path & path)
     {
       reference_traj_ = path;
+      reference_path_.setPath(path);
+      mpc_controller_->resetWarmStart();
+      solve_stats_ = SolveStats();
+      feedback_latency_.reset();
+      preparation_latency_.reset();
+    }
+
+    void MPCControllerCasadiROS::prepareNextCycle()
+    {
+      if (mpc_parameters_.rti) {
+        preparation_latency_.add(mpc_controller_->prepare());
+      }
+    }
+
+    void MPCControllerCasadiROS::reportSolveStats(
+      const MPCControllerCasadiCore::SolutionResult & res)
+    {
+      solve_stats_.cycles++;
+      solve_stats_.total_iterations += res.iterations;
+      solve_stats_.warm_started_cycles += res.is_warm_started;
+      feedback_latency_.add(res.solve_time_ms);
+
+      RCLCPP_DEBUG(
+        parent_->get_logger(), "MPC solve: %d iterations, %.3f ms, %s, %s",
+        res.iterations, res.solve_time_ms, res.is_warm_started ? "warm" : "cold",
+        res.is_optimal ? "optimal" : "not optimal");
+      RCLCPP_INFO_THROTTLE(
+        parent_->get_logger(), *parent_->get_clock(), 2000,
+        "MPC solve over %d cycles (%d warm started): mean %.1f iterations, "
+        "feedback %s, preparation %s",
+        solve_stats_.cycles, solve_stats_.warm_started_cycles,
+        static_cast<double>(solve_stats_.total_iterations) / solve_stats_.cycles,
+        feedback_latency_.summary().c_str(), preparation_latency_.summary().c_str());
     }
 
     void MPCControllerCasadiROS::obstacleTracksCallback(
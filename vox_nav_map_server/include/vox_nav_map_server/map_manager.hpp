@@ -35,9 +35,13 @@
 #include <robot_localization/srv/from_ll.hpp>
 #include <vox_nav_msgs/msg/oriented_nav_sat_fix.hpp>
 #include <vox_nav_msgs/srv/get_maps_and_surfels.hpp>
+#include <vox_nav_msgs/srv/get_octomap.hpp>
+#include <vox_nav_msgs/srv/get_point_cloud.hpp>
 #include <vox_nav_utilities/pcl_helpers.hpp>
 #include <vox_nav_utilities/tf_helpers.hpp>
 #include <vox_nav_utilities/map_manager_helpers.hpp>
+#include <vox_nav_utilities/octree_builder.hpp>
+#include <vox_nav_utilities/map_region.hpp>
 #include <octomap_msgs/msg/octomap.hpp>
 #include <octomap_msgs/conversions.h>
 #include <octomap/octomap.h>
@@ -54,6 +58,7 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <future>
 
 /**
  * @brief namespace for vox_nav map server. The map server reads map from disk.
@@ -140,13 +145,37 @@ namespace vox_nav_map_server
     void timerCallback();
 
     /**
-     * @brief Given PCD Map's GPS coordinate and heading,
-     * this method aligns PCD Map to robots initial coordinates,
+     * @brief Map frame independent part of map configuration, run in a worker thread
+     * from construction on. Loads PCD Map, rotates it by heading of datum,
+     * preprocesses it and regresses costs.
+     *
+     */
+    void prepareMap();
+
+    /**
+     * @brief Given PCD Map's GPS coordinate, waits for /fromLL to get datum position in
+     * "map" frame published by robot_localization, and broadcasts static_map frame.
+     *
+     * @return geometry_msgs::msg::Point
+     */
+    geometry_msgs::msg::Point requestMapDatumPosition();
+
+    /**
+     * @brief Given datum position in map frame, this method aligns prepared PCD Map,
+     * elevated surfels and their poses to robots initial coordinates,
      * thats basically "map" frame published by robot_localization.
      * One must think PCD Map as a static map.
      *
+     * @param datum_position
+     */
+    void transfromPCDfromGPS2Map(const geometry_msgs::msg::Point & datum_position);
+
+    /**
+     * @brief Given georeferenced elevated surfels, constructs their octomap,
+     * its message and markers
+     *
      */
-    void transfromPCDfromGPS2Map();
+    void handleElevatedSurfelOctomap();
 
     /**
      * @brief Given preprocessed and cost regressed point cloud of PCD Map
@@ -165,10 +194,21 @@ namespace vox_nav_map_server
      */
     void regressCosts();
 
+    /**
+     * @brief Build one CostOcTree holding both the cost regressed pcd map and the elevated
+     * surfels, cost and class of each voxel is kept in dedicated node fields instead of
+     * log odds. Elevated surfels keep resolution of their own octree (octomap_voxel_size / 4),
+     * map voxels are set at octomap_voxel_size. No planner reads this tree yet.
+     *
+     * @return std::shared_ptr<vox_nav_utilities::CostOcTree>
+     */
+    std::shared_ptr<vox_nav_utilities::CostOcTree> buildCostOctree();
+
     /**
    * @brief once map is georefenced, this function
    *  is called from timerCallback to publish map related visuals
-   *  e.g point cloud, octomap markers etc
+   *  e.g point cloud, octomap markers etc. With latch_map_visuals
+   *  visuals are published only once per map version
    *
    */
     void publishMapVisuals();
@@ -194,11 +234,101 @@ namespace vox_nav_map_server
       const std::shared_ptr<vox_nav_msgs::srv::GetMapsAndSurfels::Request> request,
       std::shared_ptr<vox_nav_msgs::srv::GetMapsAndSurfels::Response> response);
 
+    /**
+     * @brief Service callback to provide original octomap, cropped to region of interest
+     * of request if it has one
+     *
+     * @param request_header
+     * @param request
+     * @param response
+     */
+    void getOctomapCallback(
+      const std::shared_ptr<rmw_request_id_t> request_header,
+      const std::shared_ptr<vox_nav_msgs::srv::GetOctomap::Request> request,
+      std::shared_ptr<vox_nav_msgs::srv::GetOctomap::Response> response);
+
+    /**
+     * @brief Service callback to provide cost regressed pcd map cloud, cropped to region of
+     * interest of request if it has one and downsampled to leaf_size if it is positive
+     *
+     * @param request_header
+     * @param request
+     * @param response
+     */
+    void getPointCloudCallback(
+      const std::shared_ptr<rmw_request_id_t> request_header,
+      const std::shared_ptr<vox_nav_msgs::srv::GetPointCloud::Request> request,
+      std::shared_ptr<vox_nav_msgs::srv::GetPointCloud::Response> response);
+
+    /**
+     * @brief Path in export_directory to store filename of a map request at
+     *
+     * @param filename
+     * @param path
+     * @return true
+     * @return false if filename is empty, export_directory is not set or filename is
+     * absolute or contains ".."
+     */
+    bool resolveExportPath(const std::string & filename, std::string & path);
+
+    /**
+     * @brief Region of interest of a map request, all map requests share bounding box and
+     * corridor fields
+     *
+     * @tparam RequestT
+     * @param request
+     * @return vox_nav_utilities::MapRegion
+     */
+    template<typename RequestT>
+    vox_nav_utilities::MapRegion regionFromRequest(const RequestT & request) const
+    {
+      vox_nav_utilities::MapRegion region;
+      region.setBox(
+        request.bounding_box_origin.x, request.bounding_box_origin.y,
+        request.bounding_box_origin.z,
+        request.bounding_box_lengths.x, request.bounding_box_lengths.y,
+        request.bounding_box_lengths.z);
+      for (auto && p : request.corridor_points) {
+        region.corridor.push_back(octomap::point3d(p.x, p.y, p.z));
+      }
+      region.corridor_radius = request.corridor_radius;
+      return region;
+    }
+
+    /**
+     * @brief Serialize tree to msg, the same way full maps are serialized
+     *
+     * @tparam TreeT
+     * @param tree
+     * @param msg
+     * @return true
+     * @return false if conversion throws
+     */
+    template<typename TreeT>
+    bool octreeToMsg(const TreeT & tree, octomap_msgs::msg::Octomap & msg)
+    {
+      try {
+        octomap_msgs::fullMapToMsg<TreeT>(tree, msg);
+        msg.binary = false;
+        msg.resolution = tree.getResolution();
+        msg.header.frame_id = map_frame_id_;
+        msg.header.stamp = this->now();
+      } catch (const std::exception & e) {
+        RCLCPP_ERROR(
+          get_logger(), "Exception while converting octomap %s:", e.what());
+        return false;
+      }
+      return true;
+    }
+
   protected:
     // Used to call a periodic callback function IOT publish octomap visuals
     rclcpp::TimerBase::SharedPtr timer_;
     // Service to provide Octomap, elevated surfel and elevated surfel poses
     rclcpp::Service<vox_nav_msgs::srv::GetMapsAndSurfels>::SharedPtr get_maps_and_surfels_service_;
+    // Services to provide original octomap and pcd map cloud, optionally in a region of interest
+    rclcpp::Service<vox_nav_msgs::srv::GetOctomap>::SharedPtr get_octomap_service_;
+    rclcpp::Service<vox_nav_msgs::srv::GetPointCloud>::SharedPtr get_pointcloud_service_;
     // publishes octomap in form of a point cloud message
     rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr octomap_pointloud_publisher_;
     // publishes octomap in form of a point cloud message
@@ -208,6 +338,8 @@ namespace vox_nav_map_server
     // publish sampled node poses for planner to use.
     rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr
       elevated_surfel_octomap_markers_publisher_;
+    // publishes a decimated copy of map cloud, only created if lod_cloud.enabled
+    rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr octomap_pointloud_lod_publisher_;
     // robot_localization package provides a service to convert
     // lat,long,al GPS cooordinates to x,y,z map points
     rclcpp::Client<robot_localization::srv::FromLL>::SharedPtr robot_localization_fromLL_client_;
@@ -217,6 +349,8 @@ namespace vox_nav_map_server
     sensor_msgs::msg::PointCloud2::SharedPtr octomap_pointcloud_msg_;
     // reusable octomap point loud message, dont need to recreate each time we publish
     sensor_msgs::msg::PointCloud2::SharedPtr elevated_surfels_pointcloud_msg_;
+    // reusable level of detail cloud message, map cloud downsampled to lod_cloud_voxel_size_
+    sensor_msgs::msg::PointCloud2::SharedPtr octomap_pointcloud_lod_msg_;
     // reusable octomap marker array message, used to publish occupied nodes onlyu
     visualization_msgs::msg::MarkerArray::SharedPtr original_octomap_markers_msg_;
     // reusable octomap marker array message, used to publish occupied nodes onlyu
@@ -231,6 +365,15 @@ namespace vox_nav_map_server
     // it is also required to have orientation information of surfels, they are kept in
     // elevated_surfel_poses_msg_
     geometry_msgs::msg::PoseArray::SharedPtr elevated_surfel_poses_msg_;
+    // octrees behind the messages above, kept to extract regions of interest on request
+    std::shared_ptr<octomap::OcTree> original_octomap_octree_;
+    std::shared_ptr<octomap::OcTree> elevated_surfels_octomap_octree_;
+    std::shared_ptr<vox_nav_utilities::CostOcTree> cost_octree_;
+    // Optional single octree of pcd map and elevated surfels with per voxel cost and label
+    octomap_msgs::msg::Octomap::SharedPtr cost_octomap_msg_;
+    bool cost_octree_enabled_;
+    // filename of GetOctomap and GetPointCloud requests is relative to this, empty disables
+    std::string export_directory_;
     // we read gps coordinates of map from yaml
     vox_nav_msgs::msg::OrientedNavSatFix::SharedPtr pcd_map_gps_pose_;
     // otree object to read and store binary octomap from disk
@@ -255,8 +398,17 @@ namespace vox_nav_map_server
     int octomap_publish_frequency_;
     // rclcpp parameters from yaml file: if true, a cloud will be published which represents octomap
     bool publish_octomap_visuals_;
+    // rclcpp parameters from yaml file: if true, visuals are published with transient local
+    // durability and only when map changes, instead of each timer cycle
+    bool latch_map_visuals_;
+    // rclcpp parameters from yaml file: optional level of detail cloud for remote viewers
+    bool lod_cloud_enabled_;
+    double lod_cloud_voxel_size_;
+    std::string lod_cloud_topic_;
     // we need to align static map to map only once, since it is static !
     std::once_flag align_static_map_once_;
+    // worker running prepareMap, started in constructor
+    std::future<void> map_preparation_future_;
     // tf buffer to get access to transfroms
     std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
     std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
@@ -270,6 +422,9 @@ namespace vox_nav_map_server
     CostRegressionParams cost_params_;
     // hther map has beene configured yet
     volatile bool map_configured_;
+    // increased each time map is (re)configured, visuals are republished when it changes
+    uint64_t map_version_;
+    uint64_t published_map_version_;
   };
 }  // namespace vox_nav_map_server
 
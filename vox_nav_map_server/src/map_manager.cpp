@@ -18,21 +18,26 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <filesystem>
 
 namespace vox_nav_map_server
 {
   MapManager::MapManager()
   : Node("vox_nav_map_manager_rclcpp_node"),
-    map_configured_(false)
+    map_configured_(false),
+    map_version_(0),
+    published_map_version_(0)
   {
     RCLCPP_INFO(this->get_logger(), "Creating..");
     // initialize shared pointers asap
     pcd_map_gps_pose_ = std::make_shared<vox_nav_msgs::msg::OrientedNavSatFix>();
     original_octomap_msg_ = std::make_shared<octomap_msgs::msg::Octomap>();
     elevated_surfel_octomap_msg_ = std::make_shared<octomap_msgs::msg::Octomap>();
+    cost_octomap_msg_ = std::make_shared<octomap_msgs::msg::Octomap>();
     elevated_surfel_poses_msg_ = std::make_shared<geometry_msgs::msg::PoseArray>();
     octomap_pointcloud_msg_ = std::make_shared<sensor_msgs::msg::PointCloud2>();
     elevated_surfels_pointcloud_msg_ = std::make_shared<sensor_msgs::msg::PointCloud2>();
+    octomap_pointcloud_lod_msg_ = std::make_shared<sensor_msgs::msg::PointCloud2>();
     original_octomap_markers_msg_ = std::make_shared<visualization_msgs::msg::MarkerArray>();
     elevated_surfel_octomap_markers_msg_ = std::make_shared<visualization_msgs::msg::MarkerArray>();
     tf_buffer_ = std::make_shared<tf2_ros::Buffer>(this->get_clock());
@@ -46,6 +51,10 @@ namespace vox_nav_map_server
     declare_parameter("publish_octomap_visuals", true);
     declare_parameter("octomap_point_cloud_publish_topic", "octomap_pointcloud");
     declare_parameter("octomap_markers_publish_topic", "octomap_markers");
+    declare_parameter("latch_map_visuals", true);
+    declare_parameter("lod_cloud.enabled", false);
+    declare_parameter("lod_cloud.voxel_size", 1.0);
+    declare_parameter("lod_cloud.topic", "octomap_pointcloud_lod");
     declare_parameter("map_frame_id", "map");
     declare_parameter("utm_frame_id", "utm");
     declare_parameter("map_datum.latitude", 49.0);
@@ -77,6 +86,8 @@ namespace vox_nav_map_server
     declare_parameter("robot_mass", 0.1);
     declare_parameter("average_speed", 1.0);
     declare_parameter("cost_critic_weights", std::vector<double>({0.8, 0.1, 0.1}));
+    declare_parameter("cost_octree.enabled", false);
+    declare_parameter("export_directory", "");
 
     // get this node's parameters
     get_parameter("pcd_map_filename", pcd_map_filename_);
@@ -85,6 +96,10 @@ namespace vox_nav_map_server
     get_parameter("publish_octomap_visuals", publish_octomap_visuals_);
     get_parameter("octomap_point_cloud_publish_topic", octomap_point_cloud_publish_topic_);
     get_parameter("octomap_markers_publish_topic", octomap_markers_publish_topic_);
+    get_parameter("latch_map_visuals", latch_map_visuals_);
+    get_parameter("lod_cloud.enabled", lod_cloud_enabled_);
+    get_parameter("lod_cloud.voxel_size", lod_cloud_voxel_size_);
+    get_parameter("lod_cloud.topic", lod_cloud_topic_);
     get_parameter("map_frame_id", map_frame_id_);
     get_parameter("utm_frame_id", utm_frame_id_);
     get_parameter("map_datum.latitude", pcd_map_gps_pose_->position.latitude);
@@ -110,6 +125,8 @@ namespace vox_nav_map_server
     get_parameter("robot_mass", cost_params_.robot_mass);
     get_parameter("average_speed", cost_params_.average_speed);
     get_parameter("cost_critic_weights", cost_params_.cost_critic_weights);
+    get_parameter("cost_octree.enabled", cost_octree_enabled_);
+    get_parameter("export_directory", export_directory_);
     get_parameter("apply_filters", preprocess_params_.apply_filters);
     get_parameter(
       "pcd_map_downsample_voxel_size",
@@ -133,6 +150,27 @@ namespace vox_nav_map_server
         std::placeholders::_2,
         std::placeholders::_3));
 
+    // service hooks for region of interest queries of original octomap and pcd map
+    get_octomap_service_ = this->create_service
+      <vox_nav_msgs::srv::GetOctomap>(
+      std::string("get_octomap"),
+      std::bind(
+        &MapManager::getOctomapCallback,
+        this,
+        std::placeholders::_1,
+        std::placeholders::_2,
+        std::placeholders::_3));
+
+    get_pointcloud_service_ = this->create_service
+      <vox_nav_msgs::srv::GetPointCloud>(
+      std::string("get_pointcloud"),
+      std::bind(
+        &MapManager::getPointCloudCallback,
+        this,
+        std::placeholders::_1,
+        std::placeholders::_2,
+        std::placeholders::_3));
+
     // service hooks for robot localization fromll service
     robot_localization_fromLL_client_node_ = std::make_shared
       <rclcpp::Node>("map_manager_fromll_client_node");
@@ -146,24 +184,35 @@ namespace vox_nav_map_server
       std::chrono::milliseconds(static_cast<int>(1000 / octomap_publish_frequency_)),
       std::bind(&MapManager::timerCallback, this));
 
+    // Map is static, when latched visuals are published once per map version and kept by
+    // the publisher for late joining subscribers (e.g. rviz started after map server)
+    rclcpp::QoS visuals_qos = rclcpp::SystemDefaultsQoS();
+    if (latch_map_visuals_) {
+      visuals_qos = rclcpp::QoS(rclcpp::KeepLast(1)).reliable().transient_local();
+    }
+
     octomap_pointloud_publisher_ = this->create_publisher<sensor_msgs::msg::PointCloud2>(
-      octomap_point_cloud_publish_topic_, rclcpp::SystemDefaultsQoS());
+      octomap_point_cloud_publish_topic_, visuals_qos);
 
     elevated_surfel_pcl_publisher_ = this->create_publisher<sensor_msgs::msg::PointCloud2>(
-      "vox_nav/map_server/elevated_surfel_pointcloud", rclcpp::SystemDefaultsQoS());
+      "vox_nav/map_server/elevated_surfel_pointcloud", visuals_qos);
 
     octomap_markers_publisher_ = this->create_publisher<visualization_msgs::msg::MarkerArray>(
-      octomap_markers_publish_topic_, rclcpp::SystemDefaultsQoS());
+      octomap_markers_publish_topic_, visuals_qos);
 
     elevated_surfel_octomap_markers_publisher_ =
       this->create_publisher<visualization_msgs::msg::MarkerArray>(
-      "vox_nav/map_server/elevated_surfel_markers", rclcpp::SystemDefaultsQoS());
+      "vox_nav/map_server/elevated_surfel_markers", visuals_qos);
 
-    pcd_map_pointcloud_ = vox_nav_utilities::loadPointcloudFromPcd(pcd_map_filename_.c_str());
+    if (lod_cloud_enabled_) {
+      octomap_pointloud_lod_publisher_ = this->create_publisher<sensor_msgs::msg::PointCloud2>(
+        lod_cloud_topic_, visuals_qos);
+    }
 
-    RCLCPP_INFO(
-      this->get_logger(), "Loaded a PCD map with %d points",
-      pcd_map_pointcloud_->points.size());
+    // Work that does not depend on map datum position starts right away in a worker,
+    // overlapping with waiting for TF and /fromLL in timerCallback
+    map_preparation_future_ = std::async(
+      std::launch::async, &MapManager::prepareMap, this);
   }
 
   MapManager::~MapManager()
@@ -189,18 +238,49 @@ namespace vox_nav_map_server
           " But the map and octomap will be published at %i frequency rate",
           octomap_publish_frequency_);
 
-        transfromPCDfromGPS2Map();
-        preProcessPCDMap();
-        regressCosts();
+        auto datum_position = requestMapDatumPosition();
+        if (map_preparation_future_.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready)
+        {
+          RCLCPP_INFO(get_logger(), "Got map datum, waiting for map preparation to finish");
+        }
+        map_preparation_future_.get();
+        transfromPCDfromGPS2Map(datum_position);
+        handleElevatedSurfelOctomap();
         handleOriginalOctomap();
         RCLCPP_INFO(get_logger(), "Georeferenced given map, ready to publish");
 
+        map_version_++;
         map_configured_ = true;
       });
     publishMapVisuals();
   }
 
-  void MapManager::transfromPCDfromGPS2Map()
+  void MapManager::prepareMap()
+  {
+    pcd_map_pointcloud_ = vox_nav_utilities::loadPointcloudFromPcd(pcd_map_filename_.c_str());
+
+    RCLCPP_INFO(
+      this->get_logger(), "Loaded a PCD map with %d points",
+      pcd_map_pointcloud_->points.size());
+
+    // Orientation of datum comes from parameters, so map is rotated here and only the
+    // translation that depends on /fromLL is left to transfromPCDfromGPS2Map
+    tf2::Transform static_map_rotation;
+    static_map_rotation.setIdentity();
+    tf2::Quaternion static_map_quaternion;
+    tf2::fromMsg(pcd_map_gps_pose_->orientation, static_map_quaternion);
+    static_map_rotation.setRotation(static_map_quaternion);
+    pcl_ros::transformPointCloud(
+      *pcd_map_pointcloud_, *pcd_map_pointcloud_, static_map_rotation
+    );
+
+    preProcessPCDMap();
+    regressCosts();
+    RCLCPP_INFO(get_logger(), "Map is prepared, it will be georeferenced once datum is known");
+  }
+
+  geometry_msgs::msg::Point MapManager::requestMapDatumPosition()
   {
     auto request = std::make_shared<robot_localization::srv::FromLL::Request>();
     auto response = std::make_shared<robot_localization::srv::FromLL::Response>();
@@ -213,7 +293,7 @@ namespace vox_nav_map_server
         RCLCPP_ERROR(
           this->get_logger(),
           "Interrupted while waiting for the /fromLL service.Exiting");
-        return;
+        return response->map_point;
       }
       RCLCPP_INFO(
         this->get_logger(), "/fromLL service not available, waiting and trying again");
@@ -231,17 +311,6 @@ namespace vox_nav_map_server
     response->map_point = result->map_point;
 
     // The translation from static_map origin to map is basically inverse of this transform
-    tf2::Transform static_map_to_map_transfrom;
-    static_map_to_map_transfrom.setOrigin(
-      tf2::Vector3(
-        response->map_point.x,
-        response->map_point.y,
-        response->map_point.z));
-
-    tf2::Quaternion static_map_quaternion;
-    tf2::fromMsg(pcd_map_gps_pose_->orientation, static_map_quaternion);
-    static_map_to_map_transfrom.setRotation(static_map_quaternion);
-
     geometry_msgs::msg::TransformStamped stamped;
     stamped.child_frame_id = "static_map";
     stamped.header.frame_id = "map";
@@ -253,10 +322,30 @@ namespace vox_nav_map_server
     translation.z = response->map_point.z;
     stamped.transform.translation = translation;
     static_transform_broadcaster_->sendTransform(stamped);
+    return response->map_point;
+  }
 
-    pcl_ros::transformPointCloud(
-      *pcd_map_pointcloud_, *pcd_map_pointcloud_, static_map_to_map_transfrom
-    );
+  void MapManager::transfromPCDfromGPS2Map(const geometry_msgs::msg::Point & datum_position)
+  {
+    // In map frame datum translation comes before the optional rigid body transform of
+    // preProcessPCDMap, hence it is rotated by that transform
+    Eigen::Affine3f rigid_body_transform = vox_nav_utilities::getRigidBodyTransform(
+      pcd_map_transform_matrix_.translation_,
+      pcd_map_transform_matrix_.rpyIntrinsic_,
+      get_logger());
+    Eigen::Vector3f translation = rigid_body_transform.linear() *
+      Eigen::Vector3f(datum_position.x, datum_position.y, datum_position.z);
+    Eigen::Affine3f static_map_to_map_transfrom(Eigen::Translation3f(translation));
+
+    pcl::transformPointCloud(
+      *pcd_map_pointcloud_, *pcd_map_pointcloud_, static_map_to_map_transfrom);
+    pcl::transformPointCloud(
+      *elevated_surfel_pointcloud_, *elevated_surfel_pointcloud_, static_map_to_map_transfrom);
+    for (auto && pose : elevated_surfel_poses_msg_->poses) {
+      pose.position.x += translation.x();
+      pose.position.y += translation.y();
+      pose.position.z += translation.z();
+    }
   }
 
   void MapManager::preProcessPCDMap()
@@ -450,20 +539,29 @@ namespace vox_nav_map_server
         elevated_surfel_pointcloud_, preprocess_params_.pcd_map_downsample_voxel_size);
     }
 
-    octomap::Pointcloud surfel_octocloud;
-    for (auto && i : elevated_surfel_pointcloud_->points) {
-      surfel_octocloud.push_back(octomap::point3d(i.x, i.y, i.z));
-    }
-    auto elevated_surfels_octomap_octree = std::make_shared<octomap::OcTree>(
-      octomap_voxel_size_ / 4.0);
-    elevated_surfels_octomap_octree->insertPointCloud(surfel_octocloud, octomap::point3d(0, 0, 0));
+    cost_regressed_cloud += *pure_non_traversable_pcl;
+    *pcd_map_pointcloud_ = cost_regressed_cloud;
 
-    for (auto && i : elevated_surfel_pointcloud_->points) {
-      double cost_value =
-        static_cast<double>(i.b / 255.0) -
-        static_cast<double>(i.g / 255.0);
-      elevated_surfels_octomap_octree->setNodeValue(i.x, i.y, i.z, std::max(0.0, cost_value));
+    // overlapping sufels duplicates some points , get rid of them by downsampling
+    if (preprocess_params_.pcd_map_downsample_voxel_size > 0.0) {
+      pcd_map_pointcloud_ = vox_nav_utilities::downsampleInputCloud<pcl::PointXYZRGB>(
+        pcd_map_pointcloud_, preprocess_params_.pcd_map_downsample_voxel_size);
     }
+  }
+
+  void MapManager::handleElevatedSurfelOctomap()
+  {
+    elevated_surfels_octomap_octree_ = std::make_shared<octomap::OcTree>(
+      octomap_voxel_size_ / 4.0);
+    vox_nav_utilities::buildOctreeFromCloud(
+      *elevated_surfels_octomap_octree_, *elevated_surfel_pointcloud_,
+      [](const pcl::PointSurfel & i, vox_nav_utilities::OctreeLeaf & leaf) {
+        double cost_value =
+          static_cast<double>(i.b / 255.0) -
+          static_cast<double>(i.g / 255.0);
+        leaf.value = std::max(0.0, cost_value);
+        return true;
+      });
 
     auto header = std::make_shared<std_msgs::msg::Header>();
     header->frame_id = map_frame_id_;
@@ -472,11 +570,11 @@ namespace vox_nav_map_server
     vox_nav_utilities::fillOctomapMarkers(
       elevated_surfel_octomap_markers_msg_,
       header,
-      elevated_surfels_octomap_octree);
+      elevated_surfels_octomap_octree_);
 
     try {
       octomap_msgs::fullMapToMsg<octomap::OcTree>(
-        *elevated_surfels_octomap_octree,
+        *elevated_surfels_octomap_octree_,
         *elevated_surfel_octomap_msg_);
       elevated_surfel_octomap_msg_->binary = false;
       elevated_surfel_octomap_msg_->resolution = octomap_voxel_size_ / 4.0;
@@ -484,49 +582,63 @@ namespace vox_nav_map_server
       RCLCPP_ERROR(
         get_logger(), "Exception while converting binary octomap %s:", e.what());
     }
-
-    cost_regressed_cloud += *pure_non_traversable_pcl;
-    *pcd_map_pointcloud_ = cost_regressed_cloud;
-
-    // overlapping sufels duplicates some points , get rid of them by downsampling
-    if (preprocess_params_.pcd_map_downsample_voxel_size > 0.0) {
-      pcd_map_pointcloud_ = vox_nav_utilities::downsampleInputCloud<pcl::PointXYZRGB>(
-        pcd_map_pointcloud_, preprocess_params_.pcd_map_downsample_voxel_size);
-    }
   }
 
   void MapManager::handleOriginalOctomap()
   {
     pcl::toROSMsg(*pcd_map_pointcloud_, *octomap_pointcloud_msg_);
     pcl::toROSMsg(*elevated_surfel_pointcloud_, *elevated_surfels_pointcloud_msg_);
-
-    octomap::Pointcloud octocloud;
-    for (auto && i : pcd_map_pointcloud_->points) {
-      octocloud.push_back(octomap::point3d(i.x, i.y, i.z));
-
+    if (lod_cloud_enabled_) {
+      // decimated copy of map for remote viewers with limited bandwidth
+      auto lod_cloud = vox_nav_utilities::downsampleInputCloud<pcl::PointXYZRGB>(
+        pcd_map_pointcloud_, lod_cloud_voxel_size_);
+      pcl::toROSMsg(*lod_cloud, *octomap_pointcloud_lod_msg_);
+      RCLCPP_INFO(
+        get_logger(), "Level of detail cloud has %d points, full map cloud has %d points",
+        lod_cloud->points.size(), pcd_map_pointcloud_->points.size());
     }
-    auto original_octomap_octree = std::make_shared<octomap::OcTree>(octomap_voxel_size_);
-    original_octomap_octree->insertPointCloud(octocloud, octomap::point3d(0, 0, 0));
 
-    for (auto && i : pcd_map_pointcloud_->points) {
-      octocloud.push_back(octomap::point3d(i.x, i.y, i.z));
-      double value =
-        static_cast<double>(i.b / 255.0) -
-        static_cast<double>(i.g / 255.0);
-      if (i.r == 255) {
-        value = 2.0;
-      }
-      original_octomap_octree->setNodeValue(i.x, i.y, i.z, std::max(0.0, value));
-    }
+    // Map is static and prebuilt, so occupied leafs are inserted directly with their
+    // cost, instead of raycasting free space from origin to each point
+    original_octomap_octree_ = std::make_shared<octomap::OcTree>(octomap_voxel_size_);
+    vox_nav_utilities::buildOctreeFromCloud(
+      *original_octomap_octree_, *pcd_map_pointcloud_,
+      [](const pcl::PointXYZRGB & i, vox_nav_utilities::OctreeLeaf & leaf) {
+        double value =
+          static_cast<double>(i.b / 255.0) -
+          static_cast<double>(i.g / 255.0);
+        if (i.r == 255) {
+          value = 2.0;
+        }
+        leaf.value = std::max(0.0, value);
+        return true;
+      });
     auto header = std::make_shared<std_msgs::msg::Header>();
     header->frame_id = map_frame_id_;
     header->stamp = this->now();
     vox_nav_utilities::fillOctomapMarkers(
       original_octomap_markers_msg_, header,
-      original_octomap_octree);
+      original_octomap_octree_);
+
+    if (cost_octree_enabled_) {
+      cost_octree_ = buildCostOctree();
+      RCLCPP_INFO(
+        get_logger(), "Cost octree has %zu nodes and uses %zu bytes",
+        cost_octree_->size(), cost_octree_->memoryUsage());
+      try {
+        octomap_msgs::fullMapToMsg<vox_nav_utilities::CostOcTree>(
+          *cost_octree_,
+          *cost_octomap_msg_);
+        cost_octomap_msg_->binary = false;
+        cost_octomap_msg_->resolution = cost_octree_->getResolution();
+      } catch (const std::exception & e) {
+        RCLCPP_ERROR(
+          get_logger(), "Exception while converting cost octomap %s:", e.what());
+      }
+    }
     try {
       octomap_msgs::fullMapToMsg<octomap::OcTree>(
-        *original_octomap_octree,
+        *original_octomap_octree_,
         *original_octomap_msg_);
       original_octomap_msg_->binary = false;
       original_octomap_msg_->resolution = octomap_voxel_size_;
@@ -536,19 +648,86 @@ namespace vox_nav_map_server
     }
   }
 
-  void MapManager::publishMapVisuals()
+  std::shared_ptr<vox_nav_utilities::CostOcTree> MapManager::buildCostOctree()
   {
-    if (publish_octomap_visuals_) {
-      octomap_pointcloud_msg_->header.frame_id = map_frame_id_;
-      octomap_pointcloud_msg_->header.stamp = this->now();
-      elevated_surfels_pointcloud_msg_->header.frame_id = map_frame_id_;
-      elevated_surfels_pointcloud_msg_->header.stamp = this->now();
+    // Finest resolution is that of elevated surfel octree, map voxels are set two levels
+    // up, at octomap_voxel_size_. A surfel cell inside a map voxel splits that voxel
+    auto cost_octree =
+      std::make_shared<vox_nav_utilities::CostOcTree>(octomap_voxel_size_ / 4.0);
+    const unsigned int map_depth = cost_octree->getTreeDepth() - 2;
+    // all voxels are occupied, what differs is their cost and label
+    const float occupied = cost_octree->getClampingThresMaxLog();
+    auto fine_map_leafs = vox_nav_utilities::computeOctreeLeafs(
+      *cost_octree, *pcd_map_pointcloud_,
+      [occupied](const pcl::PointXYZRGB & i, vox_nav_utilities::OctreeLeaf & leaf) {
+        double value =
+          static_cast<double>(i.b / 255.0) -
+          static_cast<double>(i.g / 255.0);
+        leaf.value = occupied;
+        if (i.r == 255) {
+          leaf.cost = vox_nav_utilities::CostOcTree::kLethalCost;
+          leaf.label = vox_nav_utilities::CostLabel::NON_TRAVERSABLE;
+        } else {
+          leaf.cost = vox_nav_utilities::CostOcTree::quantizeCost(value);
+          leaf.label = vox_nav_utilities::CostLabel::TRAVERSABLE;
+        }
+        return true;
+      });
+    auto surfel_leafs = vox_nav_utilities::computeOctreeLeafs(
+      *cost_octree, *elevated_surfel_pointcloud_,
+      [occupied](const pcl::PointSurfel & i, vox_nav_utilities::OctreeLeaf & leaf) {
+        double cost_value =
+          static_cast<double>(i.b / 255.0) -
+          static_cast<double>(i.g / 255.0);
+        leaf.value = occupied;
+        leaf.cost = vox_nav_utilities::CostOcTree::quantizeCost(cost_value);
+        leaf.label = vox_nav_utilities::CostLabel::ELEVATED_SURFEL;
+        return true;
+      });
+    vox_nav_utilities::OctreeLeafMap map_leafs;
+    for (auto && leaf : fine_map_leafs) {
+      vox_nav_utilities::keepHighestOctreeLeaf(
+        map_leafs, cost_octree->adjustKeyAtDepth(leaf.first, map_depth), leaf.second);
+    }
+    for (auto && leaf : map_leafs) {
+      cost_octree->setNodeValueAtDepth(
+        leaf.first, map_depth, leaf.second.value, leaf.second.cost, leaf.second.label);
+    }
+    for (auto && leaf : surfel_leafs) {
+      cost_octree->setNodeValueAtDepth(
+        leaf.first, cost_octree->getTreeDepth(), leaf.second.value, leaf.second.cost,
+        leaf.second.label);
+    }
+    cost_octree->updateInnerOccupancy();
+    cost_octree->prune();
+    return cost_octree;
+  }
 
-      octomap_pointloud_publisher_->publish(*octomap_pointcloud_msg_);
-      octomap_markers_publisher_->publish(*original_octomap_markers_msg_);
-      elevated_surfel_octomap_markers_publisher_->publish(*elevated_surfel_octomap_markers_msg_);
-      elevated_surfel_pcl_publisher_->publish(*elevated_surfels_pointcloud_msg_);
+  void MapManager::publishMapVisuals()
+  {
+    if (!publish_octomap_visuals_ || !map_configured_) {
+      return;
+    }
+    // latched visuals are only sent again when map changes
+    if (latch_map_visuals_ && published_map_version_ == map_version_) {
+      return;
+    }
+    octomap_pointcloud_msg_->header.frame_id = map_frame_id_;
+    octomap_pointcloud_msg_->header.stamp = this->now();
+    elevated_surfels_pointcloud_msg_->header.frame_id = map_frame_id_;
+    elevated_surfels_pointcloud_msg_->header.stamp = this->now();
+
+    octomap_pointloud_publisher_->publish(*octomap_pointcloud_msg_);
+    octomap_markers_publisher_->publish(*original_octomap_markers_msg_);
+    elevated_surfel_octomap_markers_publisher_->publish(*elevated_surfel_octomap_markers_msg_);
+    elevated_surfel_pcl_publisher_->publish(*elevated_surfels_pointcloud_msg_);
+
+    if (lod_cloud_enabled_) {
+      octomap_pointcloud_lod_msg_->header.frame_id = map_frame_id_;
+      octomap_pointcloud_lod_msg_->header.stamp = this->now();
+      octomap_pointloud_lod_publisher_->publish(*octomap_pointcloud_lod_msg_);
     }
+    published_map_version_ = map_version_;
   }
 
   void MapManager::getGetMapsAndSurfelsCallback(
@@ -563,10 +742,122 @@ namespace vox_nav_map_server
       return;
     }
     RCLCPP_INFO(get_logger(), "Map is Cofigured Handling an incoming request");
-    response->original_octomap = *original_octomap_msg_;
-    response->elevated_surfel_octomap = *elevated_surfel_octomap_msg_;
-    response->elevated_surfel_poses = *elevated_surfel_poses_msg_;
-    response->is_valid = true;
+    auto region = regionFromRequest(*request);
+    if (region.isEmpty()) {
+      response->original_octomap = *original_octomap_msg_;
+      response->elevated_surfel_octomap = *elevated_surfel_octomap_msg_;
+      response->elevated_surfel_poses = *elevated_surfel_poses_msg_;
+      if (cost_octree_enabled_) {
+        response->cost_octomap = *cost_octomap_msg_;
+      }
+      response->is_valid = true;
+      return;
+    }
+
+    // Only serialize subtrees and surfels inside region of interest
+    response->is_valid =
+      octreeToMsg(
+      *vox_nav_utilities::extractOctreeRegion(*original_octomap_octree_, region),
+      response->original_octomap) &&
+      octreeToMsg(
+      *vox_nav_utilities::extractOctreeRegion(*elevated_surfels_octomap_octree_, region),
+      response->elevated_surfel_octomap);
+    if (cost_octree_enabled_) {
+      response->is_valid = response->is_valid &&
+        octreeToMsg(
+        *vox_nav_utilities::extractOctreeRegion(*cost_octree_, region),
+        response->cost_octomap);
+    }
+    response->elevated_surfel_poses.header = elevated_surfel_poses_msg_->header;
+    for (auto && pose : elevated_surfel_poses_msg_->poses) {
+      if (region.contains(pose.position.x, pose.position.y, pose.position.z)) {
+        response->elevated_surfel_poses.poses.push_back(pose);
+      }
+    }
+    RCLCPP_INFO(
+      get_logger(), "Served region of interest with %d of %d elevated surfels",
+      response->elevated_surfel_poses.poses.size(), elevated_surfel_poses_msg_->poses.size());
+  }
+
+  void MapManager::getOctomapCallback(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<vox_nav_msgs::srv::GetOctomap::Request> request,
+    std::shared_ptr<vox_nav_msgs::srv::GetOctomap::Response> response)
+  {
+    if (!map_configured_) {
+      RCLCPP_INFO(
+        get_logger(), "Map has not been configured yet,  cannot handle GetOctomap request");
+      return;
+    }
+    auto region = regionFromRequest(*request);
+    auto octree = original_octomap_octree_;
+    if (region.isEmpty()) {
+      response->map = *original_octomap_msg_;
+    } else {
+      octree = vox_nav_utilities::extractOctreeRegion(*original_octomap_octree_, region);
+      octreeToMsg(*octree, response->map);
+    }
+    std::string export_path;
+    if (resolveExportPath(request->filename, export_path)) {
+      octree->writeBinary(export_path);
+    }
+    response->origin_latitude = pcd_map_gps_pose_->position.latitude;
+    response->origin_longitude = pcd_map_gps_pose_->position.longitude;
+    response->origin_altitude = pcd_map_gps_pose_->position.altitude;
+  }
+
+  void MapManager::getPointCloudCallback(
+    const std::shared_ptr<rmw_request_id_t> request_header,
+    const std::shared_ptr<vox_nav_msgs::srv::GetPointCloud::Request> request,
+    std::shared_ptr<vox_nav_msgs::srv::GetPointCloud::Response> response)
+  {
+    if (!map_configured_) {
+      RCLCPP_INFO(
+        get_logger(), "Map has not been configured yet,  cannot handle GetPointCloud request");
+      return;
+    }
+    auto cloud = vox_nav_utilities::cropCloudToRegion<pcl::PointXYZRGB>(
+      pcd_map_pointcloud_, regionFromRequest(*request));
+    if (request->leaf_size > 0.0 && !cloud->points.empty()) {
+      cloud = vox_nav_utilities::downsampleInputCloud<pcl::PointXYZRGB>(
+        cloud, request->leaf_size);
+    }
+    pcl::toROSMsg(*cloud, response->cloud);
+    response->cloud.header.frame_id = map_frame_id_;
+    response->cloud.header.stamp = this->now();
+    std::string export_path;
+    if (!cloud->points.empty() && resolveExportPath(request->filename, export_path)) {
+      pcl::io::savePCDFileBinary(export_path, *cloud);
+    }
+    response->origin_latitude = pcd_map_gps_pose_->position.latitude;
+    response->origin_longitude = pcd_map_gps_pose_->position.longitude;
+    response->origin_altitude = pcd_map_gps_pose_->position.altitude;
+  }
+
+  bool MapManager::resolveExportPath(const std::string & filename, std::string & path)
+  {
+    if (filename.empty()) {
+      return false;
+    }
+    if (export_directory_.empty()) {
+      RCLCPP_WARN(
+        get_logger(), "export_directory is not set, not storing %s", filename.c_str());
+      return false;
+    }
+    // services are callable by anyone on the ROS graph, keep writes inside export_directory
+    std::filesystem::path relative_path(filename);
+    bool escapes = relative_path.is_absolute() || relative_path.has_root_name();
+    for (auto && part : relative_path) {
+      escapes |= part == "..";
+    }
+    if (escapes) {
+      RCLCPP_WARN(
+        get_logger(), "Rejected storing to %s, only paths relative to export_directory without "
+        "\"..\" are allowed", filename.c_str());
+      return false;
+    }
+    path = (std::filesystem::path(export_directory_) / relative_path).string();
+    return true;
   }
 }   // namespace vox_nav_map_server
 
@@ -28,6 +28,7 @@
 #include <vox_nav_utilities/pcl_helpers.hpp>
 #include <vox_nav_utilities/planner_helpers.hpp>
 #include <vox_nav_msgs/srv/get_maps_and_surfels.hpp>
+#include <vox_nav_planning/planning_profile.hpp>
 // PCL
 #include <pcl/common/common.h>
 #include <pcl/common/transforms.h>
@@ -82,6 +83,9 @@
 #include <fcl/broadphase/broadphase.h>
 #include <fcl/math/transform.h>
 // STL
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <string>
 #include <iostream>
 #include <memory>
@@ -131,6 +135,59 @@ namespace vox_nav_planning
       const geometry_msgs::msg::PoseStamped & start,
       const geometry_msgs::msg::PoseStamped & goal) = 0;
 
+    /**
+     * @brief Plan between two poses without changing state plugins keep between createPlan
+     * calls (warm start solutions, incremental search state), used to repair a segment of a
+     * cached plan. Default calls createPlan, plugins with such state override this.
+     *
+     * @param start
+     * @param goal
+     * @return std::vector<geometry_msgs::msg::PoseStamped>
+     */
+    virtual std::vector<geometry_msgs::msg::PoseStamped> createPlanSegment(
+      const geometry_msgs::msg::PoseStamped & start,
+      const geometry_msgs::msg::PoseStamped & goal)
+    {
+      return createPlan(start, goal);
+    }
+
+    /**
+     * @brief Solve a batch of start/goal queries on the same map.
+     * Default solves queries one after another, plugins that can plan concurrently
+     * override this to distribute queries to num_workers threads.
+     * Remaining queries are left empty once is_canceled returns true.
+     *
+     * @param starts
+     * @param goals
+     * @param num_workers
+     * @param planning_times seconds spent on each query
+     * @param is_canceled polled while planning, may be empty
+     * @return std::vector<std::vector<geometry_msgs::msg::PoseStamped>> empty for failed queries
+     */
+    virtual std::vector<std::vector<geometry_msgs::msg::PoseStamped>> createPlans(
+      const std::vector<geometry_msgs::msg::PoseStamped> & starts,
+      const std::vector<geometry_msgs::msg::PoseStamped> & goals,
+      int num_workers,
+      std::vector<double> & planning_times,
+      const std::function<bool()> & is_canceled)
+    {
+      (void)num_workers;
+      std::vector<std::vector<geometry_msgs::msg::PoseStamped>> plans;
+      planning_times.clear();
+      for (size_t i = 0; i < starts.size() && i < goals.size(); i++) {
+        if (is_canceled && is_canceled()) {
+          plans.resize(std::min(starts.size(), goals.size()));
+          planning_times.resize(plans.size(), 0.0);
+          break;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        plans.push_back(createPlan(starts[i], goals[i]));
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t1;
+        planning_times.push_back(elapsed.count());
+      }
+      return plans;
+    }
+
     /**
     * @brief
     *
@@ -154,6 +211,59 @@ namespace vox_nav_planning
      */
     virtual void setupMap() = 0;
 
+    /**
+     * @brief Check a single pose of an existing plan against current collision map,
+     * used to re-validate cached plans without planning again.
+     * Default checks robot body against the full octomap.
+     *
+     * @param pose
+     * @return true
+     * @return false
+     */
+    virtual bool isPoseValid(const geometry_msgs::msg::PoseStamped & pose)
+    {
+      auto octomap_collision_object = original_octomap_collision_object_;
+      if (!is_map_ready_ || !robot_collision_object_ || !octomap_collision_object) {
+        return false;
+      }
+      fcl::Vec3f translation(pose.pose.position.x, pose.pose.position.y, pose.pose.position.z);
+      // keep same convention as isStateValid() of plugins, so cached plans pass same checks
+      fcl::Quaternion3f rotation(
+        pose.pose.orientation.x, pose.pose.orientation.y,
+        pose.pose.orientation.z, pose.pose.orientation.w);
+      // called without global_mutex_ while plugins may be planning with robot_collision_object_,
+      // so collide with a local object sharing its geometry instead of moving the shared one
+      fcl::CollisionObject robot_collision_object(
+        robot_collision_object_->collisionGeometry(), fcl::Transform3f(rotation, translation));
+      fcl::CollisionRequest requestType(1, false, 1, false);
+      fcl::CollisionResult collisionResult;
+      fcl::collide(
+        &robot_collision_object,
+        octomap_collision_object.get(), requestType, collisionResult);
+      return !collisionResult.isCollision();
+    }
+
+    /**
+     * @brief Version of the map planner currently plans on, increased each time map
+     * or obstacle information changes so that plans made on older maps can be told apart.
+     *
+     * @return uint64_t
+     */
+    uint64_t getMapVersion() const
+    {
+      return map_version_;
+    }
+
+    /**
+     * @brief Per phase call counts and times of planning requests since last reset
+     *
+     * @return PlanningProfile&
+     */
+    PlanningProfile & getProfile()
+    {
+      return profile_;
+    }
+
   protected:
     rclcpp::Client<vox_nav_msgs::srv::GetMapsAndSurfels>::SharedPtr get_maps_and_surfels_client_;
     rclcpp::Node::SharedPtr get_maps_and_surfels_client_node_;
@@ -176,6 +286,16 @@ namespace vox_nav_planning
     // global mutex to guard octomap
     std::mutex octomap_mutex_;
     volatile bool is_map_ready_;
+    // increased by plugins each time collision map changes
+    std::atomic<uint64_t> map_version_{0};
+    // plugins record time of validity checks, graph construction, search, smoothing etc. here
+    PlanningProfile profile_;
+    // Request local state space bounds, box around start and goal inflated by
+    // adaptive_bounds_margin_ and clipped to map extent, instead of state_space_boundries
+    bool adaptive_bounds_enabled_{false};
+    double adaptive_bounds_margin_{5.0};
+    geometry_msgs::msg::Point map_min_;
+    geometry_msgs::msg::Point map_max_;
   };
 }  // namespace vox_nav_planning
 #endif  // VOX_NAV_PLANNING__PLANNER_CORE_HPP_
@@ -18,8 +18,11 @@
 
 
 #include <chrono>
+#include <list>
+#include <mutex>
 #include <string>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
@@ -28,11 +31,14 @@
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "visualization_msgs/msg/marker.hpp"
 #include "visualization_msgs/msg/marker_array.hpp"
+#include "std_msgs/msg/u_int64_multi_array.hpp"
 #include "pluginlib/class_loader.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "vox_nav_planning/planner_core.hpp"
+#include "vox_nav_planning/visualization_queue.hpp"
 #include "vox_nav_utilities/tf_helpers.hpp"
 #include "vox_nav_msgs/action/compute_path_to_pose.hpp"
+#include "vox_nav_msgs/action/compute_paths_to_poses.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "tf2_ros/transform_listener.h"
 #include "tf2/transform_datatypes.h"
@@ -45,6 +51,8 @@ namespace vox_nav_planning
   public:
     using ComputePathToPose = vox_nav_msgs::action::ComputePathToPose;
     using GoalHandleComputePathToPose = rclcpp_action::ServerGoalHandle<ComputePathToPose>;
+    using ComputePathsToPoses = vox_nav_msgs::action::ComputePathsToPoses;
+    using GoalHandleComputePathsToPoses = rclcpp_action::ServerGoalHandle<ComputePathsToPoses>;
     /**
      * @brief Construct a new Planner Server object
      *
@@ -97,9 +105,38 @@ namespace vox_nav_planning
      */
     void handle_accepted(const std::shared_ptr<GoalHandleComputePathToPose> goal_handle);
 
+    /**
+     * @brief
+     *
+     * @param uuid
+     * @param goal
+     * @return rclcpp_action::GoalResponse
+     */
+    rclcpp_action::GoalResponse handle_batch_goal(
+      const rclcpp_action::GoalUUID & uuid,
+      std::shared_ptr<const ComputePathsToPoses::Goal> goal);
+
+    /**
+     * @brief
+     *
+     * @param goal_handle
+     * @return rclcpp_action::CancelResponse
+     */
+    rclcpp_action::CancelResponse handle_batch_cancel(
+      const std::shared_ptr<GoalHandleComputePathsToPoses> goal_handle);
+
+    /**
+     * @brief
+     *
+     * @param goal_handle
+     */
+    void handle_batch_accepted(const std::shared_ptr<GoalHandleComputePathsToPoses> goal_handle);
+
   protected:
     // Our action server implements the ComputePathToPose action
     rclcpp_action::Server<ComputePathToPose>::SharedPtr action_server_;
+    // Batch action server, solves many start/goal queries in one request
+    rclcpp_action::Server<ComputePathsToPoses>::SharedPtr batch_action_server_;
 
     /**
      * @brief The action server callback which calls planner to get the path
@@ -107,7 +144,63 @@ namespace vox_nav_planning
     void computePlan(const std::shared_ptr<GoalHandleComputePathToPose> goal_handle);
 
     /**
-     * @brief Publish a path for visualization purposes, add start and goal poses too
+     * @brief The batch action server callback, if no starts are given goals are chained
+     * starting from current robot pose
+     */
+    void computePlans(const std::shared_ptr<GoalHandleComputePathsToPoses> goal_handle);
+
+    /**
+     * @brief Build plan cache key from quantized start and goal, planner id and
+     * version of the map that planner currently uses
+     *
+     * @param start
+     * @param goal
+     * @param planner_id
+     * @return std::string
+     */
+    std::string getPlanCacheKey(
+      const geometry_msgs::msg::PoseStamped & start,
+      const geometry_msgs::msg::PoseStamped & goal,
+      const std::string & planner_id);
+
+    /**
+     * @brief Look up the key, on success moves entry to front of LRU list
+     *
+     * @param key
+     * @param plan
+     * @return true
+     * @return false
+     */
+    bool lookupPlanCache(
+      const std::string & key,
+      std::vector<geometry_msgs::msg::PoseStamped> & plan);
+
+    /**
+     * @brief Insert a plan to cache, evicts least recently used entry when full
+     *
+     * @param key
+     * @param plan
+     */
+    void insertPlanCache(
+      const std::string & key,
+      const std::vector<geometry_msgs::msg::PoseStamped> & plan);
+
+    /**
+     * @brief Re-validate a cached plan against current collision map, invalid
+     * section of plan is replanned and spliced in. Returns empty path if repair fails.
+     *
+     * @param plan
+     * @param planner_id
+     * @return std::vector<geometry_msgs::msg::PoseStamped>
+     */
+    std::vector<geometry_msgs::msg::PoseStamped> validateCachedPlan(
+      const std::vector<geometry_msgs::msg::PoseStamped> & plan,
+      const std::string & planner_id);
+
+    /**
+     * @brief Publish a path for visualization purposes, add start and goal poses too.
+     * Markers are built and published by visualization queue thread, path is decimated to
+     * visualization.max_plan_markers poses
      *
      * @param path
      * @param start_pose
@@ -126,6 +219,13 @@ namespace vox_nav_planning
     double max_planner_duration_;
     std::string planner_ids_concat_;
     double expected_planner_frequency_;
+    // Number of threads used to solve batch queries
+    int batch_planning_workers_;
+    // Whether plugins record per phase timings, returned in result of each request
+    bool planner_profiling_enabled_;
+    // Profile of a planner is shared by all requests, with profiling enabled requests that
+    // record into it run one at a time so that a reset never lands in another request
+    std::mutex profile_mutex_;
     // Clock
     rclcpp::Clock steady_clock_{RCL_STEADY_TIME};
     // tf buffer to get transfroms
@@ -136,6 +236,26 @@ namespace vox_nav_planning
     rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr plan_publisher_;
     // obot mesh path, if there is one
     std::string robot_mesh_path_;
+    // robot body dimensions, read once for scale of path markers
+    geometry_msgs::msg::Vector3 robot_body_dimens_;
+    // Builds and publishes plan markers off the planning thread
+    std::shared_ptr<VisualizationQueue> plan_visualization_queue_;
+    int max_plan_markers_;
+
+    // LRU plan cache, most recently used plans are at front
+    using PlanCacheEntry = std::pair<std::string, std::vector<geometry_msgs::msg::PoseStamped>>;
+    std::list<PlanCacheEntry> plan_cache_;
+    std::unordered_map<std::string, std::list<PlanCacheEntry>::iterator> plan_cache_index_;
+    std::mutex plan_cache_mutex_;
+    bool plan_cache_enabled_;
+    int plan_cache_capacity_;
+    double plan_cache_position_resolution_;
+    double plan_cache_yaw_resolution_;
+    uint64_t plan_cache_hits_{0};
+    uint64_t plan_cache_misses_{0};
+    uint64_t plan_cache_repairs_{0};
+    // [hits, misses, repairs]
+    rclcpp::Publisher<std_msgs::msg::UInt64MultiArray>::SharedPtr plan_cache_stats_publisher_;
   };
 
 }  // namespace vox_nav_planning
@@ -0,0 +1,184 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_PLANNING__PLANNING_PROFILE_HPP_
+#define VOX_NAV_PLANNING__PLANNING_PROFILE_HPP_
+
+#include <ompl/base/DiscreteMotionValidator.h>
+#include <vox_nav_msgs/msg/planning_profile.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace vox_nav_planning
+{
+
+  enum class PlanningPhase : int
+  {
+    STATE_VALIDITY = 0,
+    MOTION_VALIDITY,
+    GRAPH_CONSTRUCTION,
+    SEARCH,
+    SMOOTHING,
+    CONVERSION,
+    NUM_PHASES
+  };
+
+/**
+ * @brief Call counters and cumulative time of planning phases. Counters are relaxed atomics
+ * so that concurrent queries can share a profile, recording a phase costs two clock reads.
+ *
+ */
+  class PlanningProfile
+  {
+  public:
+    PlanningProfile()
+    : enabled_(true)
+    {
+      reset();
+    }
+
+    /**
+     * @brief
+     *
+     * @param phase
+     * @return const char*
+     */
+    static const char * phaseName(PlanningPhase phase)
+    {
+      static const char * names[] = {
+        "state_validity", "motion_validity", "graph_construction",
+        "search", "smoothing", "conversion"};
+      return names[static_cast<int>(phase)];
+    }
+
+    void add(PlanningPhase phase, uint64_t nanoseconds)
+    {
+      calls_[static_cast<int>(phase)].fetch_add(1, std::memory_order_relaxed);
+      nanoseconds_[static_cast<int>(phase)].fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+      for (int i = 0; i < kNumPhases; i++) {
+        calls_[i].store(0, std::memory_order_relaxed);
+        nanoseconds_[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    bool isEnabled() const
+    {
+      return enabled_;
+    }
+
+    void setEnabled(bool enabled)
+    {
+      enabled_ = enabled;
+    }
+
+    /**
+     * @brief
+     *
+     * @param msg
+     */
+    void toMsg(vox_nav_msgs::msg::PlanningProfile & msg) const
+    {
+      msg.phases.clear();
+      msg.calls.clear();
+      msg.seconds.clear();
+      for (int i = 0; i < kNumPhases; i++) {
+        msg.phases.push_back(phaseName(static_cast<PlanningPhase>(i)));
+        msg.calls.push_back(calls_[i].load(std::memory_order_relaxed));
+        msg.seconds.push_back(nanoseconds_[i].load(std::memory_order_relaxed) * 1e-9);
+      }
+    }
+
+  private:
+    static constexpr int kNumPhases = static_cast<int>(PlanningPhase::NUM_PHASES);
+    std::array<std::atomic<uint64_t>, kNumPhases> calls_;
+    std::array<std::atomic<uint64_t>, kNumPhases> nanoseconds_;
+    std::atomic<bool> enabled_;
+  };
+
+/**
+ * @brief Records time from construction to destruction into given phase of profile
+ *
+ */
+  class ScopedPhaseTimer
+  {
+  public:
+    ScopedPhaseTimer(PlanningProfile & profile, PlanningPhase phase)
+    : profile_(profile),
+      phase_(phase),
+      enabled_(profile.isEnabled())
+    {
+      if (enabled_) {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~ScopedPhaseTimer()
+    {
+      if (enabled_) {
+        profile_.add(
+          phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+      }
+    }
+
+  private:
+    PlanningProfile & profile_;
+    PlanningPhase phase_;
+    bool enabled_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+/**
+ * @brief OMPL's discrete motion validator, with motion checks recorded to a profile
+ *
+ */
+  class ProfiledMotionValidator : public ompl::base::DiscreteMotionValidator
+  {
+  public:
+    ProfiledMotionValidator(
+      const ompl::base::SpaceInformationPtr & si,
+      PlanningProfile & profile)
+    : ompl::base::DiscreteMotionValidator(si),
+      profile_(profile)
+    {
+    }
+
+    bool checkMotion(const ompl::base::State * s1, const ompl::base::State * s2) const override
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::MOTION_VALIDITY);
+      return ompl::base::DiscreteMotionValidator::checkMotion(s1, s2);
+    }
+
+    bool checkMotion(
+      const ompl::base::State * s1, const ompl::base::State * s2,
+      std::pair<ompl::base::State *, double> & lastValid) const override
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::MOTION_VALIDITY);
+      return ompl::base::DiscreteMotionValidator::checkMotion(s1, s2, lastValid);
+    }
+
+  private:
+    PlanningProfile & profile_;
+  };
+
+}  // namespace vox_nav_planning
+
+#endif  // VOX_NAV_PLANNING__PLANNING_PROFILE_HPP_
@@ -22,11 +22,166 @@
 #include "vox_nav_planning/planner_core.hpp"
 #include "geometry_msgs/msg/pose_array.hpp"
 #include "vox_nav_utilities/elevation_state_space.hpp"
-
+// OMPL CONTROL
+#include <ompl/control/SimpleSetup.h>
+#include <ompl/control/StatePropagator.h>
+#include <ompl/control/ControlSampler.h>
+#include <ompl/control/spaces/RealVectorControlSpace.h>
+#include <ompl/base/ProjectionEvaluator.h>
 
 namespace vox_nav_planning
 {
 
+  /**
+   * @brief Kinematic bicycle model, parameters have the same meaning as common::Parameters
+   * of vox_nav_control so that planned trajectories are feasible for the MPC controllers
+   *
+   */
+  struct BicycleModelParameters
+  {
+    // distance from CoG to front axle(m)
+    double L_F;
+    // distance from CoG to rear axle(m)
+    double L_R;
+    // min / max velocity constraint(m / s)
+    double V_MIN;
+    double V_MAX;
+    // min / max front steer angle constraint(rad)
+    double DF_MIN;
+    double DF_MAX;
+    // number of discrete velocity and steering values in motion primitive table
+    int V_BINS;
+    int DF_BINS;
+    // duration of one propagation step(s) and the longest cached duration (in steps)
+    double DT;
+    int MAX_STEPS;
+    // euler integration steps per propagation step, only used while building the cache
+    int INTEGRATION_SUBSTEPS;
+    BicycleModelParameters()
+    : L_F(0.67),
+      L_R(0.67),
+      V_MIN(-0.4),
+      V_MAX(1.0),
+      DF_MIN(-0.8),
+      DF_MAX(0.8),
+      V_BINS(5),
+      DF_BINS(9),
+      DT(0.2),
+      MAX_STEPS(20),
+      INTEGRATION_SUBSTEPS(10) {}
+  };
+
+  /**
+   * @brief Table driven StatePropagator for ElevationStateSpace.
+   * Every (velocity, steering) bin is integrated once from the origin and its relative
+   * SE2 displacement is stored for each duration 1..MAX_STEPS * DT.
+   * A propagation is then a table lookup plus a rigid transform, z is snapped to nearest surfel.
+   * Controls or durations that are not in the table are integrated on the fly.
+   */
+  class CachedBicyclePropagator : public ompl::control::StatePropagator
+  {
+  public:
+    CachedBicyclePropagator(
+      const ompl::control::SpaceInformationPtr & si,
+      const BicycleModelParameters & params,
+      const pcl::PointCloud<pcl::PointSurfel>::Ptr & elevated_surfel_cloud);
+
+    void propagate(
+      const ompl::base::State * state,
+      const ompl::control::Control * control,
+      const double duration,
+      ompl::base::State * result) const override;
+
+    /**
+     * @brief discrete values of velocity and steering that have cached primitives
+     *
+     */
+    const std::vector<double> & getVelocityBins() const {return v_bins_;}
+    const std::vector<double> & getSteeringBins() const {return df_bins_;}
+
+  protected:
+    struct Primitive
+    {
+      double dx;
+      double dy;
+      double dyaw;
+    };
+
+    /**
+     * @brief Integrate bicycle model from origin, for given control and duration
+     *
+     */
+    Primitive integrate(double v, double df, double duration) const;
+
+    /**
+     * @brief find the bin index of value, returns -1 if value is not on a bin
+     *
+     */
+    int binIndex(const std::vector<double> & bins, double value) const;
+
+    BicycleModelParameters params_;
+    std::vector<double> v_bins_;
+    std::vector<double> df_bins_;
+    // flattened [v_bin][df_bin][step] table
+    std::vector<Primitive> primitives_;
+    pcl::PointCloud<pcl::PointSurfel>::Ptr elevated_surfel_cloud_;
+    pcl::KdTreeFLANN<pcl::PointSurfel>::Ptr elevated_surfel_kdtree_;
+  };
+
+  /**
+   * @brief Samples controls only from the cached bins, so every propagation hits the table
+   *
+   */
+  class DiscreteBicycleControlSampler : public ompl::control::ControlSampler
+  {
+  public:
+    DiscreteBicycleControlSampler(
+      const ompl::control::ControlSpace * space,
+      const std::vector<double> & v_bins,
+      const std::vector<double> & df_bins)
+    : ompl::control::ControlSampler(space), v_bins_(v_bins), df_bins_(df_bins) {}
+
+    void sample(ompl::control::Control * control) override
+    {
+      auto * u = control->as<ompl::control::RealVectorControlSpace::ControlType>();
+      u->values[0] = v_bins_[rng_.uniformInt(0, v_bins_.size() - 1)];
+      u->values[1] = df_bins_[rng_.uniformInt(0, df_bins_.size() - 1)];
+    }
+
+  protected:
+    std::vector<double> v_bins_;
+    std::vector<double> df_bins_;
+  };
+
+  /**
+   * @brief x, y projection of ElevationStateSpace, required by KPIECE1, EST and PDST
+   *
+   */
+  class ElevationStateProjection : public ompl::base::ProjectionEvaluator
+  {
+  public:
+    ElevationStateProjection(const ompl::base::StateSpace * space, double cell_size)
+    : ompl::base::ProjectionEvaluator(space)
+    {
+      cellSizes_ = {cell_size, cell_size};
+    }
+
+    unsigned int getDimension() const override
+    {
+      return 2;
+    }
+
+    void project(
+      const ompl::base::State * state,
+      Eigen::Ref<Eigen::VectorXd> projection) const override
+    {
+      const auto * cstate = state->as<ompl::base::ElevationStateSpace::StateType>();
+      const auto * se2 = cstate->as<ompl::base::SE2StateSpace::StateType>(0);
+      projection(0) = se2->getX();
+      projection(1) = se2->getY();
+    }
+  };
+
   class ElevationControlPlanner : public vox_nav_planning::PlannerCore
   {
 
@@ -109,7 +264,7 @@ namespace vox_nav_planning
     void setupMap() override;
 
   protected:
-    rclcpp::Logger logger_{rclcpp::get_logger("elevation_planner")};
+    rclcpp::Logger logger_{rclcpp::get_logger("elevation_control_planner")};
     // Surfels centers are elevated by node_elevation_distance_, and are stored in this
     // octomap, this maps is used by planner to sample states that are
     // strictly laying on ground but not touching. So it constrains the path to be on ground
@@ -123,7 +278,14 @@ namespace vox_nav_planning
     geometry_msgs::msg::PoseStamped nearest_elevated_surfel_to_goal_;
     std::shared_ptr<fcl::CollisionObject> elevated_surfels_collision_object_;
     ompl::base::OptimizationObjectivePtr octocost_optimization_;
+
+    ompl::base::StateSpacePtr state_space_;
     ompl::control::ControlSpacePtr control_state_space_;
+    // PlannerCore::simple_setup_ is geometric, kinodynamic planning needs its own
+    ompl::control::SimpleSetupPtr control_simple_setup_;
+    std::shared_ptr<CachedBicyclePropagator> state_propagator_;
+    BicycleModelParameters bicycle_params_;
+    double goal_tolerance_;
 
     std::shared_ptr<ompl::base::RealVectorBounds> z_bounds_;
     std::shared_ptr<ompl::base::RealVectorBounds> se2_bounds_;
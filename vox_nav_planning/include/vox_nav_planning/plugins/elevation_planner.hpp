@@ -15,18 +15,65 @@
 #ifndef VOX_NAV_PLANNING__PLUGINS__ELEVATION_PLANNER_HPP_
 #define VOX_NAV_PLANNING__PLUGINS__ELEVATION_PLANNER_HPP_
 
+#include <array>
 #include <vector>
 #include <string>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "vox_nav_planning/planner_core.hpp"
 #include "geometry_msgs/msg/pose_array.hpp"
 #include "vox_nav_utilities/elevation_state_space.hpp"
+#include "vox_nav_utilities/esdf.hpp"
+#include "vox_nav_utilities/footprint_masks.hpp"
+#include <ompl/geometric/planners/rrt/RRTConnect.h>
 
 
 namespace vox_nav_planning
 {
 
+  /**
+   * @brief Samples states uniformly from a given set of surfels,
+   * used to keep samples of fine planner inside the coarse corridor
+   *
+   */
+  class CorridorValidStateSampler : public ompl::base::ValidStateSampler
+  {
+  public:
+    CorridorValidStateSampler(
+      const ompl::base::SpaceInformation * si,
+      const pcl::PointCloud<pcl::PointSurfel>::Ptr & corridor_surfels)
+    : ompl::base::ValidStateSampler(si), corridor_surfels_(corridor_surfels)
+    {
+      name_ = "CorridorValidStateSampler";
+    }
+
+    bool sample(ompl::base::State * state) override
+    {
+      if (corridor_surfels_->points.empty()) {
+        return false;
+      }
+      auto * cstate = state->as<ompl::base::ElevationStateSpace::StateType>();
+      const auto & surfel =
+        corridor_surfels_->points[rng_.uniformInt(0, corridor_surfels_->points.size() - 1)];
+      cstate->setSE2(surfel.x, surfel.y, rng_.uniformReal(-M_PI, M_PI));
+      cstate->setZ(surfel.z);
+      return si_->isValid(state);
+    }
+
+    bool sampleNear(
+      ompl::base::State * state, const ompl::base::State * near,
+      const double distance) override
+    {
+      throw ompl::Exception("CorridorValidStateSampler::sampleNear", "not implemented");
+      return false;
+    }
+
+  protected:
+    pcl::PointCloud<pcl::PointSurfel>::Ptr corridor_surfels_;
+  };
+
   class ElevationPlanner : public vox_nav_planning::PlannerCore
   {
 
@@ -71,6 +118,66 @@ namespace vox_nav_planning
     */
     bool isStateValid(const ompl::base::State * state) override;
 
+    /**
+     * @brief collision check with given robot bodies, so that concurrent queries
+     * can use their own copies
+     *
+     * @param state
+     * @param robot
+     * @param robot_minimal
+     * @return true
+     * @return false
+     */
+    bool isStateValid(
+      const ompl::base::State * state,
+      fcl::CollisionObject * robot,
+      fcl::CollisionObject * robot_minimal);
+
+    /**
+     * @brief Plan as a batch of one query, in a state space and SimpleSetup of its own,
+     * so that warm start solution and corridor of createPlan are left untouched
+     *
+     * @param start
+     * @param goal
+     * @return std::vector<geometry_msgs::msg::PoseStamped>
+     */
+    std::vector<geometry_msgs::msg::PoseStamped> createPlanSegment(
+      const geometry_msgs::msg::PoseStamped & start,
+      const geometry_msgs::msg::PoseStamped & goal) override;
+
+    /**
+     * @brief Solve queries in parallel, each worker has its own SimpleSetup, state space,
+     * planner and robot collision bodies while maps are shared. Multi query planners
+     * (PRM family, SPARS) keep their roadmap among the queries of a worker. A running
+     * solve is terminated and remaining queries are skipped once is_canceled returns true.
+     *
+     * @param starts
+     * @param goals
+     * @param num_workers
+     * @param planning_times
+     * @param is_canceled
+     * @return std::vector<std::vector<geometry_msgs::msg::PoseStamped>>
+     */
+    std::vector<std::vector<geometry_msgs::msg::PoseStamped>> createPlans(
+      const std::vector<geometry_msgs::msg::PoseStamped> & starts,
+      const std::vector<geometry_msgs::msg::PoseStamped> & goals,
+      int num_workers,
+      std::vector<double> & planning_times,
+      const std::function<bool()> & is_canceled) override;
+
+    /**
+     * @brief interpolate, smooth and convert OMPL solution to poses
+     *
+     * @param solution_path
+     * @param si
+     * @param frame_id
+     * @return std::vector<geometry_msgs::msg::PoseStamped>
+     */
+    std::vector<geometry_msgs::msg::PoseStamped> solutionPathToPoses(
+      ompl::geometric::PathGeometric & solution_path,
+      const ompl::base::SpaceInformationPtr & si,
+      const std::string & frame_id);
+
     /**
      * @brief
      *
@@ -108,7 +215,65 @@ namespace vox_nav_planning
      */
     void setupMap() override;
 
+    /**
+     * @brief Build coarse tile graph of elevated surfels, called once after map is received
+     *
+     */
+    void buildCoarseTiles();
+
+    /**
+     * @brief Run A* on coarse tiles between start and goal, and widen the found
+     * tile path by corridor_width tiles. Fills corridor_tiles_, corridor_surfels_ and
+     * sets corridor bounds to se2/z bounds.
+     *
+     * @param start
+     * @param goal
+     * @param se2_bounds
+     * @param z_bounds
+     * @return true if a coarse corridor was found
+     */
+    bool findCorridor(
+      const geometry_msgs::msg::PoseStamped & start,
+      const geometry_msgs::msg::PoseStamped & goal,
+      ompl::base::RealVectorBounds & se2_bounds,
+      ompl::base::RealVectorBounds & z_bounds);
+
+    /**
+     * @brief Reuse previous solution for a request close to the last one. Previous states
+     * from the one closest to new start up to goal are kept, states and motions that became
+     * invalid are bridged with a short RRTConnect run between the neighbouring valid states.
+     *
+     * @param start
+     * @param goal
+     * @param path repaired path, start to goal
+     * @return true
+     * @return false if start or goal moved too far or a segment could not be repaired
+     */
+    bool warmStartPlan(
+      const ompl::base::State * start,
+      const ompl::base::State * goal,
+      ompl::geometric::PathGeometric & path);
+
   protected:
+    /**
+     * @brief A square tile of map in x-y, the coarse level of hierarchical planning
+     *
+     */
+    struct CoarseTile
+    {
+      int ix;
+      int iy;
+      double z_min;
+      double z_max;
+      double z_mean;
+      std::vector<int> surfel_indices;
+    };
+
+    int64_t tileKey(int ix, int iy) const
+    {
+      return (static_cast<int64_t>(ix) << 32) | static_cast<uint32_t>(iy);
+    }
+
     rclcpp::Logger logger_{rclcpp::get_logger("elevation_planner")};
     // Surfels centers are elevated by node_elevation_distance_, and are stored in this
     // octomap, this maps is used by planner to sample states that are
@@ -132,6 +297,36 @@ namespace vox_nav_planning
     ompl::base::ElevationStateSpace::SE2StateType se2_space_type_;
     // curve radius for reeds and dubins only
     double rho_;
+
+    // distance field of original octomap, skips exact robot body checks when conclusive
+    std::shared_ptr<vox_nav_utilities::ESDF> esdf_;
+    bool esdf_enabled_;
+    double esdf_max_distance_;
+    double robot_inscribed_radius_;
+    double robot_circumscribed_radius_;
+    std::array<double, 3> robot_body_dimens_;
+    // voxelized robot body per yaw bin, lookups against hashed occupied voxels
+    std::shared_ptr<vox_nav_utilities::FootprintMasks> footprint_masks_;
+    bool footprint_masks_enabled_;
+    bool footprint_masks_exact_confirmation_;
+    int footprint_masks_yaw_bins_;
+    // Hierarchical (coarse to fine) planning, the coarse tiles are computed once,
+    // fine planner bounds and samples are limited to corridor of coarse path
+    bool hierarchical_planning_enabled_;
+    double tile_size_;
+    int corridor_width_;
+    int min_surfels_per_tile_;
+    double max_tile_elevation_diff_;
+    std::unordered_map<int64_t, CoarseTile> coarse_tiles_;
+    std::unordered_set<int64_t> corridor_tiles_;
+    pcl::PointCloud<pcl::PointSurfel>::Ptr corridor_surfels_;
+    bool corridor_active_;
+    // Warm started replanning, last solution before interpolation and smoothing
+    std::shared_ptr<ompl::geometric::PathGeometric> previous_solution_;
+    bool warm_start_enabled_;
+    double warm_start_max_start_shift_;
+    double warm_start_max_goal_shift_;
+    double warm_start_repair_timeout_;
   };
 }  // namespace vox_nav_planning
 
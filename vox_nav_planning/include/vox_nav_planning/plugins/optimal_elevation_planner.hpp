@@ -24,9 +24,15 @@
 #include <boost/graph/random.hpp>
 #include <boost/random.hpp>
 #include <boost/graph/graphviz.hpp>
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
 #include "vox_nav_planning/planner_core.hpp"
+#include "vox_nav_planning/visualization_queue.hpp"
 #include "geometry_msgs/msg/pose_array.hpp"
 #include "visualization_msgs/msg/marker_array.hpp"
+#include "vox_nav_msgs/msg/object_array.hpp"
 #include "vox_nav_utilities/elevation_state_space.hpp"
 
 namespace vox_nav_planning
@@ -67,6 +73,18 @@ namespace vox_nav_planning
       const geometry_msgs::msg::PoseStamped & start,
       const geometry_msgs::msg::PoseStamped & goal) override;
 
+    /**
+     * @brief Plan on a graph built for this query only, D* Lite search state of
+     * createPlan is left untouched
+     *
+     * @param start
+     * @param goal
+     * @return std::vector<geometry_msgs::msg::PoseStamped>
+     */
+    std::vector<geometry_msgs::msg::PoseStamped> createPlanSegment(
+      const geometry_msgs::msg::PoseStamped & start,
+      const geometry_msgs::msg::PoseStamped & goal) override;
+
     /**
     * @brief
     * @param state
@@ -75,6 +93,16 @@ namespace vox_nav_planning
     */
     bool isStateValid(const ompl::base::State * state) override;
 
+    /**
+     * @brief Check pose against full octomap and latest obstacle tracks, a pose closer to
+     * a track than its inflated radius is not valid
+     *
+     * @param pose
+     * @return true
+     * @return false
+     */
+    bool isPoseValid(const geometry_msgs::msg::PoseStamped & pose) override;
+
     /**
      * @brief
      *
@@ -117,6 +145,14 @@ namespace vox_nav_planning
       const pcl::PointXYZRGBA & a,
       const pcl::PointXYZRGBA & b);
 
+    /**
+     * @brief Keep latest obstacle tracks, they are turned into edge cost changes
+     * on next incremental (dstar_lite) query
+     *
+     * @param msg
+     */
+    void obstacleTracksCallback(const vox_nav_msgs::msg::ObjectArray::SharedPtr msg);
+
   protected:
     struct VertexProperty
     {
@@ -167,6 +203,8 @@ namespace vox_nav_planning
     // refer to PCL supervoxel_clustering for more details on algorithm
     rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr
       super_voxel_adjacency_marker_pub_;
+    std::shared_ptr<VisualizationQueue> supervoxel_visualization_queue_;
+    int max_supervoxel_markers_;
     SuperVoxelClusters supervoxel_clusters_;
 
     bool supervoxel_disable_transform_;
@@ -179,12 +217,157 @@ namespace vox_nav_planning
     float distance_penalty_weight_;
     float elevation_penalty_weight_;
 
-    std::string graph_search_method_; // astar ? , diskstra ?
+    std::string graph_search_method_; // astar ? , diskstra ? , dstar_lite ?
+
+    // D* Lite search state, kept between createPlan calls when graph_search_method_ is
+    // dstar_lite. A start move or edge cost change only repairs the affected vertices,
+    // the graph is rebuilt only if the goal changes or start leaves the graph
+    typedef std::pair<Cost, Cost> DStarKey;
+    GraphT incremental_graph_;
+    std::map<std::uint32_t, vertex_descriptor> incremental_label_id_map_;
+    // supervoxel centroids indexed by vertex_descriptor, used for heuristic and local queries
+    pcl::PointCloud<pcl::PointXYZRGBA>::Ptr vertex_centroids_;
+    pcl::KdTreeFLANN<pcl::PointXYZRGBA>::Ptr vertex_kdtree_;
+    float max_edge_length_;
+    std::vector<Cost> dstar_g_;
+    std::vector<Cost> dstar_rhs_;
+    std::vector<DStarKey> dstar_keys_;
+    std::vector<bool> dstar_in_queue_;
+    std::set<std::pair<DStarKey, vertex_descriptor>> dstar_queue_;
+    Cost dstar_km_;
+    vertex_descriptor dstar_start_vertex_;
+    vertex_descriptor dstar_goal_vertex_;
+    geometry_msgs::msg::PoseStamped dstar_goal_;
+    bool dstar_initialized_;
+    // edges made untraversable by obstacle tracks, stored as (min vertex, max vertex)
+    std::set<std::pair<vertex_descriptor, vertex_descriptor>> dstar_blocked_edges_;
+
+    rclcpp::Subscription<vox_nav_msgs::msg::ObjectArray>::SharedPtr obstacle_tracks_sub_;
+    vox_nav_msgs::msg::ObjectArray obstacle_tracks_;
+    std::mutex obstacle_tracks_mutex_;
+    double obstacle_inflation_radius_;
 
     std::string selected_se2_space_name_;
     ompl::base::ElevationStateSpace::SE2StateType se2_space_type_;
     // curve radius for reeds and dubins only
     double rho_;
+
+    /**
+     * @brief Supervoxelize surfels around start and goal and construct a boost::graph of
+     * supervoxel adjacency, edges in collision are skipped
+     *
+     * @param start
+     * @param goal
+     * @param g
+     * @param supervoxel_label_id_map
+     */
+    void buildSupervoxelGraph(
+      const geometry_msgs::msg::PoseStamped & start,
+      const geometry_msgs::msg::PoseStamped & goal,
+      GraphT & g,
+      std::map<std::uint32_t, vertex_descriptor> & supervoxel_label_id_map);
+
+    /**
+     * @brief Queue centroids and edges of graph for visualization, decimated to
+     * max_supervoxel_markers_, nothing is copied if there are no subscribers
+     *
+     * @param g
+     */
+    void publishSupervoxelGraph(const GraphT & g);
+
+    /**
+     * @brief weighted distance and elevation penalty between two supervoxel centroids
+     *
+     * @param a
+     * @param b
+     * @return Cost
+     */
+    Cost getEdgeCost(
+      const pcl::PointXYZRGBA & a,
+      const pcl::PointXYZRGBA & b);
+
+    /**
+     * @brief Get the closest vertex to pose, distance is set to centroid distance
+     *
+     * @param pose
+     * @param supervoxel_label_id_map
+     * @param distance
+     * @return vertex_descriptor
+     */
+    vertex_descriptor getNearestVertex(
+      const geometry_msgs::msg::PoseStamped & pose,
+      const std::map<std::uint32_t, vertex_descriptor> & supervoxel_label_id_map,
+      double & distance);
+
+    /**
+     * @brief Interpolate and smooth vertex path, and convert it to poses
+     *
+     * @param shortest_path
+     * @param g
+     * @param frame_id
+     * @return std::vector<geometry_msgs::msg::PoseStamped>
+     */
+    std::vector<geometry_msgs::msg::PoseStamped> vertexPathToPoses(
+      const std::list<vertex_descriptor> & shortest_path,
+      const GraphT & g,
+      const std::string & frame_id);
+
+    /**
+     * @brief Build a supervoxel graph around start and goal and search it with astar or
+     * dijkstra
+     *
+     * @param start
+     * @param goal
+     * @param search_method
+     * @return std::vector<geometry_msgs::msg::PoseStamped>
+     */
+    std::vector<geometry_msgs::msg::PoseStamped> createPlanOnNewGraph(
+      const geometry_msgs::msg::PoseStamped & start,
+      const geometry_msgs::msg::PoseStamped & goal,
+      const std::string & search_method);
+
+    /**
+     * @brief createPlan for dstar_lite, reuses search state of previous query if possible
+     *
+     * @param start
+     * @param goal
+     * @return std::vector<geometry_msgs::msg::PoseStamped>
+     */
+    std::vector<geometry_msgs::msg::PoseStamped> createPlanIncremental(
+      const geometry_msgs::msg::PoseStamped & start,
+      const geometry_msgs::msg::PoseStamped & goal);
+
+    /**
+     * @brief Reset D* Lite search state for the current incremental_graph_
+     *
+     */
+    void dstarInitialize(vertex_descriptor start_vertex, vertex_descriptor goal_vertex);
+
+    Cost dstarHeuristic(vertex_descriptor a, vertex_descriptor b);
+
+    DStarKey dstarCalculateKey(vertex_descriptor v);
+
+    void dstarUpdateVertex(vertex_descriptor v);
+
+    /**
+     * @brief Expand inconsistent vertices until start is consistent
+     *
+     * @param num_visited_nodes number of expansions done
+     */
+    void dstarComputeShortestPath(int & num_visited_nodes);
+
+    /**
+     * @brief Change cost of edge u-v and repair the search state around it
+     *
+     */
+    void dstarUpdateEdgeCost(vertex_descriptor u, vertex_descriptor v, Cost cost);
+
+    /**
+     * @brief Block edges passing through obstacle tracks, and restore edges
+     * that are no longer blocked, only edges close to obstacles are visited
+     *
+     */
+    void applyObstacleTracks();
   };
 
   // euclidean distance heuristic
@@ -20,6 +20,7 @@
 #include <memory>
 
 #include "vox_nav_planning/planner_core.hpp"
+#include "vox_nav_utilities/elevation_grid.hpp"
 /**
  * @brief
  *
@@ -102,6 +103,13 @@ namespace vox_nav_planning
     std::shared_ptr<ompl::base::RealVectorBounds> se2_bounds_;
     // curve radius for reeds and dubins only
     double rho_;
+    // 2.5D terrain layers, when enabled state validity is a lookup of footprint cells
+    vox_nav_utilities::ElevationGrid elevation_grid_;
+    vox_nav_utilities::TraversabilityLimits traversability_limits_;
+    bool elevation_grid_enabled_;
+    double elevation_grid_resolution_;
+    double robot_length_;
+    double robot_width_;
   };
 }  // namespace vox_nav_planning
 
@@ -0,0 +1,185 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_PLANNING__VISUALIZATION_QUEUE_HPP_
+#define VOX_NAV_PLANNING__VISUALIZATION_QUEUE_HPP_
+
+#include <rclcpp/rclcpp.hpp>
+#include <visualization_msgs/msg/marker_array.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace vox_nav_planning
+{
+
+/**
+ * @brief Publishes debug markers from a dedicated low priority thread.
+ * Planning code only enqueues a builder, markers are built and published by the thread
+ * at most rate times a second. Queue is bounded, when full the oldest builder is dropped.
+ * Nothing is built while the publisher has no subscribers, so planning latency does
+ * not depend on RViz being connected.
+ *
+ */
+  class VisualizationQueue
+  {
+  public:
+    typedef std::function<visualization_msgs::msg::MarkerArray()> MarkerBuilder;
+
+    /**
+     * @brief Construct a new Visualization Queue object and start its thread if enabled
+     *
+     * @param publisher
+     * @param enabled
+     * @param rate maximum number of publishes per second
+     * @param queue_size
+     */
+    VisualizationQueue(
+      const rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr & publisher,
+      bool enabled,
+      double rate,
+      int queue_size)
+    : publisher_(publisher),
+      enabled_(enabled),
+      period_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / std::max(rate, 1e-3)))),
+      queue_size_(std::max(queue_size, 1)),
+      stop_(false)
+    {
+      if (enabled_) {
+        thread_ = std::thread(&VisualizationQueue::run, this);
+#ifdef __linux__
+        sched_param param{};
+        param.sched_priority = 0;
+        pthread_setschedparam(thread_.native_handle(), SCHED_IDLE, &param);
+#endif
+      }
+    }
+
+    /**
+     * @brief Destroy the Visualization Queue object, pending builders are discarded
+     *
+     */
+    ~VisualizationQueue()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cv_.notify_one();
+      if (thread_.joinable()) {
+        thread_.join();
+      }
+    }
+
+    /**
+     * @brief Whether enqueued markers would be published at all,
+     * callers can skip collecting data for a builder when this is false
+     *
+     * @return true
+     * @return false
+     */
+    bool isActive() const
+    {
+      return enabled_ && publisher_->get_subscription_count() > 0;
+    }
+
+    /**
+     * @brief Queue a builder, it should capture the data it needs by value
+     *
+     * @param builder
+     */
+    void enqueue(MarkerBuilder builder)
+    {
+      if (!isActive()) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= queue_size_) {
+          queue_.pop_front();
+        }
+        queue_.push_back(std::move(builder));
+      }
+      cv_.notify_one();
+    }
+
+    /**
+     * @brief Stride that keeps num_elements under max_elements, 0 max_elements disables
+     * decimation
+     *
+     * @param num_elements
+     * @param max_elements
+     * @return size_t
+     */
+    static size_t decimationStride(size_t num_elements, size_t max_elements)
+    {
+      if (max_elements == 0 || num_elements <= max_elements) {
+        return 1;
+      }
+      return (num_elements + max_elements - 1) / max_elements;
+    }
+
+  private:
+    void run()
+    {
+      auto last_publish = std::chrono::steady_clock::now() - period_;
+      while (true) {
+        MarkerBuilder builder;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          cv_.wait(lock, [this] {return stop_ || !queue_.empty();});
+          if (stop_) {
+            return;
+          }
+          // rate limit, builders enqueued meanwhile may push out the oldest ones
+          auto next_publish = last_publish + period_;
+          if (cv_.wait_until(lock, next_publish, [this] {return stop_;})) {
+            return;
+          }
+          builder = std::move(queue_.front());
+          queue_.pop_front();
+        }
+        if (publisher_->get_subscription_count() > 0) {
+          publisher_->publish(builder());
+        }
+        last_publish = std::chrono::steady_clock::now();
+      }
+    }
+
+    rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr publisher_;
+    bool enabled_;
+    std::chrono::steady_clock::duration period_;
+    size_t queue_size_;
+
+    std::deque<MarkerBuilder> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+    std::thread thread_;
+  };
+
+}  // namespace vox_nav_planning
+
+#endif  // VOX_NAV_PLANNING__VISUALIZATION_QUEUE_HPP_
@@ -14,13 +14,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <utility>
 
@@ -50,10 +53,34 @@ namespace vox_nav_planning
     declare_parameter("robot_body_dimens.y", 0.8);
     declare_parameter("robot_body_dimens.z", 0.6);
     declare_parameter("robot_mesh_path", "");
+    declare_parameter(
+      "batch_planning_workers",
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
 
     get_parameter("expected_planner_frequency", expected_planner_frequency_);
     get_parameter("planner_plugin", planner_id_);
     get_parameter("robot_mesh_path", robot_mesh_path_);
+    get_parameter("batch_planning_workers", batch_planning_workers_);
+    declare_parameter("planner_profiling_enabled", true);
+    get_parameter("planner_profiling_enabled", planner_profiling_enabled_);
+
+    declare_parameter("plan_cache.enabled", false);
+    declare_parameter("plan_cache.capacity", 32);
+    declare_parameter("plan_cache.position_resolution", 0.25);
+    declare_parameter("plan_cache.yaw_resolution", 0.2);
+    get_parameter("plan_cache.enabled", plan_cache_enabled_);
+    get_parameter("plan_cache.capacity", plan_cache_capacity_);
+    get_parameter("plan_cache.position_resolution", plan_cache_position_resolution_);
+    get_parameter("plan_cache.yaw_resolution", plan_cache_yaw_resolution_);
+
+    declare_parameter("visualization.enabled", true);
+    declare_parameter("visualization.rate", 2.0);
+    declare_parameter("visualization.queue_size", 2);
+    declare_parameter("visualization.max_plan_markers", 200);
+    get_parameter("visualization.max_plan_markers", max_plan_markers_);
+    get_parameter("robot_body_dimens.x", robot_body_dimens_.x);
+    get_parameter("robot_body_dimens.y", robot_body_dimens_.y);
+    get_parameter("robot_body_dimens.z", robot_body_dimens_.z);
 
 
     declare_parameter(planner_id_ + ".plugin", planner_type_);
@@ -63,6 +90,7 @@ namespace vox_nav_planning
       vox_nav_planning::PlannerCore::Ptr planner =
         pc_loader_.createSharedInstance(planner_type_);
       planner->initialize(this, planner_id_);
+      planner->getProfile().setEnabled(planner_profiling_enabled_);
       RCLCPP_INFO(
         get_logger(), "Created planner plugin %s of type %s",
         planner_id_.c_str(), planner_type_.c_str());
@@ -91,6 +119,13 @@ namespace vox_nav_planning
     // Initialize pubs & subs
     plan_publisher_ = this->create_publisher<visualization_msgs::msg::MarkerArray>(
       "vox_nav/planning/plan", 1);
+    plan_visualization_queue_ = std::make_shared<VisualizationQueue>(
+      plan_publisher_,
+      get_parameter("visualization.enabled").as_bool(),
+      get_parameter("visualization.rate").as_double(),
+      get_parameter("visualization.queue_size").as_int());
+    plan_cache_stats_publisher_ = this->create_publisher<std_msgs::msg::UInt64MultiArray>(
+      "vox_nav/planning/plan_cache_stats", 1);
 
     this->action_server_ = rclcpp_action::create_server<ComputePathToPose>(
       this->get_node_base_interface(),
@@ -102,6 +137,18 @@ namespace vox_nav_planning
       std::bind(&PlannerServer::handle_cancel, this, std::placeholders::_1),
       std::bind(&PlannerServer::handle_accepted, this, std::placeholders::_1));
 
+    this->batch_action_server_ = rclcpp_action::create_server<ComputePathsToPoses>(
+      this->get_node_base_interface(),
+      this->get_node_clock_interface(),
+      this->get_node_logging_interface(),
+      this->get_node_waitables_interface(),
+      "compute_paths_to_poses",
+      std::bind(
+        &PlannerServer::handle_batch_goal, this, std::placeholders::_1,
+        std::placeholders::_2),
+      std::bind(&PlannerServer::handle_batch_cancel, this, std::placeholders::_1),
+      std::bind(&PlannerServer::handle_batch_accepted, this, std::placeholders::_1));
+
     tf_buffer_ = std::make_unique<tf2_ros::Buffer>(this->get_clock());
     tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
   }
@@ -111,6 +158,8 @@ namespace vox_nav_planning
     RCLCPP_INFO(get_logger(), "Destroying");
     planners_.clear();
     action_server_.reset();
+    batch_action_server_.reset();
+    plan_visualization_queue_.reset();
     plan_publisher_.reset();
     RCLCPP_INFO(get_logger(), "Shutting down");
   }
@@ -159,7 +208,27 @@ namespace vox_nav_planning
     vox_nav_utilities::getCurrentPose(start_pose, *tf_buffer_, "map", "base_link", 0.1);
     goal_pose = goal->pose;
 
+    std::unique_lock<std::mutex> profile_lock(profile_mutex_, std::defer_lock);
+    if (planner_profiling_enabled_) {
+      profile_lock.lock();
+    }
+    if (planners_.find(planner_id_) != planners_.end()) {
+      planners_[planner_id_]->getProfile().reset();
+    }
     result->path.poses = getPlan(start_pose, goal_pose, planner_id_);
+    if (planners_.find(planner_id_) != planners_.end() && planner_profiling_enabled_) {
+      const auto & profile = planners_[planner_id_]->getProfile();
+      profile.toMsg(result->profile);
+      for (size_t i = 0; i < result->profile.phases.size(); i++) {
+        RCLCPP_DEBUG(
+          get_logger(), "Planning phase %s: %lu calls, %.4f seconds",
+          result->profile.phases[i].c_str(), result->profile.calls[i],
+          result->profile.seconds[i]);
+      }
+    }
+    if (profile_lock.owns_lock()) {
+      profile_lock.unlock();
+    }
 
     if (result->path.poses.size() == 0) {
       RCLCPP_WARN(
@@ -214,6 +283,108 @@ namespace vox_nav_planning
     loop_rate.sleep();
   }
 
+  rclcpp_action::GoalResponse PlannerServer::handle_batch_goal(
+    const rclcpp_action::GoalUUID & uuid,
+    std::shared_ptr<const ComputePathsToPoses::Goal> goal)
+  {
+    (void)uuid;
+    if (!goal->starts.empty() && goal->starts.size() != goal->goals.size()) {
+      RCLCPP_WARN(
+        this->get_logger(), "Rejecting batch request, %u starts given for %u goals",
+        goal->starts.size(), goal->goals.size());
+      return rclcpp_action::GoalResponse::REJECT;
+    }
+    RCLCPP_INFO(
+      this->get_logger(), "Received goal request in order to compute %u paths",
+      goal->goals.size());
+    return rclcpp_action::GoalResponse::ACCEPT_AND_EXECUTE;
+  }
+
+  rclcpp_action::CancelResponse PlannerServer::handle_batch_cancel(
+    const std::shared_ptr<GoalHandleComputePathsToPoses> goal_handle)
+  {
+    RCLCPP_INFO(this->get_logger(), "Received request to cancel batch goal");
+    (void)goal_handle;
+    return rclcpp_action::CancelResponse::ACCEPT;
+  }
+
+  void PlannerServer::handle_batch_accepted(
+    const std::shared_ptr<GoalHandleComputePathsToPoses> goal_handle)
+  {
+    std::thread{std::bind(&PlannerServer::computePlans, this, std::placeholders::_1),
+      goal_handle}.detach();
+  }
+
+  void
+  PlannerServer::computePlans(const std::shared_ptr<GoalHandleComputePathsToPoses> goal_handle)
+  {
+    auto start_time = steady_clock_.now();
+
+    const auto goal = goal_handle->get_goal();
+    auto feedback = std::make_shared<ComputePathsToPoses::Feedback>();
+    auto result = std::make_shared<ComputePathsToPoses::Result>();
+
+    if (planners_.find(planner_id_) == planners_.end()) {
+      RCLCPP_ERROR(
+        get_logger(), "planner %s is not a valid planner. "
+        "Planner names are: %s", planner_id_.c_str(),
+        planner_ids_concat_.c_str());
+      goal_handle->abort(result);
+      return;
+    }
+
+    std::vector<geometry_msgs::msg::PoseStamped> starts(goal->starts.begin(), goal->starts.end());
+    std::vector<geometry_msgs::msg::PoseStamped> goals(goal->goals.begin(), goal->goals.end());
+    if (starts.empty() && !goals.empty()) {
+      // Chain the goals, first query starts from current robot pose
+      geometry_msgs::msg::PoseStamped robot_pose;
+      vox_nav_utilities::getCurrentPose(robot_pose, *tf_buffer_, "map", "base_link", 0.1);
+      starts.push_back(robot_pose);
+      starts.insert(starts.end(), goals.begin(), goals.end() - 1);
+    }
+
+    std::vector<double> planning_times;
+    std::unique_lock<std::mutex> profile_lock(profile_mutex_, std::defer_lock);
+    if (planner_profiling_enabled_) {
+      profile_lock.lock();
+    }
+    auto plans = planners_[planner_id_]->createPlans(
+      starts, goals, batch_planning_workers_, planning_times,
+      [goal_handle]() {return goal_handle->is_canceling();});
+    if (profile_lock.owns_lock()) {
+      profile_lock.unlock();
+    }
+
+    // Check if there is a cancel request
+    if (goal_handle->is_canceling()) {
+      goal_handle->canceled(result);
+      RCLCPP_INFO(get_logger(), "Goal was canceled. Canceling batch planning action.");
+      return;
+    }
+    feedback->elapsed_time = steady_clock_.now() - start_time;
+    goal_handle->publish_feedback(feedback);
+
+    int num_succeeded = 0;
+    for (size_t i = 0; i < plans.size(); i++) {
+      nav_msgs::msg::Path path;
+      path.header.frame_id = "map";
+      path.header.stamp = this->now();
+      path.poses = plans[i];
+      result->paths.push_back(path);
+      result->planning_times.push_back(rclcpp::Duration::from_seconds(planning_times[i]));
+      result->succeeded.push_back(!plans[i].empty());
+      num_succeeded += !plans[i].empty();
+    }
+
+    if (rclcpp::ok()) {
+      result->total_planning_time = steady_clock_.now() - start_time;
+      goal_handle->succeed(result);
+      RCLCPP_INFO(
+        this->get_logger(), "Batch goal Succeeded, found %d of %u paths in %.4f seconds",
+        num_succeeded, plans.size(), (steady_clock_.now() - start_time).seconds());
+    }
+  }
+
   std::vector<geometry_msgs::msg::PoseStamped>
   PlannerServer::getPlan(
     const geometry_msgs::msg::PoseStamped & start,
@@ -221,8 +392,36 @@ namespace vox_nav_planning
     const std::string & planner_id)
   {
     if (planners_.find(planner_id) != planners_.end()) {
+      std::string cache_key;
+      if (plan_cache_enabled_) {
+        cache_key = getPlanCacheKey(start, goal, planner_id);
+        std::vector<geometry_msgs::msg::PoseStamped> cached_plan;
+        bool hit = false;
+        if (lookupPlanCache(cache_key, cached_plan)) {
+          cached_plan = validateCachedPlan(cached_plan, planner_id);
+          hit = !cached_plan.empty();
+        }
+        {
+          const std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+          hit ? plan_cache_hits_++ : plan_cache_misses_++;
+          std_msgs::msg::UInt64MultiArray stats;
+          stats.data = {plan_cache_hits_, plan_cache_misses_, plan_cache_repairs_};
+          plan_cache_stats_publisher_->publish(stats);
+          RCLCPP_DEBUG(
+            get_logger(), "Plan cache hits: %lu misses: %lu repairs: %lu",
+            plan_cache_hits_, plan_cache_misses_, plan_cache_repairs_);
+        }
+        if (hit) {
+          RCLCPP_INFO(get_logger(), "Serving plan from cache");
+          insertPlanCache(cache_key, cached_plan);
+          return cached_plan;
+        }
+      }
       std::vector<geometry_msgs::msg::PoseStamped> plan =
         planners_[planner_id]->createPlan(start, goal);
+      if (plan_cache_enabled_ && !plan.empty()) {
+        insertPlanCache(cache_key, plan);
+      }
       return plan;
     } else {
       RCLCPP_ERROR(
@@ -235,75 +434,192 @@ namespace vox_nav_planning
     return std::vector<geometry_msgs::msg::PoseStamped>();
   }
 
+  std::string PlannerServer::getPlanCacheKey(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    const std::string & planner_id)
+  {
+    auto quantize = [](double value, double resolution) {
+        return static_cast<int64_t>(std::floor(value / resolution));
+      };
+    std::stringstream key;
+    for (auto && pose : {start, goal}) {
+      double void_s, yaw;
+      vox_nav_utilities::getRPYfromMsgQuaternion(pose.pose.orientation, void_s, void_s, yaw);
+      key << quantize(pose.pose.position.x, plan_cache_position_resolution_) << "," <<
+        quantize(pose.pose.position.y, plan_cache_position_resolution_) << "," <<
+        quantize(pose.pose.position.z, plan_cache_position_resolution_) << "," <<
+        quantize(yaw, plan_cache_yaw_resolution_) << ";";
+    }
+    key << planner_id << ";" << planners_[planner_id]->getMapVersion();
+    return key.str();
+  }
+
+  bool PlannerServer::lookupPlanCache(
+    const std::string & key,
+    std::vector<geometry_msgs::msg::PoseStamped> & plan)
+  {
+    const std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+    auto it = plan_cache_index_.find(key);
+    if (it == plan_cache_index_.end()) {
+      return false;
+    }
+    plan_cache_.splice(plan_cache_.begin(), plan_cache_, it->second);
+    plan = it->second->second;
+    return true;
+  }
+
+  void PlannerServer::insertPlanCache(
+    const std::string & key,
+    const std::vector<geometry_msgs::msg::PoseStamped> & plan)
+  {
+    const std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+    auto it = plan_cache_index_.find(key);
+    if (it != plan_cache_index_.end()) {
+      it->second->second = plan;
+      plan_cache_.splice(plan_cache_.begin(), plan_cache_, it->second);
+      return;
+    }
+    plan_cache_.emplace_front(key, plan);
+    plan_cache_index_[key] = plan_cache_.begin();
+    while (static_cast<int>(plan_cache_.size()) > std::max(1, plan_cache_capacity_)) {
+      plan_cache_index_.erase(plan_cache_.back().first);
+      plan_cache_.pop_back();
+    }
+  }
+
+  std::vector<geometry_msgs::msg::PoseStamped>
+  PlannerServer::validateCachedPlan(
+    const std::vector<geometry_msgs::msg::PoseStamped> & plan,
+    const std::string & planner_id)
+  {
+    auto & planner = planners_[planner_id];
+    // find first and last pose in collision, everything in between is replanned
+    int first_invalid = -1, last_invalid = -1;
+    for (int i = 0; i < static_cast<int>(plan.size()); i++) {
+      if (!planner->isPoseValid(plan[i])) {
+        if (first_invalid < 0) {
+          first_invalid = i;
+        }
+        last_invalid = i;
+      }
+    }
+    if (first_invalid < 0) {
+      return plan;
+    }
+    // start or goal itself is not valid anymore, nothing to repair
+    if (first_invalid == 0 || last_invalid == static_cast<int>(plan.size()) - 1) {
+      return std::vector<geometry_msgs::msg::PoseStamped>();
+    }
+
+    // live planner state (warm start, incremental search) belongs to requests, not to repairs
+    auto patch = planner->createPlanSegment(plan[first_invalid - 1], plan[last_invalid + 1]);
+    if (patch.empty()) {
+      return std::vector<geometry_msgs::msg::PoseStamped>();
+    }
+    std::vector<geometry_msgs::msg::PoseStamped> repaired_plan(
+      plan.begin(), plan.begin() + first_invalid - 1);
+    repaired_plan.insert(repaired_plan.end(), patch.begin(), patch.end());
+    repaired_plan.insert(repaired_plan.end(), plan.begin() + last_invalid + 2, plan.end());
+    {
+      const std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+      plan_cache_repairs_++;
+    }
+    RCLCPP_INFO(
+      get_logger(), "Repaired cached plan, replanned %d poses",
+      last_invalid - first_invalid + 1);
+    return repaired_plan;
+  }
+
   void PlannerServer::publishPlan(
     const std::vector<geometry_msgs::msg::PoseStamped> & path,
     const geometry_msgs::msg::PoseStamped & start_pose,
     const geometry_msgs::msg::PoseStamped & goal_pose)
   {
-    visualization_msgs::msg::MarkerArray marker_array;
-    visualization_msgs::msg::Marker start_marker, goal_marker;
-
-    auto path_idx = 0;
-    for (auto && i : path) {
-      visualization_msgs::msg::Marker marker;
-      marker.header.frame_id = "map";
-      marker.header.stamp = rclcpp::Clock().now();
-      marker.ns = "path";
-      marker.id = path_idx;
-      if (!robot_mesh_path_.empty()) {
-        marker.type = visualization_msgs::msg::Marker::MESH_RESOURCE;
-        marker.mesh_resource = robot_mesh_path_;
-      } else {
-        marker.type = visualization_msgs::msg::Marker::CUBE;
-      }
-      marker.action = visualization_msgs::msg::Marker::ADD;
-      marker.lifetime = rclcpp::Duration::from_seconds(0);
-      marker.text = std::to_string(path_idx);
-      marker.pose = i.pose;
-      marker.scale.x = get_parameter("robot_body_dimens.x").as_double() / 3;
-      marker.scale.y = get_parameter("robot_body_dimens.y").as_double() / 4;
-      marker.scale.z = get_parameter("robot_body_dimens.z").as_double() / 4;
-      marker.color.a = 0.5;
-      marker.color.r = 0.0;
-      marker.color.g = 1.0;
-      marker.color.b = 1.0;
-      marker_array.markers.push_back(marker);
-      start_marker = marker;
-      goal_marker = marker;
-
-      double void_s, yaw;
-      vox_nav_utilities::getRPYfromMsgQuaternion(i.pose.orientation, void_s, void_s, yaw);
-
-      visualization_msgs::msg::Marker text;
-      text.header.frame_id = "map";
-      text.header.stamp = rclcpp::Clock().now();
-      text.ns = "path";
-      text.id = path_idx + 1000;
-      text.type = visualization_msgs::msg::Marker::TEXT_VIEW_FACING;
-      text.action = visualization_msgs::msg::Marker::ADD;
-      text.lifetime = rclcpp::Duration::from_seconds(0);
-      //text.text = std::to_string(path_idx);
-      text.text = std::to_string(yaw);
-      text.pose = i.pose;
-      text.pose.position.z += 0.5;
-      text.scale.x = 0.3;
-      text.scale.y = 0.3;
-      text.scale.z = 0.3;
-      text.color.a = 1.0;
-      text.color.g = 1.0;
-      text.color.r = 1.0;
-      path_idx++;
-
-      marker_array.markers.push_back(text);
+    if (!plan_visualization_queue_->isActive()) {
+      return;
+    }
+    // Only decimated poses are copied here, markers are built by visualization thread
+    size_t stride = VisualizationQueue::decimationStride(path.size(), max_plan_markers_);
+    std::vector<geometry_msgs::msg::Pose> poses;
+    for (size_t i = 0; i < path.size(); i += stride) {
+      poses.push_back(path[i].pose);
+    }
+    if (!path.empty() && (path.size() - 1) % stride != 0) {
+      poses.push_back(path.back().pose);
     }
-    // Publish goal and start states for debuging
-    start_marker.pose = start_pose.pose;
-    start_marker.color.b = 0;
-    goal_marker.pose = goal_pose.pose;
-    goal_marker.color.b = 0;
-    marker_array.markers.push_back(start_marker);
-    marker_array.markers.push_back(goal_marker);
-    plan_publisher_->publish(marker_array);
+    plan_visualization_queue_->enqueue(
+      [poses, start = start_pose.pose, goal = goal_pose.pose,
+      robot_body_dimens = robot_body_dimens_, robot_mesh_path = robot_mesh_path_]() {
+        visualization_msgs::msg::MarkerArray marker_array;
+        auto stamp = rclcpp::Clock().now();
+
+        // Remove markers of previous plan, decimated plans may have less poses
+        visualization_msgs::msg::Marker delete_all;
+        delete_all.header.frame_id = "map";
+        delete_all.header.stamp = stamp;
+        delete_all.action = visualization_msgs::msg::Marker::DELETEALL;
+        marker_array.markers.push_back(delete_all);
+
+        visualization_msgs::msg::Marker marker;
+        marker.header.frame_id = "map";
+        marker.header.stamp = stamp;
+        marker.ns = "path";
+        if (!robot_mesh_path.empty()) {
+          marker.type = visualization_msgs::msg::Marker::MESH_RESOURCE;
+          marker.mesh_resource = robot_mesh_path;
+        } else {
+          marker.type = visualization_msgs::msg::Marker::CUBE;
+        }
+        marker.action = visualization_msgs::msg::Marker::ADD;
+        marker.lifetime = rclcpp::Duration::from_seconds(0);
+        marker.scale.x = robot_body_dimens.x / 3;
+        marker.scale.y = robot_body_dimens.y / 4;
+        marker.scale.z = robot_body_dimens.z / 4;
+        marker.color.a = 0.5;
+        marker.color.r = 0.0;
+        marker.color.g = 1.0;
+        marker.color.b = 1.0;
+
+        visualization_msgs::msg::Marker text;
+        text.header = marker.header;
+        text.ns = "path_yaw";
+        text.type = visualization_msgs::msg::Marker::TEXT_VIEW_FACING;
+        text.action = visualization_msgs::msg::Marker::ADD;
+        text.lifetime = rclcpp::Duration::from_seconds(0);
+        text.scale.x = 0.3;
+        text.scale.y = 0.3;
+        text.scale.z = 0.3;
+        text.color.a = 1.0;
+        text.color.g = 1.0;
+        text.color.r = 1.0;
+
+        for (size_t path_idx = 0; path_idx < poses.size(); path_idx++) {
+          marker.id = path_idx;
+          marker.text = std::to_string(path_idx);
+          marker.pose = poses[path_idx];
+          marker_array.markers.push_back(marker);
+
+          double void_s, yaw;
+          vox_nav_utilities::getRPYfromMsgQuaternion(
+            poses[path_idx].orientation, void_s, void_s, yaw);
+          text.id = path_idx;
+          text.text = std::to_string(yaw);
+          text.pose = poses[path_idx];
+          text.pose.position.z += 0.5;
+          marker_array.markers.push_back(text);
+        }
+
+        // Publish goal and start states for debuging
+        marker.color.b = 0;
+        marker.id = poses.size();
+        marker.pose = start;
+        marker_array.markers.push_back(marker);
+        marker.id = poses.size() + 1;
+        marker.pose = goal;
+        marker_array.markers.push_back(marker);
+        return marker_array;
+      });
   }
 }  // namespace vox_nav_planning
 
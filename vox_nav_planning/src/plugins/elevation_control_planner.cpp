@@ -23,6 +23,137 @@
 namespace vox_nav_planning
 {
 
+  CachedBicyclePropagator::CachedBicyclePropagator(
+    const ompl::control::SpaceInformationPtr & si,
+    const BicycleModelParameters & params,
+    const pcl::PointCloud<pcl::PointSurfel>::Ptr & elevated_surfel_cloud)
+  : ompl::control::StatePropagator(si),
+    params_(params),
+    elevated_surfel_cloud_(elevated_surfel_cloud)
+  {
+    auto linspace = [](double min, double max, int count) {
+        std::vector<double> values;
+        if (count < 2) {
+          values.push_back((min + max) / 2.0);
+          return values;
+        }
+        for (int i = 0; i < count; i++) {
+          values.push_back(min + i * (max - min) / (count - 1));
+        }
+        return values;
+      };
+    v_bins_ = linspace(params_.V_MIN, params_.V_MAX, params_.V_BINS);
+    df_bins_ = linspace(params_.DF_MIN, params_.DF_MAX, params_.DF_BINS);
+
+    // Each step continues from the end of previous one, so the whole table costs
+    // V_BINS * DF_BINS * MAX_STEPS propagation steps
+    primitives_.resize(v_bins_.size() * df_bins_.size() * params_.MAX_STEPS);
+    for (size_t i = 0; i < v_bins_.size(); i++) {
+      for (size_t j = 0; j < df_bins_.size(); j++) {
+        Primitive accumulated{0.0, 0.0, 0.0};
+        Primitive step = integrate(v_bins_[i], df_bins_[j], params_.DT);
+        for (int k = 0; k < params_.MAX_STEPS; k++) {
+          double c = std::cos(accumulated.dyaw);
+          double s = std::sin(accumulated.dyaw);
+          accumulated.dx += c * step.dx - s * step.dy;
+          accumulated.dy += s * step.dx + c * step.dy;
+          accumulated.dyaw += step.dyaw;
+          primitives_[(i * df_bins_.size() + j) * params_.MAX_STEPS + k] = accumulated;
+        }
+      }
+    }
+
+    elevated_surfel_kdtree_ = pcl::KdTreeFLANN<pcl::PointSurfel>::Ptr(
+      new pcl::KdTreeFLANN<pcl::PointSurfel>());
+    if (!elevated_surfel_cloud_->points.empty()) {
+      elevated_surfel_kdtree_->setInputCloud(elevated_surfel_cloud_);
+    }
+  }
+
+  CachedBicyclePropagator::Primitive CachedBicyclePropagator::integrate(
+    double v, double df, double duration) const
+  {
+    Primitive primitive{0.0, 0.0, 0.0};
+    int substeps = std::max(1, params_.INTEGRATION_SUBSTEPS);
+    double dt = duration / substeps;
+    double beta = std::atan(params_.L_R / (params_.L_F + params_.L_R) * std::tan(df));
+    for (int i = 0; i < substeps; i++) {
+      primitive.dx += v * std::cos(primitive.dyaw + beta) * dt;
+      primitive.dy += v * std::sin(primitive.dyaw + beta) * dt;
+      primitive.dyaw += v / params_.L_R * std::sin(beta) * dt;
+    }
+    return primitive;
+  }
+
+  int CachedBicyclePropagator::binIndex(const std::vector<double> & bins, double value) const
+  {
+    if (bins.size() < 2) {
+      return std::abs(bins.front() - value) < 1e-6 ? 0 : -1;
+    }
+    double resolution = (bins.back() - bins.front()) / (bins.size() - 1);
+    int index = std::lround((value - bins.front()) / resolution);
+    if (index < 0 || index >= static_cast<int>(bins.size()) ||
+      std::abs(bins[index] - value) > 1e-6)
+    {
+      return -1;
+    }
+    return index;
+  }
+
+  void CachedBicyclePropagator::propagate(
+    const ompl::base::State * state,
+    const ompl::control::Control * control,
+    const double duration,
+    ompl::base::State * result) const
+  {
+    const auto * cstate = state->as<ompl::base::ElevationStateSpace::StateType>();
+    const auto * se2 = cstate->as<ompl::base::SE2StateSpace::StateType>(0);
+    const auto * z = cstate->as<ompl::base::RealVectorStateSpace::StateType>(1);
+    const double * u =
+      control->as<ompl::control::RealVectorControlSpace::ControlType>()->values;
+
+    int v_index = binIndex(v_bins_, u[0]);
+    int df_index = binIndex(df_bins_, u[1]);
+    double steps = duration / params_.DT;
+    int step_index = std::lround(steps) - 1;
+
+    Primitive primitive;
+    if (v_index >= 0 && df_index >= 0 &&
+      step_index >= 0 && step_index < params_.MAX_STEPS &&
+      std::abs(steps - (step_index + 1)) < 1e-6)
+    {
+      primitive =
+        primitives_[(v_index * df_bins_.size() + df_index) * params_.MAX_STEPS + step_index];
+    } else {
+      primitive = integrate(u[0], u[1], duration);
+    }
+
+    double yaw = se2->getYaw();
+    double c = std::cos(yaw);
+    double s = std::sin(yaw);
+    double x = se2->getX() + c * primitive.dx - s * primitive.dy;
+    double y = se2->getY() + s * primitive.dx + c * primitive.dy;
+    double result_z = z->values[0];
+
+    // Keep the robot on the ground, take elevation of nearest surfel
+    if (!elevated_surfel_cloud_->points.empty()) {
+      pcl::PointSurfel search_point;
+      search_point.x = x;
+      search_point.y = y;
+      search_point.z = result_z;
+      std::vector<int> indices(1);
+      std::vector<float> sqr_distances(1);
+      if (elevated_surfel_kdtree_->nearestKSearch(search_point, 1, indices, sqr_distances) > 0) {
+        result_z = elevated_surfel_cloud_->points[indices[0]].z;
+      }
+    }
+
+    auto * cresult = result->as<ompl::base::ElevationStateSpace::StateType>();
+    cresult->setSE2(x, y, yaw + primitive.dyaw);
+    cresult->setZ(result_z);
+    si_->enforceBounds(result);
+  }
+
   ElevationControlPlanner::ElevationControlPlanner()
   {
   }
@@ -51,6 +182,23 @@ namespace vox_nav_planning
     parent->declare_parameter(plugin_name + ".state_space_boundries.maxy", 10.0);
     parent->declare_parameter(plugin_name + ".state_space_boundries.minz", -10.0);
     parent->declare_parameter(plugin_name + ".state_space_boundries.maxz", 10.0);
+    parent->declare_parameter(plugin_name + ".goal_tolerance", 1.0);
+    parent->declare_parameter(plugin_name + ".adaptive_bounds.enabled", false);
+    parent->declare_parameter(plugin_name + ".adaptive_bounds.margin", 5.0);
+    parent->declare_parameter(plugin_name + ".bicycle_model.L_F", bicycle_params_.L_F);
+    parent->declare_parameter(plugin_name + ".bicycle_model.L_R", bicycle_params_.L_R);
+    parent->declare_parameter(plugin_name + ".bicycle_model.V_MIN", bicycle_params_.V_MIN);
+    parent->declare_parameter(plugin_name + ".bicycle_model.V_MAX", bicycle_params_.V_MAX);
+    parent->declare_parameter(plugin_name + ".bicycle_model.DF_MIN", bicycle_params_.DF_MIN);
+    parent->declare_parameter(plugin_name + ".bicycle_model.DF_MAX", bicycle_params_.DF_MAX);
+    parent->declare_parameter(plugin_name + ".motion_primitives.v_bins", bicycle_params_.V_BINS);
+    parent->declare_parameter(plugin_name + ".motion_primitives.df_bins", bicycle_params_.DF_BINS);
+    parent->declare_parameter(plugin_name + ".motion_primitives.dt", bicycle_params_.DT);
+    parent->declare_parameter(
+      plugin_name + ".motion_primitives.max_steps", bicycle_params_.MAX_STEPS);
+    parent->declare_parameter(
+      plugin_name + ".motion_primitives.integration_substeps",
+      bicycle_params_.INTEGRATION_SUBSTEPS);
 
     parent->get_parameter("planner_name", planner_name_);
     parent->get_parameter("planner_timeout", planner_timeout_);
@@ -58,6 +206,22 @@ namespace vox_nav_planning
     parent->get_parameter("octomap_voxel_size", octomap_voxel_size_);
     parent->get_parameter(plugin_name + ".se2_space", selected_se2_space_name_);
     parent->get_parameter(plugin_name + ".rho", rho_);
+    parent->get_parameter(plugin_name + ".goal_tolerance", goal_tolerance_);
+    parent->get_parameter(plugin_name + ".adaptive_bounds.enabled", adaptive_bounds_enabled_);
+    parent->get_parameter(plugin_name + ".adaptive_bounds.margin", adaptive_bounds_margin_);
+    parent->get_parameter(plugin_name + ".bicycle_model.L_F", bicycle_params_.L_F);
+    parent->get_parameter(plugin_name + ".bicycle_model.L_R", bicycle_params_.L_R);
+    parent->get_parameter(plugin_name + ".bicycle_model.V_MIN", bicycle_params_.V_MIN);
+    parent->get_parameter(plugin_name + ".bicycle_model.V_MAX", bicycle_params_.V_MAX);
+    parent->get_parameter(plugin_name + ".bicycle_model.DF_MIN", bicycle_params_.DF_MIN);
+    parent->get_parameter(plugin_name + ".bicycle_model.DF_MAX", bicycle_params_.DF_MAX);
+    parent->get_parameter(plugin_name + ".motion_primitives.v_bins", bicycle_params_.V_BINS);
+    parent->get_parameter(plugin_name + ".motion_primitives.df_bins", bicycle_params_.DF_BINS);
+    parent->get_parameter(plugin_name + ".motion_primitives.dt", bicycle_params_.DT);
+    parent->get_parameter(plugin_name + ".motion_primitives.max_steps", bicycle_params_.MAX_STEPS);
+    parent->get_parameter(
+      plugin_name + ".motion_primitives.integration_substeps",
+      bicycle_params_.INTEGRATION_SUBSTEPS);
 
     se2_bounds_->setLow(
       0, parent->get_parameter(plugin_name + ".state_space_boundries.minx").as_double());
@@ -125,10 +289,49 @@ namespace vox_nav_planning
       *se2_bounds_,
       *z_bounds_);
 
-    simple_setup_ = std::make_shared<ompl::geometric::SimpleSetup>(state_space_);
-    simple_setup_->setOptimizationObjective(getOptimizationObjective());
-    simple_setup_->setStateValidityChecker(
-      std::bind(&ElevationControlPlanner::isStateValid, this, std::placeholders::_1));
+    state_space_->registerDefaultProjection(
+      std::make_shared<ElevationStateProjection>(state_space_.get(), octomap_voxel_size_ * 4.0));
+
+    // controls are; [0] linear velocity, [1] front steering angle
+    control_state_space_ = std::make_shared<ompl::control::RealVectorControlSpace>(
+      state_space_, 2);
+    ompl::base::RealVectorBounds control_bounds(2);
+    control_bounds.setLow(0, bicycle_params_.V_MIN);
+    control_bounds.setHigh(0, bicycle_params_.V_MAX);
+    control_bounds.setLow(1, bicycle_params_.DF_MIN);
+    control_bounds.setHigh(1, bicycle_params_.DF_MAX);
+    control_state_space_->as<ompl::control::RealVectorControlSpace>()->setBounds(control_bounds);
+
+    control_simple_setup_ = std::make_shared<ompl::control::SimpleSetup>(control_state_space_);
+    auto si = control_simple_setup_->getSpaceInformation();
+
+    state_propagator_ = std::make_shared<CachedBicyclePropagator>(
+      si, bicycle_params_, elevated_surfel_cloud_);
+    control_simple_setup_->setStatePropagator(state_propagator_);
+
+    control_state_space_->setControlSamplerAllocator(
+      [this](const ompl::control::ControlSpace * space) {
+        return std::make_shared<DiscreteBicycleControlSampler>(
+          space,
+          state_propagator_->getVelocityBins(),
+          state_propagator_->getSteeringBins());
+      });
+
+    // Durations are multiples of DT so that they land on cached primitives
+    si->setPropagationStepSize(bicycle_params_.DT);
+    si->setMinMaxControlDuration(1, bicycle_params_.MAX_STEPS);
+
+    control_simple_setup_->setOptimizationObjective(getOptimizationObjective());
+    control_simple_setup_->setStateValidityChecker(
+      [this](const ompl::base::State * state) {
+        ScopedPhaseTimer timer(profile_, PlanningPhase::STATE_VALIDITY);
+        return isStateValid(state);
+      });
+
+    RCLCPP_INFO(
+      logger_, "Cached %d x %d motion primitives for %d propagation steps of %.2f s",
+      bicycle_params_.V_BINS, bicycle_params_.DF_BINS,
+      bicycle_params_.MAX_STEPS, bicycle_params_.DT);
   }
 
   std::vector<geometry_msgs::msg::PoseStamped> ElevationControlPlanner::createPlan(
@@ -170,12 +373,24 @@ namespace vox_nav_planning
       nearest_elevated_surfel_to_goal_.pose.position.y, goal_yaw);
     se3_goal->setZ(nearest_elevated_surfel_to_goal_.pose.position.z);
 
-    simple_setup_->setStartAndGoalStates(se3_start, se3_goal);
+    if (adaptive_bounds_enabled_) {
+      ompl::base::RealVectorBounds request_se2_bounds(2), request_z_bounds(1);
+      vox_nav_utilities::determineAdaptiveBounds(
+        nearest_elevated_surfel_to_start_.pose.position,
+        nearest_elevated_surfel_to_goal_.pose.position,
+        map_min_, map_max_, adaptive_bounds_margin_,
+        request_se2_bounds, request_z_bounds);
+      state_space_->as<ompl::base::ElevationStateSpace>()->setBounds(
+        request_se2_bounds, request_z_bounds);
+    }
 
-    auto si = simple_setup_->getSpaceInformation();
+    // control planners hardly reach goal exactly, hence the tolerance
+    control_simple_setup_->setStartAndGoalStates(se3_start, se3_goal, goal_tolerance_);
+
+    auto si = control_simple_setup_->getSpaceInformation();
     // create a planner for the defined space
     ompl::base::PlannerPtr planner;
-    vox_nav_utilities::initializeSelectedPlanner(
+    vox_nav_utilities::initializeSelectedControlPlanner(
       planner,
       planner_name_,
       si,
@@ -186,20 +401,27 @@ namespace vox_nav_planning
         &ElevationControlPlanner::
         allocValidStateSampler, this, std::placeholders::_1));
 
-    simple_setup_->setPlanner(planner);
-    simple_setup_->setup();
-    //simple_setup_->print(std::cout);
+    control_simple_setup_->setPlanner(planner);
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::GRAPH_CONSTRUCTION);
+      control_simple_setup_->setup();
+    }
 
     // attempt to solve the problem within one second of planning time
-    ompl::base::PlannerStatus solved = simple_setup_->solve(planner_timeout_);
+    ompl::base::PlannerStatus solved;
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::SEARCH);
+      solved = control_simple_setup_->solve(planner_timeout_);
+    }
     std::vector<geometry_msgs::msg::PoseStamped> plan_poses;
 
     if (solved) {
-      ompl::geometric::PathGeometric solution_path = simple_setup_->getSolutionPath();
-      ompl::geometric::PathSimplifier * path_simlifier = new ompl::geometric::PathSimplifier(si);
-      solution_path.interpolate(interpolation_parameter_);
-      path_simlifier->smoothBSpline(solution_path, 1, 0.1);
+      // Do not smooth, it would break the kinodynamic feasibility of the solution.
+      // asGeometric() already contains states at each propagation step
+      ompl::geometric::PathGeometric solution_path =
+        control_simple_setup_->getSolutionPath().asGeometric();
 
+      ScopedPhaseTimer timer(profile_, PlanningPhase::CONVERSION);
       for (std::size_t path_idx = 0; path_idx < solution_path.getStateCount(); path_idx++) {
         const auto * cstate =
           solution_path.getState(path_idx)->as<ompl::base::ElevationStateSpace::StateType>();
@@ -229,7 +451,7 @@ namespace vox_nav_planning
         logger_, "No solution for requested path planning !");
     }
 
-    simple_setup_->clear();
+    control_simple_setup_->clear();
     return plan_poses;
   }
 
@@ -297,6 +519,7 @@ namespace vox_nav_planning
 
       if (response->is_valid) {
         is_map_ready_ = true;
+        map_version_++;
       } else {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         RCLCPP_INFO(
@@ -340,6 +563,16 @@ namespace vox_nav_planning
         surfel.normal_z = y;
         elevated_surfel_cloud_->points.push_back(surfel);
       }
+      if (!elevated_surfel_cloud_->points.empty()) {
+        pcl::PointSurfel min_surfel, max_surfel;
+        pcl::getMinMax3D(*elevated_surfel_cloud_, min_surfel, max_surfel);
+        map_min_.x = min_surfel.x;
+        map_min_.y = min_surfel.y;
+        map_min_.z = min_surfel.z;
+        map_max_.x = max_surfel.x;
+        map_max_.y = max_surfel.y;
+        map_max_.z = max_surfel.z;
+      }
 
       RCLCPP_INFO(
         logger_,
@@ -360,13 +593,14 @@ namespace vox_nav_planning
   {
     // select a optimizatio objective
     ompl::base::OptimizationObjectivePtr length_objective(
-      new ompl::base::PathLengthOptimizationObjective(simple_setup_->getSpaceInformation()));
+      new ompl::base::PathLengthOptimizationObjective(
+        control_simple_setup_->getSpaceInformation()));
     ompl::base::OptimizationObjectivePtr octocost_objective(
       new ompl::base::OctoCostOptimizationObjective(
-        simple_setup_->getSpaceInformation(), elevated_surfel_octomap_octree_));
+        control_simple_setup_->getSpaceInformation(), elevated_surfel_octomap_octree_));
 
     ompl::base::MultiOptimizationObjective * multi_optimization =
-      new ompl::base::MultiOptimizationObjective(simple_setup_->getSpaceInformation());
+      new ompl::base::MultiOptimizationObjective(control_simple_setup_->getSpaceInformation());
     multi_optimization->addObjective(length_objective, 1.0);
     multi_optimization->addObjective(octocost_objective, 1.0);
 
@@ -377,7 +611,7 @@ namespace vox_nav_planning
     const ompl::base::SpaceInformation * si)
   {
     auto valid_sampler = std::make_shared<ompl::base::OctoCellValidStateSampler>(
-      simple_setup_->getSpaceInformation(),
+      control_simple_setup_->getSpaceInformation(),
       nearest_elevated_surfel_to_start_,
       nearest_elevated_surfel_to_goal_,
       elevated_surfel_poses_msg_);
@@ -15,9 +15,13 @@
 #include "vox_nav_planning/plugins/elevation_planner.hpp"
 #include <pluginlib/class_list_macros.hpp>
 
+#include <algorithm>
 #include <memory>
+#include <queue>
 #include <random>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 namespace vox_nav_planning {
@@ -44,6 +48,28 @@ void ElevationPlanner::initialize(rclcpp::Node *parent,
   parent->declare_parameter(plugin_name + ".state_space_boundries.maxy", 10.0);
   parent->declare_parameter(plugin_name + ".state_space_boundries.minz", -10.0);
   parent->declare_parameter(plugin_name + ".state_space_boundries.maxz", 10.0);
+  parent->declare_parameter(plugin_name + ".hierarchical_planning.enabled",
+                            false);
+  parent->declare_parameter(plugin_name + ".hierarchical_planning.tile_size",
+                            5.0);
+  parent->declare_parameter(
+      plugin_name + ".hierarchical_planning.corridor_width", 1);
+  parent->declare_parameter(
+      plugin_name + ".hierarchical_planning.min_surfels_per_tile", 3);
+  parent->declare_parameter(
+      plugin_name + ".hierarchical_planning.max_tile_elevation_diff", 2.0);
+  parent->declare_parameter(plugin_name + ".esdf.enabled", false);
+  parent->declare_parameter(plugin_name + ".esdf.max_distance", 2.0);
+  parent->declare_parameter(plugin_name + ".footprint_masks.enabled", false);
+  parent->declare_parameter(
+      plugin_name + ".footprint_masks.exact_confirmation", true);
+  parent->declare_parameter(plugin_name + ".footprint_masks.yaw_bins", 36);
+  parent->declare_parameter(plugin_name + ".adaptive_bounds.enabled", false);
+  parent->declare_parameter(plugin_name + ".adaptive_bounds.margin", 5.0);
+  parent->declare_parameter(plugin_name + ".warm_start.enabled", false);
+  parent->declare_parameter(plugin_name + ".warm_start.max_start_shift", 2.0);
+  parent->declare_parameter(plugin_name + ".warm_start.max_goal_shift", 0.5);
+  parent->declare_parameter(plugin_name + ".warm_start.repair_timeout", 0.05);
 
   parent->get_parameter("planner_name", planner_name_);
   parent->get_parameter("planner_timeout", planner_timeout_);
@@ -51,6 +77,43 @@ void ElevationPlanner::initialize(rclcpp::Node *parent,
   parent->get_parameter("octomap_voxel_size", octomap_voxel_size_);
   parent->get_parameter(plugin_name + ".se2_space", selected_se2_space_name_);
   parent->get_parameter(plugin_name + ".rho", rho_);
+  parent->get_parameter(plugin_name + ".hierarchical_planning.enabled",
+                        hierarchical_planning_enabled_);
+  parent->get_parameter(plugin_name + ".hierarchical_planning.tile_size",
+                        tile_size_);
+  parent->get_parameter(plugin_name + ".hierarchical_planning.corridor_width",
+                        corridor_width_);
+  parent->get_parameter(
+      plugin_name + ".hierarchical_planning.min_surfels_per_tile",
+      min_surfels_per_tile_);
+  parent->get_parameter(
+      plugin_name + ".hierarchical_planning.max_tile_elevation_diff",
+      max_tile_elevation_diff_);
+  parent->get_parameter(plugin_name + ".esdf.enabled", esdf_enabled_);
+  parent->get_parameter(plugin_name + ".esdf.max_distance", esdf_max_distance_);
+  esdf_ = std::make_shared<vox_nav_utilities::ESDF>();
+  parent->get_parameter(plugin_name + ".footprint_masks.enabled",
+                        footprint_masks_enabled_);
+  parent->get_parameter(plugin_name + ".footprint_masks.exact_confirmation",
+                        footprint_masks_exact_confirmation_);
+  parent->get_parameter(plugin_name + ".footprint_masks.yaw_bins",
+                        footprint_masks_yaw_bins_);
+  footprint_masks_ = std::make_shared<vox_nav_utilities::FootprintMasks>();
+  parent->get_parameter(plugin_name + ".adaptive_bounds.enabled",
+                        adaptive_bounds_enabled_);
+  parent->get_parameter(plugin_name + ".adaptive_bounds.margin",
+                        adaptive_bounds_margin_);
+  parent->get_parameter(plugin_name + ".warm_start.enabled",
+                        warm_start_enabled_);
+  parent->get_parameter(plugin_name + ".warm_start.max_start_shift",
+                        warm_start_max_start_shift_);
+  parent->get_parameter(plugin_name + ".warm_start.max_goal_shift",
+                        warm_start_max_goal_shift_);
+  parent->get_parameter(plugin_name + ".warm_start.repair_timeout",
+                        warm_start_repair_timeout_);
+  corridor_active_ = false;
+  corridor_surfels_ = pcl::PointCloud<pcl::PointSurfel>::Ptr(
+      new pcl::PointCloud<pcl::PointSurfel>);
 
   se2_bounds_->setLow(
       0, parent->get_parameter(plugin_name + ".state_space_boundries.minx")
@@ -100,6 +163,16 @@ void ElevationPlanner::initialize(rclcpp::Node *parent,
   robot_collision_object_minimal_ =
       std::make_shared<fcl::CollisionObject>(robot_body_box_minimal_object);
 
+  // spheres of robot body, used for the ESDF test before exact collision check
+  double robot_x = parent->get_parameter("robot_body_dimens.x").as_double();
+  double robot_y = parent->get_parameter("robot_body_dimens.y").as_double();
+  double robot_z = parent->get_parameter("robot_body_dimens.z").as_double();
+  robot_inscribed_radius_ = std::min({robot_x, robot_y, robot_z}) / 2.0;
+  robot_circumscribed_radius_ =
+      std::sqrt(robot_x * robot_x + robot_y * robot_y + robot_z * robot_z) /
+      2.0;
+  robot_body_dimens_ = {robot_x, robot_y, robot_z};
+
   elevated_surfel_octomap_octree_ =
       std::make_shared<octomap::OcTree>(octomap_voxel_size_ / 4.0);
   original_octomap_octree_ =
@@ -118,6 +191,10 @@ void ElevationPlanner::initialize(rclcpp::Node *parent,
 
   setupMap();
 
+  if (hierarchical_planning_enabled_) {
+    buildCoarseTiles();
+  }
+
   // WARN elevated_surfel_poses_msg_ needs to be populated by setupMap();
   state_space_ = std::make_shared<ompl::base::ElevationStateSpace>(
       se2_space_type_, elevated_surfel_poses_msg_,
@@ -136,12 +213,20 @@ void ElevationPlanner::initialize(rclcpp::Node *parent,
   // simple_setup_->setOptimizationObjective(length_objective);
 
   simple_setup_->setStateValidityChecker(
-      std::bind(&ElevationPlanner::isStateValid, this, std::placeholders::_1));
+      [this](const ompl::base::State *state) {
+        ScopedPhaseTimer timer(profile_, PlanningPhase::STATE_VALIDITY);
+        return isStateValid(state);
+      });
+  simple_setup_->getSpaceInformation()->setMotionValidator(
+      std::make_shared<ProfiledMotionValidator>(
+          simple_setup_->getSpaceInformation(), profile_));
 }
 
 std::vector<geometry_msgs::msg::PoseStamped>
 ElevationPlanner::createPlan(const geometry_msgs::msg::PoseStamped &start,
                              const geometry_msgs::msg::PoseStamped &goal) {
+  // state_space_, simple_setup_ and corridor are mutated for each request
+  const std::lock_guard<std::mutex> lock(global_mutex_);
   if (!is_map_ready_) {
     RCLCPP_WARN(logger_,
                 "A valid Octomap has not been receievd yet, Try later again.");
@@ -174,6 +259,53 @@ ElevationPlanner::createPlan(const geometry_msgs::msg::PoseStamped &start,
                    nearest_elevated_surfel_to_goal_.pose.position.y, goal_yaw);
   se3_goal->setZ(nearest_elevated_surfel_to_goal_.pose.position.z);
 
+  // In hierarchical mode fine planner only explores the coarse corridor,
+  // otherwise the whole static state_space_boundries box
+  corridor_active_ = false;
+  if (hierarchical_planning_enabled_) {
+    ompl::base::RealVectorBounds corridor_se2_bounds(2), corridor_z_bounds(1);
+    if (findCorridor(nearest_elevated_surfel_to_start_,
+                     nearest_elevated_surfel_to_goal_, corridor_se2_bounds,
+                     corridor_z_bounds)) {
+      state_space_->as<ompl::base::ElevationStateSpace>()->setBounds(
+          corridor_se2_bounds, corridor_z_bounds);
+      corridor_active_ = true;
+    } else {
+      RCLCPP_WARN(logger_, "Could not find a coarse corridor, planning in "
+                           "whole state space.");
+    }
+  }
+  if (!corridor_active_ && adaptive_bounds_enabled_) {
+    ompl::base::RealVectorBounds request_se2_bounds(2), request_z_bounds(1);
+    vox_nav_utilities::determineAdaptiveBounds(
+        nearest_elevated_surfel_to_start_.pose.position,
+        nearest_elevated_surfel_to_goal_.pose.position, map_min_, map_max_,
+        adaptive_bounds_margin_, request_se2_bounds, request_z_bounds);
+    state_space_->as<ompl::base::ElevationStateSpace>()->setBounds(
+        request_se2_bounds, request_z_bounds);
+  } else if (!corridor_active_) {
+    state_space_->as<ompl::base::ElevationStateSpace>()->setBounds(*se2_bounds_,
+                                                                   *z_bounds_);
+  }
+
+  // Replans after small drift reuse still valid part of the previous solution
+  if (warm_start_enabled_) {
+    ompl::geometric::PathGeometric warm_start_path(
+        simple_setup_->getSpaceInformation());
+    if (warmStartPlan(se3_start.get(), se3_goal.get(), warm_start_path)) {
+      previous_solution_ =
+          std::make_shared<ompl::geometric::PathGeometric>(warm_start_path);
+      auto plan_poses =
+          solutionPathToPoses(warm_start_path,
+                              simple_setup_->getSpaceInformation(),
+                              start.header.frame_id);
+      RCLCPP_INFO(logger_,
+                  "Warm started a plan with %i poses from previous solution",
+                  plan_poses.size());
+      return plan_poses;
+    }
+  }
+
   simple_setup_->setStartAndGoalStates(se3_start, se3_goal);
 
   auto si = simple_setup_->getSpaceInformation();
@@ -182,66 +314,183 @@ ElevationPlanner::createPlan(const geometry_msgs::msg::PoseStamped &start,
   vox_nav_utilities::initializeSelectedPlanner(planner, planner_name_, si,
                                                logger_);
 
+  if (corridor_active_) {
+    si->setValidStateSamplerAllocator(
+        [this](const ompl::base::SpaceInformation *si) {
+          return std::make_shared<CorridorValidStateSampler>(
+              si, corridor_surfels_);
+        });
+  } else {
+    si->clearValidStateSamplerAllocator();
+  }
+
   // si->setValidStateSamplerAllocator(std::bind(
   //     &ElevationPlanner::allocValidStateSampler, this,
   //     std::placeholders::_1));
 
   simple_setup_->setPlanner(planner);
-  simple_setup_->setup();
+  {
+    ScopedPhaseTimer timer(profile_, PlanningPhase::GRAPH_CONSTRUCTION);
+    simple_setup_->setup();
+  }
   // simple_setup_->print(std::cout);
 
   // attempt to solve the problem within one second of planning time
-  ompl::base::PlannerStatus solved = simple_setup_->solve(planner_timeout_);
+  ompl::base::PlannerStatus solved;
+  {
+    ScopedPhaseTimer timer(profile_, PlanningPhase::SEARCH);
+    solved = simple_setup_->solve(planner_timeout_);
+  }
   std::vector<geometry_msgs::msg::PoseStamped> plan_poses;
 
   if (solved) {
     ompl::geometric::PathGeometric solution_path =
         simple_setup_->getSolutionPath();
-    ompl::geometric::PathSimplifier *path_simlifier =
-        new ompl::geometric::PathSimplifier(si);
-    solution_path.interpolate(interpolation_parameter_);
-    path_simlifier->smoothBSpline(solution_path, 1, 0.1);
-
-    for (std::size_t path_idx = 0; path_idx < solution_path.getStateCount();
-         path_idx++) {
-      const auto *cstate =
-          solution_path.getState(path_idx)
-              ->as<ompl::base::ElevationStateSpace::StateType>();
-      // cast the abstract state type to the type we expect
-      const auto *se2 = cstate->as<ompl::base::SE2StateSpace::StateType>(0);
-      // extract the second component of the state and cast it to what we expect
-      const auto *z =
-          cstate->as<ompl::base::RealVectorStateSpace::StateType>(1);
-      tf2::Quaternion this_pose_quat;
-      this_pose_quat.setRPY(0, 0, se2->getYaw());
-      geometry_msgs::msg::PoseStamped pose;
-      pose.header.frame_id = start.header.frame_id;
-      pose.header.stamp = rclcpp::Clock().now();
-      pose.pose.position.x = se2->getX();
-      pose.pose.position.y = se2->getY();
-      pose.pose.position.z = z->values[0];
-      pose.pose.orientation.x = this_pose_quat.getX();
-      pose.pose.orientation.y = this_pose_quat.getY();
-      pose.pose.orientation.z = this_pose_quat.getZ();
-      pose.pose.orientation.w = this_pose_quat.getW();
-      plan_poses.push_back(pose);
+    if (warm_start_enabled_) {
+      previous_solution_ =
+          std::make_shared<ompl::geometric::PathGeometric>(solution_path);
     }
+    plan_poses =
+        solutionPathToPoses(solution_path, si, start.header.frame_id);
 
     RCLCPP_INFO(logger_, "Found A plan with %i poses", plan_poses.size());
   } else {
     RCLCPP_WARN(logger_, "No solution for requested path planning !");
+    previous_solution_.reset();
   }
 
   simple_setup_->clear();
   return plan_poses;
 }
 
+bool ElevationPlanner::warmStartPlan(const ompl::base::State *start,
+                                     const ompl::base::State *goal,
+                                     ompl::geometric::PathGeometric &path) {
+  if (!previous_solution_ || previous_solution_->getStateCount() < 2) {
+    return false;
+  }
+  auto si = simple_setup_->getSpaceInformation();
+  // shifts are compared in meters, state space distance also weighs yaw
+  auto position_distance = [](const ompl::base::State *a,
+                              const ompl::base::State *b) {
+    const auto *a_state = a->as<ompl::base::ElevationStateSpace::StateType>();
+    const auto *b_state = b->as<ompl::base::ElevationStateSpace::StateType>();
+    const auto *a_se2 = a_state->as<ompl::base::SE2StateSpace::StateType>(0);
+    const auto *b_se2 = b_state->as<ompl::base::SE2StateSpace::StateType>(0);
+    const auto *a_z =
+        a_state->as<ompl::base::RealVectorStateSpace::StateType>(1);
+    const auto *b_z =
+        b_state->as<ompl::base::RealVectorStateSpace::StateType>(1);
+    return std::sqrt(std::pow(a_se2->getX() - b_se2->getX(), 2) +
+                     std::pow(a_se2->getY() - b_se2->getY(), 2) +
+                     std::pow(a_z->values[0] - b_z->values[0], 2));
+  };
+
+  const auto &previous_states = previous_solution_->getStates();
+  if (position_distance(previous_states.back(), goal) >
+      warm_start_max_goal_shift_) {
+    return false;
+  }
+  size_t closest = 0;
+  for (size_t i = 1; i < previous_states.size() - 1; i++) {
+    if (position_distance(previous_states[i], start) <
+        position_distance(previous_states[closest], start)) {
+      closest = i;
+    }
+  }
+  if (position_distance(previous_states[closest], start) >
+      warm_start_max_start_shift_) {
+    return false;
+  }
+  // robot may have already passed the closest state, then do not drive back
+  if (closest + 2 < previous_states.size() &&
+      position_distance(start, previous_states[closest + 1]) <
+          position_distance(previous_states[closest],
+                            previous_states[closest + 1])) {
+    closest++;
+  }
+
+  std::vector<const ompl::base::State *> waypoints;
+  waypoints.push_back(start);
+  for (size_t i = closest; i < previous_states.size() - 1; i++) {
+    waypoints.push_back(previous_states[i]);
+  }
+  waypoints.push_back(goal);
+
+  auto is_valid = [&si](const ompl::base::State *state) {
+    return si->satisfiesBounds(state) && si->isValid(state);
+  };
+  if (!is_valid(start) || !is_valid(goal)) {
+    return false;
+  }
+
+  path = ompl::geometric::PathGeometric(si);
+  path.append(start);
+  size_t anchor = 0;
+  while (anchor + 1 < waypoints.size()) {
+    size_t next = anchor + 1;
+    if (is_valid(waypoints[next]) &&
+        si->checkMotion(waypoints[anchor], waypoints[next])) {
+      path.append(waypoints[next]);
+      anchor = next;
+      continue;
+    }
+    // bridge from last valid state to first valid one after invalidated part
+    while (!is_valid(waypoints[next])) {
+      next++;
+    }
+    auto problem_definition =
+        std::make_shared<ompl::base::ProblemDefinition>(si);
+    problem_definition->setStartAndGoalStates(waypoints[anchor],
+                                              waypoints[next]);
+    auto repair_planner = std::make_shared<ompl::geometric::RRTConnect>(si);
+    repair_planner->setProblemDefinition(problem_definition);
+    repair_planner->setup();
+    ompl::base::PlannerStatus repaired;
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::SEARCH);
+      repaired = repair_planner->solve(warm_start_repair_timeout_);
+    }
+    if (repaired != ompl::base::PlannerStatus::EXACT_SOLUTION) {
+      RCLCPP_INFO(logger_, "Could not repair previous solution, replanning.");
+      return false;
+    }
+    const auto *segment =
+        problem_definition->getSolutionPath()
+            ->as<ompl::geometric::PathGeometric>();
+    for (size_t i = 1; i < segment->getStateCount(); i++) {
+      path.append(segment->getState(i));
+    }
+    anchor = next;
+  }
+  return true;
+}
+
 bool ElevationPlanner::isStateValid(const ompl::base::State *state) {
   const auto *cstate = state->as<ompl::base::ElevationStateSpace::StateType>();
   // cast the abstract state type to the type we expect
   const auto *se2 = cstate->as<ompl::base::SE2StateSpace::StateType>(0);
   // extract the second component of the state and cast it to what we expect
   const auto *z = cstate->as<ompl::base::RealVectorStateSpace::StateType>(1);
+
+  // cheap rejection of states outside coarse corridor, before any collision
+  if (corridor_active_ &&
+      !corridor_tiles_.count(
+          tileKey(static_cast<int>(std::floor(se2->getX() / tile_size_)),
+                  static_cast<int>(std::floor(se2->getY() / tile_size_))))) {
+    return false;
+  }
+
+  return isStateValid(state, robot_collision_object_.get(),
+                      robot_collision_object_minimal_.get());
+}
+
+bool ElevationPlanner::isStateValid(const ompl::base::State *state,
+                                    fcl::CollisionObject *robot,
+                                    fcl::CollisionObject *robot_minimal) {
+  const auto *cstate = state->as<ompl::base::ElevationStateSpace::StateType>();
+  const auto *se2 = cstate->as<ompl::base::SE2StateSpace::StateType>(0);
+  const auto *z = cstate->as<ompl::base::RealVectorStateSpace::StateType>(1);
   fcl::CollisionRequest requestType(1, false, 1, false);
   // check validity of state Fdefined by pos & rot
   fcl::Vec3f translation(se2->getX(), se2->getY(), z->values[0]);
@@ -250,23 +499,252 @@ bool ElevationPlanner::isStateValid(const ompl::base::State *state) {
   fcl::Quaternion3f rotation(myQuaternion.getX(), myQuaternion.getY(),
                              myQuaternion.getZ(), myQuaternion.getW());
 
-  robot_collision_object_->setTransform(rotation, translation);
-  robot_collision_object_minimal_->setTransform(rotation, translation);
+  // Full body check against map is a single distance lookup when the sphere
+  // test is conclusive, contact with surfels is always checked exactly
+  auto esdf_result = vox_nav_utilities::ESDF::ClearanceResult::UNKNOWN;
+  if (esdf_enabled_) {
+    esdf_result =
+        esdf_->checkClearance(se2->getX(), se2->getY(), z->values[0],
+                              robot_inscribed_radius_,
+                              robot_circumscribed_radius_);
+    if (esdf_result == vox_nav_utilities::ESDF::ClearanceResult::COLLISION) {
+      return false;
+    }
+  }
+
+  robot->setTransform(rotation, translation);
+  robot_minimal->setTransform(rotation, translation);
 
   fcl::CollisionResult collisionWithSurfelsResult, collisionWithFullMapResult;
 
-  fcl::collide(robot_collision_object_minimal_.get(),
-               elevated_surfels_collision_object_.get(), requestType,
-               collisionWithSurfelsResult);
+  fcl::collide(robot_minimal, elevated_surfels_collision_object_.get(),
+               requestType, collisionWithSurfelsResult);
+
+  if (esdf_result == vox_nav_utilities::ESDF::ClearanceResult::FREE) {
+    return collisionWithSurfelsResult.isCollision();
+  }
+
+  // body is only rotated around z here, so yaw binned masks are sufficient
+  if (footprint_masks_enabled_ && footprint_masks_->isReady()) {
+    if (footprint_masks_->isCollisionFree(se2->getX(), se2->getY(),
+                                          z->values[0], se2->getYaw())) {
+      return collisionWithSurfelsResult.isCollision();
+    }
+    if (!footprint_masks_exact_confirmation_) {
+      return false;
+    }
+  }
 
-  fcl::collide(robot_collision_object_.get(),
-               original_octomap_collision_object_.get(), requestType,
+  fcl::collide(robot, original_octomap_collision_object_.get(), requestType,
                collisionWithFullMapResult);
 
   return collisionWithSurfelsResult.isCollision() &&
          !collisionWithFullMapResult.isCollision();
 }
 
+std::vector<geometry_msgs::msg::PoseStamped>
+ElevationPlanner::createPlanSegment(
+    const geometry_msgs::msg::PoseStamped &start,
+    const geometry_msgs::msg::PoseStamped &goal) {
+  std::vector<double> planning_times;
+  auto plans = createPlans({start}, {goal}, 1, planning_times, nullptr);
+  return plans.empty() ? std::vector<geometry_msgs::msg::PoseStamped>()
+                       : plans.front();
+}
+
+std::vector<std::vector<geometry_msgs::msg::PoseStamped>>
+ElevationPlanner::createPlans(
+    const std::vector<geometry_msgs::msg::PoseStamped> &starts,
+    const std::vector<geometry_msgs::msg::PoseStamped> &goals,
+    int num_workers, std::vector<double> &planning_times,
+    const std::function<bool()> &is_canceled) {
+  size_t num_queries = std::min(starts.size(), goals.size());
+  std::vector<std::vector<geometry_msgs::msg::PoseStamped>> plans(num_queries);
+  planning_times.assign(num_queries, 0.0);
+  if (!is_map_ready_) {
+    RCLCPP_WARN(logger_,
+                "A valid Octomap has not been receievd yet, Try later again.");
+    return plans;
+  }
+  if (num_queries == 0) {
+    return plans;
+  }
+
+  // Corridor is computed per request, batch queries use the static bounds.
+  // Shared state_space_ and corridor_active_ belong to createPlan(), so workers
+  // plan in their own state spaces, all bounded by union of queries
+  ompl::base::RealVectorBounds union_se2_bounds(*se2_bounds_),
+      union_z_bounds(*z_bounds_);
+  if (adaptive_bounds_enabled_) {
+    union_se2_bounds.setLow(INFINITY);
+    union_se2_bounds.setHigh(-INFINITY);
+    union_z_bounds.setLow(INFINITY);
+    union_z_bounds.setHigh(-INFINITY);
+    for (size_t i = 0; i < num_queries; i++) {
+      ompl::base::RealVectorBounds request_se2_bounds(2), request_z_bounds(1);
+      vox_nav_utilities::determineAdaptiveBounds(
+          starts[i].pose.position, goals[i].pose.position, map_min_, map_max_,
+          adaptive_bounds_margin_, request_se2_bounds, request_z_bounds);
+      for (int d = 0; d < 2; d++) {
+        union_se2_bounds.low[d] =
+            std::min(union_se2_bounds.low[d], request_se2_bounds.low[d]);
+        union_se2_bounds.high[d] =
+            std::max(union_se2_bounds.high[d], request_se2_bounds.high[d]);
+      }
+      union_z_bounds.low[0] =
+          std::min(union_z_bounds.low[0], request_z_bounds.low[0]);
+      union_z_bounds.high[0] =
+          std::max(union_z_bounds.high[0], request_z_bounds.high[0]);
+    }
+  }
+
+  bool multi_query_planner =
+      planner_name_ == "PRMstar" || planner_name_ == "LazyPRMstar" ||
+      planner_name_ == "SPARS" || planner_name_ == "SPARStwo";
+  num_workers =
+      std::max(1, std::min(num_workers, static_cast<int>(num_queries)));
+  auto canceled = [&is_canceled]() { return is_canceled && is_canceled(); };
+
+  auto worker = [&](int worker_index) {
+    // maps are shared read only, anything mutated while planning, including
+    // the state space set up by SimpleSetup, is owned by the worker
+    auto state_space = std::make_shared<ompl::base::ElevationStateSpace>(
+        se2_space_type_, elevated_surfel_poses_msg_,
+        rho_ /*only valid for duins or reeds*/, false /*only valid for dubins*/);
+    state_space->setBounds(union_se2_bounds, union_z_bounds);
+    auto robot = std::make_shared<fcl::CollisionObject>(
+        robot_collision_object_->collisionGeometry(), fcl::Transform3f());
+    auto robot_minimal = std::make_shared<fcl::CollisionObject>(
+        robot_collision_object_minimal_->collisionGeometry(),
+        fcl::Transform3f());
+
+    ompl::geometric::SimpleSetup simple_setup(state_space);
+    simple_setup.setStateValidityChecker(
+        [this, robot, robot_minimal](const ompl::base::State *state) {
+          ScopedPhaseTimer timer(profile_, PlanningPhase::STATE_VALIDITY);
+          return isStateValid(state, robot.get(), robot_minimal.get());
+        });
+    auto si = simple_setup.getSpaceInformation();
+    si->setMotionValidator(
+        std::make_shared<ProfiledMotionValidator>(si, profile_));
+    ompl::base::PlannerPtr planner;
+    vox_nav_utilities::initializeSelectedPlanner(planner, planner_name_, si,
+                                                 logger_);
+    simple_setup.setPlanner(planner);
+
+    for (size_t i = worker_index; i < num_queries; i += num_workers) {
+      if (canceled()) {
+        break;
+      }
+      auto t1 = std::chrono::steady_clock::now();
+
+      geometry_msgs::msg::PoseStamped nearest_start, nearest_goal;
+      vox_nav_utilities::determineValidNearestGoalStart(
+          nearest_start, nearest_goal, starts[i], goals[i],
+          elevated_surfel_cloud_);
+
+      double start_yaw, goal_yaw, nan;
+      vox_nav_utilities::getRPYfromMsgQuaternion(starts[i].pose.orientation,
+                                                 nan, nan, start_yaw);
+      vox_nav_utilities::getRPYfromMsgQuaternion(goals[i].pose.orientation, nan,
+                                                 nan, goal_yaw);
+      ompl::base::ScopedState<ompl::base::ElevationStateSpace> se3_start(
+          state_space),
+          se3_goal(state_space);
+      se3_start->setSE2(nearest_start.pose.position.x,
+                        nearest_start.pose.position.y, start_yaw);
+      se3_start->setZ(nearest_start.pose.position.z);
+      se3_goal->setSE2(nearest_goal.pose.position.x,
+                       nearest_goal.pose.position.y, goal_yaw);
+      se3_goal->setZ(nearest_goal.pose.position.z);
+
+      simple_setup.setStartAndGoalStates(se3_start, se3_goal);
+      bool solved;
+      {
+        ScopedPhaseTimer timer(profile_, PlanningPhase::SEARCH);
+        // cancel request is polled by a thread of the condition, not on every
+        // iteration of the planner
+        solved = simple_setup.solve(ompl::base::plannerOrTerminationCondition(
+            ompl::base::timedPlannerTerminationCondition(planner_timeout_),
+            ompl::base::PlannerTerminationCondition(canceled, 0.05)));
+      }
+      if (solved) {
+        ompl::geometric::PathGeometric solution_path =
+            simple_setup.getSolutionPath();
+        plans[i] =
+            solutionPathToPoses(solution_path, si, starts[i].header.frame_id);
+      }
+
+      // Roadmap of multi query planners is reused by next query of this worker
+      if (multi_query_planner) {
+        simple_setup.getProblemDefinition()->clearSolutionPaths();
+        planner->clearQuery();
+      } else {
+        simple_setup.clear();
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - t1;
+      planning_times[i] = elapsed.count();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_workers; i++) {
+    workers.emplace_back(worker, i);
+  }
+  for (auto &&i : workers) {
+    i.join();
+  }
+
+  int num_solved = 0;
+  for (auto &&i : plans) {
+    num_solved += !i.empty();
+  }
+  RCLCPP_INFO(logger_, "Solved %d of %d batch queries with %d workers",
+              num_solved, num_queries, num_workers);
+  return plans;
+}
+
+std::vector<geometry_msgs::msg::PoseStamped>
+ElevationPlanner::solutionPathToPoses(
+    ompl::geometric::PathGeometric &solution_path,
+    const ompl::base::SpaceInformationPtr &si, const std::string &frame_id) {
+  std::vector<geometry_msgs::msg::PoseStamped> plan_poses;
+  {
+    ScopedPhaseTimer timer(profile_, PlanningPhase::SMOOTHING);
+    ompl::geometric::PathSimplifier path_simlifier(si);
+    solution_path.interpolate(interpolation_parameter_);
+    path_simlifier.smoothBSpline(solution_path, 1, 0.1);
+  }
+
+  ScopedPhaseTimer timer(profile_, PlanningPhase::CONVERSION);
+  for (std::size_t path_idx = 0; path_idx < solution_path.getStateCount();
+       path_idx++) {
+    const auto *cstate =
+        solution_path.getState(path_idx)
+            ->as<ompl::base::ElevationStateSpace::StateType>();
+    // cast the abstract state type to the type we expect
+    const auto *se2 = cstate->as<ompl::base::SE2StateSpace::StateType>(0);
+    // extract the second component of the state and cast it to what we expect
+    const auto *z =
+        cstate->as<ompl::base::RealVectorStateSpace::StateType>(1);
+    tf2::Quaternion this_pose_quat;
+    this_pose_quat.setRPY(0, 0, se2->getYaw());
+    geometry_msgs::msg::PoseStamped pose;
+    pose.header.frame_id = frame_id;
+    pose.header.stamp = rclcpp::Clock().now();
+    pose.pose.position.x = se2->getX();
+    pose.pose.position.y = se2->getY();
+    pose.pose.position.z = z->values[0];
+    pose.pose.orientation.x = this_pose_quat.getX();
+    pose.pose.orientation.y = this_pose_quat.getY();
+    pose.pose.orientation.z = this_pose_quat.getZ();
+    pose.pose.orientation.w = this_pose_quat.getW();
+    plan_poses.push_back(pose);
+  }
+  return plan_poses;
+}
+
 void ElevationPlanner::setupMap() {
   const std::lock_guard<std::mutex> lock(octomap_mutex_);
 
@@ -297,6 +775,7 @@ void ElevationPlanner::setupMap() {
 
     if (response->is_valid) {
       is_map_ready_ = true;
+      map_version_++;
     } else {
       std::this_thread::sleep_for(std::chrono::seconds(1));
       RCLCPP_INFO(
@@ -343,6 +822,16 @@ void ElevationPlanner::setupMap() {
       surfel.normal_z = y;
       elevated_surfel_cloud_->points.push_back(surfel);
     }
+    if (!elevated_surfel_cloud_->points.empty()) {
+      pcl::PointSurfel min_surfel, max_surfel;
+      pcl::getMinMax3D(*elevated_surfel_cloud_, min_surfel, max_surfel);
+      map_min_.x = min_surfel.x;
+      map_min_.y = min_surfel.y;
+      map_min_.z = min_surfel.z;
+      map_max_.x = max_surfel.x;
+      map_max_.y = max_surfel.y;
+      map_max_.z = max_surfel.z;
+    }
 
     RCLCPP_INFO(logger_,
                 "Recieved a valid Octomap with %d nodes, A FCL collision tree "
@@ -356,9 +845,200 @@ void ElevationPlanner::setupMap() {
                 " A FCL collision tree will be created from this "
                 "octomap for state validity (aka collision check)",
                 elevated_surfel_octomap_octree_->size());
+
+    if (footprint_masks_enabled_) {
+      footprint_masks_->buildMasks(
+          robot_body_dimens_[0], robot_body_dimens_[1], robot_body_dimens_[2],
+          original_octomap_octree_->getResolution(), footprint_masks_yaw_bins_);
+      footprint_masks_->setMap(original_octomap_octree_);
+      RCLCPP_INFO(logger_, "Built robot footprint masks with up to %d voxels",
+                  footprint_masks_->getMaxMaskSize());
+    }
+
+    if (esdf_enabled_) {
+      esdf_->build(original_octomap_octree_, esdf_max_distance_);
+      RCLCPP_INFO(logger_,
+                  "Built ESDF of %d voxels from Octomap for clearance queries",
+                  esdf_->size());
+    }
   }
 }
 
+void ElevationPlanner::buildCoarseTiles() {
+  coarse_tiles_.clear();
+  for (size_t i = 0; i < elevated_surfel_cloud_->points.size(); i++) {
+    const auto &surfel = elevated_surfel_cloud_->points[i];
+    int ix = static_cast<int>(std::floor(surfel.x / tile_size_));
+    int iy = static_cast<int>(std::floor(surfel.y / tile_size_));
+    auto inserted = coarse_tiles_.emplace(tileKey(ix, iy), CoarseTile());
+    auto &tile = inserted.first->second;
+    if (inserted.second) {
+      tile.ix = ix;
+      tile.iy = iy;
+      tile.z_min = INFINITY;
+      tile.z_max = -INFINITY;
+      tile.z_mean = 0.0;
+    }
+    tile.z_min = std::min(tile.z_min, static_cast<double>(surfel.z));
+    tile.z_max = std::max(tile.z_max, static_cast<double>(surfel.z));
+    tile.z_mean += surfel.z;
+    tile.surfel_indices.push_back(static_cast<int>(i));
+  }
+
+  // sparse tiles are most likely noise or edge of map, do not use them
+  for (auto it = coarse_tiles_.begin(); it != coarse_tiles_.end();) {
+    if (it->second.surfel_indices.size() <
+        static_cast<size_t>(std::max(0, min_surfels_per_tile_))) {
+      it = coarse_tiles_.erase(it);
+    } else {
+      it->second.z_mean /= it->second.surfel_indices.size();
+      ++it;
+    }
+  }
+
+  RCLCPP_INFO(logger_,
+              "Built %d coarse tiles of size %.2f from %d elevated surfels",
+              coarse_tiles_.size(), tile_size_,
+              elevated_surfel_cloud_->points.size());
+}
+
+bool ElevationPlanner::findCorridor(
+    const geometry_msgs::msg::PoseStamped &start,
+    const geometry_msgs::msg::PoseStamped &goal,
+    ompl::base::RealVectorBounds &se2_bounds,
+    ompl::base::RealVectorBounds &z_bounds) {
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  int64_t start_key = tileKey(
+      static_cast<int>(std::floor(start.pose.position.x / tile_size_)),
+      static_cast<int>(std::floor(start.pose.position.y / tile_size_)));
+  int64_t goal_key = tileKey(
+      static_cast<int>(std::floor(goal.pose.position.x / tile_size_)),
+      static_cast<int>(std::floor(goal.pose.position.y / tile_size_)));
+
+  if (!coarse_tiles_.count(start_key) || !coarse_tiles_.count(goal_key)) {
+    RCLCPP_WARN(logger_, "Start or goal is not on a valid coarse tile.");
+    return false;
+  }
+
+  const auto &goal_tile = coarse_tiles_.at(goal_key);
+  auto heuristic = [&](const CoarseTile &tile) {
+    return tile_size_ *
+           std::hypot(tile.ix - goal_tile.ix, tile.iy - goal_tile.iy);
+  };
+
+  // A* on 8-connected coarse tiles, elements are f, g and key of a tile
+  typedef std::tuple<double, double, int64_t> QueueElement;
+  std::priority_queue<QueueElement, std::vector<QueueElement>,
+                      std::greater<QueueElement>>
+      open;
+  std::unordered_map<int64_t, double> cost_so_far;
+  std::unordered_map<int64_t, int64_t> came_from;
+  cost_so_far[start_key] = 0.0;
+  came_from[start_key] = start_key;
+  open.push(
+      std::make_tuple(heuristic(coarse_tiles_.at(start_key)), 0.0, start_key));
+
+  bool found = false;
+  while (!open.empty()) {
+    int64_t current_key = std::get<2>(open.top());
+    double current_cost = std::get<1>(open.top());
+    open.pop();
+    // a cheaper path to this tile was found after this entry was pushed
+    if (current_cost > cost_so_far[current_key]) {
+      continue;
+    }
+    if (current_key == goal_key) {
+      found = true;
+      break;
+    }
+    const auto &current = coarse_tiles_.at(current_key);
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        if (dx == 0 && dy == 0) {
+          continue;
+        }
+        int64_t neighbour_key = tileKey(current.ix + dx, current.iy + dy);
+        auto neighbour_it = coarse_tiles_.find(neighbour_key);
+        if (neighbour_it == coarse_tiles_.end()) {
+          continue;
+        }
+        double dz = neighbour_it->second.z_mean - current.z_mean;
+        if (std::abs(dz) > max_tile_elevation_diff_) {
+          continue;
+        }
+        double step = tile_size_ * std::hypot(dx, dy);
+        double new_cost = current_cost + std::sqrt(step * step + dz * dz);
+        auto cost_it = cost_so_far.find(neighbour_key);
+        if (cost_it == cost_so_far.end() || new_cost < cost_it->second) {
+          cost_so_far[neighbour_key] = new_cost;
+          came_from[neighbour_key] = current_key;
+          open.push(std::make_tuple(new_cost + heuristic(neighbour_it->second),
+                                    new_cost, neighbour_key));
+        }
+      }
+    }
+  }
+
+  if (!found) {
+    RCLCPP_WARN(logger_,
+                "Coarse search could not connect start and goal tiles.");
+    return false;
+  }
+
+  // Widen the coarse path by corridor_width_ tiles to give fine planner room
+  corridor_tiles_.clear();
+  int num_path_tiles = 0;
+  for (int64_t key = goal_key;; key = came_from[key]) {
+    const auto &tile = coarse_tiles_.at(key);
+    for (int dx = -corridor_width_; dx <= corridor_width_; dx++) {
+      for (int dy = -corridor_width_; dy <= corridor_width_; dy++) {
+        int64_t corridor_key = tileKey(tile.ix + dx, tile.iy + dy);
+        if (coarse_tiles_.count(corridor_key)) {
+          corridor_tiles_.insert(corridor_key);
+        }
+      }
+    }
+    num_path_tiles++;
+    if (key == start_key) {
+      break;
+    }
+  }
+
+  corridor_surfels_->points.clear();
+  double minx = INFINITY, maxx = -INFINITY, miny = INFINITY, maxy = -INFINITY;
+  double minz = INFINITY, maxz = -INFINITY;
+  for (auto &&key : corridor_tiles_) {
+    const auto &tile = coarse_tiles_.at(key);
+    minx = std::min(minx, tile.ix * tile_size_);
+    maxx = std::max(maxx, (tile.ix + 1) * tile_size_);
+    miny = std::min(miny, tile.iy * tile_size_);
+    maxy = std::max(maxy, (tile.iy + 1) * tile_size_);
+    minz = std::min(minz, tile.z_min);
+    maxz = std::max(maxz, tile.z_max);
+    for (auto &&index : tile.surfel_indices) {
+      corridor_surfels_->points.push_back(
+          elevated_surfel_cloud_->points[index]);
+    }
+  }
+
+  se2_bounds.setLow(0, minx);
+  se2_bounds.setHigh(0, maxx);
+  se2_bounds.setLow(1, miny);
+  se2_bounds.setHigh(1, maxy);
+  z_bounds.setLow(0, minz - octomap_voxel_size_);
+  z_bounds.setHigh(0, maxz + octomap_voxel_size_);
+
+  auto t2 = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double, std::milli> ms_double = t2 - t1;
+  RCLCPP_INFO(logger_,
+              "Coarse path of %d tiles widened to a corridor of %d tiles with "
+              "%d surfels, took %.4f milliseconds",
+              num_path_tiles, corridor_tiles_.size(),
+              corridor_surfels_->points.size(), ms_double.count());
+  return true;
+}
+
 ompl::base::OptimizationObjectivePtr
 ElevationPlanner::getOptimizationObjective() {
   // select a optimizatio objective
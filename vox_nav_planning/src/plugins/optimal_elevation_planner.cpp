@@ -18,6 +18,8 @@
 #include <memory>
 #include <vector>
 #include <random>
+#include <limits>
+#include <algorithm>
 
 namespace vox_nav_planning
 {
@@ -59,7 +61,11 @@ namespace vox_nav_planning
     parent->declare_parameter(plugin_name + ".graph_search_method", "astar");
     parent->declare_parameter(plugin_name + ".se2_space", "REEDS");
     parent->declare_parameter(plugin_name + ".rho", 1.5);
-
+    parent->declare_parameter(plugin_name + ".obstacle_tracks_topic", "/vox_nav/tracking/objects");
+    parent->declare_parameter(plugin_name + ".obstacle_inflation_radius", 0.5);
+    parent->declare_parameter(plugin_name + ".visualization.enabled", true);
+    parent->declare_parameter(plugin_name + ".visualization.rate", 1.0);
+    parent->declare_parameter(plugin_name + ".visualization.max_supervoxel_markers", 2000);
 
     parent->get_parameter("interpolation_parameter", interpolation_parameter_);
     parent->get_parameter("octomap_voxel_size", octomap_voxel_size_);
@@ -80,6 +86,15 @@ namespace vox_nav_planning
     parent->get_parameter(plugin_name + ".graph_search_method", graph_search_method_);
     parent->get_parameter(plugin_name + ".se2_space", selected_se2_space_name_);
     parent->get_parameter(plugin_name + ".rho", rho_);
+    parent->get_parameter(plugin_name + ".obstacle_inflation_radius", obstacle_inflation_radius_);
+
+    dstar_initialized_ = false;
+    dstar_km_ = 0.0;
+    max_edge_length_ = 0.0;
+    vertex_centroids_ = pcl::PointCloud<pcl::PointXYZRGBA>::Ptr(
+      new pcl::PointCloud<pcl::PointXYZRGBA>);
+    vertex_kdtree_ = pcl::KdTreeFLANN<pcl::PointXYZRGBA>::Ptr(
+      new pcl::KdTreeFLANN<pcl::PointXYZRGBA>);
 
     if (selected_se2_space_name_ == "SE2") {
       se2_space_type_ = ompl::base::ElevationStateSpace::SE2StateType::SE2;
@@ -125,6 +140,20 @@ namespace vox_nav_planning
     super_voxel_adjacency_marker_pub_ =
       parent->create_publisher<visualization_msgs::msg::MarkerArray>(
       "vox_nav/supervoxel_adjacency_markers", rclcpp::SystemDefaultsQoS());
+    supervoxel_visualization_queue_ = std::make_shared<VisualizationQueue>(
+      super_voxel_adjacency_marker_pub_,
+      parent->get_parameter(plugin_name + ".visualization.enabled").as_bool(),
+      parent->get_parameter(plugin_name + ".visualization.rate").as_double(),
+      1);
+    max_supervoxel_markers_ =
+      parent->get_parameter(plugin_name + ".visualization.max_supervoxel_markers").as_int();
+
+    if (graph_search_method_ == "dstar_lite") {
+      obstacle_tracks_sub_ = parent->create_subscription<vox_nav_msgs::msg::ObjectArray>(
+        parent->get_parameter(plugin_name + ".obstacle_tracks_topic").as_string(),
+        rclcpp::SystemDefaultsQoS(),
+        std::bind(&OptimalElevationPlanner::obstacleTracksCallback, this, std::placeholders::_1));
+    }
 
     RCLCPP_INFO(
       logger_,
@@ -144,21 +173,140 @@ namespace vox_nav_planning
 
     simple_setup_ = std::make_shared<ompl::geometric::SimpleSetup>(state_space_);
     simple_setup_->setStateValidityChecker(
-      std::bind(&OptimalElevationPlanner::isStateValid, this, std::placeholders::_1));
+      [this](const ompl::base::State * state) {
+        ScopedPhaseTimer timer(profile_, PlanningPhase::STATE_VALIDITY);
+        return isStateValid(state);
+      });
   }
 
   std::vector<geometry_msgs::msg::PoseStamped> OptimalElevationPlanner::createPlan(
     const geometry_msgs::msg::PoseStamped & start,
     const geometry_msgs::msg::PoseStamped & goal)
   {
-    // get a stamp of time to calculate how much time this function costs
-    auto t1 = std::chrono::high_resolution_clock::now();
+    if (!is_map_ready_) {
+      RCLCPP_WARN(logger_, "A valid Octomap has not been recieved yet !, Try later again.");
+      return std::vector<geometry_msgs::msg::PoseStamped>();
+    }
 
+    if (graph_search_method_ == "dstar_lite") {
+      return createPlanIncremental(start, goal);
+    }
+    return createPlanOnNewGraph(start, goal, graph_search_method_);
+  }
+
+  std::vector<geometry_msgs::msg::PoseStamped> OptimalElevationPlanner::createPlanSegment(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal)
+  {
     if (!is_map_ready_) {
       RCLCPP_WARN(logger_, "A valid Octomap has not been recieved yet !, Try later again.");
       return std::vector<geometry_msgs::msg::PoseStamped>();
     }
+    // D* Lite state, including clusters its graph was built on, belongs to queries of
+    // createPlan. Segments are searched with astar and clusters are restored afterwards
+    const std::lock_guard<std::mutex> lock(global_mutex_);
+    SuperVoxelClusters clusters = supervoxel_clusters_;
+    auto plan_poses = createPlanOnNewGraph(
+      start, goal, graph_search_method_ == "dijkstra" ? "dijkstra" : "astar");
+    supervoxel_clusters_.swap(clusters);
+    return plan_poses;
+  }
+
+  std::vector<geometry_msgs::msg::PoseStamped> OptimalElevationPlanner::createPlanOnNewGraph(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    const std::string & search_method)
+  {
+    // get a stamp of time to calculate how much time this function costs
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    GraphT g;
+    std::map<std::uint32_t, vertex_descriptor> supervoxel_label_id_map;
+    buildSupervoxelGraph(start, goal, g, supervoxel_label_id_map);
+
+    // Match requested start and goal poses with valid vertexes on Graph
+    double start_dist_min, goal_dist_min;
+    vertex_descriptor start_vertex =
+      getNearestVertex(start, supervoxel_label_id_map, start_dist_min);
+    vertex_descriptor goal_vertex =
+      getNearestVertex(goal, supervoxel_label_id_map, goal_dist_min);
+
+    std::vector<vertex_descriptor> p(boost::num_vertices(g));
+    std::vector<Cost> d(boost::num_vertices(g));
+    std::vector<geometry_msgs::msg::PoseStamped> plan_poses;
+    RCLCPP_INFO(
+      logger_, "Running %s search on Constructed Boost Graph", search_method.c_str());
+    auto a1 = std::chrono::high_resolution_clock::now();
+
+    int num_visited_nodes = 0;
+    try {
+
+      if (supervoxel_clusters_.empty()) {
+        RCLCPP_WARN(
+          logger_, "Empty supervoxel clusters!,%s failed to find a valid path!",
+          search_method.c_str());
+        return plan_poses;
+      }
+
+      auto heuristic =
+        distance_heuristic<GraphT, Cost, SuperVoxelClusters *>(
+        &supervoxel_clusters_, goal_vertex, g);
+      auto c_visitor = custom_goal_visitor<vertex_descriptor>(goal_vertex, &num_visited_nodes);
+
+      // timer also stops when the search throws FoundGoal
+      ScopedPhaseTimer timer(profile_, PlanningPhase::SEARCH);
+      if (search_method == "dijkstra") {
+        boost::dijkstra_shortest_paths(
+          g, start_vertex,
+          boost::predecessor_map(&p[0]).distance_map(&d[0]).visitor(c_visitor));
+      } else { // astar
+        boost::astar_search_tree(
+          g, start_vertex, heuristic /*only difference*/,
+          boost::predecessor_map(&p[0]).distance_map(&d[0]).visitor(c_visitor));
+      }
+
+      // If a path found exception will be thrown and code block here
+      // Should not be eecuted. If code executed up until here,
+      // A path was NOT found. Warn user about it
+      RCLCPP_WARN(logger_, "%s search failed to find a valid path!", search_method.c_str());
+    } catch (FoundGoal found_goal) {
+      auto a2 = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double, std::milli> graph_search_ms_double = a2 - a1;
+      RCLCPP_INFO(
+        logger_, "Pure %s graph search took %.4f milliseconds.",
+        search_method.c_str(), graph_search_ms_double.count());
+
+      // Found a path to the goal, catch the exception
+      std::list<vertex_descriptor> shortest_path;
+      for (vertex_descriptor v = goal_vertex;; v = p[v]) {
+        shortest_path.push_front(v);
+        if (p[v] == v) {break;}
+      }
+      plan_poses = vertexPathToPoses(shortest_path, g, start.header.frame_id);
+    }
+
+    RCLCPP_INFO(
+      logger_, "A total of %d vertices were visited from a Boost Graph", num_visited_nodes);
+    RCLCPP_INFO(
+      logger_, "Found path with %s search %d which includes poses,",
+      search_method.c_str(), plan_poses.size());
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> ms_double = t2 - t1;
+    RCLCPP_INFO(
+      logger_, "Whole %s path finding function took %.4f milliseconds.",
+      search_method.c_str(), ms_double.count());
+
+    return plan_poses;
+  }
 
+  void OptimalElevationPlanner::buildSupervoxelGraph(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    GraphT & g,
+    std::map<std::uint32_t, vertex_descriptor> & supervoxel_label_id_map)
+  {
+    ScopedPhaseTimer timer(profile_, PlanningPhase::GRAPH_CONSTRUCTION);
     double radius = vox_nav_utilities::getEuclidianDistBetweenPoses(goal, start) / 2.0;
     auto search_point_pose = vox_nav_utilities::getLinearInterpolatedPose(goal, start);
     auto search_point_surfel = vox_nav_utilities::poseMsg2PCLSurfel(search_point_pose);
@@ -199,93 +347,14 @@ namespace vox_nav_planning
     std::multimap<std::uint32_t, std::uint32_t> supervoxel_adjacency;
     super.getSupervoxelAdjacency(supervoxel_adjacency);
 
-    // Lets visualize supervxoel centroids and its adjacency
-    // Yeah this looks cool but certainly computationally expensive
-    std_msgs::msg::Header header;
-    header.frame_id = "map";
-    header.stamp = rclcpp::Clock().now();
-    visualization_msgs::msg::MarkerArray marker_array;
-    // Publish empty to reset previous
-    super_voxel_adjacency_marker_pub_->publish(marker_array);
-    /*vox_nav_utilities::fillSuperVoxelMarkersfromAdjacency(
-      supervoxel_clusters_, supervoxel_adjacency, header, marker_array);*/
-
-    /////////////////////////////////////////////////////////////////////////////////////////////////
-    // CAREFUL , GONNA BE FUNCTIONIZED
-    int index = 0;
-    // To make a graph of the supervoxel adjacency,
-    // we need to iterate through the supervoxel adjacency multimap
-    for (auto label_itr = supervoxel_adjacency.cbegin();
-      label_itr != supervoxel_adjacency.cend(); )
-    {
-      // First get the label
-      std::uint32_t supervoxel_label = label_itr->first;
-      // Now get the supervoxel corresponding to the label
-      auto supervoxel = supervoxel_clusters_.at(supervoxel_label);
-      visualization_msgs::msg::Marker line_strip;
-      line_strip.header = header;
-      line_strip.ns = "supervoxel_markers_ns";
-      line_strip.id = index;
-      line_strip.type = visualization_msgs::msg::Marker::LINE_STRIP;
-      line_strip.action = visualization_msgs::msg::Marker::ADD;
-      line_strip.scale.x = 0.1;
-      geometry_msgs::msg::Point point;
-      point.x = supervoxel->centroid_.x;
-      point.y = supervoxel->centroid_.y;
-      point.z = supervoxel->centroid_.z;
-      std_msgs::msg::ColorRGBA yellow_color;
-      yellow_color.r = 1.0;
-      yellow_color.g = 1.0;
-      yellow_color.a = 0.4;
-
-      visualization_msgs::msg::Marker sphere;
-      sphere.header = header;
-      sphere.ns = "supervoxel_markers_ns";
-      sphere.id = index + 10000;
-      sphere.type = visualization_msgs::msg::Marker::SPHERE;
-      sphere.action = visualization_msgs::msg::Marker::ADD;
-      sphere.pose.position = point;
-      sphere.scale.x = 0.3;
-      sphere.scale.y = 0.3;
-      sphere.scale.z = 0.3;
-      sphere.color.a = 1.0;
-      sphere.color.g = 1.0;
-      sphere.color.b = 1.0;
-
-      for (auto adjacent_itr = supervoxel_adjacency.equal_range(supervoxel_label).first;
-        adjacent_itr != supervoxel_adjacency.equal_range(supervoxel_label).second; ++adjacent_itr)
-      {
-        auto neighbour_supervoxel = supervoxel_clusters_.at(adjacent_itr->second);
-        if (isEdgeinCollision(supervoxel->centroid_, neighbour_supervoxel->centroid_)) {
-          continue;
-        }
-        geometry_msgs::msg::Point n_point;
-        n_point.x = neighbour_supervoxel->centroid_.x;
-        n_point.y = neighbour_supervoxel->centroid_.y;
-        n_point.z = neighbour_supervoxel->centroid_.z;
-        line_strip.points.push_back(point);
-        line_strip.colors.push_back(yellow_color);
-        line_strip.points.push_back(n_point);
-        line_strip.colors.push_back(yellow_color);
-      }
-      // Move iterator forward to next label
-      label_itr = supervoxel_adjacency.upper_bound(supervoxel_label);
-      index++;
-      marker_array.markers.push_back(sphere);
-      marker_array.markers.push_back(line_strip);
-    }
-    // CAREFUL , GONNA BE FUNCTIONIZED
-    /////////////////////////////////////////////////////////////////////////////////////////////////////
-    super_voxel_adjacency_marker_pub_->publish(marker_array);
-
     // lets construct a boost::graph of supervoxels and the adjacency of them
     // we can then use all boost::graph algortihms on this graph
     // edge weights are set as distances or elevations, see the configration to
     // adjust the weights of penalties
-    GraphT g;
+    g.clear();
+    supervoxel_label_id_map.clear();
     WeightMap weightmap = get(boost::edge_weight, g);
     //Add a vertex for each label, store ids in a map
-    std::map<std::uint32_t, vertex_descriptor> supervoxel_label_id_map;
     for (auto it = supervoxel_adjacency.cbegin();
       it != supervoxel_adjacency.cend(); )
     {
@@ -317,16 +386,7 @@ namespace vox_nav_planning
         // Calc distance between centers, set this as edge weight
         // the more distane the heavier final cost
         if (edge_added) {
-          pcl::PointXYZRGBA centroid_data = supervoxel->centroid_;
-          pcl::PointXYZRGBA neighbour_centroid_data = neighbour_supervoxel->centroid_;
-
-          float absolute_distance = vox_nav_utilities::PCLPointEuclideanDist<>(
-            centroid_data,
-            neighbour_centroid_data);
-          // Lets also add elevation as weight
-          float absolute_elevation = std::abs(centroid_data.z - neighbour_centroid_data.z);
-          weightmap[e] = distance_penalty_weight_ * absolute_distance +
-            elevation_penalty_weight_ * absolute_elevation;
+          weightmap[e] = getEdgeCost(supervoxel->centroid_, neighbour_supervoxel->centroid_);
         }
       }
       it = supervoxel_adjacency.upper_bound(supervoxel_label);
@@ -338,134 +398,171 @@ namespace vox_nav_planning
       boost::num_vertices(g),
       boost::num_edges(g));
 
-    pcl::PointXYZRGBA start_as_pcl_point, goal_as_pcl_point;
-    start_as_pcl_point.x = start.pose.position.x;
-    start_as_pcl_point.y = start.pose.position.y;
-    start_as_pcl_point.z = start.pose.position.z;
-    goal_as_pcl_point.x = goal.pose.position.x;
-    goal_as_pcl_point.y = goal.pose.position.y;
-    goal_as_pcl_point.z = goal.pose.position.z;
+    publishSupervoxelGraph(g);
+  }
 
-    // Match requested start and goal poses with valid vertexes on Graph
-    vertex_descriptor start_vertex, goal_vertex;
+  void OptimalElevationPlanner::publishSupervoxelGraph(const GraphT & g)
+  {
+    if (!supervoxel_visualization_queue_->isActive()) {
+      return;
+    }
+    // Copy decimated centroids and collision free edges of graph, markers are built by
+    // visualization thread. Edges were already collision checked while adding them to graph
+    std::vector<geometry_msgs::msg::Point> centroids;
+    std::vector<geometry_msgs::msg::Point> edges;
+    size_t vertex_stride = VisualizationQueue::decimationStride(
+      boost::num_vertices(g), max_supervoxel_markers_);
+    size_t edge_stride = VisualizationQueue::decimationStride(
+      boost::num_edges(g), max_supervoxel_markers_);
+    auto toPoint = [this, &g](vertex_descriptor v) {
+        auto centroid = supervoxel_clusters_.at(g[v].label)->centroid_;
+        geometry_msgs::msg::Point point;
+        point.x = centroid.x;
+        point.y = centroid.y;
+        point.z = centroid.z;
+        return point;
+      };
+    for (vertex_descriptor v = 0; v < boost::num_vertices(g); v += vertex_stride) {
+      centroids.push_back(toPoint(v));
+    }
+    size_t edge_index = 0;
+    auto graph_edges = boost::edges(g);
+    for (auto it = graph_edges.first; it != graph_edges.second; ++it, ++edge_index) {
+      if (edge_index % edge_stride == 0) {
+        edges.push_back(toPoint(boost::source(*it, g)));
+        edges.push_back(toPoint(boost::target(*it, g)));
+      }
+    }
 
-    // Simple O(N) algorithm to find closest vertex to start and goal poses on boost::graph g
-    double start_dist_min = INFINITY, goal_dist_min = INFINITY;
-    for (auto itr = supervoxel_label_id_map.begin(); itr != supervoxel_label_id_map.end(); ++itr) {
+    supervoxel_visualization_queue_->enqueue(
+      [centroids, edges]() {
+        visualization_msgs::msg::MarkerArray marker_array;
+        std_msgs::msg::Header header;
+        header.frame_id = "map";
+        header.stamp = rclcpp::Clock().now();
+
+        visualization_msgs::msg::Marker spheres;
+        spheres.header = header;
+        spheres.ns = "supervoxel_markers_ns";
+        spheres.id = 0;
+        spheres.type = visualization_msgs::msg::Marker::SPHERE_LIST;
+        spheres.action = visualization_msgs::msg::Marker::ADD;
+        spheres.pose.orientation.w = 1.0;
+        spheres.scale.x = 0.3;
+        spheres.scale.y = 0.3;
+        spheres.scale.z = 0.3;
+        spheres.color.a = 1.0;
+        spheres.color.g = 1.0;
+        spheres.color.b = 1.0;
+        spheres.points = centroids;
+
+        visualization_msgs::msg::Marker lines;
+        lines.header = header;
+        lines.ns = "supervoxel_markers_ns";
+        lines.id = 1;
+        lines.type = visualization_msgs::msg::Marker::LINE_LIST;
+        lines.action = visualization_msgs::msg::Marker::ADD;
+        lines.pose.orientation.w = 1.0;
+        lines.scale.x = 0.1;
+        lines.color.r = 1.0;
+        lines.color.g = 1.0;
+        lines.color.a = 0.4;
+        lines.points = edges;
+
+        marker_array.markers.push_back(spheres);
+        marker_array.markers.push_back(lines);
+        return marker_array;
+      });
+  }
 
+  OptimalElevationPlanner::Cost OptimalElevationPlanner::getEdgeCost(
+    const pcl::PointXYZRGBA & a,
+    const pcl::PointXYZRGBA & b)
+  {
+    float absolute_distance = vox_nav_utilities::PCLPointEuclideanDist<>(a, b);
+    // Lets also add elevation as weight
+    float absolute_elevation = std::abs(a.z - b.z);
+    return distance_penalty_weight_ * absolute_distance +
+           elevation_penalty_weight_ * absolute_elevation;
+  }
+
+  OptimalElevationPlanner::vertex_descriptor OptimalElevationPlanner::getNearestVertex(
+    const geometry_msgs::msg::PoseStamped & pose,
+    const std::map<std::uint32_t, vertex_descriptor> & supervoxel_label_id_map,
+    double & distance)
+  {
+    pcl::PointXYZRGBA pose_as_pcl_point;
+    pose_as_pcl_point.x = pose.pose.position.x;
+    pose_as_pcl_point.y = pose.pose.position.y;
+    pose_as_pcl_point.z = pose.pose.position.z;
+
+    // Simple O(N) algorithm to find closest vertex to pose on boost::graph
+    vertex_descriptor nearest_vertex = 0;
+    distance = INFINITY;
+    for (auto itr = supervoxel_label_id_map.begin(); itr != supervoxel_label_id_map.end(); ++itr) {
       auto voxel_centroid = supervoxel_clusters_.at(itr->first)->centroid_;
-      auto start_dist_to_crr_voxel_centroid =
-        vox_nav_utilities::PCLPointEuclideanDist<>(start_as_pcl_point, voxel_centroid);
-      auto goal_dist_to_crr_voxel_centroid =
-        vox_nav_utilities::PCLPointEuclideanDist<>(goal_as_pcl_point, voxel_centroid);
-
-      if (start_dist_to_crr_voxel_centroid < start_dist_min) {
-        start_dist_min = start_dist_to_crr_voxel_centroid;
-        start_vertex = itr->second;
-      }
-      if (goal_dist_to_crr_voxel_centroid < goal_dist_min) {
-        goal_dist_min = goal_dist_to_crr_voxel_centroid;
-        goal_vertex = itr->second;
+      auto dist_to_crr_voxel_centroid =
+        vox_nav_utilities::PCLPointEuclideanDist<>(pose_as_pcl_point, voxel_centroid);
+      if (dist_to_crr_voxel_centroid < distance) {
+        distance = dist_to_crr_voxel_centroid;
+        nearest_vertex = itr->second;
       }
     }
-    std::vector<vertex_descriptor> p(boost::num_vertices(g));
-    std::vector<Cost> d(boost::num_vertices(g));
+    return nearest_vertex;
+  }
+
+  std::vector<geometry_msgs::msg::PoseStamped> OptimalElevationPlanner::vertexPathToPoses(
+    const std::list<vertex_descriptor> & shortest_path,
+    const GraphT & g,
+    const std::string & frame_id)
+  {
     std::vector<geometry_msgs::msg::PoseStamped> plan_poses;
     ompl::geometric::PathGeometricPtr solution_path =
       std::make_shared<ompl::geometric::PathGeometric>(simple_setup_->getSpaceInformation());
     ompl::geometric::PathSimplifierPtr path_simlifier =
       std::make_shared<ompl::geometric::PathSimplifier>(simple_setup_->getSpaceInformation());
-    RCLCPP_INFO(
-      logger_, "Running %s search on Constructed Boost Graph", graph_search_method_.c_str());
-    auto a1 = std::chrono::high_resolution_clock::now();
-
-    int num_visited_nodes = 0;
-    try {
 
-      if (supervoxel_clusters_.empty()) {
-        RCLCPP_WARN(
-          logger_, "Empty supervoxel clusters!,%s failed to find a valid path!",
-          graph_search_method_.c_str());
-        return plan_poses;
-      }
-
-      auto heuristic =
-        distance_heuristic<GraphT, Cost, SuperVoxelClusters *>(
-        &supervoxel_clusters_, goal_vertex, g);
-      auto c_visitor = custom_goal_visitor<vertex_descriptor>(goal_vertex, &num_visited_nodes);
-
-      if (graph_search_method_ == "dijkstra") {
-        boost::dijkstra_shortest_paths(
-          g, start_vertex,
-          boost::predecessor_map(&p[0]).distance_map(&d[0]).visitor(c_visitor));
-      } else { // astar
-        boost::astar_search_tree(
-          g, start_vertex, heuristic /*only difference*/,
-          boost::predecessor_map(&p[0]).distance_map(&d[0]).visitor(c_visitor));
-      }
-
-      // If a path found exception will be thrown and code block here
-      // Should not be eecuted. If code executed up until here,
-      // A path was NOT found. Warn user about it
-      RCLCPP_WARN(logger_, "%s search failed to find a valid path!", graph_search_method_.c_str());
-    } catch (FoundGoal found_goal) {
-      auto a2 = std::chrono::high_resolution_clock::now();
-      std::chrono::duration<double, std::milli> graph_search_ms_double = a2 - a1;
-      RCLCPP_INFO(
-        logger_, "Pure %s graph search took %.4f milliseconds.",
-        graph_search_method_.c_str(), graph_search_ms_double.count());
-
-      // Found a path to the goal, catch the exception
-      std::list<vertex_descriptor> shortest_path;
-      for (vertex_descriptor v = goal_vertex;; v = p[v]) {
-        shortest_path.push_front(v);
-        if (p[v] == v) {break;}
-      }
-      auto shortest_path_iterator = shortest_path.begin();
-      for (++shortest_path_iterator; shortest_path_iterator != shortest_path.end();
-        ++shortest_path_iterator)
-      {
-        // Match vertex_descriptor of current vertex in shortess_path to its eqiuvalent
-        // In supervoxel_label_id_map, do this to get
-        std::uint32_t label;
-        for (auto & i : supervoxel_label_id_map) {
-          if (i.second == *shortest_path_iterator) {
-            label = g[*shortest_path_iterator].label;
-            break;
-          }
-        }
-        // Fill the solution vertex to OMPL path
-        // tis is needed for path smoothing and interpolation
-        auto solution_state_position = supervoxel_clusters_.at(label)->centroid_;
-        auto solution_state = state_space_->allocState();
-        auto * compound_elevation_state =
-          solution_state->as<ompl::base::ElevationStateSpace::StateType>();
-        compound_elevation_state->setSE2(
-          solution_state_position.x,
-          solution_state_position.y,
-          0 /*assume a 0 yaw here*/);
-        compound_elevation_state->setZ(solution_state_position.z);
-        solution_path->append(compound_elevation_state);
-      }
+    auto shortest_path_iterator = shortest_path.begin();
+    for (++shortest_path_iterator; shortest_path_iterator != shortest_path.end();
+      ++shortest_path_iterator)
+    {
+      // Get the supervoxel label of current vertex in shortest_path
+      std::uint32_t label = g[*shortest_path_iterator].label;
+      // Fill the solution vertex to OMPL path
+      // tis is needed for path smoothing and interpolation
+      auto solution_state_position = supervoxel_clusters_.at(label)->centroid_;
+      auto solution_state = state_space_->allocState();
+      auto * compound_elevation_state =
+        solution_state->as<ompl::base::ElevationStateSpace::StateType>();
+      compound_elevation_state->setSE2(
+        solution_state_position.x,
+        solution_state_position.y,
+        0 /*assume a 0 yaw here*/);
+      compound_elevation_state->setZ(solution_state_position.z);
+      solution_path->append(compound_elevation_state);
+    }
 
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::SMOOTHING);
       solution_path->interpolate(interpolation_parameter_);    /*WARN TAKES A LOT OF TIME*/
       path_simlifier->smoothBSpline(*solution_path, 3, 0.2);   /*WARN TAKES A LOT OF TIME*/
+    }
 
-      // from OMPL to geometry_msgs
-      for (std::size_t path_idx = 0; path_idx < solution_path->getStateCount(); path_idx++) {
-        const auto * compound_elevation_state =
-          solution_path->getState(path_idx)->as<ompl::base::ElevationStateSpace::StateType>();
-        const auto * se2 = compound_elevation_state->as<ompl::base::DubinsStateSpace::StateType>(0);
-        const auto * z =
-          compound_elevation_state->as<ompl::base::RealVectorStateSpace::StateType>(1);
-        geometry_msgs::msg::PoseStamped pose;
-        pose.header.frame_id = start.header.frame_id;
-        pose.header.stamp = rclcpp::Clock().now();
-        pose.pose.position.x = se2->getX();
-        pose.pose.position.y = se2->getY();
-        pose.pose.position.z = z->values[0];
-        plan_poses.push_back(pose);
-      }
+    // from OMPL to geometry_msgs
+    ScopedPhaseTimer timer(profile_, PlanningPhase::CONVERSION);
+    for (std::size_t path_idx = 0; path_idx < solution_path->getStateCount(); path_idx++) {
+      const auto * compound_elevation_state =
+        solution_path->getState(path_idx)->as<ompl::base::ElevationStateSpace::StateType>();
+      const auto * se2 = compound_elevation_state->as<ompl::base::DubinsStateSpace::StateType>(0);
+      const auto * z =
+        compound_elevation_state->as<ompl::base::RealVectorStateSpace::StateType>(1);
+      geometry_msgs::msg::PoseStamped pose;
+      pose.header.frame_id = frame_id;
+      pose.header.stamp = rclcpp::Clock().now();
+      pose.pose.position.x = se2->getX();
+      pose.pose.position.y = se2->getY();
+      pose.pose.position.z = z->values[0];
+      plan_poses.push_back(pose);
     }
 
     for (size_t i = 1; i < plan_poses.size(); i++) {
@@ -478,22 +575,333 @@ namespace vox_nav_planning
       plan_poses[i].pose.orientation = vox_nav_utilities::getMsgQuaternionfromRPY(roll, pitch, yaw);
       roll = 0;
     }
+    return plan_poses;
+  }
 
+  std::vector<geometry_msgs::msg::PoseStamped> OptimalElevationPlanner::createPlanIncremental(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal)
+  {
+    const std::lock_guard<std::mutex> lock(global_mutex_);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<geometry_msgs::msg::PoseStamped> plan_poses;
+
+    // Previous search state can be reused if the goal is same and start is still on graph
+    bool reuse_search_state = dstar_initialized_ &&
+      vox_nav_utilities::getEuclidianDistBetweenPoses(goal, dstar_goal_) <
+      supervoxel_seed_resolution_;
+    vertex_descriptor start_vertex = 0;
+    if (reuse_search_state) {
+      pcl::PointXYZRGBA start_as_pcl_point;
+      start_as_pcl_point.x = start.pose.position.x;
+      start_as_pcl_point.y = start.pose.position.y;
+      start_as_pcl_point.z = start.pose.position.z;
+      std::vector<int> indices(1);
+      std::vector<float> sqr_distances(1);
+      reuse_search_state =
+        vertex_kdtree_->nearestKSearch(start_as_pcl_point, 1, indices, sqr_distances) > 0 &&
+        std::sqrt(sqr_distances[0]) < 2.0 * supervoxel_seed_resolution_;
+      if (reuse_search_state) {
+        start_vertex = indices[0];
+      }
+    }
+
+    if (!reuse_search_state) {
+      buildSupervoxelGraph(start, goal, incremental_graph_, incremental_label_id_map_);
+      if (supervoxel_clusters_.empty()) {
+        RCLCPP_WARN(logger_, "Empty supervoxel clusters!,dstar_lite failed to find a valid path!");
+        dstar_initialized_ = false;
+        return plan_poses;
+      }
+
+      // vecS graph, vertex descriptors are 0..N-1
+      vertex_centroids_->points.clear();
+      for (vertex_descriptor v = 0; v < boost::num_vertices(incremental_graph_); v++) {
+        vertex_centroids_->points.push_back(
+          supervoxel_clusters_.at(incremental_graph_[v].label)->centroid_);
+      }
+      vertex_centroids_->width = vertex_centroids_->points.size();
+      vertex_centroids_->height = 1;
+      vertex_kdtree_->setInputCloud(vertex_centroids_);
+
+      max_edge_length_ = 0.0;
+      auto edges = boost::edges(incremental_graph_);
+      for (auto it = edges.first; it != edges.second; ++it) {
+        float edge_length = vox_nav_utilities::PCLPointEuclideanDist<>(
+          vertex_centroids_->points[boost::source(*it, incremental_graph_)],
+          vertex_centroids_->points[boost::target(*it, incremental_graph_)]);
+        max_edge_length_ = std::max(max_edge_length_, edge_length);
+      }
+
+      double start_dist, goal_dist;
+      start_vertex = getNearestVertex(start, incremental_label_id_map_, start_dist);
+      vertex_descriptor goal_vertex = getNearestVertex(goal, incremental_label_id_map_, goal_dist);
+      dstarInitialize(start_vertex, goal_vertex);
+      dstar_goal_ = goal;
+      RCLCPP_INFO(logger_, "Initialized dstar_lite search state on a new graph");
+    } else if (start_vertex != dstar_start_vertex_) {
+      // start moved, keys in queue stay valid as lower bounds after km is increased
+      dstar_km_ += dstarHeuristic(dstar_start_vertex_, start_vertex);
+      dstar_start_vertex_ = start_vertex;
+    }
+
+    applyObstacleTracks();
+
+    auto a1 = std::chrono::high_resolution_clock::now();
+    int num_visited_nodes = 0;
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::SEARCH);
+      dstarComputeShortestPath(num_visited_nodes);
+    }
+    auto a2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> graph_search_ms_double = a2 - a1;
     RCLCPP_INFO(
-      logger_, "A total of %d vertices were visited from a Boost Graph", num_visited_nodes);
-    RCLCPP_INFO(
-      logger_, "Found path with %s search %d which includes poses,",
-      graph_search_method_.c_str(), plan_poses.size());
+      logger_, "Pure dstar_lite graph search took %.4f milliseconds, %d vertices were expanded.",
+      graph_search_ms_double.count(), num_visited_nodes);
+
+    if (dstar_g_[dstar_start_vertex_] == std::numeric_limits<Cost>::infinity()) {
+      RCLCPP_WARN(logger_, "dstar_lite search failed to find a valid path!");
+      return plan_poses;
+    }
+
+    // Follow the cheapest successor from start to goal
+    std::list<vertex_descriptor> shortest_path;
+    vertex_descriptor v = dstar_start_vertex_;
+    shortest_path.push_back(v);
+    WeightMap weightmap = get(boost::edge_weight, incremental_graph_);
+    while (v != dstar_goal_vertex_) {
+      Cost best_cost = std::numeric_limits<Cost>::infinity();
+      vertex_descriptor best_vertex = v;
+      auto out_edges = boost::out_edges(v, incremental_graph_);
+      for (auto it = out_edges.first; it != out_edges.second; ++it) {
+        vertex_descriptor s = boost::target(*it, incremental_graph_);
+        Cost cost = weightmap[*it] + dstar_g_[s];
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_vertex = s;
+        }
+      }
+      if (best_vertex == v || shortest_path.size() > boost::num_vertices(incremental_graph_)) {
+        RCLCPP_WARN(logger_, "dstar_lite could not extract a valid path!");
+        return plan_poses;
+      }
+      v = best_vertex;
+      shortest_path.push_back(v);
+    }
+
+    plan_poses = vertexPathToPoses(shortest_path, incremental_graph_, start.header.frame_id);
 
     auto t2 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> ms_double = t2 - t1;
     RCLCPP_INFO(
-      logger_, "Whole %s path finding function took %.4f milliseconds.",
-      graph_search_method_.c_str(), ms_double.count());
-
+      logger_, "Whole dstar_lite path finding function took %.4f milliseconds.",
+      ms_double.count());
     return plan_poses;
   }
 
+  void OptimalElevationPlanner::dstarInitialize(
+    vertex_descriptor start_vertex,
+    vertex_descriptor goal_vertex)
+  {
+    size_t num_vertices = boost::num_vertices(incremental_graph_);
+    dstar_g_.assign(num_vertices, std::numeric_limits<Cost>::infinity());
+    dstar_rhs_.assign(num_vertices, std::numeric_limits<Cost>::infinity());
+    dstar_keys_.assign(num_vertices, DStarKey(0.0, 0.0));
+    dstar_in_queue_.assign(num_vertices, false);
+    dstar_queue_.clear();
+    dstar_blocked_edges_.clear();
+    dstar_km_ = 0.0;
+    dstar_start_vertex_ = start_vertex;
+    dstar_goal_vertex_ = goal_vertex;
+
+    // search runs from goal to start, so that start can move without invalidating g values
+    dstar_rhs_[goal_vertex] = 0.0;
+    dstar_keys_[goal_vertex] = dstarCalculateKey(goal_vertex);
+    dstar_queue_.insert(std::make_pair(dstar_keys_[goal_vertex], goal_vertex));
+    dstar_in_queue_[goal_vertex] = true;
+    dstar_initialized_ = true;
+  }
+
+  OptimalElevationPlanner::Cost OptimalElevationPlanner::dstarHeuristic(
+    vertex_descriptor a,
+    vertex_descriptor b)
+  {
+    // Scaled by distance weight so that it never overestimates the edge costs
+    return distance_penalty_weight_ * vox_nav_utilities::PCLPointEuclideanDist<>(
+      vertex_centroids_->points[a], vertex_centroids_->points[b]);
+  }
+
+  OptimalElevationPlanner::DStarKey OptimalElevationPlanner::dstarCalculateKey(
+    vertex_descriptor v)
+  {
+    Cost min_g_rhs = std::min(dstar_g_[v], dstar_rhs_[v]);
+    return DStarKey(min_g_rhs + dstarHeuristic(dstar_start_vertex_, v) + dstar_km_, min_g_rhs);
+  }
+
+  void OptimalElevationPlanner::dstarUpdateVertex(vertex_descriptor v)
+  {
+    if (v != dstar_goal_vertex_) {
+      WeightMap weightmap = get(boost::edge_weight, incremental_graph_);
+      Cost rhs = std::numeric_limits<Cost>::infinity();
+      auto out_edges = boost::out_edges(v, incremental_graph_);
+      for (auto it = out_edges.first; it != out_edges.second; ++it) {
+        rhs = std::min(rhs, weightmap[*it] + dstar_g_[boost::target(*it, incremental_graph_)]);
+      }
+      dstar_rhs_[v] = rhs;
+    }
+    if (dstar_in_queue_[v]) {
+      dstar_queue_.erase(std::make_pair(dstar_keys_[v], v));
+      dstar_in_queue_[v] = false;
+    }
+    if (dstar_g_[v] != dstar_rhs_[v]) {
+      dstar_keys_[v] = dstarCalculateKey(v);
+      dstar_queue_.insert(std::make_pair(dstar_keys_[v], v));
+      dstar_in_queue_[v] = true;
+    }
+  }
+
+  void OptimalElevationPlanner::dstarComputeShortestPath(int & num_visited_nodes)
+  {
+    while (!dstar_queue_.empty() &&
+      (dstar_queue_.begin()->first < dstarCalculateKey(dstar_start_vertex_) ||
+      dstar_rhs_[dstar_start_vertex_] != dstar_g_[dstar_start_vertex_]))
+    {
+      DStarKey k_old = dstar_queue_.begin()->first;
+      vertex_descriptor u = dstar_queue_.begin()->second;
+      DStarKey k_new = dstarCalculateKey(u);
+      dstar_queue_.erase(dstar_queue_.begin());
+      if (k_old < k_new) {
+        dstar_keys_[u] = k_new;
+        dstar_queue_.insert(std::make_pair(k_new, u));
+        continue;
+      }
+      dstar_in_queue_[u] = false;
+      num_visited_nodes++;
+
+      if (dstar_g_[u] > dstar_rhs_[u]) {
+        dstar_g_[u] = dstar_rhs_[u];
+      } else {
+        dstar_g_[u] = std::numeric_limits<Cost>::infinity();
+        dstarUpdateVertex(u);
+      }
+      auto adjacent = boost::adjacent_vertices(u, incremental_graph_);
+      for (auto it = adjacent.first; it != adjacent.second; ++it) {
+        dstarUpdateVertex(*it);
+      }
+    }
+  }
+
+  void OptimalElevationPlanner::dstarUpdateEdgeCost(
+    vertex_descriptor u,
+    vertex_descriptor v,
+    Cost cost)
+  {
+    auto e = boost::edge(u, v, incremental_graph_);
+    if (!e.second) {
+      return;
+    }
+    WeightMap weightmap = get(boost::edge_weight, incremental_graph_);
+    weightmap[e.first] = cost;
+    dstarUpdateVertex(u);
+    dstarUpdateVertex(v);
+  }
+
+  void OptimalElevationPlanner::applyObstacleTracks()
+  {
+    vox_nav_msgs::msg::ObjectArray obstacle_tracks;
+    {
+      std::lock_guard<std::mutex> guard(obstacle_tracks_mutex_);
+      obstacle_tracks = obstacle_tracks_;
+    }
+
+    std::set<std::pair<vertex_descriptor, vertex_descriptor>> blocked_edges;
+    for (auto && obstacle : obstacle_tracks.objects) {
+      pcl::PointXYZRGBA center;
+      center.x = obstacle.world_pose.point.x;
+      center.y = obstacle.world_pose.point.y;
+      center.z = obstacle.world_pose.point.z;
+      double obstacle_radius =
+        std::max(obstacle.length, obstacle.width) / 2.0 + obstacle_inflation_radius_;
+
+      // An edge passing within obstacle_radius has an end within this radius
+      std::vector<int> indices;
+      std::vector<float> sqr_distances;
+      vertex_kdtree_->radiusSearch(
+        center, obstacle_radius + max_edge_length_, indices, sqr_distances);
+
+      for (auto && index : indices) {
+        vertex_descriptor u = index;
+        auto adjacent = boost::adjacent_vertices(u, incremental_graph_);
+        for (auto it = adjacent.first; it != adjacent.second; ++it) {
+          // closest point of segment u-v to obstacle center
+          Eigen::Vector3f a = vertex_centroids_->points[u].getVector3fMap();
+          Eigen::Vector3f b = vertex_centroids_->points[*it].getVector3fMap();
+          Eigen::Vector3f c = center.getVector3fMap();
+          Eigen::Vector3f ab = b - a;
+          float t = ab.squaredNorm() > 0.0 ? (c - a).dot(ab) / ab.squaredNorm() : 0.0;
+          t = std::min(1.0f, std::max(0.0f, t));
+          if ((a + t * ab - c).norm() < obstacle_radius) {
+            blocked_edges.insert(std::minmax(u, *it));
+          }
+        }
+      }
+    }
+
+    int num_changed_edges = 0;
+    for (auto && e : blocked_edges) {
+      if (!dstar_blocked_edges_.count(e)) {
+        dstarUpdateEdgeCost(e.first, e.second, std::numeric_limits<Cost>::infinity());
+        num_changed_edges++;
+      }
+    }
+    for (auto && e : dstar_blocked_edges_) {
+      if (!blocked_edges.count(e)) {
+        dstarUpdateEdgeCost(
+          e.first, e.second,
+          getEdgeCost(vertex_centroids_->points[e.first], vertex_centroids_->points[e.second]));
+        num_changed_edges++;
+      }
+    }
+    dstar_blocked_edges_ = blocked_edges;
+
+    if (num_changed_edges) {
+      // plans made before this update may run through blocked edges
+      map_version_++;
+      RCLCPP_INFO(
+        logger_, "Obstacle tracks changed cost of %d edges, %d edges are blocked",
+        num_changed_edges, dstar_blocked_edges_.size());
+    }
+  }
+
+  void OptimalElevationPlanner::obstacleTracksCallback(
+    const vox_nav_msgs::msg::ObjectArray::SharedPtr msg)
+  {
+    std::lock_guard<std::mutex> guard(obstacle_tracks_mutex_);
+    obstacle_tracks_ = *msg;
+    // tracks are only applied to the graph on next plan, but cached plans made before
+    // these tracks arrived are checked against the static map only, so invalidate them now
+    map_version_++;
+  }
+
+  bool OptimalElevationPlanner::isPoseValid(const geometry_msgs::msg::PoseStamped & pose)
+  {
+    if (!PlannerCore::isPoseValid(pose)) {
+      return false;
+    }
+    std::lock_guard<std::mutex> guard(obstacle_tracks_mutex_);
+    for (auto && obstacle : obstacle_tracks_.objects) {
+      double obstacle_radius =
+        std::max(obstacle.length, obstacle.width) / 2.0 + obstacle_inflation_radius_;
+      double dx = pose.pose.position.x - obstacle.world_pose.point.x;
+      double dy = pose.pose.position.y - obstacle.world_pose.point.y;
+      double dz = pose.pose.position.z - obstacle.world_pose.point.z;
+      if (dx * dx + dy * dy + dz * dz < obstacle_radius * obstacle_radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   bool OptimalElevationPlanner::isStateValid(const ompl::base::State * state)
   {
     const auto * cstate = state->as<ompl::base::ElevationStateSpace::StateType>();
@@ -526,6 +934,7 @@ namespace vox_nav_planning
     const pcl::PointXYZRGBA & a,
     const pcl::PointXYZRGBA & b)
   {
+    ScopedPhaseTimer timer(profile_, PlanningPhase::MOTION_VALIDITY);
     fcl::Vec3f edge_center(
       (a.x + b.x) / 2.0,
       (a.y + b.y) / 2.0,
@@ -586,6 +995,7 @@ namespace vox_nav_planning
 
       if (response->is_valid) {
         is_map_ready_ = true;
+        map_version_++;
       } else {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         RCLCPP_INFO(
@@ -48,6 +48,14 @@ namespace vox_nav_planning
     parent->declare_parameter(plugin_name + ".state_space_boundries.maxy", 10.0);
     parent->declare_parameter(plugin_name + ".state_space_boundries.minyaw", -3.14);
     parent->declare_parameter(plugin_name + ".state_space_boundries.maxyaw", 3.14);
+    parent->declare_parameter(plugin_name + ".adaptive_bounds.enabled", false);
+    parent->declare_parameter(plugin_name + ".adaptive_bounds.margin", 5.0);
+    parent->declare_parameter(plugin_name + ".elevation_grid.enabled", false);
+    parent->declare_parameter(plugin_name + ".elevation_grid.resolution", 0.0);
+    parent->declare_parameter(plugin_name + ".elevation_grid.max_slope", 0.35);
+    parent->declare_parameter(plugin_name + ".elevation_grid.max_roughness", 0.1);
+    parent->declare_parameter(plugin_name + ".elevation_grid.max_step", 0.2);
+    parent->declare_parameter(plugin_name + ".elevation_grid.allow_unknown", false);
 
     parent->get_parameter("planner_name", planner_name_);
     parent->get_parameter("planner_timeout", planner_timeout_);
@@ -56,6 +64,19 @@ namespace vox_nav_planning
     parent->get_parameter(plugin_name + ".se2_space", selected_se2_space_name_);
     parent->get_parameter(plugin_name + ".rho", rho_);
     parent->get_parameter(plugin_name + ".z_elevation", z_elevation_);
+    parent->get_parameter(plugin_name + ".adaptive_bounds.enabled", adaptive_bounds_enabled_);
+    parent->get_parameter(plugin_name + ".adaptive_bounds.margin", adaptive_bounds_margin_);
+    parent->get_parameter(plugin_name + ".elevation_grid.enabled", elevation_grid_enabled_);
+    parent->get_parameter(
+      plugin_name + ".elevation_grid.resolution", elevation_grid_resolution_);
+    parent->get_parameter(
+      plugin_name + ".elevation_grid.max_slope", traversability_limits_.max_slope);
+    parent->get_parameter(
+      plugin_name + ".elevation_grid.max_roughness", traversability_limits_.max_roughness);
+    parent->get_parameter(
+      plugin_name + ".elevation_grid.max_step", traversability_limits_.max_step);
+    parent->get_parameter(
+      plugin_name + ".elevation_grid.allow_unknown", traversability_limits_.allow_unknown);
 
     se2_bounds_->setLow(
       0, parent->get_parameter(plugin_name + ".state_space_boundries.minx").as_double());
@@ -91,6 +112,12 @@ namespace vox_nav_planning
     robot_collision_object_ = std::make_shared<fcl::CollisionObject>(robot_body_box_object);
     original_octomap_octree_ = std::make_shared<octomap::OcTree>(octomap_voxel_size_);
 
+    // Robot body is on flat ground, anything higher than bottom of body is an obstacle
+    robot_length_ = parent->get_parameter("robot_body_dimens.x").as_double();
+    robot_width_ = parent->get_parameter("robot_body_dimens.y").as_double();
+    traversability_limits_.max_elevation =
+      z_elevation_ - parent->get_parameter("robot_body_dimens.z").as_double() / 2.0;
+
     // service hooks for robot localization fromll service
     get_maps_and_surfels_client_node_ = std::make_shared
       <rclcpp::Node>("get_maps_and_surfels_client_node");
@@ -135,6 +162,16 @@ namespace vox_nav_planning
     se2_goal[1] = goal.pose.position.y;
     se2_goal[2] = goal_yaw;
 
+    if (adaptive_bounds_enabled_) {
+      ompl::base::RealVectorBounds request_se2_bounds(2), request_z_bounds(1);
+      vox_nav_utilities::determineAdaptiveBounds(
+        start.pose.position, goal.pose.position, map_min_, map_max_,
+        adaptive_bounds_margin_, request_se2_bounds, request_z_bounds);
+      state_space_->as<ompl::base::SE2StateSpace>()->setBounds(request_se2_bounds);
+    } else {
+      state_space_->as<ompl::base::SE2StateSpace>()->setBounds(*se2_bounds_);
+    }
+
     simple_setup_->setStartAndGoalStates(se2_start, se2_goal);
 
     // objective is to minimize the planned path
@@ -152,24 +189,33 @@ namespace vox_nav_planning
       logger_);
 
     simple_setup_->setPlanner(planner);
-    simple_setup_->setup();
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::GRAPH_CONSTRUCTION);
+      simple_setup_->setup();
+    }
     // print the settings for this space
     simple_setup_->print(std::cout);
 
     // attempt to solve the problem within one second of planning time
-    ompl::base::PlannerStatus solved = simple_setup_->solve(planner_timeout_);
+    ompl::base::PlannerStatus solved;
+    {
+      ScopedPhaseTimer timer(profile_, PlanningPhase::SEARCH);
+      solved = simple_setup_->solve(planner_timeout_);
+    }
     std::vector<geometry_msgs::msg::PoseStamped> plan_poses;
 
     if (solved) {
 
       ompl::geometric::PathGeometric solution_path = simple_setup_->getSolutionPath();
-      // Path smoothing using bspline
-      ompl::geometric::PathSimplifier * path_simlifier =
-        new ompl::geometric::PathSimplifier(simple_setup_->getSpaceInformation());
-
-      path_simlifier->smoothBSpline(solution_path, 3);
-      solution_path.interpolate(interpolation_parameter_);
+      {
+        ScopedPhaseTimer timer(profile_, PlanningPhase::SMOOTHING);
+        // Path smoothing using bspline
+        ompl::geometric::PathSimplifier path_simlifier(simple_setup_->getSpaceInformation());
+        path_simlifier.smoothBSpline(solution_path, 3);
+        solution_path.interpolate(interpolation_parameter_);
+      }
 
+      ScopedPhaseTimer timer(profile_, PlanningPhase::CONVERSION);
       for (std::size_t path_idx = 0; path_idx < solution_path.getStateCount(); path_idx++) {
         // cast the abstract state type to the type we expect
         const ompl::base::SE2StateSpace::StateType * se2_state =
@@ -204,6 +250,12 @@ namespace vox_nav_planning
     // cast the abstract state type to the type we expect
     const ompl::base::SE2StateSpace::StateType * se2_state =
       state->as<ompl::base::SE2StateSpace::StateType>();
+    if (elevation_grid_enabled_ && elevation_grid_.isReady()) {
+      // footprint cells against 2.5D terrain layers, replaces the FCL collision
+      return elevation_grid_.isFootprintTraversable(
+        se2_state->getX(), se2_state->getY(), se2_state->getYaw(),
+        robot_length_, robot_width_, traversability_limits_);
+    }
     // check validity of state Fdefined by pos & rot
     fcl::Vec3f translation(se2_state->getX(), se2_state->getY(), z_elevation_);
     tf2::Quaternion myQuaternion;
@@ -251,6 +303,7 @@ namespace vox_nav_planning
 
       if (response->is_valid) {
         is_map_ready_ = true;
+        map_version_++;
       } else {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         RCLCPP_INFO(
@@ -261,6 +314,8 @@ namespace vox_nav_planning
       auto original_octomap_octree =
         dynamic_cast<octomap::OcTree *>(octomap_msgs::fullMsgToMap(response->original_octomap));
       original_octomap_octree_ = std::make_shared<octomap::OcTree>(*original_octomap_octree);
+      original_octomap_octree_->getMetricMin(map_min_.x, map_min_.y, map_min_.z);
+      original_octomap_octree_->getMetricMax(map_max_.x, map_max_.y, map_max_.z);
 
       delete original_octomap_octree;
 
@@ -273,8 +328,25 @@ namespace vox_nav_planning
         "Recieved a valid Octomap with %d nodes, A FCL collision tree will be created from this "
         "octomap for state validity (aka collision check)", original_octomap_octree_->size());
 
+      if (elevation_grid_enabled_) {
+        if (elevation_grid_.build(original_octomap_octree_, elevation_grid_resolution_)) {
+          RCLCPP_INFO(
+            logger_,
+            "Built a %d x %d elevation grid, it is used for state validity instead of FCL",
+            elevation_grid_.getSizeX(), elevation_grid_.getSizeY());
+        } else {
+          RCLCPP_WARN(logger_, "Could not build elevation grid, falling back to FCL");
+        }
+      }
+
       simple_setup_->setStateValidityChecker(
-        std::bind(&SE2Planner::isStateValid, this, std::placeholders::_1));
+        [this](const ompl::base::State * state) {
+          ScopedPhaseTimer timer(profile_, PlanningPhase::STATE_VALIDITY);
+          return isStateValid(state);
+        });
+      simple_setup_->getSpaceInformation()->setMotionValidator(
+        std::make_shared<ProfiledMotionValidator>(
+          simple_setup_->getSpaceInformation(), profile_));
     }
   }
 
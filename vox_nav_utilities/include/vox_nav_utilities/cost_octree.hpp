@@ -0,0 +1,224 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__COST_OCTREE_HPP_
+#define VOX_NAV_UTILITIES__COST_OCTREE_HPP_
+
+#include <octomap/OcTreeNode.h>
+#include <octomap/OccupancyOcTreeBase.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace vox_nav_utilities
+{
+
+/**
+ * @brief What a voxel of a cost octree belongs to, so that the pcd map and
+ * elevated surfels can be kept in one tree
+ *
+ */
+  enum class CostLabel : uint8_t
+  {
+    UNKNOWN = 0,
+    TRAVERSABLE,
+    NON_TRAVERSABLE,
+    ELEVATED_SURFEL
+  };
+
+/**
+ * @brief Octree node with occupancy log odds plus a quantized traversability cost and a
+ * class label. Cost and label are single bytes that fit in the padding after the float
+ * log odds, so a node takes as much memory as an octomap::OcTreeNode, while the log odds
+ * field keeps meaning occupancy instead of being overloaded with cost.
+ *
+ */
+  class CostOcTreeNode : public octomap::OcTreeNode
+  {
+  public:
+    friend class CostOcTree;
+
+    CostOcTreeNode()
+    : octomap::OcTreeNode(),
+      cost_(0),
+      label_(static_cast<uint8_t>(CostLabel::UNKNOWN))
+    {
+    }
+
+    CostOcTreeNode(const CostOcTreeNode & rhs)
+    : octomap::OcTreeNode(rhs),
+      cost_(rhs.cost_),
+      label_(rhs.label_)
+    {
+    }
+
+    bool operator==(const CostOcTreeNode & rhs) const
+    {
+      return rhs.value == value && rhs.cost_ == cost_ && rhs.label_ == label_;
+    }
+
+    void copyData(const CostOcTreeNode & from)
+    {
+      octomap::OcTreeNode::copyData(from);
+      cost_ = from.cost_;
+      label_ = from.label_;
+    }
+
+    uint8_t getCost() const
+    {
+      return cost_;
+    }
+
+    void setCost(uint8_t cost)
+    {
+      cost_ = cost;
+    }
+
+    CostLabel getLabel() const
+    {
+      return static_cast<CostLabel>(label_);
+    }
+
+    void setLabel(CostLabel label)
+    {
+      label_ = static_cast<uint8_t>(label);
+    }
+
+    /**
+     * @brief log odds, cost and label, used by octomap (de)serialization
+     *
+     * @param s
+     * @return std::istream&
+     */
+    std::istream & readData(std::istream & s);
+    std::ostream & writeData(std::ostream & s) const;
+
+  protected:
+    uint8_t cost_;
+    uint8_t label_;
+  };
+
+/**
+ * @brief Occupancy octree of CostOcTreeNode. Inner nodes carry the highest cost of their
+ * children (and label of that child), so queries at coarse depths are conservative.
+ * Tree type is registered as "CostOcTree", hence it round trips through octomap_msgs
+ * full map messages like octomap::ColorOcTree does.
+ *
+ */
+  class CostOcTree : public octomap::OccupancyOcTreeBase<CostOcTreeNode>
+  {
+  public:
+    // highest cost, any cost above 1.0 (e.g. obstacles) is quantized to this
+    static constexpr uint8_t kLethalCost = 255;
+    static constexpr uint8_t kMaxTraversableCost = 254;
+
+    explicit CostOcTree(double resolution);
+
+    CostOcTree * create() const
+    {
+      return new CostOcTree(resolution);
+    }
+
+    std::string getTreeType() const
+    {
+      return "CostOcTree";
+    }
+
+    /**
+     * @brief Map a cost in [0, 1] to [0, kMaxTraversableCost], larger costs to kLethalCost
+     *
+     * @param cost
+     * @return uint8_t
+     */
+    static uint8_t quantizeCost(double cost);
+
+    /**
+     * @brief Inverse of quantizeCost, kLethalCost is returned as 2.0
+     *
+     * @param cost
+     * @return double
+     */
+    static double dequantizeCost(uint8_t cost);
+
+    /**
+     * @brief Children are collapsed only if their occupancy, cost and label are equal
+     *
+     * @param node
+     * @return true
+     * @return false
+     */
+    bool isNodeCollapsible(const CostOcTreeNode * node) const override;
+    bool pruneNode(CostOcTreeNode * node) override;
+
+    /**
+     * @brief Set cost and label of an existing node
+     *
+     * @param key
+     * @param cost
+     * @param label
+     * @return CostOcTreeNode* nullptr if there is no node at key
+     */
+    CostOcTreeNode * setNodeCost(const octomap::OcTreeKey & key, uint8_t cost, CostLabel label);
+
+    /**
+     * @brief Set occupancy, cost and label of the node containing key at given depth,
+     * e.g. to keep coarse map voxels and fine cells in one tree. Nodes on the way are created,
+     * a coarser leaf on the way is expanded so its value is kept around the new node, and
+     * children of the node are deleted. Call updateInnerOccupancy afterwards.
+     *
+     * @param key
+     * @param depth 0 or tree depth sets a leaf at finest resolution
+     * @param log_odds
+     * @param cost
+     * @param label
+     * @return CostOcTreeNode*
+     */
+    CostOcTreeNode * setNodeValueAtDepth(
+      const octomap::OcTreeKey & key, unsigned int depth,
+      float log_odds, uint8_t cost, CostLabel label);
+
+    /**
+     * @brief Update occupancy, cost and label of all inner nodes,
+     * call after updates with lazy evaluation
+     *
+     */
+    void updateInnerOccupancy();
+
+  protected:
+    void updateInnerOccupancyRecurs(CostOcTreeNode * node, unsigned int depth);
+
+    /**
+     * @brief Registers CostOcTree to octomap's tree factory, so that
+     * AbstractOcTree::createTree (used by octomap_msgs::fullMsgToMap) knows it
+     *
+     */
+    class StaticMemberInitializer
+    {
+    public:
+      StaticMemberInitializer()
+      {
+        CostOcTree * tree = new CostOcTree(0.1);
+        tree->clearKeyRays();
+        octomap::AbstractOcTree::registerTreeType(tree);
+      }
+
+      void ensureLinking() {}
+    };
+    static StaticMemberInitializer cost_octree_member_init_;
+  };
+
+}  // namespace vox_nav_utilities
+
+#endif  // VOX_NAV_UTILITIES__COST_OCTREE_HPP_
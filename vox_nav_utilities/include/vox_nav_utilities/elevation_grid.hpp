@@ -0,0 +1,225 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__ELEVATION_GRID_HPP_
+#define VOX_NAV_UTILITIES__ELEVATION_GRID_HPP_
+
+#include <octomap/octomap.h>
+#include <octomap/octomap_utils.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace vox_nav_utilities
+{
+
+/**
+ * @brief Thresholds of a traversable cell, a cell violating any of them is not traversable
+ *
+ */
+  struct TraversabilityLimits
+  {
+    double max_slope;       // radians
+    double max_roughness;   // standard deviation of point heights in a cell
+    double max_step;        // height difference to a neighbouring cell
+    double max_elevation;   // cells above this height are obstacles
+    bool allow_unknown;     // whether cells without points are traversable, off by default
+    TraversabilityLimits()
+    : max_slope(std::numeric_limits<double>::infinity()),
+      max_roughness(std::numeric_limits<double>::infinity()),
+      max_step(std::numeric_limits<double>::infinity()),
+      max_elevation(std::numeric_limits<double>::infinity()),
+      allow_unknown(false) {}
+  };
+
+/**
+ * @brief 2.5D grid of terrain layers (elevation, slope, roughness, step height) computed
+ * from a point cloud or an octomap. Each layer is a contiguous row major array of floats,
+ * cells without points are NaN. A traversability query is a few array lookups, which is
+ * much cheaper than FCL box vs octree collision on terrain that is really 2.5D.
+ *
+ */
+  class ElevationGrid
+  {
+  public:
+    /**
+     * @brief Layers kept per cell
+     *
+     */
+    enum class Layer : int
+    {
+      ELEVATION = 0,   // highest point of cell
+      SLOPE,           // angle of elevation gradient, from central differences
+      ROUGHNESS,       // standard deviation of point heights in cell
+      STEP,            // largest elevation difference to 8 neighbours
+      NUM_LAYERS
+    };
+
+    /**
+     * @brief Construct a new Elevation Grid object
+     *
+     */
+    ElevationGrid();
+
+    /**
+     * @brief Destroy the Elevation Grid object
+     *
+     */
+    ~ElevationGrid();
+
+    /**
+     * @brief Bin points to cells and compute all layers. Points are bucketed by grid row
+     * with a counting sort, then row blocks are processed on num_threads threads.
+     *
+     * @param cloud
+     * @param resolution cell size
+     * @param num_threads <= 0 uses hardware concurrency
+     * @return true
+     * @return false if cloud is empty
+     */
+    bool build(
+      const pcl::PointCloud<pcl::PointXYZ>::Ptr & cloud,
+      double resolution,
+      int num_threads = 0);
+
+    /**
+     * @brief Build from centers of occupied voxels of octree,
+     * coarse leafs are expanded to voxels of finest resolution
+     *
+     * @param octree
+     * @param resolution <= 0 uses octree resolution
+     * @param num_threads <= 0 uses hardware concurrency
+     * @return true
+     * @return false if octree has no occupied voxels
+     */
+    bool build(
+      const std::shared_ptr<octomap::OcTree> & octree,
+      double resolution = 0.0,
+      int num_threads = 0);
+
+    /**
+     * @brief Get value of a layer at x, y, NaN if cell is unknown or outside grid
+     *
+     * @param layer
+     * @param x
+     * @param y
+     * @return float
+     */
+    float get(Layer layer, double x, double y) const;
+
+    /**
+     * @brief Whether the cell at x, y satisfies limits
+     *
+     * @param x
+     * @param y
+     * @param limits
+     * @return true
+     * @return false
+     */
+    bool isTraversable(double x, double y, const TraversabilityLimits & limits) const;
+
+    /**
+     * @brief Whether all cells under a rectangular footprint centered at x, y and
+     * rotated by yaw satisfy limits
+     *
+     * @param x
+     * @param y
+     * @param yaw
+     * @param length footprint size along heading
+     * @param width footprint size across heading
+     * @param limits
+     * @return true
+     * @return false
+     */
+    bool isFootprintTraversable(
+      double x, double y, double yaw,
+      double length, double width,
+      const TraversabilityLimits & limits) const;
+
+    /**
+     * @brief Whether build() has been called succesfully
+     *
+     * @return true
+     * @return false
+     */
+    bool isReady() const
+    {
+      return is_ready_;
+    }
+
+    double getResolution() const
+    {
+      return resolution_;
+    }
+
+    int getSizeX() const
+    {
+      return size_x_;
+    }
+
+    int getSizeY() const
+    {
+      return size_y_;
+    }
+
+    /**
+     * @brief Raw row major data of a layer, size_x * size_y floats
+     *
+     * @param layer
+     * @return const std::vector<float>&
+     */
+    const std::vector<float> & getLayer(Layer layer) const
+    {
+      return layers_[static_cast<int>(layer)];
+    }
+
+  private:
+    /**
+     * @brief Compute slope and step layers of rows [row_begin, row_end) from elevation
+     *
+     * @param row_begin
+     * @param row_end
+     */
+    void computeNeighbourLayers(int row_begin, int row_end);
+
+    bool isCellTraversable(size_t cell, const TraversabilityLimits & limits) const;
+
+    inline bool cellIndex(double x, double y, size_t & cell) const
+    {
+      int ix = static_cast<int>(std::floor((x - origin_x_) / resolution_));
+      int iy = static_cast<int>(std::floor((y - origin_y_) / resolution_));
+      if (ix < 0 || iy < 0 || ix >= size_x_ || iy >= size_y_) {
+        return false;
+      }
+      cell = static_cast<size_t>(iy) * size_x_ + ix;
+      return true;
+    }
+
+    std::vector<float> layers_[static_cast<int>(Layer::NUM_LAYERS)];
+    double origin_x_;
+    double origin_y_;
+    double resolution_;
+    int size_x_;
+    int size_y_;
+    bool is_ready_;
+  };
+
+}  // namespace vox_nav_utilities
+
+#endif  // VOX_NAV_UTILITIES__ELEVATION_GRID_HPP_
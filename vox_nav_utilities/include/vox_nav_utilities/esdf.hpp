@@ -0,0 +1,194 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__ESDF_HPP_
+#define VOX_NAV_UTILITIES__ESDF_HPP_
+
+#include <octomap/octomap.h>
+#include <octomap/octomap_utils.h>
+
+#include <memory>
+#include <vector>
+
+namespace vox_nav_utilities
+{
+
+/**
+ * @brief Euclidean signed distance field on a dense voxel grid covering the octomap.
+ * Positive values are distance of free voxels to closest occupied voxel,
+ * negative values are distance of occupied voxels to closest free voxel.
+ * Distances are saturated at max_distance, so a query is a single array lookup.
+ *
+ */
+  class ESDF
+  {
+  public:
+    /**
+     * @brief Outcome of a sphere based clearance test of a robot body
+     *
+     */
+    enum class ClearanceResult
+    {
+      FREE,       // circumscribed sphere of body is free, body can not collide
+      COLLISION,  // inscribed sphere of body touches an obstacle, body collides
+      UNKNOWN     // inconclusive, an exact collision check is needed
+    };
+
+    /**
+     * @brief Construct a new ESDF object
+     *
+     */
+    ESDF();
+
+    /**
+     * @brief Destroy the ESDF object
+     *
+     */
+    ~ESDF();
+
+    /**
+     * @brief Compute distance field of given octree, exact EDT is computed with
+     * separable passes along x, y and z. Each pass processes independent blocks of
+     * grid lines on num_threads threads.
+     *
+     * @param octree
+     * @param max_distance distances are saturated at this value
+     * @param resolution grid resolution, <= 0 uses octree resolution
+     * @param num_threads <= 0 uses hardware concurrency
+     * @return true
+     * @return false if octree is empty
+     */
+    bool build(
+      const std::shared_ptr<octomap::OcTree> & octree,
+      double max_distance,
+      double resolution = 0.0,
+      int num_threads = 0);
+
+    /**
+     * @brief Get signed distance at given point, points outside the grid are
+     * at max_distance. Only meant for clearance costs, use checkClearance() for validity
+     *
+     * @param x
+     * @param y
+     * @param z
+     * @return double
+     */
+    double getDistance(double x, double y, double z) const;
+
+    /**
+     * @brief Sphere test of a robot body centered at x, y, z. Lookup error of the grid
+     * is accounted for, so FREE and COLLISION results are conclusive.
+     * Points outside the grid are UNKNOWN.
+     *
+     * @param x
+     * @param y
+     * @param z
+     * @param inscribed_radius
+     * @param circumscribed_radius
+     * @return ClearanceResult
+     */
+    ClearanceResult checkClearance(
+      double x, double y, double z,
+      double inscribed_radius,
+      double circumscribed_radius) const;
+
+    /**
+     * @brief Whether build() has been called succesfully
+     *
+     * @return true
+     * @return false
+     */
+    bool isReady() const
+    {
+      return is_ready_;
+    }
+
+    double getResolution() const
+    {
+      return resolution_;
+    }
+
+    double getMaxDistance() const
+    {
+      return max_distance_;
+    }
+
+    /**
+     * @brief Number of voxels in the dense grid
+     *
+     * @return size_t
+     */
+    size_t size() const
+    {
+      return distance_.size();
+    }
+
+  private:
+    /**
+     * @brief Signed distance of voxel containing given point
+     *
+     * @param x
+     * @param y
+     * @param z
+     * @param distance
+     * @return true
+     * @return false if not built or point is outside the grid
+     */
+    bool lookup(double x, double y, double z, double & distance) const;
+
+    /**
+     * @brief Squared EDT of seed voxels, result is in voxel units
+     *
+     * @param seeds
+     * @param sq_distance
+     * @param num_threads
+     */
+    void computeSquaredEDT(
+      const std::vector<bool> & seeds,
+      std::vector<float> & sq_distance,
+      int num_threads) const;
+
+    /**
+     * @brief 1D squared distance transform of lower envelope of parabolas
+     * (Felzenszwalb & Huttenlocher), f is read and written with given stride
+     *
+     * @param f
+     * @param n
+     * @param stride
+     * @param v scratch buffer of size n
+     * @param z scratch buffer of size n+1
+     * @param d scratch buffer of size n
+     */
+    static void squaredEDT1D(
+      float * f, int n, size_t stride,
+      std::vector<int> & v, std::vector<double> & z, std::vector<double> & d);
+
+    inline size_t index(int x, int y, int z) const
+    {
+      return (static_cast<size_t>(z) * size_y_ + y) * size_x_ + x;
+    }
+
+    std::vector<float> distance_;
+    octomap::point3d origin_;
+    int size_x_;
+    int size_y_;
+    int size_z_;
+    double resolution_;
+    double max_distance_;
+    bool is_ready_;
+  };
+
+}  // namespace vox_nav_utilities
+
+#endif  // VOX_NAV_UTILITIES__ESDF_HPP_
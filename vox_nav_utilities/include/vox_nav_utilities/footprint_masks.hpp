@@ -0,0 +1,155 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__FOOTPRINT_MASKS_HPP_
+#define VOX_NAV_UTILITIES__FOOTPRINT_MASKS_HPP_
+
+#include <octomap/octomap.h>
+#include <octomap/octomap_utils.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace vox_nav_utilities
+{
+
+/**
+ * @brief Collision checker of a box shaped robot body against an octomap, based on
+ * voxelized body masks precomputed per discretized yaw and pitch.
+ * A check is then a set of voxel key lookups in a hashed set of occupied voxels,
+ * no quaternions or box vs octree traversal involved.
+ * Masks of a bin cover all orientations inside the bin, so the check is conservative,
+ * a free result is always free, a collision result may be confirmed with exact FCL.
+ *
+ */
+  class FootprintMasks
+  {
+  public:
+    /**
+     * @brief Construct a new Footprint Masks object
+     *
+     */
+    FootprintMasks();
+
+    /**
+     * @brief Destroy the Footprint Masks object
+     *
+     */
+    ~FootprintMasks();
+
+    /**
+     * @brief Compute masks of the body for each yaw/pitch bin, masks are in voxels of
+     * given resolution which should be same as resolution of the octomap
+     *
+     * @param body_x
+     * @param body_y
+     * @param body_z
+     * @param resolution
+     * @param yaw_bins number of bins in [-pi, pi)
+     * @param pitch_bins number of bins in [-max_pitch, max_pitch], 1 disables pitch
+     * @param max_pitch
+     */
+    void buildMasks(
+      double body_x, double body_y, double body_z,
+      double resolution,
+      int yaw_bins,
+      int pitch_bins = 1,
+      double max_pitch = 0.0);
+
+    /**
+     * @brief Insert occupied voxels of octree to hashed occupancy set,
+     * coarse leafs are expanded to voxels of finest resolution
+     *
+     * @param octree
+     */
+    void setMap(const std::shared_ptr<octomap::OcTree> & octree);
+
+    /**
+     * @brief Whether the body at given pose does not touch any occupied voxel
+     *
+     * @param x
+     * @param y
+     * @param z
+     * @param yaw
+     * @param pitch
+     * @return true
+     * @return false
+     */
+    bool isCollisionFree(double x, double y, double z, double yaw, double pitch = 0.0) const;
+
+    /**
+     * @brief Whether a pitch can be represented by the masks, for larger pitches
+     * caller should fall back to an exact check
+     *
+     * @param pitch
+     * @return true
+     * @return false
+     */
+    bool isPitchCovered(double pitch) const;
+
+    /**
+     * @brief Whether masks and map are set
+     *
+     * @return true
+     * @return false
+     */
+    bool isReady() const
+    {
+      return octree_ != nullptr && !masks_.empty();
+    }
+
+    /**
+     * @brief Number of voxels in the largest mask
+     *
+     * @return size_t
+     */
+    size_t getMaxMaskSize() const;
+
+  private:
+    /**
+     * @brief voxel offsets relative to key of body center, kept as separate arrays
+     * so that key computation of a mask is vectorized by compiler
+     *
+     */
+    struct Mask
+    {
+      std::vector<int32_t> dx;
+      std::vector<int32_t> dy;
+      std::vector<int32_t> dz;
+    };
+
+    inline static uint64_t packKey(uint32_t x, uint32_t y, uint32_t z)
+    {
+      return (static_cast<uint64_t>(x & 0xFFFF) << 32) |
+             (static_cast<uint64_t>(y & 0xFFFF) << 16) |
+             static_cast<uint64_t>(z & 0xFFFF);
+    }
+
+    int yawBin(double yaw) const;
+    int pitchBin(double pitch) const;
+
+    std::vector<Mask> masks_;
+    std::unordered_set<uint64_t> occupied_keys_;
+    std::shared_ptr<octomap::OcTree> octree_;
+    double resolution_;
+    int yaw_bins_;
+    int pitch_bins_;
+    double max_pitch_;
+  };
+
+}  // namespace vox_nav_utilities
+
+#endif  // VOX_NAV_UTILITIES__FOOTPRINT_MASKS_HPP_
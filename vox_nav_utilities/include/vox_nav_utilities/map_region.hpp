@@ -0,0 +1,381 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__MAP_REGION_HPP_
+#define VOX_NAV_UTILITIES__MAP_REGION_HPP_
+
+#include <octomap/octomap.h>
+#include <octomap/ColorOcTree.h>
+#include <pcl/point_cloud.h>
+
+#include "vox_nav_utilities/cost_octree.hpp"
+#include "vox_nav_utilities/octree_builder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace vox_nav_utilities
+{
+
+/**
+ * @brief Region of interest of a map query, an axis-aligned box and/or a corridor around a
+ * polyline (e.g. from start to goal). Corridor is a distance in xy, it is bounded in z only
+ * by the box. When both are set a point has to be in both. A region with neither contains
+ * everything.
+ *
+ */
+  struct MapRegion
+  {
+    bool has_box;
+    octomap::point3d box_min;
+    octomap::point3d box_max;
+    std::vector<octomap::point3d> corridor;
+    double corridor_radius;
+    MapRegion()
+    : has_box(false), corridor_radius(0.0) {}
+
+    /**
+     * @brief Set box from its center and side lengths, box is unset if any length is not positive
+     *
+     */
+    void setBox(
+      double center_x, double center_y, double center_z,
+      double length_x, double length_y, double length_z)
+    {
+      has_box = length_x > 0.0 && length_y > 0.0 && length_z > 0.0;
+      box_min = octomap::point3d(
+        center_x - length_x / 2.0, center_y - length_y / 2.0, center_z - length_z / 2.0);
+      box_max = octomap::point3d(
+        center_x + length_x / 2.0, center_y + length_y / 2.0, center_z + length_z / 2.0);
+    }
+
+    bool hasCorridor() const
+    {
+      return !corridor.empty() && corridor_radius > 0.0;
+    }
+
+    bool isEmpty() const
+    {
+      return !has_box && !hasCorridor();
+    }
+
+    bool contains(double x, double y, double z) const
+    {
+      if (has_box &&
+        (x < box_min.x() || y < box_min.y() || z < box_min.z() ||
+        x > box_max.x() || y > box_max.y() || z > box_max.z()))
+      {
+        return false;
+      }
+      if (!hasCorridor()) {
+        return true;
+      }
+      const double radius_sq = corridor_radius * corridor_radius;
+      for (size_t i = corridor.size() > 1; i < corridor.size(); i++) {
+        if (segmentDistanceSq(i, x, y) <= radius_sq) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * @brief Whether all of axis-aligned box [min, max] is in region. Conservative for
+     * corridors, box has to be within a single segment of corridor
+     *
+     * @param min
+     * @param max
+     * @return true
+     * @return false
+     */
+    bool containsBox(const octomap::point3d & min, const octomap::point3d & max) const
+    {
+      if (has_box &&
+        (min.x() < box_min.x() || min.y() < box_min.y() || min.z() < box_min.z() ||
+        max.x() > box_max.x() || max.y() > box_max.y() || max.z() > box_max.z()))
+      {
+        return false;
+      }
+      if (!hasCorridor()) {
+        return true;
+      }
+      // area around a segment is convex, so it contains box if it contains its xy corners
+      const double radius_sq = corridor_radius * corridor_radius;
+      for (size_t i = corridor.size() > 1; i < corridor.size(); i++) {
+        if (segmentDistanceSq(i, min.x(), min.y()) <= radius_sq &&
+          segmentDistanceSq(i, min.x(), max.y()) <= radius_sq &&
+          segmentDistanceSq(i, max.x(), min.y()) <= radius_sq &&
+          segmentDistanceSq(i, max.x(), max.y()) <= radius_sq)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * @brief Whether axis-aligned box [min, max] may intersect region, false only if it does not
+     *
+     * @param min
+     * @param max
+     * @return true
+     * @return false
+     */
+    bool mayIntersectBox(const octomap::point3d & min, const octomap::point3d & max) const
+    {
+      if (has_box &&
+        (max.x() < box_min.x() || max.y() < box_min.y() || max.z() < box_min.z() ||
+        min.x() > box_max.x() || min.y() > box_max.y() || min.z() > box_max.z()))
+      {
+        return false;
+      }
+      if (!hasCorridor()) {
+        return true;
+      }
+      const double cx = (min.x() + max.x()) / 2.0, cy = (min.y() + max.y()) / 2.0;
+      const double reach = corridor_radius +
+        std::hypot(max.x() - min.x(), max.y() - min.y()) / 2.0;
+      for (size_t i = corridor.size() > 1; i < corridor.size(); i++) {
+        if (segmentDistanceSq(i, cx, cy) <= reach * reach) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * @brief Axis-aligned bounds of region clamped to [min, max], e.g. metric bounds of a tree
+     *
+     * @param min in: lower clamp, out: lower bound of region
+     * @param max in: upper clamp, out: upper bound of region
+     * @return true
+     * @return false if region does not intersect [min, max]
+     */
+    bool clampBounds(octomap::point3d & min, octomap::point3d & max) const
+    {
+      octomap::point3d lo(
+        -std::numeric_limits<float>::max(),
+        -std::numeric_limits<float>::max(),
+        -std::numeric_limits<float>::max());
+      octomap::point3d hi(
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max());
+      if (has_box) {
+        lo = box_min;
+        hi = box_max;
+      }
+      if (hasCorridor()) {
+        float r = static_cast<float>(corridor_radius);
+        float cmin_x = std::numeric_limits<float>::max(), cmin_y = cmin_x;
+        float cmax_x = -std::numeric_limits<float>::max(), cmax_y = cmax_x;
+        for (auto && p : corridor) {
+          cmin_x = std::min(cmin_x, p.x() - r);
+          cmin_y = std::min(cmin_y, p.y() - r);
+          cmax_x = std::max(cmax_x, p.x() + r);
+          cmax_y = std::max(cmax_y, p.y() + r);
+        }
+        lo.x() = std::max(lo.x(), cmin_x);
+        lo.y() = std::max(lo.y(), cmin_y);
+        hi.x() = std::min(hi.x(), cmax_x);
+        hi.y() = std::min(hi.y(), cmax_y);
+      }
+      for (unsigned int i = 0; i < 3; i++) {
+        min(i) = std::max(min(i), lo(i));
+        max(i) = std::min(max(i), hi(i));
+        if (min(i) > max(i)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  private:
+    /**
+     * @brief Squared xy distance of a point to segment ending at corridor[i],
+     * segment 0 is the point corridor[0]
+     *
+     */
+    double segmentDistanceSq(size_t i, double x, double y) const
+    {
+      double ax = corridor[i ? i - 1 : 0].x(), ay = corridor[i ? i - 1 : 0].y();
+      double sx = corridor[i].x() - ax, sy = corridor[i].y() - ay;
+      double len_sq = sx * sx + sy * sy;
+      double t = len_sq > 0.0 ? ((x - ax) * sx + (y - ay) * sy) / len_sq : 0.0;
+      t = std::min(1.0, std::max(0.0, t));
+      double dx = x - (ax + t * sx), dy = y - (ay + t * sy);
+      return dx * dx + dy * dy;
+    }
+  };
+
+  inline void getOctreeLeafData(const octomap::OcTreeNode *, OctreeLeaf &)
+  {
+  }
+
+  inline void getOctreeLeafData(const octomap::ColorOcTreeNode * node, OctreeLeaf & leaf)
+  {
+    auto color = node->getColor();
+    leaf.r = color.r;
+    leaf.g = color.g;
+    leaf.b = color.b;
+  }
+
+  inline void getOctreeLeafData(const CostOcTreeNode * node, OctreeLeaf & leaf)
+  {
+    leaf.cost = node->getCost();
+    leaf.label = node->getLabel();
+  }
+
+/**
+ * @brief Tree that leafs can be inserted at any depth, OcTree only inserts at finest depth
+ * and does not expose the root to create one otherwise
+ *
+ * @tparam TreeT
+ */
+  template<typename TreeT>
+  class RegionOctree : public TreeT
+  {
+  public:
+    typedef typename TreeT::NodeType NodeType;
+
+    explicit RegionOctree(double resolution)
+    : TreeT(resolution) {}
+
+    /**
+     * @brief Insert leaf of a tree with same resolution at its key and depth, or the parts of it
+     * in region. Leafs crossing region border are split, finest voxels are kept if their
+     * center is in region.
+     *
+     * @param key
+     * @param depth
+     * @param leaf
+     * @param region
+     */
+    void insertRegionLeaf(
+      const octomap::OcTreeKey & key, unsigned int depth,
+      const OctreeLeaf & leaf, const MapRegion & region)
+    {
+      const octomap::point3d center = this->keyToCoord(key, depth);
+      if (depth == this->tree_depth) {
+        if (region.contains(center.x(), center.y(), center.z())) {
+          insertLeaf(key, depth, leaf);
+        }
+        return;
+      }
+      const float half_size = this->getNodeSize(depth) / 2.0;
+      const octomap::point3d half(half_size, half_size, half_size);
+      if (!region.mayIntersectBox(center - half, center + half)) {
+        return;
+      }
+      if (region.containsBox(center - half, center + half)) {
+        insertLeaf(key, depth, leaf);
+        return;
+      }
+      const octomap::key_type center_offset_key = this->tree_max_val >> (depth + 1);
+      for (unsigned int i = 0; i < 8; i++) {
+        octomap::OcTreeKey child_key;
+        octomap::computeChildKey(i, center_offset_key, key, child_key);
+        insertRegionLeaf(child_key, depth + 1, leaf, region);
+      }
+    }
+
+  private:
+    void insertLeaf(const octomap::OcTreeKey & key, unsigned int depth, const OctreeLeaf & leaf)
+    {
+      if (!this->root) {
+        this->root = new NodeType();
+        this->tree_size++;
+      }
+      NodeType * node = this->root;
+      for (unsigned int d = 0; d < depth; d++) {
+        const unsigned int child = octomap::computeChildIdx(key, this->tree_depth - 1 - d);
+        node = this->nodeChildExists(node, child) ?
+          this->getNodeChild(node, child) : this->createNodeChild(node, child);
+      }
+      node->setLogOdds(leaf.value);
+      setOctreeLeafData(node, leaf);
+    }
+  };
+
+/**
+ * @brief Copy leafs of tree inside region to a new tree of same type and resolution.
+ * Only the bounding box of region is traversed, pruned leafs inside region are copied at
+ * their own depth and only the ones crossing its border are split, down to finest voxels
+ * whose centers are in region.
+ *
+ * @tparam TreeT
+ * @param tree
+ * @param region
+ * @return std::shared_ptr<TreeT>
+ */
+  template<typename TreeT>
+  std::shared_ptr<TreeT> extractOctreeRegion(const TreeT & tree, const MapRegion & region)
+  {
+    auto cropped = std::make_shared<TreeT>(tree.getResolution());
+    octomap::point3d min, max;
+    double x, y, z;
+    tree.getMetricMin(x, y, z);
+    min = octomap::point3d(x, y, z);
+    tree.getMetricMax(x, y, z);
+    max = octomap::point3d(x, y, z);
+    if (tree.size() == 0 || !region.clampBounds(min, max)) {
+      return cropped;
+    }
+
+    RegionOctree<TreeT> region_tree(tree.getResolution());
+    for (auto it = tree.begin_leafs_bbx(min, max), end = tree.end_leafs_bbx(); it != end; ++it) {
+      OctreeLeaf leaf;
+      leaf.value = it->getLogOdds();
+      getOctreeLeafData(&(*it), leaf);
+      region_tree.insertRegionLeaf(it.getKey(), it.getDepth(), leaf, region);
+    }
+    region_tree.updateInnerOccupancy();
+    region_tree.prune();
+    cropped->swapContent(region_tree);
+    return cropped;
+  }
+
+/**
+ * @brief Points of cloud inside region, cloud itself is returned if region is empty
+ *
+ * @tparam P
+ * @param cloud
+ * @param region
+ * @return pcl::PointCloud<P>::Ptr
+ */
+  template<typename P>
+  typename pcl::PointCloud<P>::Ptr cropCloudToRegion(
+    const typename pcl::PointCloud<P>::Ptr cloud,
+    const MapRegion & region)
+  {
+    if (region.isEmpty()) {
+      return cloud;
+    }
+    typename pcl::PointCloud<P>::Ptr cropped(new pcl::PointCloud<P>());
+    for (auto && p : cloud->points) {
+      if (region.contains(p.x, p.y, p.z)) {
+        cropped->points.push_back(p);
+      }
+    }
+    cropped->width = cropped->points.size();
+    cropped->height = 1;
+    return cropped;
+  }
+
+}  // namespace vox_nav_utilities
+
+#endif  // VOX_NAV_UTILITIES__MAP_REGION_HPP_
@@ -0,0 +1,214 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__OCTREE_BUILDER_HPP_
+#define VOX_NAV_UTILITIES__OCTREE_BUILDER_HPP_
+
+#include <octomap/octomap.h>
+#include <octomap/ColorOcTree.h>
+#include <pcl/point_cloud.h>
+
+#include "vox_nav_utilities/cost_octree.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vox_nav_utilities
+{
+
+/**
+ * @brief Value of an occupied leaf, value is written as log odds of the node.
+ * Color is only used for ColorOcTree, cost and label only for CostOcTree.
+ *
+ */
+  struct OctreeLeaf
+  {
+    float value;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t cost;
+    CostLabel label;
+    OctreeLeaf()
+    : value(0.0f), r(0), g(0), b(0), cost(0), label(CostLabel::UNKNOWN) {}
+  };
+
+  typedef octomap::unordered_ns::unordered_map<octomap::OcTreeKey, OctreeLeaf,
+      octomap::OcTreeKey::KeyHash> OctreeLeafMap;
+
+/**
+ * @brief Insert leaf at key, or replace the existing one if leaf has higher value
+ * (then higher cost)
+ *
+ * @param leafs
+ * @param key
+ * @param leaf
+ */
+  inline void keepHighestOctreeLeaf(
+    OctreeLeafMap & leafs,
+    const octomap::OcTreeKey & key,
+    const OctreeLeaf & leaf)
+  {
+    auto it = leafs.find(key);
+    if (it == leafs.end()) {
+      leafs.emplace(key, leaf);
+    } else if (leaf.value > it->second.value ||
+      (leaf.value == it->second.value && leaf.cost > it->second.cost))
+    {
+      it->second = leaf;
+    }
+  }
+
+/**
+ * @brief Merge leafs of from into into, e.g. to put several clouds into one tree
+ *
+ * @param into
+ * @param from
+ */
+  inline void mergeOctreeLeafs(OctreeLeafMap & into, const OctreeLeafMap & from)
+  {
+    for (auto && leaf : from) {
+      keepHighestOctreeLeaf(into, leaf.first, leaf.second);
+    }
+  }
+
+/**
+ * @brief Deduplicate points of cloud into leaf keys of tree. leaf_of(point, leaf) fills
+ * value of a point and returns false for points that should be skipped. When several points
+ * fall into same leaf, the one with highest value (then highest cost) is kept. Keys are
+ * computed on num_threads threads, each with its own map, maps are merged at the end.
+ *
+ * @tparam TreeT
+ * @tparam PointT
+ * @tparam LeafFn
+ * @param tree only used for key computation
+ * @param cloud
+ * @param leaf_of
+ * @param num_threads <= 0 uses hardware concurrency
+ * @return OctreeLeafMap
+ */
+  template<typename TreeT, typename PointT, typename LeafFn>
+  OctreeLeafMap computeOctreeLeafs(
+    const TreeT & tree,
+    const pcl::PointCloud<PointT> & cloud,
+    LeafFn leaf_of,
+    int num_threads = 0)
+  {
+    if (num_threads <= 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t num_points = cloud.points.size();
+    num_threads = std::max(1, std::min<int>(num_threads, num_points / 10000 + 1));
+
+    std::vector<OctreeLeafMap> thread_leafs(num_threads);
+    auto process_chunk = [&](int thread_id) {
+        size_t begin = num_points * thread_id / num_threads;
+        size_t end = num_points * (thread_id + 1) / num_threads;
+        auto & leafs = thread_leafs[thread_id];
+        leafs.reserve(end - begin);
+        for (size_t i = begin; i < end; i++) {
+          const auto & point = cloud.points[i];
+          OctreeLeaf leaf;
+          octomap::OcTreeKey key;
+          if (!leaf_of(point, leaf) ||
+            !tree.coordToKeyChecked(point.x, point.y, point.z, key))
+          {
+            continue;
+          }
+          keepHighestOctreeLeaf(leafs, key, leaf);
+        }
+      };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+      threads.emplace_back(process_chunk, i);
+    }
+    process_chunk(0);
+    for (auto && t : threads) {
+      t.join();
+    }
+    for (int i = 1; i < num_threads; i++) {
+      mergeOctreeLeafs(thread_leafs[0], thread_leafs[i]);
+    }
+    return std::move(thread_leafs[0]);
+  }
+
+  inline void setOctreeLeafData(octomap::OcTreeNode *, const OctreeLeaf &)
+  {
+  }
+
+  inline void setOctreeLeafData(octomap::ColorOcTreeNode * node, const OctreeLeaf & leaf)
+  {
+    node->setColor(leaf.r, leaf.g, leaf.b);
+  }
+
+  inline void setOctreeLeafData(CostOcTreeNode * node, const OctreeLeaf & leaf)
+  {
+    node->setCost(leaf.cost);
+    node->setLabel(leaf.label);
+  }
+
+/**
+ * @brief Insert occupied leafs directly at their keys, without raycasting from an origin.
+ * Nodes are created with lazy evaluation, inner node occupancy is updated and tree is
+ * pruned once at the end. Free space is not marked, which is right for static prebuilt maps.
+ *
+ * @tparam TreeT
+ * @param tree
+ * @param leafs
+ */
+  template<typename TreeT>
+  void insertOctreeLeafs(TreeT & tree, const OctreeLeafMap & leafs)
+  {
+    for (auto && leaf : leafs) {
+      auto * node = tree.setNodeValue(leaf.first, leaf.second.value, true);
+      if (node) {
+        setOctreeLeafData(node, leaf.second);
+      }
+    }
+    tree.updateInnerOccupancy();
+    tree.prune();
+  }
+
+/**
+ * @brief computeOctreeLeafs followed by insertOctreeLeafs, replaces insertPointCloud
+ * followed by a setNodeValue per point
+ *
+ * @tparam TreeT
+ * @tparam PointT
+ * @tparam LeafFn
+ * @param tree
+ * @param cloud
+ * @param leaf_of
+ * @param num_threads
+ * @return size_t number of inserted leafs
+ */
+  template<typename TreeT, typename PointT, typename LeafFn>
+  size_t buildOctreeFromCloud(
+    TreeT & tree,
+    const pcl::PointCloud<PointT> & cloud,
+    LeafFn leaf_of,
+    int num_threads = 0)
+  {
+    auto leafs = computeOctreeLeafs(tree, cloud, leaf_of, num_threads);
+    insertOctreeLeafs(tree, leafs);
+    return leafs.size();
+  }
+
+}  // namespace vox_nav_utilities
+
+#endif  // VOX_NAV_UTILITIES__OCTREE_BUILDER_HPP_
@@ -0,0 +1,320 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__PARALLEL_CLOUD_FILTERS_HPP_
+#define VOX_NAV_UTILITIES__PARALLEL_CLOUD_FILTERS_HPP_
+
+#include <pcl/common/centroid.h>
+#include <pcl/common/point_tests.h>
+#include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/point_cloud.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vox_nav_utilities
+{
+
+/**
+ * @brief Run fn(begin, end, thread_id) on num_threads contiguous chunks of [0, n),
+ * chunk 0 runs on calling thread
+ *
+ * @tparam Fn
+ * @param n
+ * @param num_threads <= 0 uses hardware concurrency
+ * @param fn
+ * @return int number of threads used
+ */
+  template<typename Fn>
+  int parallelForChunks(size_t n, int num_threads, Fn fn)
+  {
+    if (num_threads <= 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::max(1, std::min<int>(num_threads, n / 10000 + 1));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+      threads.emplace_back(fn, n * i / num_threads, n * (i + 1) / num_threads, i);
+    }
+    fn(size_t(0), n / num_threads, 0);
+    for (auto && t : threads) {
+      t.join();
+    }
+    return num_threads;
+  }
+
+/**
+ * @brief Integer coordinates of a voxel, 64 bit so that there is no limit on number of
+ * voxels, unlike pcl::VoxelGrid which refuses leaf sizes giving more than INT_MAX voxels
+ *
+ */
+  struct VoxelKey
+  {
+    int64_t x;
+    int64_t y;
+    int64_t z;
+    bool operator==(const VoxelKey & rhs) const
+    {
+      return x == rhs.x && y == rhs.y && z == rhs.z;
+    }
+  };
+
+  struct VoxelKeyHash
+  {
+    size_t operator()(const VoxelKey & key) const
+    {
+      return static_cast<size_t>(static_cast<uint64_t>(key.x) * 73856093) ^
+             static_cast<size_t>(static_cast<uint64_t>(key.y) * 19349663) ^
+             static_cast<size_t>(static_cast<uint64_t>(key.z) * 83492791);
+    }
+  };
+
+/**
+ * @brief Voxel grid downsampling, each occupied voxel is replaced by centroid of its points
+ * (all fields averaged, like pcl::VoxelGrid with downsample all data). Voxels are hashed,
+ * each thread owns the voxels whose hash maps to it, so voxels are accumulated in parallel
+ * without locks or merging. Non finite points are dropped.
+ *
+ * @tparam P
+ * @param cloud
+ * @param leaf_size
+ * @param num_threads <= 0 uses hardware concurrency
+ * @return pcl::PointCloud<P>::Ptr
+ */
+  template<typename P>
+  typename pcl::PointCloud<P>::Ptr parallelVoxelDownsample(
+    const pcl::PointCloud<P> & cloud,
+    double leaf_size,
+    int num_threads = 0)
+  {
+    typename pcl::PointCloud<P>::Ptr downsampled(new pcl::PointCloud<P>());
+    downsampled->header = cloud.header;
+    if (leaf_size <= 0.0 || cloud.points.empty()) {
+      *downsampled = cloud;
+      return downsampled;
+    }
+    const double inverse_leaf_size = 1.0 / leaf_size;
+    auto key_of = [inverse_leaf_size](const P & p) {
+        return VoxelKey{
+          static_cast<int64_t>(std::floor(p.x * inverse_leaf_size)),
+          static_cast<int64_t>(std::floor(p.y * inverse_leaf_size)),
+          static_cast<int64_t>(std::floor(p.z * inverse_leaf_size))};
+      };
+
+    // owning thread of each point, kSkip for non finite points
+    const uint8_t kSkip = std::numeric_limits<uint8_t>::max();
+    if (num_threads <= 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min<int>(num_threads, kSkip);
+    num_threads = std::max(1, std::min<int>(num_threads, cloud.points.size() / 10000 + 1));
+    std::vector<uint8_t> owner(cloud.points.size());
+    parallelForChunks(
+      cloud.points.size(), num_threads, [&](size_t begin, size_t end, int) {
+        VoxelKeyHash hash;
+        for (size_t i = begin; i < end; i++) {
+          const auto & p = cloud.points[i];
+          owner[i] = pcl::isFinite(p) ?
+          static_cast<uint8_t>(hash(key_of(p)) % num_threads) : kSkip;
+        }
+      });
+
+    std::vector<std::vector<P>> thread_points(num_threads);
+    auto accumulate = [&](int thread_id) {
+        std::unordered_map<VoxelKey, pcl::CentroidPoint<P>, VoxelKeyHash> voxels;
+        for (size_t i = 0; i < cloud.points.size(); i++) {
+          if (owner[i] == thread_id) {
+            voxels[key_of(cloud.points[i])].add(cloud.points[i]);
+          }
+        }
+        auto & points = thread_points[thread_id];
+        points.reserve(voxels.size());
+        for (auto && voxel : voxels) {
+          P centroid;
+          voxel.second.get(centroid);
+          points.push_back(centroid);
+        }
+      };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+      threads.emplace_back(accumulate, i);
+    }
+    accumulate(0);
+    for (auto && t : threads) {
+      t.join();
+    }
+
+    for (auto && points : thread_points) {
+      downsampled->points.insert(downsampled->points.end(), points.begin(), points.end());
+    }
+    downsampled->width = downsampled->points.size();
+    downsampled->height = 1;
+    downsampled->is_dense = true;
+    return downsampled;
+  }
+
+/**
+ * @brief Statistical outlier removal with same semantics as pcl::StatisticalOutlierRemoval,
+ * mean distance of each point to its mean_k neighbours is computed on num_threads threads
+ * sharing one kd-tree. Points whose mean distance is above mean + stddev_mul * stddev of all
+ * mean distances are removed.
+ *
+ * @tparam P
+ * @param cloud
+ * @param mean_k
+ * @param stddev_mul
+ * @param num_threads <= 0 uses hardware concurrency
+ * @return pcl::PointCloud<P>::Ptr
+ */
+  template<typename P>
+  typename pcl::PointCloud<P>::Ptr parallelStatisticalOutlierRemoval(
+    const typename pcl::PointCloud<P>::Ptr & cloud,
+    int mean_k,
+    double stddev_mul,
+    int num_threads = 0)
+  {
+    typename pcl::PointCloud<P>::Ptr filtered(new pcl::PointCloud<P>());
+    filtered->header = cloud->header;
+    if (cloud->points.empty() || mean_k <= 0) {
+      *filtered = *cloud;
+      return filtered;
+    }
+    pcl::KdTreeFLANN<P> kdtree;
+    kdtree.setInputCloud(cloud);
+
+    const size_t num_points = cloud->points.size();
+    std::vector<float> distances(num_points, 0.0f);
+    std::vector<uint8_t> valid(num_points, 0);
+    if (num_threads <= 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // per thread sums of mean distances, combined after threads are joined
+    std::vector<double> thread_sum(num_threads, 0.0);
+    std::vector<double> thread_sq_sum(num_threads, 0.0);
+    std::vector<size_t> thread_count(num_threads, 0);
+
+    parallelForChunks(
+      num_points, num_threads, [&](size_t begin, size_t end, int thread_id) {
+        std::vector<int> nn_indices(mean_k + 1);
+        std::vector<float> nn_dists(mean_k + 1);
+        double sum = 0.0, sq_sum = 0.0;
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++) {
+          if (!pcl::isFinite(cloud->points[i])) {
+            continue;
+          }
+          int found = kdtree.nearestKSearch(static_cast<int>(i), mean_k + 1, nn_indices, nn_dists);
+          if (found <= 1) {
+            continue;
+          }
+          // first neighbour is point itself
+          double dist_sum = 0.0;
+          for (int k = 1; k < found; k++) {
+            dist_sum += std::sqrt(nn_dists[k]);
+          }
+          distances[i] = static_cast<float>(dist_sum / (found - 1));
+          valid[i] = 1;
+          sum += distances[i];
+          sq_sum += distances[i] * distances[i];
+          count++;
+        }
+        thread_sum[thread_id] = sum;
+        thread_sq_sum[thread_id] = sq_sum;
+        thread_count[thread_id] = count;
+      });
+
+    double sum = 0.0, sq_sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < thread_sum.size(); i++) {
+      sum += thread_sum[i];
+      sq_sum += thread_sq_sum[i];
+      count += thread_count[i];
+    }
+    if (count < 2) {
+      return filtered;
+    }
+    double mean = sum / count;
+    double variance = (sq_sum - sum * sum / count) / (count - 1);
+    double threshold = mean + stddev_mul * std::sqrt(std::max(0.0, variance));
+
+    filtered->points.reserve(count);
+    for (size_t i = 0; i < num_points; i++) {
+      if (valid[i] && distances[i] <= threshold) {
+        filtered->points.push_back(cloud->points[i]);
+      }
+    }
+    filtered->width = filtered->points.size();
+    filtered->height = 1;
+    filtered->is_dense = true;
+    return filtered;
+  }
+
+/**
+ * @brief Radius outlier removal with same semantics as pcl::RadiusOutlierRemoval with keep
+ * organized set, points with less than min_neighbors neighbours within radius are replaced
+ * by NaN points. Neighbour queries run on num_threads threads sharing one kd-tree.
+ *
+ * @tparam P
+ * @param cloud
+ * @param min_neighbors
+ * @param radius
+ * @param num_threads <= 0 uses hardware concurrency
+ * @return pcl::PointCloud<P>::Ptr
+ */
+  template<typename P>
+  typename pcl::PointCloud<P>::Ptr parallelRadiusOutlierRemoval(
+    const typename pcl::PointCloud<P>::Ptr & cloud,
+    int min_neighbors,
+    double radius,
+    int num_threads = 0)
+  {
+    typename pcl::PointCloud<P>::Ptr filtered(new pcl::PointCloud<P>(*cloud));
+    if (cloud->points.empty() || radius <= 0.0) {
+      return filtered;
+    }
+    pcl::KdTreeFLANN<P> kdtree;
+    kdtree.setInputCloud(cloud);
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    parallelForChunks(
+      cloud->points.size(), num_threads, [&](size_t begin, size_t end, int) {
+        std::vector<int> nn_indices;
+        std::vector<float> nn_dists;
+        for (size_t i = begin; i < end; i++) {
+          bool inlier = false;
+          if (pcl::isFinite(cloud->points[i])) {
+            // point itself is one of found neighbours
+            int found = kdtree.radiusSearch(
+              static_cast<int>(i), radius, nn_indices, nn_dists, min_neighbors + 1);
+            inlier = found > min_neighbors;
+          }
+          if (!inlier) {
+            filtered->points[i].x = nan;
+            filtered->points[i].y = nan;
+            filtered->points[i].z = nan;
+          }
+        }
+      });
+    filtered->is_dense = false;
+    return filtered;
+  }
+
+}  // namespace vox_nav_utilities
+
+#endif  // VOX_NAV_UTILITIES__PARALLEL_CLOUD_FILTERS_HPP_
@@ -0,0 +1,84 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_HPP_
+#define VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_HPP_
+
+#include <octomap/octomap.h>
+#include <octomap/ColorOcTree.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace vox_nav_utilities
+{
+
+/**
+ * @brief Options of convertCloudToColorOctree
+ *
+ */
+  struct PCL2OctomapOptions
+  {
+    // leaf size of octree
+    double resolution;
+    // <= 0 uses hardware concurrency
+    int num_threads;
+    // points are partitioned to the 8^partition_depth subtrees at this depth below root,
+    // each subtree is built by one thread, clamped to [0, 5]
+    int partition_depth;
+    // yellow points (r and g set) are elevated node centers, not part of map
+    bool skip_elevated_nodes;
+    // called with name of current stage and its completed fraction in [0, 1],
+    // calls are serialized but may come from worker threads
+    std::function<void(const std::string &, double)> progress;
+    PCL2OctomapOptions()
+    : resolution(0.2),
+      num_threads(0),
+      partition_depth(3),
+      skip_elevated_nodes(true),
+      progress(nullptr) {}
+  };
+
+/**
+ * @brief Convert a cost colored cloud to a ColorOcTree without raycasting.
+ * Points are spatially partitioned by the subtree their key falls in, leafs of each subtree
+ * are computed in parallel (highest cost of its points as occupancy value, colors averaged),
+ * and subtrees are then inserted in to one tree, which is updated and pruned once.
+ * Cost of a point is b / 255, points with r set are obstacles with cost 1.0.
+ *
+ * @param cloud
+ * @param options
+ * @return std::shared_ptr<octomap::ColorOcTree>
+ */
+  std::shared_ptr<octomap::ColorOcTree> convertCloudToColorOctree(
+    const pcl::PointCloud<pcl::PointXYZRGB> & cloud,
+    const PCL2OctomapOptions & options = PCL2OctomapOptions());
+
+/**
+ * @brief Write tree to filename, format is chosen by extension. ".bt" is binary occupancy
+ * only (colors are dropped), ".ot" is full tree with colors
+ *
+ * @param tree
+ * @param filename
+ * @return true
+ * @return false if extension is unknown or writing fails
+ */
+  bool writeColorOctree(const octomap::ColorOcTree & tree, const std::string & filename);
+
+}  // namespace vox_nav_utilities
+
+#endif  // VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_HPP_
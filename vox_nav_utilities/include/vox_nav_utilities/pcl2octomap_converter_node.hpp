@@ -12,8 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#ifndef VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_HPP_
-#define VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_HPP_
+#ifndef VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_NODE_HPP_
+#define VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_NODE_HPP_
 
 #include <octomap/octomap.h>
 #include <octomap/ColorOcTree.h>
@@ -34,6 +34,7 @@
 #include "rclcpp/rclcpp.hpp"
 #include "visualization_msgs/msg/marker_array.hpp"
 #include "vox_nav_utilities/pcl_helpers.hpp"
+#include "vox_nav_utilities/pcl2octomap_converter.hpp"
 
 
 namespace vox_nav_utilities
@@ -55,8 +56,11 @@ namespace vox_nav_utilities
     double remove_outlier_radius_search_;
     int remove_outlier_min_neighbors_in_radius_;
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr pointcloud_;
-    // Used to creted a periodic callback function IOT publish transfrom/octomap/cloud etc.
-    rclcpp::TimerBase::SharedPtr timer_;
+    // see PCL2OctomapOptions
+    int num_threads_;
+    int partition_depth_;
+    // if true, markers of converted octomap are published latched and node keeps spinning
+    bool publish_markers_;
     rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr octomap_markers_publisher_;
     visualization_msgs::msg::MarkerArray octomap_markers_;
 
@@ -93,18 +97,26 @@ namespace vox_nav_utilities
     void outputStatistics(const octomap::ColorOcTree tree);
 
     /**
-     * @brief
+     * @brief Convert loaded cloud to a ColorOcTree with convertCloudToColorOctree, write it to
+     * output_binary_octomap_filename (.bt or .ot) and fill octomap markers
      *
+     * @return true
+     * @return false if octree could not be written
      */
-    void processConversion();
+    bool processConversion();
 
     /**
-     * @brief
+     * @brief Whether markers should be published after conversion
      *
+     * @return true
+     * @return false
      */
-    void timerCallback();
+    bool publishMarkers() const
+    {
+      return publish_markers_;
+    }
 
   };
 
 }  // namespace vox_nav_utilities
-#endif  // VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_HPP_
+#endif  // VOX_NAV_UTILITIES__PCL2OCTOMAP_CONVERTER_NODE_HPP_
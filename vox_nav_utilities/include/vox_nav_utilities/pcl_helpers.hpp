@@ -53,6 +53,7 @@
 #include "rclcpp/rclcpp.hpp"
 #include "sensor_msgs/msg/point_cloud2.hpp"
 #include "geometry_msgs/msg/point.hpp"
+#include "vox_nav_utilities/parallel_cloud_filters.hpp"
 
 namespace vox_nav_utilities
 {
@@ -145,6 +146,8 @@ namespace vox_nav_utilities
 * the StatisticalOutlierRemoval filter from pcl. The explanation on
 * how the algorithm works can be found here:
 * http://pointclouds.org/documentation/tutorials/statistical_outlier.php
+* Neighbour queries run on all cores, see parallelStatisticalOutlierRemoval and
+* parallelRadiusOutlierRemoval
 * @param[in] Input point cloud
 * @return Point cloud where outliers have been removed.
 */
@@ -185,16 +188,20 @@ namespace vox_nav_utilities
   }
 
 
+/**
+ * @brief Replace points in each voxel of downsmaple_leaf_size by their centroid, runs on all
+ * cores, see parallelVoxelDownsample
+ *
+ * @tparam P
+ * @param inputCloud
+ * @param downsmaple_leaf_size
+ * @return pcl::PointCloud<P>::Ptr
+ */
   template<typename P>
   typename pcl::PointCloud<P>::Ptr downsampleInputCloud(
     typename pcl::PointCloud<P>::Ptr inputCloud, double downsmaple_leaf_size)
   {
-    pcl::VoxelGrid<P> voxelGrid;
-    voxelGrid.setInputCloud(inputCloud);
-    voxelGrid.setLeafSize(downsmaple_leaf_size, downsmaple_leaf_size, downsmaple_leaf_size);
-    typename pcl::PointCloud<P>::Ptr downsampledCloud(new pcl::PointCloud<P>());
-    voxelGrid.filter(*downsampledCloud);
-    return downsampledCloud;
+    return parallelVoxelDownsample<P>(*inputCloud, downsmaple_leaf_size);
   }
 
   template<typename P>
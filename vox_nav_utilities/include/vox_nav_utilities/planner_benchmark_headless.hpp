@@ -0,0 +1,247 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VOX_NAV_UTILITIES__PLANNER_BENCHMARK_HEADLESS_HPP_
+#define VOX_NAV_UTILITIES__PLANNER_BENCHMARK_HEADLESS_HPP_
+#pragma once
+
+#include <vox_nav_utilities/planner_benchmarking_node.hpp>
+#include <vox_nav_utilities/planner_helpers.hpp>
+// STL
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace vox_nav_utilities {
+
+/**
+ * @brief A start/goal pair of a benchmark scenario file
+ *
+ */
+struct BenchmarkScenario {
+  int id;
+  GroundRobotPose start;
+  GroundRobotPose goal;
+  BenchmarkScenario() : id(0) {}
+};
+
+/**
+ * @brief Outcome of one planner on one scenario
+ *
+ */
+struct BenchmarkRunResult {
+  std::string planner;
+  int scenario_id;
+  bool success;
+  double time_to_first_solution;
+  double total_time;
+  double cost;
+  uint64_t validity_checks;
+  double bounds_margin; // negative for static bounds
+  double bounds_area;   // xy area of state space bounds of run
+  BenchmarkRunResult()
+      : scenario_id(0), success(false), time_to_first_solution(-1.0),
+        total_time(0.0), cost(-1.0), validity_checks(0), bounds_margin(-1.0),
+        bounds_area(0.0) {}
+};
+
+/**
+ * @brief Benchmark harness that does not need a running map server,
+ * map is loaded from disk, scenarios are generated from a seed (or loaded from
+ * a scenario file) and each planner runs in its own worker process.
+ * Per run results are written as CSV, per planner summary as JSON.
+ *
+ */
+class PlannerBenchmarkHeadless : public rclcpp::Node {
+public:
+  /**
+   * @brief Construct a new Planner Benchmark Headless object,
+   * only reads parameters, nothing is spun
+   *
+   */
+  PlannerBenchmarkHeadless();
+
+  /**
+   * @brief Destroy the Planner Benchmark Headless object
+   *
+   */
+  ~PlannerBenchmarkHeadless();
+
+  /**
+   * @brief Load .bt or .ot octomap from map_file
+   *
+   * @return true
+   * @return false
+   */
+  bool loadMap();
+
+  /**
+   * @brief Load scenarios from scenario_file, malformed rows are skipped
+   *
+   * @return true
+   * @return false if scenario_file can not be read
+   */
+  bool loadScenarios();
+
+  /**
+   * @brief Load scenarios from scenario_file if it exists, otherwise generate
+   * them with seed and save to scenario_file
+   *
+   * @return true
+   * @return false
+   */
+  bool loadOrGenerateScenarios();
+
+  /**
+   * @brief Run all planners on all scenarios, up to num_workers processes at
+   * a time, then write results. Each worker is a new instance of this binary
+   * started with --worker <planner> and given arguments
+   *
+   * @param argc
+   * @param argv arguments of this process, without --worker
+   * @return int process exit code, non zero if a planner is under
+   * min_success_rate or its worker failed
+   */
+  int run(int argc, char **argv);
+
+  /**
+   * @brief Run a single planner on all scenarios and write its part file,
+   * entry point of a worker process
+   *
+   * @param planner_name
+   * @return int process exit code
+   */
+  int runWorker(const std::string &planner_name);
+
+protected:
+  /**
+   * @brief Solve all scenarios with given planner, runs inside a worker process
+   *
+   * @param planner_name
+   * @return std::vector<BenchmarkRunResult>
+   */
+  std::vector<BenchmarkRunResult> runPlanner(const std::string &planner_name);
+
+  /**
+   * @brief Allocate state space of selected_state_space with bounds
+   *
+   * @return ompl::base::StateSpacePtr
+   */
+  ompl::base::StateSpacePtr allocateStateSpace();
+
+  /**
+   * @brief Robot body vs map collision check at given pose
+   *
+   * @param x
+   * @param y
+   * @param z
+   * @param yaw
+   * @return true
+   * @return false
+   */
+  bool isPoseValid(double x, double y, double z, double yaw);
+
+  /**
+   * @brief
+   *
+   * @param state
+   * @return true
+   * @return false
+   */
+  bool isStateValid(const ompl::base::State *state);
+
+  /**
+   * @brief Set start and goal states of a scenario to simple setup
+   *
+   * @param scenario
+   * @param ss
+   */
+  void setStartAndGoal(const BenchmarkScenario &scenario,
+                       ompl::geometric::SimpleSetup &ss);
+
+  /**
+   * @brief Set state space bounds for a scenario, request local bounds
+   * inflated by margin when margin is non negative, static
+   * state_space_boundries otherwise
+   *
+   * @param scenario
+   * @param margin
+   * @return double xy area of the bounds
+   */
+  double setBoundsForScenario(const BenchmarkScenario &scenario,
+                              double margin);
+
+  void writeRunResults(const std::string &file,
+                       const std::vector<BenchmarkRunResult> &results);
+
+  /**
+   * @brief Append results of a run results CSV, malformed rows are skipped
+   *
+   * @param file
+   * @param results
+   * @return true
+   * @return false if file can not be read
+   */
+  bool readRunResults(const std::string &file,
+                      std::vector<BenchmarkRunResult> &results);
+
+  /**
+   * @brief Results of a worker, merged in to results.csv by parent
+   *
+   * @param planner
+   * @return std::string
+   */
+  std::string partFile(const std::string &planner) const;
+
+  /**
+   * @brief Write per planner summary to JSON, returns false if a planner is
+   * under min_success_rate or has no results
+   *
+   * @param file
+   * @param results
+   * @return true
+   * @return false
+   */
+  bool writeSummary(const std::string &file,
+                    const std::vector<BenchmarkRunResult> &results);
+
+  std::string map_file_;
+  std::string scenario_file_;
+  std::string results_output_dir_;
+  std::vector<std::string> selected_planners_;
+  std::string selected_state_space_;
+  SEBounds se_bounds_;
+  geometry_msgs::msg::Vector3 robot_body_dimensions_;
+  double robot_z_;
+  double planner_timeout_;
+  double min_turning_radius_;
+  double goal_tolerance_;
+  double min_euclidean_dist_start_to_goal_;
+  double min_success_rate_;
+  int seed_;
+  int num_scenarios_;
+  int max_sampling_attempts_;
+  int num_workers_;
+  std::vector<double> adaptive_bounds_margins_;
+
+  std::vector<BenchmarkScenario> scenarios_;
+  std::shared_ptr<octomap::OcTree> original_octomap_octree_;
+  std::shared_ptr<fcl::CollisionObject> original_octomap_collision_object_;
+  std::shared_ptr<fcl::CollisionObject> robot_collision_object_;
+  ompl::base::StateSpacePtr state_space_;
+};
+} // namespace vox_nav_utilities
+
+#endif // VOX_NAV_UTILITIES__PLANNER_BENCHMARK_HEADLESS_HPP_
@@ -26,7 +26,10 @@
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <visualization_msgs/msg/marker_array.hpp>
 #include <vox_nav_utilities/elevation_state_space.hpp>
+#include <vox_nav_utilities/esdf.hpp>
+#include <vox_nav_utilities/footprint_masks.hpp>
 #include <vox_nav_utilities/pcl_helpers.hpp>
+#include <vox_nav_utilities/planner_helpers.hpp>
 #include <vox_nav_utilities/tf_helpers.hpp>
 // PCL
 #include <pcl/common/common.h>
@@ -144,6 +147,20 @@ private:
   std::shared_ptr<octomap::OcTree> original_octomap_octree_;
   std::shared_ptr<fcl::CollisionObject> original_octomap_collision_object_;
   std::shared_ptr<fcl::CollisionObject> robot_collision_object_;
+  // distance field of original octomap, answers clearance queries
+  std::shared_ptr<ESDF> esdf_;
+  bool esdf_enabled_;
+  double esdf_max_distance_;
+  double esdf_resolution_;
+  double robot_inscribed_radius_;
+  double robot_circumscribed_radius_;
+  // voxelized robot body per yaw/pitch bin, replaces most FCL checks
+  std::shared_ptr<FootprintMasks> footprint_masks_;
+  bool footprint_masks_enabled_;
+  bool footprint_masks_exact_confirmation_;
+  int footprint_masks_yaw_bins_;
+  int footprint_masks_pitch_bins_;
+  double footprint_masks_max_pitch_;
   // Publishers for the path
 
   rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr
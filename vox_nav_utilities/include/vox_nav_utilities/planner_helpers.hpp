@@ -15,6 +15,7 @@
 #ifndef VOX_NAV_UTILITIES__PLANNER_HELPERS_HPP_
 #define VOX_NAV_UTILITIES__PLANNER_HELPERS_HPP_
 
+#include <functional>
 #include <string>
 #include <memory>
 #include "rclcpp/rclcpp.hpp"
@@ -25,6 +26,7 @@
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "vox_nav_utilities/tf_helpers.hpp"
 #include "vox_nav_utilities/pcl_helpers.hpp"
+#include "vox_nav_utilities/esdf.hpp"
 // OMPL BASE
 #include <ompl/base/samplers/ObstacleBasedValidStateSampler.h>
 #include <ompl/base/OptimizationObjective.h>
@@ -56,6 +58,13 @@
 #include <ompl/geometric/planners/informedtrees/AITstar.h>
 #include <ompl/geometric/SimpleSetup.h>
 #include <ompl/base/OptimizationObjective.h>
+// OMPL CONTROL
+#include <ompl/control/SpaceInformation.h>
+#include <ompl/control/planners/sst/SST.h>
+#include <ompl/control/planners/rrt/RRT.h>
+#include <ompl/control/planners/est/EST.h>
+#include <ompl/control/planners/kpiece/KPIECE1.h>
+#include <ompl/control/planners/pdst/PDST.h>
 // OCTOMAP
 #include <octomap_msgs/msg/octomap.hpp>
 #include <octomap_msgs/conversions.h>
@@ -70,6 +79,41 @@
 namespace vox_nav_utilities
 {
 
+/**
+ * @brief Validity checker that answers clearance() from an ESDF, so that
+ * clearance based objectives and samplers (e.g. MaximizeMinClearanceObjective)
+ * get real obstacle distances instead of OMPL's default of 0.
+ * Validity is delegated to given exact check.
+ *
+ */
+  class ClearanceValidityChecker : public ompl::base::StateValidityChecker
+  {
+  public:
+    /**
+     * @brief Construct a new Clearance Validity Checker object
+     *
+     * @param si
+     * @param esdf
+     * @param is_valid exact validity check
+     * @param get_position extracts x, y, z of a state of the used state space
+     */
+    ClearanceValidityChecker(
+      const ompl::base::SpaceInformationPtr & si,
+      const std::shared_ptr<ESDF> & esdf,
+      const std::function<bool(const ompl::base::State *)> & is_valid,
+      const std::function<void(const ompl::base::State *, double &, double &, double &)> &
+      get_position);
+
+    bool isValid(const ompl::base::State * state) const override;
+
+    double clearance(const ompl::base::State * state) const override;
+
+  private:
+    std::shared_ptr<ESDF> esdf_;
+    std::function<bool(const ompl::base::State *)> is_valid_;
+    std::function<void(const ompl::base::State *, double &, double &, double &)> get_position_;
+  };
+
 /**
  * @brief Get the Nearst Node to given state object
  *
@@ -95,6 +139,21 @@ namespace vox_nav_utilities
     const ompl::base::SpaceInformationPtr & si,
     const rclcpp::Logger logger);
 
+/**
+ * @brief Same as initializeSelectedPlanner but for kinodynamic (ompl::control) planners,
+ * falls back to SST for unknown names
+ *
+ * @param planner
+ * @param selected_planner_name
+ * @param si
+ * @param logger
+ */
+  void initializeSelectedControlPlanner(
+    ompl::base::PlannerPtr & planner,
+    const std::string & selected_planner_name,
+    const ompl::control::SpaceInformationPtr & si,
+    const rclcpp::Logger logger);
+
   /**
    * @brief populate pcl surfel from geometry msgs Pose
    *
@@ -128,6 +187,28 @@ namespace vox_nav_utilities
     const pcl::PointCloud<pcl::PointSurfel>::Ptr & elevated_surfel_cloud
   );
 
+  /**
+   * @brief Request local state space bounds. Box around start and goal is inflated by margin
+   * and clipped to map extent, start and goal always stay inside the bounds.
+   * Degenerate axes (e.g. a flat map) are widened to at least max(margin, 1 m).
+   *
+   * @param start
+   * @param goal
+   * @param map_min min corner of map extent
+   * @param map_max max corner of map extent
+   * @param margin inflation of start/goal box, meters
+   * @param se2_bounds x and y bounds, must have 2 dimensions
+   * @param z_bounds z bounds, must have 1 dimension
+   */
+  void determineAdaptiveBounds(
+    const geometry_msgs::msg::Point & start,
+    const geometry_msgs::msg::Point & goal,
+    const geometry_msgs::msg::Point & map_min,
+    const geometry_msgs::msg::Point & map_max,
+    double margin,
+    ompl::base::RealVectorBounds & se2_bounds,
+    ompl::base::RealVectorBounds & z_bounds);
+
   /**
    * @brief
    *
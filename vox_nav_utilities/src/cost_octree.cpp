@@ -0,0 +1,184 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+
+#include "vox_nav_utilities/cost_octree.hpp"
+
+namespace vox_nav_utilities
+{
+
+  std::istream & CostOcTreeNode::readData(std::istream & s)
+  {
+    s.read(reinterpret_cast<char *>(&value), sizeof(value));
+    s.read(reinterpret_cast<char *>(&cost_), sizeof(cost_));
+    s.read(reinterpret_cast<char *>(&label_), sizeof(label_));
+    return s;
+  }
+
+  std::ostream & CostOcTreeNode::writeData(std::ostream & s) const
+  {
+    s.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    s.write(reinterpret_cast<const char *>(&cost_), sizeof(cost_));
+    s.write(reinterpret_cast<const char *>(&label_), sizeof(label_));
+    return s;
+  }
+
+  CostOcTree::CostOcTree(double resolution)
+  : octomap::OccupancyOcTreeBase<CostOcTreeNode>(resolution)
+  {
+    cost_octree_member_init_.ensureLinking();
+  }
+
+  uint8_t CostOcTree::quantizeCost(double cost)
+  {
+    if (cost > 1.0) {
+      return kLethalCost;
+    }
+    return static_cast<uint8_t>(std::round(std::max(0.0, cost) * kMaxTraversableCost));
+  }
+
+  double CostOcTree::dequantizeCost(uint8_t cost)
+  {
+    if (cost == kLethalCost) {
+      return 2.0;
+    }
+    return static_cast<double>(cost) / kMaxTraversableCost;
+  }
+
+  bool CostOcTree::isNodeCollapsible(const CostOcTreeNode * node) const
+  {
+    if (!nodeChildExists(node, 0)) {
+      return false;
+    }
+    const CostOcTreeNode * first_child = getNodeChild(node, 0);
+    if (nodeHasChildren(first_child)) {
+      return false;
+    }
+    for (unsigned int i = 1; i < 8; i++) {
+      if (!nodeChildExists(node, i)) {
+        return false;
+      }
+      const CostOcTreeNode * child = getNodeChild(node, i);
+      if (nodeHasChildren(child) || !(*child == *first_child)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool CostOcTree::pruneNode(CostOcTreeNode * node)
+  {
+    if (!isNodeCollapsible(node)) {
+      return false;
+    }
+    // all children are equal, so node takes data of first one
+    node->copyData(*(getNodeChild(node, 0)));
+    for (unsigned int i = 0; i < 8; i++) {
+      deleteNodeChild(node, i);
+    }
+    delete[] node->children;
+    node->children = nullptr;
+    return true;
+  }
+
+  CostOcTreeNode * CostOcTree::setNodeCost(
+    const octomap::OcTreeKey & key, uint8_t cost, CostLabel label)
+  {
+    CostOcTreeNode * node = search(key);
+    if (node) {
+      node->setCost(cost);
+      node->setLabel(label);
+    }
+    return node;
+  }
+
+  CostOcTreeNode * CostOcTree::setNodeValueAtDepth(
+    const octomap::OcTreeKey & key, unsigned int depth,
+    float log_odds, uint8_t cost, CostLabel label)
+  {
+    if (depth == 0 || depth > tree_depth) {
+      depth = tree_depth;
+    }
+    bool created = false;
+    if (!root) {
+      root = new CostOcTreeNode();
+      tree_size++;
+      created = true;
+    }
+    CostOcTreeNode * node = root;
+    for (unsigned int d = 0; d < depth; d++) {
+      unsigned int child_index = octomap::computeChildIdx(key, tree_depth - 1 - d);
+      if (!nodeChildExists(node, child_index)) {
+        if (!created && d > 0 && !nodeHasChildren(node)) {
+          // node is a coarser leaf, its children take its value
+          expandNode(node);
+        } else {
+          createNodeChild(node, child_index);
+          created = true;
+        }
+      }
+      node = getNodeChild(node, child_index);
+    }
+    for (unsigned int i = 0; i < 8; i++) {
+      if (nodeChildExists(node, i)) {
+        deleteNodeChild(node, i);
+      }
+    }
+    node->setLogOdds(log_odds);
+    node->setCost(cost);
+    node->setLabel(label);
+    return node;
+  }
+
+  void CostOcTree::updateInnerOccupancy()
+  {
+    if (root) {
+      updateInnerOccupancyRecurs(root, 0);
+    }
+  }
+
+  void CostOcTree::updateInnerOccupancyRecurs(CostOcTreeNode * node, unsigned int depth)
+  {
+    if (!nodeHasChildren(node)) {
+      return;
+    }
+    if (depth < tree_depth) {
+      for (unsigned int i = 0; i < 8; i++) {
+        if (nodeChildExists(node, i)) {
+          updateInnerOccupancyRecurs(getNodeChild(node, i), depth + 1);
+        }
+      }
+    }
+    node->updateOccupancyChildren();
+    // costliest child represents the node
+    const CostOcTreeNode * costliest = nullptr;
+    for (unsigned int i = 0; i < 8; i++) {
+      if (nodeChildExists(node, i)) {
+        const CostOcTreeNode * child = getNodeChild(node, i);
+        if (!costliest || child->getCost() > costliest->getCost()) {
+          costliest = child;
+        }
+      }
+    }
+    if (costliest) {
+      node->setCost(costliest->getCost());
+      node->setLabel(costliest->getLabel());
+    }
+  }
+
+  CostOcTree::StaticMemberInitializer CostOcTree::cost_octree_member_init_;
+
+}  // namespace vox_nav_utilities
@@ -0,0 +1,309 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "vox_nav_utilities/elevation_grid.hpp"
+
+namespace vox_nav_utilities
+{
+
+  ElevationGrid::ElevationGrid()
+  : origin_x_(0.0),
+    origin_y_(0.0),
+    resolution_(0.0),
+    size_x_(0),
+    size_y_(0),
+    is_ready_(false)
+  {
+  }
+
+  ElevationGrid::~ElevationGrid()
+  {
+  }
+
+  bool ElevationGrid::build(
+    const pcl::PointCloud<pcl::PointXYZ>::Ptr & cloud,
+    double resolution,
+    int num_threads)
+  {
+    is_ready_ = false;
+    if (!cloud || cloud->points.empty() || resolution <= 0.0) {
+      return false;
+    }
+    if (num_threads <= 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    resolution_ = resolution;
+
+    double min_x = std::numeric_limits<double>::infinity(), min_y = min_x;
+    double max_x = -std::numeric_limits<double>::infinity(), max_y = max_x;
+    for (auto && p : cloud->points) {
+      if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) {
+        continue;
+      }
+      min_x = std::min(min_x, static_cast<double>(p.x));
+      min_y = std::min(min_y, static_cast<double>(p.y));
+      max_x = std::max(max_x, static_cast<double>(p.x));
+      max_y = std::max(max_y, static_cast<double>(p.y));
+    }
+    if (!std::isfinite(min_x)) {
+      return false;
+    }
+    origin_x_ = min_x;
+    origin_y_ = min_y;
+    size_x_ = static_cast<int>(std::floor((max_x - min_x) / resolution_)) + 1;
+    size_y_ = static_cast<int>(std::floor((max_y - min_y) / resolution_)) + 1;
+    const size_t num_cells = static_cast<size_t>(size_x_) * size_y_;
+    for (auto && layer : layers_) {
+      layer.assign(num_cells, std::numeric_limits<float>::quiet_NaN());
+    }
+
+    // Counting sort of point indices by row, so that each thread owns a block of rows
+    // and accumulates cell statistics without locking
+    std::vector<uint32_t> cell_of_point(cloud->points.size());
+    std::vector<size_t> row_start(size_y_ + 1, 0);
+    for (size_t i = 0; i < cloud->points.size(); i++) {
+      const auto & p = cloud->points[i];
+      size_t cell;
+      if (!std::isfinite(p.z) || !cellIndex(p.x, p.y, cell)) {
+        cell_of_point[i] = std::numeric_limits<uint32_t>::max();
+        continue;
+      }
+      cell_of_point[i] = cell;
+      row_start[cell / size_x_ + 1]++;
+    }
+    for (int row = 0; row < size_y_; row++) {
+      row_start[row + 1] += row_start[row];
+    }
+    std::vector<uint32_t> sorted_points(row_start[size_y_]);
+    std::vector<size_t> row_fill(row_start.begin(), row_start.end() - 1);
+    for (size_t i = 0; i < cloud->points.size(); i++) {
+      if (cell_of_point[i] != std::numeric_limits<uint32_t>::max()) {
+        sorted_points[row_fill[cell_of_point[i] / size_x_]++] = i;
+      }
+    }
+
+    auto & elevation = layers_[static_cast<int>(Layer::ELEVATION)];
+    auto & roughness = layers_[static_cast<int>(Layer::ROUGHNESS)];
+    auto cell_statistics = [&](int row_begin, int row_end) {
+        std::vector<double> sum(size_x_), sum_sq(size_x_);
+        std::vector<uint32_t> count(size_x_);
+        for (int row = row_begin; row < row_end; row++) {
+          std::fill(sum.begin(), sum.end(), 0.0);
+          std::fill(sum_sq.begin(), sum_sq.end(), 0.0);
+          std::fill(count.begin(), count.end(), 0);
+          const size_t row_offset = static_cast<size_t>(row) * size_x_;
+          for (size_t i = row_start[row]; i < row_start[row + 1]; i++) {
+            const uint32_t point = sorted_points[i];
+            const size_t col = cell_of_point[point] - row_offset;
+            const double z = cloud->points[point].z;
+            sum[col] += z;
+            sum_sq[col] += z * z;
+            count[col]++;
+            float & top = elevation[row_offset + col];
+            if (std::isnan(top) || z > top) {
+              top = z;
+            }
+          }
+          for (int col = 0; col < size_x_; col++) {
+            if (count[col]) {
+              double mean = sum[col] / count[col];
+              roughness[row_offset + col] =
+                std::sqrt(std::max(0.0, sum_sq[col] / count[col] - mean * mean));
+            }
+          }
+        }
+      };
+
+    // Rows of second pass read elevation of neighbouring rows, so it starts after first pass
+    auto run_blocks = [&](auto && fn) {
+        std::vector<std::thread> threads;
+        int rows_per_thread = (size_y_ + num_threads - 1) / num_threads;
+        for (int row = 0; row < size_y_; row += rows_per_thread) {
+          threads.emplace_back(fn, row, std::min(size_y_, row + rows_per_thread));
+        }
+        for (auto && t : threads) {
+          t.join();
+        }
+      };
+    run_blocks(cell_statistics);
+    run_blocks(
+      [this](int row_begin, int row_end) {
+        computeNeighbourLayers(row_begin, row_end);
+      });
+
+    is_ready_ = true;
+    return true;
+  }
+
+  bool ElevationGrid::build(
+    const std::shared_ptr<octomap::OcTree> & octree,
+    double resolution,
+    int num_threads)
+  {
+    is_ready_ = false;
+    if (!octree) {
+      return false;
+    }
+    const double octree_resolution = octree->getResolution();
+    auto cloud = pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>);
+    for (auto it = octree->begin_leafs(), end = octree->end_leafs(); it != end; ++it) {
+      if (!octree->isNodeOccupied(*it)) {
+        continue;
+      }
+      // leafs of pruned tree can span many voxels of finest resolution
+      int n = std::max(1, static_cast<int>(std::round(it.getSize() / octree_resolution)));
+      octomap::point3d corner = it.getCoordinate() -
+        octomap::point3d(it.getSize() / 2.0, it.getSize() / 2.0, it.getSize() / 2.0);
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+          for (int k = 0; k < n; k++) {
+            cloud->points.push_back(
+              pcl::PointXYZ(
+                corner.x() + (i + 0.5) * octree_resolution,
+                corner.y() + (j + 0.5) * octree_resolution,
+                corner.z() + (k + 0.5) * octree_resolution));
+          }
+        }
+      }
+    }
+    cloud->width = cloud->points.size();
+    cloud->height = 1;
+    return build(cloud, resolution > 0.0 ? resolution : octree_resolution, num_threads);
+  }
+
+  void ElevationGrid::computeNeighbourLayers(int row_begin, int row_end)
+  {
+    const auto & elevation = layers_[static_cast<int>(Layer::ELEVATION)];
+    auto & slope = layers_[static_cast<int>(Layer::SLOPE)];
+    auto & step = layers_[static_cast<int>(Layer::STEP)];
+
+    auto elevation_at = [&](int col, int row) {
+        if (col < 0 || row < 0 || col >= size_x_ || row >= size_y_) {
+          return std::numeric_limits<float>::quiet_NaN();
+        }
+        return elevation[static_cast<size_t>(row) * size_x_ + col];
+      };
+    // one sided difference where a neighbour is unknown, 0 if both are
+    auto derivative = [this](float center, float prev, float next) {
+        if (!std::isnan(prev) && !std::isnan(next)) {
+          return (next - prev) / (2.0 * resolution_);
+        } else if (!std::isnan(next)) {
+          return (next - center) / resolution_;
+        } else if (!std::isnan(prev)) {
+          return (center - prev) / resolution_;
+        }
+        return 0.0;
+      };
+
+    for (int row = row_begin; row < row_end; row++) {
+      for (int col = 0; col < size_x_; col++) {
+        const size_t cell = static_cast<size_t>(row) * size_x_ + col;
+        const float center = elevation[cell];
+        if (std::isnan(center)) {
+          continue;
+        }
+        double gx = derivative(center, elevation_at(col - 1, row), elevation_at(col + 1, row));
+        double gy = derivative(center, elevation_at(col, row - 1), elevation_at(col, row + 1));
+        slope[cell] = std::atan(std::sqrt(gx * gx + gy * gy));
+
+        float max_step = 0.0;
+        for (int dy = -1; dy <= 1; dy++) {
+          for (int dx = -1; dx <= 1; dx++) {
+            float neighbour = elevation_at(col + dx, row + dy);
+            if (!std::isnan(neighbour)) {
+              max_step = std::max(max_step, std::abs(neighbour - center));
+            }
+          }
+        }
+        step[cell] = max_step;
+      }
+    }
+  }
+
+  float ElevationGrid::get(Layer layer, double x, double y) const
+  {
+    size_t cell;
+    if (!is_ready_ || !cellIndex(x, y, cell)) {
+      return std::numeric_limits<float>::quiet_NaN();
+    }
+    return layers_[static_cast<int>(layer)][cell];
+  }
+
+  bool ElevationGrid::isCellTraversable(size_t cell, const TraversabilityLimits & limits) const
+  {
+    const float elevation = layers_[static_cast<int>(Layer::ELEVATION)][cell];
+    if (std::isnan(elevation)) {
+      return limits.allow_unknown;
+    }
+    return elevation <= limits.max_elevation &&
+           layers_[static_cast<int>(Layer::SLOPE)][cell] <= limits.max_slope &&
+           layers_[static_cast<int>(Layer::ROUGHNESS)][cell] <= limits.max_roughness &&
+           layers_[static_cast<int>(Layer::STEP)][cell] <= limits.max_step;
+  }
+
+  bool ElevationGrid::isTraversable(
+    double x, double y, const TraversabilityLimits & limits) const
+  {
+    size_t cell;
+    if (!is_ready_ || !cellIndex(x, y, cell)) {
+      return is_ready_ && limits.allow_unknown;
+    }
+    return isCellTraversable(cell, limits);
+  }
+
+  bool ElevationGrid::isFootprintTraversable(
+    double x, double y, double yaw,
+    double length, double width,
+    const TraversabilityLimits & limits) const
+  {
+    if (!is_ready_) {
+      return false;
+    }
+    // sample footprint at half cell spacing so that every covered cell is visited
+    const double spacing = resolution_ / 2.0;
+    const int samples_x = static_cast<int>(std::ceil(length / spacing)) + 1;
+    const int samples_y = static_cast<int>(std::ceil(width / spacing)) + 1;
+    const double c = std::cos(yaw), s = std::sin(yaw);
+    size_t last_cell = std::numeric_limits<size_t>::max();
+    for (int i = 0; i < samples_x; i++) {
+      const double u = -length / 2.0 + length * i / std::max(1, samples_x - 1);
+      for (int j = 0; j < samples_y; j++) {
+        const double v = -width / 2.0 + width * j / std::max(1, samples_y - 1);
+        size_t cell;
+        if (!cellIndex(x + c * u - s * v, y + s * u + c * v, cell)) {
+          if (!limits.allow_unknown) {
+            return false;
+          }
+          continue;
+        }
+        if (cell == last_cell) {
+          continue;
+        }
+        last_cell = cell;
+        if (!isCellTraversable(cell, limits)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+}  // namespace vox_nav_utilities
@@ -254,6 +254,25 @@ void OctoCellValidStateSampler::updateSearchArea(
 
   RCLCPP_INFO(logger_, "Updated search area surfels, %d", search_area_surfels_->points.size());
 
+  // Drop surfels outside of current (possibly request local) state space bounds,
+  // samples there would be rejected by satisfiesBounds anyway
+  auto bounds = si_->getStateSpace()->as<ompl::base::ElevationStateSpace>()->getBounds();
+  auto cropped_surfels = pcl::PointCloud<pcl::PointSurfel>::Ptr(
+    new pcl::PointCloud<pcl::PointSurfel>);
+  for (auto && i : search_area_surfels_->points) {
+    if (i.x >= bounds.low[0] && i.x <= bounds.high[0] &&
+      i.y >= bounds.low[1] && i.y <= bounds.high[1] &&
+      i.z >= bounds.low[2] && i.z <= bounds.high[2])
+    {
+      cropped_surfels->points.push_back(i);
+    }
+  }
+  if (!cropped_surfels->points.empty()) {
+    cropped_surfels->width = cropped_surfels->points.size();
+    cropped_surfels->height = 1;
+    search_area_surfels_ = cropped_surfels;
+  }
+
   search_area_surfels_ = vox_nav_utilities::uniformlySampleCloud<pcl::PointSurfel>(
     search_area_surfels_, 1.2);
 
@@ -0,0 +1,260 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "vox_nav_utilities/esdf.hpp"
+
+namespace vox_nav_utilities
+{
+
+  ESDF::ESDF()
+  : size_x_(0),
+    size_y_(0),
+    size_z_(0),
+    resolution_(0.0),
+    max_distance_(0.0),
+    is_ready_(false)
+  {
+  }
+
+  ESDF::~ESDF()
+  {
+  }
+
+  bool ESDF::build(
+    const std::shared_ptr<octomap::OcTree> & octree,
+    double max_distance,
+    double resolution,
+    int num_threads)
+  {
+    is_ready_ = false;
+    if (!octree || octree->size() == 0) {
+      return false;
+    }
+    if (num_threads <= 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    resolution_ = resolution > 0.0 ? resolution : octree->getResolution();
+    max_distance_ = max_distance;
+
+    double min_x, min_y, min_z, max_x, max_y, max_z;
+    octree->getMetricMin(min_x, min_y, min_z);
+    octree->getMetricMax(max_x, max_y, max_z);
+    origin_ = octomap::point3d(min_x, min_y, min_z);
+    size_x_ = std::max(1, static_cast<int>(std::ceil((max_x - min_x) / resolution_)));
+    size_y_ = std::max(1, static_cast<int>(std::ceil((max_y - min_y) / resolution_)));
+    size_z_ = std::max(1, static_cast<int>(std::ceil((max_z - min_z) / resolution_)));
+    size_t num_voxels = static_cast<size_t>(size_x_) * size_y_ * size_z_;
+
+    // Mark every grid voxel covered by an occupied leaf, leafs can be coarser than grid
+    std::vector<bool> occupied(num_voxels, false);
+    for (auto it = octree->begin_leafs(), end = octree->end_leafs(); it != end; ++it) {
+      if (!octree->isNodeOccupied(*it)) {
+        continue;
+      }
+      double half_size = it.getSize() / 2.0;
+      octomap::point3d center = it.getCoordinate();
+      int lo[3], hi[3];
+      int sizes[3] = {size_x_, size_y_, size_z_};
+      for (int axis = 0; axis < 3; axis++) {
+        double min_c = (center(axis) - half_size - origin_(axis)) / resolution_;
+        double max_c = (center(axis) + half_size - origin_(axis)) / resolution_;
+        lo[axis] = std::max(0, static_cast<int>(std::floor(min_c + 1e-6)));
+        hi[axis] = std::min(sizes[axis] - 1, static_cast<int>(std::ceil(max_c - 1e-6)) - 1);
+      }
+      for (int z = lo[2]; z <= hi[2]; z++) {
+        for (int y = lo[1]; y <= hi[1]; y++) {
+          for (int x = lo[0]; x <= hi[0]; x++) {
+            occupied[index(x, y, z)] = true;
+          }
+        }
+      }
+    }
+
+    std::vector<bool> free(num_voxels);
+    for (size_t i = 0; i < num_voxels; i++) {
+      free[i] = !occupied[i];
+    }
+
+    std::vector<float> sq_distance_to_occupied, sq_distance_to_free;
+    computeSquaredEDT(occupied, sq_distance_to_occupied, num_threads);
+    computeSquaredEDT(free, sq_distance_to_free, num_threads);
+
+    distance_.resize(num_voxels);
+    for (size_t i = 0; i < num_voxels; i++) {
+      double d = occupied[i] ?
+        -std::sqrt(sq_distance_to_free[i]) * resolution_ :
+        std::sqrt(sq_distance_to_occupied[i]) * resolution_;
+      distance_[i] = static_cast<float>(std::max(-max_distance_, std::min(max_distance_, d)));
+    }
+    is_ready_ = true;
+    return true;
+  }
+
+  void ESDF::computeSquaredEDT(
+    const std::vector<bool> & seeds,
+    std::vector<float> & sq_distance,
+    int num_threads) const
+  {
+    // Non seed voxels start from a finite cap instead of infinity. The transform is a
+    // min-plus convolution, so stored values are min(true distance, cap), small integers
+    // that float holds exactly. Envelope arithmetic grows with q^2, it is done in double
+    float cap = std::pow(max_distance_ / resolution_ + 2.0, 2);
+    sq_distance.resize(seeds.size());
+    for (size_t i = 0; i < seeds.size(); i++) {
+      sq_distance[i] = seeds[i] ? 0.0f : cap;
+    }
+
+    // lines along x, then y, then z, each line is independent of others
+    struct Pass
+    {
+      int n;
+      size_t stride;
+      size_t num_lines;
+    };
+    const size_t plane = static_cast<size_t>(size_x_) * size_y_;
+    Pass passes[3] = {
+      {size_x_, 1, static_cast<size_t>(size_y_) * size_z_},
+      {size_y_, static_cast<size_t>(size_x_), static_cast<size_t>(size_x_) * size_z_},
+      {size_z_, plane, plane}};
+
+    for (int axis = 0; axis < 3; axis++) {
+      const Pass & pass = passes[axis];
+      auto line_start = [&](size_t line) -> size_t {
+          switch (axis) {
+            case 0:
+              return index(0, line % size_y_, line / size_y_);
+            case 1:
+              return index(line % size_x_, 0, line / size_x_);
+            default:
+              return index(line % size_x_, line / size_x_, 0);
+          }
+        };
+      auto worker = [&](size_t first_line, size_t last_line) {
+          std::vector<int> v(pass.n);
+          std::vector<double> z(pass.n + 1);
+          std::vector<double> d(pass.n);
+          for (size_t line = first_line; line < last_line; line++) {
+            squaredEDT1D(&sq_distance[line_start(line)], pass.n, pass.stride, v, z, d);
+          }
+        };
+      size_t threads =
+        std::max<size_t>(1, std::min(static_cast<size_t>(std::max(1, num_threads)), pass.num_lines));
+      size_t block = (pass.num_lines + threads - 1) / threads;
+      std::vector<std::thread> workers;
+      for (size_t t = 0; t < threads; t++) {
+        size_t first_line = t * block;
+        size_t last_line = std::min(pass.num_lines, first_line + block);
+        if (first_line < last_line) {
+          workers.emplace_back(worker, first_line, last_line);
+        }
+      }
+      for (auto && i : workers) {
+        i.join();
+      }
+    }
+  }
+
+  void ESDF::squaredEDT1D(
+    float * f, int n, size_t stride,
+    std::vector<int> & v, std::vector<double> & z, std::vector<double> & d)
+  {
+    auto value = [&](int q) {
+        return static_cast<double>(f[q * stride]);
+      };
+    auto intersection = [&](int q, int p) {
+        const double dq = q, dp = p;
+        return ((value(q) + dq * dq) - (value(p) + dp * dp)) / (2.0 * (dq - dp));
+      };
+    int k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<double>::infinity();
+    z[1] = std::numeric_limits<double>::infinity();
+    for (int q = 1; q < n; q++) {
+      double s = intersection(q, v[k]);
+      while (s <= z[k]) {
+        k--;
+        s = intersection(q, v[k]);
+      }
+      k++;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1] = std::numeric_limits<double>::infinity();
+    }
+    k = 0;
+    for (int q = 0; q < n; q++) {
+      while (z[k + 1] < q) {
+        k++;
+      }
+      const double dq = q - v[k];
+      d[q] = dq * dq + value(v[k]);
+    }
+    for (int q = 0; q < n; q++) {
+      f[q * stride] = static_cast<float>(d[q]);
+    }
+  }
+
+  bool ESDF::lookup(double x, double y, double z, double & distance) const
+  {
+    if (!is_ready_) {
+      return false;
+    }
+    int ix = static_cast<int>(std::floor((x - origin_.x()) / resolution_));
+    int iy = static_cast<int>(std::floor((y - origin_.y()) / resolution_));
+    int iz = static_cast<int>(std::floor((z - origin_.z()) / resolution_));
+    if (ix < 0 || iy < 0 || iz < 0 || ix >= size_x_ || iy >= size_y_ || iz >= size_z_) {
+      return false;
+    }
+    distance = distance_[index(ix, iy, iz)];
+    return true;
+  }
+
+  double ESDF::getDistance(double x, double y, double z) const
+  {
+    double distance;
+    if (!lookup(x, y, z, distance)) {
+      return max_distance_;
+    }
+    return distance;
+  }
+
+  ESDF::ClearanceResult ESDF::checkClearance(
+    double x, double y, double z,
+    double inscribed_radius,
+    double circumscribed_radius) const
+  {
+    // outside the grid an obstacle just inside its border may still be within the body
+    double d;
+    if (!lookup(x, y, z, d)) {
+      return ClearanceResult::UNKNOWN;
+    }
+    // distances are between voxel centers, query point and obstacle surface can each be
+    // half a voxel diagonal away from the centers
+    double lookup_error = 0.5 * std::sqrt(3.0) * resolution_;
+    if (d - 2.0 * lookup_error > circumscribed_radius) {
+      return ClearanceResult::FREE;
+    }
+    if (d + lookup_error < inscribed_radius) {
+      return ClearanceResult::COLLISION;
+    }
+    return ClearanceResult::UNKNOWN;
+  }
+
+}  // namespace vox_nav_utilities
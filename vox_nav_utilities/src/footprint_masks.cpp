@@ -0,0 +1,207 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "vox_nav_utilities/footprint_masks.hpp"
+
+namespace vox_nav_utilities
+{
+
+  FootprintMasks::FootprintMasks()
+  : resolution_(0.0),
+    yaw_bins_(1),
+    pitch_bins_(1),
+    max_pitch_(0.0)
+  {
+  }
+
+  FootprintMasks::~FootprintMasks()
+  {
+  }
+
+  void FootprintMasks::buildMasks(
+    double body_x, double body_y, double body_z,
+    double resolution,
+    int yaw_bins,
+    int pitch_bins,
+    double max_pitch)
+  {
+    resolution_ = resolution;
+    yaw_bins_ = std::max(1, yaw_bins);
+    pitch_bins_ = std::max(1, pitch_bins);
+    max_pitch_ = std::abs(max_pitch);
+    masks_.clear();
+    masks_.resize(yaw_bins_ * pitch_bins_);
+
+    const double half_x = body_x / 2.0, half_y = body_y / 2.0, half_z = body_z / 2.0;
+    const double circumscribed_radius =
+      std::sqrt(half_x * half_x + half_y * half_y + half_z * half_z);
+    // body center can be anywhere in its voxel and a voxel touches the body with its
+    // corner, so boundary is inflated by both half diagonals to stay conservative
+    const double voxel_margin = std::sqrt(3.0) * resolution_;
+
+    const double yaw_bin_width = 2.0 * M_PI / yaw_bins_;
+    const double pitch_bin_width = 2.0 * max_pitch_ / pitch_bins_;
+    // sample orientations of a bin densely enough so that body boundary moves less than
+    // half a voxel between two samples
+    const double max_step = resolution_ / (2.0 * std::max(circumscribed_radius, resolution_));
+    // an orientation between samples is at most half a step in yaw and in pitch away from
+    // the nearest one, a body corner then moves at most half diagonal times that angle
+    const double angular_margin = circumscribed_radius * std::sqrt(2.0) * max_step / 2.0;
+    const double margin = voxel_margin + angular_margin;
+    const int extent = static_cast<int>(std::ceil((circumscribed_radius + margin) / resolution_));
+
+    for (int yaw_bin = 0; yaw_bin < yaw_bins_; yaw_bin++) {
+      for (int pitch_bin = 0; pitch_bin < pitch_bins_; pitch_bin++) {
+        double yaw_low = -M_PI + yaw_bin * yaw_bin_width;
+        double pitch_low = -max_pitch_ + pitch_bin * pitch_bin_width;
+        int yaw_samples = static_cast<int>(std::ceil(yaw_bin_width / max_step)) + 1;
+        int pitch_samples = pitch_bin_width > 0.0 ?
+          static_cast<int>(std::ceil(pitch_bin_width / max_step)) + 1 : 1;
+
+        std::unordered_set<uint64_t> offsets;
+        for (int ys = 0; ys < yaw_samples; ys++) {
+          double yaw = yaw_low + yaw_bin_width * ys / std::max(1, yaw_samples - 1);
+          double cy = std::cos(yaw), sy = std::sin(yaw);
+          for (int ps = 0; ps < pitch_samples; ps++) {
+            double pitch = pitch_samples > 1 ?
+              pitch_low + pitch_bin_width * ps / (pitch_samples - 1) : pitch_low;
+            double cp = std::cos(pitch), sp = std::sin(pitch);
+            for (int dz = -extent; dz <= extent; dz++) {
+              for (int dy = -extent; dy <= extent; dy++) {
+                for (int dx = -extent; dx <= extent; dx++) {
+                  double px = dx * resolution_, py = dy * resolution_, pz = dz * resolution_;
+                  // voxel center in body frame, undo yaw then pitch
+                  double x1 = cy * px + sy * py;
+                  double y1 = -sy * px + cy * py;
+                  double x2 = cp * x1 - sp * pz;
+                  double z2 = sp * x1 + cp * pz;
+                  if (std::abs(x2) <= half_x + margin &&
+                    std::abs(y1) <= half_y + margin &&
+                    std::abs(z2) <= half_z + margin)
+                  {
+                    offsets.insert(packKey(dx + 0x8000, dy + 0x8000, dz + 0x8000));
+                  }
+                }
+              }
+            }
+          }
+        }
+
+        Mask & mask = masks_[yaw_bin * pitch_bins_ + pitch_bin];
+        for (auto && i : offsets) {
+          mask.dx.push_back(static_cast<int32_t>((i >> 32) & 0xFFFF) - 0x8000);
+          mask.dy.push_back(static_cast<int32_t>((i >> 16) & 0xFFFF) - 0x8000);
+          mask.dz.push_back(static_cast<int32_t>(i & 0xFFFF) - 0x8000);
+        }
+      }
+    }
+  }
+
+  void FootprintMasks::setMap(const std::shared_ptr<octomap::OcTree> & octree)
+  {
+    octree_ = octree;
+    occupied_keys_.clear();
+    if (!octree_) {
+      return;
+    }
+    const double resolution = octree_->getResolution();
+    for (auto it = octree_->begin_leafs(), end = octree_->end_leafs(); it != end; ++it) {
+      if (!octree_->isNodeOccupied(*it)) {
+        continue;
+      }
+      // leafs of pruned tree can span many voxels of finest resolution
+      int n = std::max(1, static_cast<int>(std::round(it.getSize() / resolution)));
+      octomap::point3d corner = it.getCoordinate() -
+        octomap::point3d(it.getSize() / 2.0, it.getSize() / 2.0, it.getSize() / 2.0);
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+          for (int k = 0; k < n; k++) {
+            octomap::OcTreeKey key = octree_->coordToKey(
+              corner + octomap::point3d(
+                (i + 0.5) * resolution, (j + 0.5) * resolution, (k + 0.5) * resolution));
+            occupied_keys_.insert(packKey(key[0], key[1], key[2]));
+          }
+        }
+      }
+    }
+  }
+
+  int FootprintMasks::yawBin(double yaw) const
+  {
+    double normalized = std::fmod(yaw + M_PI, 2.0 * M_PI);
+    if (normalized < 0.0) {
+      normalized += 2.0 * M_PI;
+    }
+    int bin = static_cast<int>(normalized / (2.0 * M_PI / yaw_bins_));
+    return std::min(bin, yaw_bins_ - 1);
+  }
+
+  int FootprintMasks::pitchBin(double pitch) const
+  {
+    if (pitch_bins_ <= 1 || max_pitch_ <= 0.0) {
+      return 0;
+    }
+    int bin = static_cast<int>((pitch + max_pitch_) / (2.0 * max_pitch_ / pitch_bins_));
+    return std::max(0, std::min(bin, pitch_bins_ - 1));
+  }
+
+  bool FootprintMasks::isPitchCovered(double pitch) const
+  {
+    return std::abs(pitch) <= max_pitch_ + 1e-6;
+  }
+
+  bool FootprintMasks::isCollisionFree(
+    double x, double y, double z, double yaw, double pitch) const
+  {
+    if (!isReady()) {
+      return false;
+    }
+    octomap::OcTreeKey center;
+    if (!octree_->coordToKeyChecked(octomap::point3d(x, y, z), center)) {
+      return false;
+    }
+    const Mask & mask = masks_[yawBin(yaw) * pitch_bins_ + pitchBin(pitch)];
+    const size_t n = mask.dx.size();
+
+    // keys of a mask are computed in one branch free loop, then looked up
+    thread_local std::vector<uint64_t> keys;
+    keys.resize(n);
+    const int32_t cx = center[0], cy = center[1], cz = center[2];
+    for (size_t i = 0; i < n; i++) {
+      keys[i] = packKey(cx + mask.dx[i], cy + mask.dy[i], cz + mask.dz[i]);
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (occupied_keys_.count(keys[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t FootprintMasks::getMaxMaskSize() const
+  {
+    size_t max_size = 0;
+    for (auto && i : masks_) {
+      max_size = std::max(max_size, i.dx.size());
+    }
+    return max_size;
+  }
+
+}  // namespace vox_nav_utilities
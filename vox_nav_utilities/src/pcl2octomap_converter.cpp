@@ -0,0 +1,230 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vox_nav_utilities/pcl2octomap_converter.hpp"
+#include "vox_nav_utilities/parallel_cloud_filters.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vox_nav_utilities
+{
+  namespace
+  {
+    // sums of a leaf, colors are averaged once all points are in
+    struct ColorLeafAccumulator
+    {
+      float value;
+      uint64_t r;
+      uint64_t g;
+      uint64_t b;
+      uint32_t count;
+      ColorLeafAccumulator()
+      : value(0.0f), r(0), g(0), b(0), count(0) {}
+    };
+
+    struct ColorLeaf
+    {
+      octomap::OcTreeKey key;
+      float value;
+      uint8_t r;
+      uint8_t g;
+      uint8_t b;
+    };
+
+    class ProgressReporter
+    {
+    public:
+      ProgressReporter(const PCL2OctomapOptions & options, const std::string & stage, size_t total)
+      : options_(options), stage_(stage), total_(std::max<size_t>(total, 1)), done_(0),
+        last_percent_(-1)
+      {
+        add(0);
+      }
+
+      void add(size_t n)
+      {
+        if (!options_.progress) {
+          return;
+        }
+        size_t done = done_ += n;
+        int percent = static_cast<int>(100 * std::min(done, total_) / total_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (percent > last_percent_) {
+          last_percent_ = percent;
+          options_.progress(stage_, percent / 100.0);
+        }
+      }
+
+    private:
+      const PCL2OctomapOptions & options_;
+      std::string stage_;
+      size_t total_;
+      std::atomic<size_t> done_;
+      int last_percent_;
+      std::mutex mutex_;
+    };
+  }  // namespace
+
+  std::shared_ptr<octomap::ColorOcTree> convertCloudToColorOctree(
+    const pcl::PointCloud<pcl::PointXYZRGB> & cloud,
+    const PCL2OctomapOptions & options)
+  {
+    auto tree = std::make_shared<octomap::ColorOcTree>(options.resolution);
+    const size_t num_points = cloud.points.size();
+    const unsigned int depth = std::max(0, std::min(options.partition_depth, 5));
+    const unsigned int shift = tree->getTreeDepth() - depth;
+    const uint32_t num_partitions = 1u << (3 * depth);
+    const uint32_t kSkip = std::numeric_limits<uint32_t>::max();
+    int num_threads = options.num_threads;
+    if (num_threads <= 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // keys and subtree of each point
+    std::vector<octomap::OcTreeKey> keys(num_points);
+    std::vector<uint32_t> partition_of(num_points, kSkip);
+    {
+      ProgressReporter progress(options, "partitioning", num_points);
+      parallelForChunks(
+        num_points, num_threads, [&](size_t begin, size_t end, int) {
+          for (size_t i = begin; i < end; i++) {
+            const auto & p = cloud.points[i];
+            if ((options.skip_elevated_nodes && p.r && p.g) ||
+            !tree->coordToKeyChecked(p.x, p.y, p.z, keys[i]))
+            {
+              continue;
+            }
+            partition_of[i] = (keys[i][0] >> shift) |
+            ((keys[i][1] >> shift) << depth) |
+            ((keys[i][2] >> shift) << (2 * depth));
+          }
+          progress.add(end - begin);
+        });
+    }
+
+    // counting sort of point indices by subtree
+    std::vector<size_t> partition_begin(num_partitions + 1, 0);
+    for (size_t i = 0; i < num_points; i++) {
+      if (partition_of[i] != kSkip) {
+        partition_begin[partition_of[i] + 1]++;
+      }
+    }
+    for (uint32_t p = 0; p < num_partitions; p++) {
+      partition_begin[p + 1] += partition_begin[p];
+    }
+    std::vector<size_t> sorted(partition_begin[num_partitions]);
+    {
+      std::vector<size_t> next(partition_begin.begin(), partition_begin.end() - 1);
+      for (size_t i = 0; i < num_points; i++) {
+        if (partition_of[i] != kSkip) {
+          sorted[next[partition_of[i]]++] = i;
+        }
+      }
+    }
+    std::vector<uint32_t>().swap(partition_of);
+
+    // leafs of each subtree, threads take next unbuilt subtree so that dense and sparse
+    // subtrees balance out
+    std::vector<std::vector<ColorLeaf>> partition_leafs(num_partitions);
+    {
+      ProgressReporter progress(options, "building subtrees", sorted.size());
+      std::atomic<uint32_t> next_partition(0);
+      auto build = [&]() {
+          octomap::unordered_ns::unordered_map<octomap::OcTreeKey, ColorLeafAccumulator,
+            octomap::OcTreeKey::KeyHash> accumulators;
+          for (uint32_t p = next_partition++; p < num_partitions; p = next_partition++) {
+            if (partition_begin[p] == partition_begin[p + 1]) {
+              continue;
+            }
+            accumulators.clear();
+            for (size_t j = partition_begin[p]; j < partition_begin[p + 1]; j++) {
+              const auto & point = cloud.points[sorted[j]];
+              // Obstacle point set the value to highest cost
+              float cost = point.r ? 1.0f : static_cast<float>(point.b) / 255.0f;
+              auto & acc = accumulators[keys[sorted[j]]];
+              acc.value = std::max(acc.value, cost);
+              acc.r += point.r;
+              acc.g += point.g;
+              acc.b += point.b;
+              acc.count++;
+            }
+            auto & leafs = partition_leafs[p];
+            leafs.reserve(accumulators.size());
+            for (auto && acc : accumulators) {
+              ColorLeaf leaf;
+              leaf.key = acc.first;
+              leaf.value = acc.second.value;
+              leaf.r = static_cast<uint8_t>(acc.second.r / acc.second.count);
+              leaf.g = static_cast<uint8_t>(acc.second.g / acc.second.count);
+              leaf.b = static_cast<uint8_t>(acc.second.b / acc.second.count);
+              leafs.push_back(leaf);
+            }
+            progress.add(partition_begin[p + 1] - partition_begin[p]);
+          }
+        };
+      std::vector<std::thread> threads;
+      for (int i = 1; i < num_threads; i++) {
+        threads.emplace_back(build);
+      }
+      build();
+      for (auto && t : threads) {
+        t.join();
+      }
+    }
+
+    // merge subtrees, they are disjoint so there is nothing to resolve
+    {
+      ProgressReporter progress(options, "merging subtrees", num_partitions);
+      for (uint32_t p = 0; p < num_partitions; p++) {
+        for (auto && leaf : partition_leafs[p]) {
+          auto * node = tree->setNodeValue(leaf.key, leaf.value, true);
+          if (node) {
+            node->setColor(leaf.r, leaf.g, leaf.b);
+          }
+        }
+        std::vector<ColorLeaf>().swap(partition_leafs[p]);
+        progress.add(1);
+      }
+    }
+    {
+      ProgressReporter progress(options, "pruning", 1);
+      tree->updateInnerOccupancy();
+      tree->prune();
+      progress.add(1);
+    }
+    return tree;
+  }
+
+  bool writeColorOctree(const octomap::ColorOcTree & tree, const std::string & filename)
+  {
+    auto extension_start = filename.find_last_of('.');
+    std::string extension =
+      extension_start == std::string::npos ? "" : filename.substr(extension_start);
+    if (extension == ".bt") {
+      return tree.writeBinaryConst(filename);
+    }
+    if (extension == ".ot") {
+      return tree.write(filename);
+    }
+    return false;
+  }
+
+}  // namespace vox_nav_utilities
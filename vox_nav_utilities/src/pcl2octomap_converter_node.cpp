@@ -36,6 +36,9 @@ namespace vox_nav_utilities
     this->declare_parameter("remove_outlier_stddev_threshold", 1.0);
     this->declare_parameter("remove_outlier_radius_search", 0.1);
     this->declare_parameter("remove_outlier_min_neighbors_in_radius", 1);
+    this->declare_parameter("num_threads", 0);
+    this->declare_parameter("partition_depth", 3);
+    this->declare_parameter("publish_markers", true);
 
     input_pcd_filename_ = this->get_parameter("input_pcd_filename").as_string();
     output_binary_octomap_filename_ =
@@ -62,6 +65,9 @@ namespace vox_nav_utilities
     remove_outlier_radius_search_ = this->get_parameter("remove_outlier_radius_search").as_double();
     remove_outlier_min_neighbors_in_radius_ =
       this->get_parameter("remove_outlier_min_neighbors_in_radius").as_int();
+    num_threads_ = this->get_parameter("num_threads").as_int();
+    partition_depth_ = this->get_parameter("partition_depth").as_int();
+    publish_markers_ = this->get_parameter("publish_markers").as_bool();
 
     pointcloud_ = vox_nav_utilities::loadPointcloudFromPcd(input_pcd_filename_.c_str());
 
@@ -88,12 +94,10 @@ namespace vox_nav_utilities
         pointloud_transform_matrix_.rpyIntrinsic_,
         get_logger()));
 
+    // markers are published once after conversion, latched for late subscribers
     octomap_markers_publisher_ = this->create_publisher<visualization_msgs::msg::MarkerArray>(
-      "vox_nav/utils/octomap_markers", rclcpp::SystemDefaultsQoS());
-
-    timer_ = this->create_wall_timer(
-      std::chrono::milliseconds(static_cast<int>(1)),
-      std::bind(&PCL2OctomapConverter::timerCallback, this));
+      "vox_nav/utils/octomap_markers",
+      rclcpp::QoS(rclcpp::KeepLast(1)).reliable().transient_local());
   }
 
   PCL2OctomapConverter::~PCL2OctomapConverter()
@@ -101,11 +105,6 @@ namespace vox_nav_utilities
 
   }
 
-  void PCL2OctomapConverter::timerCallback()
-  {
-    octomap_markers_publisher_->publish(octomap_markers_);
-  }
-
   void PCL2OctomapConverter::calcThresholdedNodes(
     const octomap::ColorOcTree tree,
     unsigned int & num_thresholded,
@@ -147,43 +146,31 @@ namespace vox_nav_utilities
     std::cout << std::endl;
   }
 
-  void PCL2OctomapConverter::processConversion()
+  bool PCL2OctomapConverter::processConversion()
   {
-    octomap::Pointcloud octocloud;
-    octomap::ColorOcTree tree(octomap_voxelsize_);
-
-    for (auto && i : pointcloud_->points) {
-      octomap::point3d endpoint(i.x, i.y, i.z);
-
-      // Yellow color pints are elevated Node centers, keep them out for now
-      if (!(i.r && i.g)) {
-        octocloud.push_back(endpoint);
-      }
-    }
-
-    std::cout << "Octocloud size is:" << octocloud.size() << std::endl;
-    octomap::point3d sensorOrigin(0, 0, 0);
-    tree.insertPointCloud(octocloud, sensorOrigin);
-
-    octomap::unordered_ns::unordered_multimap<octomap::OcTreeKey, double,
-      octomap::OcTreeKey::KeyHash> node_values;
+    PCL2OctomapOptions options;
+    options.resolution = octomap_voxelsize_;
+    options.num_threads = num_threads_;
+    options.partition_depth = partition_depth_;
+    // report each 10 percent of a stage
+    int last_reported = -1;
+    std::string last_stage;
+    options.progress = [&](const std::string & stage, double fraction) {
+        int tenth = static_cast<int>(fraction * 10.0);
+        if (stage != last_stage || tenth > last_reported) {
+          last_stage = stage;
+          last_reported = tenth;
+          RCLCPP_INFO(get_logger(), "%s: %d%%", stage.c_str(), tenth * 10);
+        }
+      };
 
-    for (auto && i : pointcloud_->points) {
-      octomap::point3d crr_point(i.x, i.y, i.z);
-      double cost = static_cast<double>(i.b) / static_cast<double>(255.0);
-      // Obstacle point set the value to highest cost
-      if (i.r) {
-        cost = 1.0;
-      }
-      if (!(i.r && i.g)) {
-        auto crr_point_node = tree.coordToKey(crr_point);
-        auto pair = std::pair<octomap::OcTreeKey, double>(crr_point_node, cost);
-        node_values.insert(pair);
-
-        tree.setNodeValue(crr_point_node, cost, false);
-        tree.setNodeColor(crr_point_node, i.r, i.g, i.b);
-      }
-    }
+    auto start = std::chrono::steady_clock::now();
+    auto tree_ptr = convertCloudToColorOctree(*pointcloud_, options);
+    auto & tree = *tree_ptr;
+    RCLCPP_INFO(
+      get_logger(), "Converted %d points to %d leafs in %.2f s",
+      pointcloud_->points.size(), tree.getNumLeafNodes(),
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
 
     auto m_treeDepth = tree.getTreeDepth();
     octomap_markers_.markers.resize(m_treeDepth + 1);
@@ -243,7 +230,15 @@ namespace vox_nav_utilities
     }
 
     outputStatistics(tree);
-    tree.write(output_binary_octomap_filename_);
+    if (!writeColorOctree(tree, output_binary_octomap_filename_)) {
+      RCLCPP_ERROR(
+        get_logger(), "Could not write octomap to %s, extension must be .bt or .ot",
+        output_binary_octomap_filename_.c_str());
+      return false;
+    }
+    RCLCPP_INFO(get_logger(), "Wrote octomap to %s", output_binary_octomap_filename_.c_str());
+    octomap_markers_publisher_->publish(octomap_markers_);
+    return true;
   }
 
 }   // namespace vox_nav_utilities
@@ -252,8 +247,10 @@ int main(int argc, char const * argv[])
 {
   rclcpp::init(argc, argv);
   auto node = std::make_shared<vox_nav_utilities::PCL2OctomapConverter>();
-  node->processConversion();
-  rclcpp::spin(node);
+  bool converted = node->processConversion();
+  if (converted && node->publishMarkers()) {
+    rclcpp::spin(node);
+  }
   rclcpp::shutdown();
-  return 0;
+  return converted ? 0 : 1;
 }
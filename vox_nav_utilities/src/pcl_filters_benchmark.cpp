@@ -0,0 +1,142 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Compares single threaded PCL filters used by map server preprocessing against
+ * vox_nav_utilities parallel ones on a given PCD map.
+ *
+ * usage: pcl_filters_benchmark <map.pcd> [leaf_size] [mean_k] [stddev_mul] [num_threads]
+ *        [radius] [min_neighbors]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+#include "vox_nav_utilities/pcl_helpers.hpp"
+#include "vox_nav_utilities/parallel_cloud_filters.hpp"
+
+namespace
+{
+  double timeMs(const std::function<void()> & fn)
+  {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  }
+
+  // radius outlier removal keeps cloud organized, outliers are NaN
+  size_t numFinitePoints(const pcl::PointCloud<pcl::PointXYZRGB> & cloud)
+  {
+    return std::count_if(
+      cloud.points.begin(), cloud.points.end(),
+      [](const pcl::PointXYZRGB & p) {return std::isfinite(p.x);});
+  }
+
+  void printRow(const char * filter, const char * impl, size_t in, size_t out, double ms)
+  {
+    std::printf("%-12s %-10s %12zu %12zu %12.1f\n", filter, impl, in, out, ms);
+  }
+}  // namespace
+
+int main(int argc, char const * argv[])
+{
+  if (argc < 2) {
+    std::printf(
+      "usage: %s <map.pcd> [leaf_size=0.1] [mean_k=10] [stddev_mul=1.0] [num_threads=0] "
+      "[radius=0.1] [min_neighbors=1]\n",
+      argv[0]);
+    return 1;
+  }
+  const std::string filename = argv[1];
+  const double leaf_size = argc > 2 ? std::atof(argv[2]) : 0.1;
+  const int mean_k = argc > 3 ? std::atoi(argv[3]) : 10;
+  const double stddev_mul = argc > 4 ? std::atof(argv[4]) : 1.0;
+  const int num_threads = argc > 5 ? std::atoi(argv[5]) : 0;
+  const double radius = argc > 6 ? std::atof(argv[6]) : 0.1;
+  const int min_neighbors = argc > 7 ? std::atoi(argv[7]) : 1;
+
+  auto cloud = vox_nav_utilities::loadPointcloudFromPcd(filename);
+  if (cloud->points.empty()) {
+    std::printf("Could not load any points from %s\n", filename.c_str());
+    return 1;
+  }
+  std::printf(
+    "%zu points, leaf_size %.3f, mean_k %d, stddev_mul %.2f, radius %.3f, min_neighbors %d\n",
+    cloud->points.size(), leaf_size, mean_k, stddev_mul, radius, min_neighbors);
+  std::printf(
+    "%-12s %-10s %12s %12s %12s\n", "filter", "impl", "points_in", "points_out", "time_ms");
+
+  // Voxel grid, PCL prints a warning and returns input if number of voxels overflows int
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr downsampled(new pcl::PointCloud<pcl::PointXYZRGB>());
+  double ms = timeMs(
+    [&]() {
+      pcl::VoxelGrid<pcl::PointXYZRGB> voxel_grid;
+      voxel_grid.setInputCloud(cloud);
+      voxel_grid.setLeafSize(leaf_size, leaf_size, leaf_size);
+      voxel_grid.filter(*downsampled);
+    });
+  printRow("voxel_grid", "pcl", cloud->points.size(), downsampled->points.size(), ms);
+
+  ms = timeMs(
+    [&]() {
+      downsampled = vox_nav_utilities::parallelVoxelDownsample<pcl::PointXYZRGB>(
+        *cloud, leaf_size, num_threads);
+    });
+  printRow("voxel_grid", "parallel", cloud->points.size(), downsampled->points.size(), ms);
+
+  // Outlier removal runs on downsampled cloud, as it does in map server
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr filtered(new pcl::PointCloud<pcl::PointXYZRGB>());
+  ms = timeMs(
+    [&]() {
+      pcl::StatisticalOutlierRemoval<pcl::PointXYZRGB> sor;
+      sor.setInputCloud(downsampled);
+      sor.setMeanK(mean_k);
+      sor.setStddevMulThresh(stddev_mul);
+      sor.filter(*filtered);
+    });
+  printRow("sor", "pcl", downsampled->points.size(), filtered->points.size(), ms);
+
+  ms = timeMs(
+    [&]() {
+      filtered = vox_nav_utilities::parallelStatisticalOutlierRemoval<pcl::PointXYZRGB>(
+        downsampled, mean_k, stddev_mul, num_threads);
+    });
+  printRow("sor", "parallel", downsampled->points.size(), filtered->points.size(), ms);
+
+  ms = timeMs(
+    [&]() {
+      pcl::RadiusOutlierRemoval<pcl::PointXYZRGB> ror;
+      ror.setInputCloud(downsampled);
+      ror.setMinNeighborsInRadius(min_neighbors);
+      ror.setRadiusSearch(radius);
+      ror.setKeepOrganized(true);
+      ror.filter(*filtered);
+    });
+  printRow("ror", "pcl", downsampled->points.size(), numFinitePoints(*filtered), ms);
+
+  ms = timeMs(
+    [&]() {
+      filtered = vox_nav_utilities::parallelRadiusOutlierRemoval<pcl::PointXYZRGB>(
+        downsampled, min_neighbors, radius, num_threads);
+    });
+  printRow("ror", "parallel", downsampled->points.size(), numFinitePoints(*filtered), ms);
+
+  return 0;
+}
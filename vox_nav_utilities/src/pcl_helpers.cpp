@@ -132,23 +132,13 @@ namespace vox_nav_utilities
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr inputCloud, int int_param, double double_param,
     OutlierRemovalType outlier_removal_type)
   {
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr filteredCloud(new pcl::PointCloud<pcl::PointXYZRGB>());
-
     if (outlier_removal_type == OutlierRemovalType::StatisticalOutlierRemoval) {
-      pcl::StatisticalOutlierRemoval<pcl::PointXYZRGB> sor;
-      sor.setInputCloud(inputCloud);
-      sor.setMeanK(int_param);
-      sor.setStddevMulThresh(double_param);
-      sor.filter(*filteredCloud);
-    } else {
-      pcl::RadiusOutlierRemoval<pcl::PointXYZRGB> outrem;
-      outrem.setInputCloud(inputCloud);
-      outrem.setMinNeighborsInRadius(int_param);
-      outrem.setRadiusSearch(double_param);
-      outrem.setKeepOrganized(true);
-      outrem.filter(*filteredCloud);
+      return parallelStatisticalOutlierRemoval<pcl::PointXYZRGB>(
+        inputCloud, int_param, double_param);
     }
-    return filteredCloud;
+    // keeps cloud organized, outliers are NaN
+    return parallelRadiusOutlierRemoval<pcl::PointXYZRGB>(
+      inputCloud, int_param, double_param);
   }
 
 /**
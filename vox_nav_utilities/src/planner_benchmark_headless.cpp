@@ -0,0 +1,694 @@
+// Copyright (c) 2020 Fetullah Atas, Norwegian University of Life Sciences
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vox_nav_utilities/planner_benchmark_headless.hpp"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace vox_nav_utilities {
+PlannerBenchmarkHeadless::PlannerBenchmarkHeadless()
+    : Node("planner_benchmark_headless_rclcpp_node") {
+  this->declare_parameter("map_file", "/home/user/map.bt");
+  this->declare_parameter("scenario_file", "/home/user/scenarios.csv");
+  this->declare_parameter("results_output_dir", "/home/user/");
+  this->declare_parameter("selected_planners",
+                          std::vector<std::string>({"RRTstar", "PRMstar"}));
+  this->declare_parameter("selected_state_space", "SE2");
+  this->declare_parameter("planner_timeout", 5.0);
+  this->declare_parameter("min_turning_radius", 2.5);
+  this->declare_parameter("goal_tolerance", 0.2);
+  this->declare_parameter("state_space_boundries.minx", -50.0);
+  this->declare_parameter("state_space_boundries.maxx", 50.0);
+  this->declare_parameter("state_space_boundries.miny", -10.0);
+  this->declare_parameter("state_space_boundries.maxy", 10.0);
+  this->declare_parameter("state_space_boundries.minz", -10.0);
+  this->declare_parameter("state_space_boundries.maxz", 10.0);
+  this->declare_parameter("state_space_boundries.minyaw", -3.14);
+  this->declare_parameter("state_space_boundries.maxyaw", 3.14);
+  this->declare_parameter("robot_body_dimens.x", 1.5);
+  this->declare_parameter("robot_body_dimens.y", 1.5);
+  this->declare_parameter("robot_body_dimens.z", 0.4);
+  this->declare_parameter("robot_z", 0.0);
+  this->declare_parameter("seed", 0);
+  this->declare_parameter("num_scenarios", 20);
+  this->declare_parameter("max_sampling_attempts", 10000);
+  this->declare_parameter("min_euclidean_dist_start_to_goal", 25.0);
+  this->declare_parameter("num_workers", 4);
+  this->declare_parameter("min_success_rate", 0.0);
+  this->declare_parameter("adaptive_bounds_margins", std::vector<double>());
+
+  this->get_parameter("map_file", map_file_);
+  this->get_parameter("scenario_file", scenario_file_);
+  this->get_parameter("results_output_dir", results_output_dir_);
+  this->get_parameter("selected_planners", selected_planners_);
+  this->get_parameter("selected_state_space", selected_state_space_);
+  this->get_parameter("planner_timeout", planner_timeout_);
+  this->get_parameter("min_turning_radius", min_turning_radius_);
+  this->get_parameter("goal_tolerance", goal_tolerance_);
+  this->get_parameter("state_space_boundries.minx", se_bounds_.minx);
+  this->get_parameter("state_space_boundries.maxx", se_bounds_.maxx);
+  this->get_parameter("state_space_boundries.miny", se_bounds_.miny);
+  this->get_parameter("state_space_boundries.maxy", se_bounds_.maxy);
+  this->get_parameter("state_space_boundries.minz", se_bounds_.minz);
+  this->get_parameter("state_space_boundries.maxz", se_bounds_.maxz);
+  this->get_parameter("state_space_boundries.minyaw", se_bounds_.minyaw);
+  this->get_parameter("state_space_boundries.maxyaw", se_bounds_.maxyaw);
+  this->get_parameter("robot_body_dimens.x", robot_body_dimensions_.x);
+  this->get_parameter("robot_body_dimens.y", robot_body_dimensions_.y);
+  this->get_parameter("robot_body_dimens.z", robot_body_dimensions_.z);
+  this->get_parameter("robot_z", robot_z_);
+  this->get_parameter("seed", seed_);
+  this->get_parameter("num_scenarios", num_scenarios_);
+  this->get_parameter("max_sampling_attempts", max_sampling_attempts_);
+  this->get_parameter("min_euclidean_dist_start_to_goal",
+                      min_euclidean_dist_start_to_goal_);
+  this->get_parameter("num_workers", num_workers_);
+  this->get_parameter("min_success_rate", min_success_rate_);
+  this->get_parameter("adaptive_bounds_margins", adaptive_bounds_margins_);
+  if (adaptive_bounds_margins_.empty()) {
+    adaptive_bounds_margins_.push_back(-1.0);
+  }
+
+  typedef std::shared_ptr<fcl::CollisionGeometry> CollisionGeometryPtr_t;
+  CollisionGeometryPtr_t robot_body_box(new fcl::Box(robot_body_dimensions_.x,
+                                                     robot_body_dimensions_.y,
+                                                     robot_body_dimensions_.z));
+  robot_collision_object_ = std::make_shared<fcl::CollisionObject>(
+      robot_body_box, fcl::Transform3f());
+}
+
+PlannerBenchmarkHeadless::~PlannerBenchmarkHeadless() {}
+
+bool PlannerBenchmarkHeadless::loadMap() {
+  if (map_file_.size() > 3 &&
+      map_file_.compare(map_file_.size() - 3, 3, ".bt") == 0) {
+    auto octree = std::make_shared<octomap::OcTree>(0.1);
+    if (octree->readBinary(map_file_)) {
+      original_octomap_octree_ = octree;
+    }
+  } else {
+    octomap::AbstractOcTree *tree = octomap::AbstractOcTree::read(map_file_);
+    if (tree) {
+      auto octree = dynamic_cast<octomap::OcTree *>(tree);
+      if (octree) {
+        original_octomap_octree_ = std::make_shared<octomap::OcTree>(*octree);
+      }
+      delete tree;
+    }
+  }
+  if (!original_octomap_octree_) {
+    RCLCPP_ERROR(this->get_logger(), "Could not read an OcTree from %s",
+                 map_file_.c_str());
+    return false;
+  }
+
+  auto original_octomap_fcl_octree =
+      std::make_shared<fcl::OcTree>(original_octomap_octree_);
+  original_octomap_collision_object_ = std::make_shared<fcl::CollisionObject>(
+      std::shared_ptr<fcl::CollisionGeometry>(original_octomap_fcl_octree));
+
+  RCLCPP_INFO(this->get_logger(), "Loaded Octomap with %d nodes from %s",
+              original_octomap_octree_->size(), map_file_.c_str());
+  return true;
+}
+
+bool PlannerBenchmarkHeadless::loadScenarios() {
+  scenarios_.clear();
+  std::ifstream scenario_in(scenario_file_);
+  if (!scenario_in.good()) {
+    return false;
+  }
+  std::string line;
+  std::getline(scenario_in, line); // header
+  int line_number = 1, skipped_rows = 0;
+  while (std::getline(scenario_in, line)) {
+    line_number++;
+    if (line.empty()) {
+      continue;
+    }
+    BenchmarkScenario scenario;
+    char c;
+    std::stringstream ss(line);
+    if (!(ss >> scenario.id >> c >> scenario.start.x >> c >> scenario.start.y >>
+          c >> scenario.start.z >> c >> scenario.start.yaw >> c >>
+          scenario.goal.x >> c >> scenario.goal.y >> c >> scenario.goal.z >>
+          c >> scenario.goal.yaw)) {
+      RCLCPP_WARN(this->get_logger(), "Skipping malformed row %d of %s",
+                  line_number, scenario_file_.c_str());
+      skipped_rows++;
+      continue;
+    }
+    scenarios_.push_back(scenario);
+  }
+  RCLCPP_INFO(this->get_logger(), "Loaded %d scenarios from %s, skipped %d rows",
+              scenarios_.size(), scenario_file_.c_str(), skipped_rows);
+  return true;
+}
+
+bool PlannerBenchmarkHeadless::loadOrGenerateScenarios() {
+  if (loadScenarios()) {
+    return !scenarios_.empty();
+  }
+
+  // Same seed and map always give same scenarios
+  std::mt19937 rng(seed_);
+  std::uniform_real_distribution<double> x_distr(se_bounds_.minx,
+                                                 se_bounds_.maxx);
+  std::uniform_real_distribution<double> y_distr(se_bounds_.miny,
+                                                 se_bounds_.maxy);
+  std::uniform_real_distribution<double> yaw_distr(se_bounds_.minyaw,
+                                                   se_bounds_.maxyaw);
+  int attempts = 0;
+  while (static_cast<int>(scenarios_.size()) < num_scenarios_ &&
+         attempts < max_sampling_attempts_) {
+    attempts++;
+    BenchmarkScenario scenario;
+    scenario.id = scenarios_.size();
+    scenario.start.x = x_distr(rng);
+    scenario.start.y = y_distr(rng);
+    scenario.start.z = robot_z_;
+    scenario.start.yaw = yaw_distr(rng);
+    scenario.goal.x = x_distr(rng);
+    scenario.goal.y = y_distr(rng);
+    scenario.goal.z = robot_z_;
+    scenario.goal.yaw = yaw_distr(rng);
+    double distance = std::hypot(scenario.goal.x - scenario.start.x,
+                                 scenario.goal.y - scenario.start.y);
+    if (distance > min_euclidean_dist_start_to_goal_ &&
+        isPoseValid(scenario.start.x, scenario.start.y, scenario.start.z,
+                    scenario.start.yaw) &&
+        isPoseValid(scenario.goal.x, scenario.goal.y, scenario.goal.z,
+                    scenario.goal.yaw)) {
+      scenarios_.push_back(scenario);
+    }
+  }
+  if (static_cast<int>(scenarios_.size()) < num_scenarios_) {
+    RCLCPP_WARN(this->get_logger(),
+                "Only %d of %d scenarios could be sampled in %d attempts",
+                scenarios_.size(), num_scenarios_, max_sampling_attempts_);
+  }
+
+  // workers load scenarios from this file
+  std::ofstream scenario_out(scenario_file_);
+  if (!scenario_out.good()) {
+    RCLCPP_ERROR(this->get_logger(), "Could not write scenarios to %s",
+                 scenario_file_.c_str());
+    return false;
+  }
+  scenario_out << "id,start_x,start_y,start_z,start_yaw,goal_x,goal_y,goal_z,"
+                  "goal_yaw\n";
+  scenario_out << std::setprecision(10);
+  for (auto &&i : scenarios_) {
+    scenario_out << i.id << "," << i.start.x << "," << i.start.y << ","
+                 << i.start.z << "," << i.start.yaw << "," << i.goal.x << ","
+                 << i.goal.y << "," << i.goal.z << "," << i.goal.yaw << "\n";
+  }
+  RCLCPP_INFO(this->get_logger(),
+              "Generated %d scenarios with seed %d, saved to %s",
+              scenarios_.size(), seed_, scenario_file_.c_str());
+  return !scenarios_.empty();
+}
+
+ompl::base::StateSpacePtr PlannerBenchmarkHeadless::allocateStateSpace() {
+  ompl::base::StateSpacePtr state_space;
+  if (selected_state_space_ == "SE3") {
+    ompl::base::RealVectorBounds bounds(3);
+    bounds.setLow(0, se_bounds_.minx);
+    bounds.setHigh(0, se_bounds_.maxx);
+    bounds.setLow(1, se_bounds_.miny);
+    bounds.setHigh(1, se_bounds_.maxy);
+    bounds.setLow(2, se_bounds_.minz);
+    bounds.setHigh(2, se_bounds_.maxz);
+    state_space = std::make_shared<ompl::base::SE3StateSpace>();
+    state_space->as<ompl::base::SE3StateSpace>()->setBounds(bounds);
+    return state_space;
+  }
+
+  ompl::base::RealVectorBounds bounds(2);
+  bounds.setLow(0, se_bounds_.minx);
+  bounds.setHigh(0, se_bounds_.maxx);
+  bounds.setLow(1, se_bounds_.miny);
+  bounds.setHigh(1, se_bounds_.maxy);
+  if (selected_state_space_ == "REEDS") {
+    state_space =
+        std::make_shared<ompl::base::ReedsSheppStateSpace>(min_turning_radius_);
+  } else if (selected_state_space_ == "DUBINS") {
+    state_space = std::make_shared<ompl::base::DubinsStateSpace>(
+        min_turning_radius_, false);
+  } else {
+    state_space = std::make_shared<ompl::base::SE2StateSpace>();
+  }
+  state_space->as<ompl::base::SE2StateSpace>()->setBounds(bounds);
+  return state_space;
+}
+
+bool PlannerBenchmarkHeadless::isPoseValid(double x, double y, double z,
+                                           double yaw) {
+  fcl::Vec3f translation(x, y, z);
+  tf2::Quaternion myQuaternion;
+  myQuaternion.setRPY(0, 0, yaw);
+  fcl::Quaternion3f rotation(myQuaternion.getX(), myQuaternion.getY(),
+                             myQuaternion.getZ(), myQuaternion.getW());
+  robot_collision_object_->setTransform(rotation, translation);
+  fcl::CollisionRequest requestType(1, false, 1, false);
+  fcl::CollisionResult collisionResult;
+  fcl::collide(robot_collision_object_.get(),
+               original_octomap_collision_object_.get(), requestType,
+               collisionResult);
+  return !collisionResult.isCollision();
+}
+
+bool PlannerBenchmarkHeadless::isStateValid(const ompl::base::State *state) {
+  if (selected_state_space_ != "SE3") {
+    const auto *se2_state = state->as<ompl::base::SE2StateSpace::StateType>();
+    return isPoseValid(se2_state->getX(), se2_state->getY(), robot_z_,
+                       se2_state->getYaw());
+  }
+  const auto *se3state = state->as<ompl::base::SE3StateSpace::StateType>();
+  const auto *pos =
+      se3state->as<ompl::base::RealVectorStateSpace::StateType>(0);
+  const auto *rot = se3state->as<ompl::base::SO3StateSpace::StateType>(1);
+  fcl::Vec3f translation(pos->values[0], pos->values[1], pos->values[2]);
+  fcl::Quaternion3f rotation(rot->w, rot->x, rot->y, rot->z);
+  robot_collision_object_->setTransform(rotation, translation);
+  fcl::CollisionRequest requestType(1, false, 1, false);
+  fcl::CollisionResult collisionResult;
+  fcl::collide(robot_collision_object_.get(),
+               original_octomap_collision_object_.get(), requestType,
+               collisionResult);
+  return !collisionResult.isCollision();
+}
+
+void PlannerBenchmarkHeadless::setStartAndGoal(
+    const BenchmarkScenario &scenario, ompl::geometric::SimpleSetup &ss) {
+  if (selected_state_space_ == "SE3") {
+    ompl::base::ScopedState<ompl::base::SE3StateSpace> start(state_space_),
+        goal(state_space_);
+    start->setXYZ(scenario.start.x, scenario.start.y, scenario.start.z);
+    start->as<ompl::base::SO3StateSpace::StateType>(1)->setAxisAngle(
+        0, 0, 1, scenario.start.yaw);
+    goal->setXYZ(scenario.goal.x, scenario.goal.y, scenario.goal.z);
+    goal->as<ompl::base::SO3StateSpace::StateType>(1)->setAxisAngle(
+        0, 0, 1, scenario.goal.yaw);
+    ss.setStartAndGoalStates(start, goal, goal_tolerance_);
+    return;
+  }
+  ompl::base::ScopedState<ompl::base::SE2StateSpace> start(state_space_),
+      goal(state_space_);
+  start->setXY(scenario.start.x, scenario.start.y);
+  start->setYaw(scenario.start.yaw);
+  goal->setXY(scenario.goal.x, scenario.goal.y);
+  goal->setYaw(scenario.goal.yaw);
+  ss.setStartAndGoalStates(start, goal, goal_tolerance_);
+}
+
+double PlannerBenchmarkHeadless::setBoundsForScenario(
+    const BenchmarkScenario &scenario, double margin) {
+  ompl::base::RealVectorBounds se2_bounds(2), z_bounds(1);
+  if (margin < 0.0) {
+    se2_bounds.setLow(0, se_bounds_.minx);
+    se2_bounds.setHigh(0, se_bounds_.maxx);
+    se2_bounds.setLow(1, se_bounds_.miny);
+    se2_bounds.setHigh(1, se_bounds_.maxy);
+    z_bounds.setLow(0, se_bounds_.minz);
+    z_bounds.setHigh(0, se_bounds_.maxz);
+  } else {
+    geometry_msgs::msg::Point start, goal, map_min, map_max;
+    start.x = scenario.start.x;
+    start.y = scenario.start.y;
+    start.z = scenario.start.z;
+    goal.x = scenario.goal.x;
+    goal.y = scenario.goal.y;
+    goal.z = scenario.goal.z;
+    original_octomap_octree_->getMetricMin(map_min.x, map_min.y, map_min.z);
+    original_octomap_octree_->getMetricMax(map_max.x, map_max.y, map_max.z);
+    determineAdaptiveBounds(start, goal, map_min, map_max, margin, se2_bounds,
+                            z_bounds);
+  }
+
+  if (selected_state_space_ == "SE3") {
+    ompl::base::RealVectorBounds bounds(3);
+    for (int i = 0; i < 2; i++) {
+      bounds.setLow(i, se2_bounds.low[i]);
+      bounds.setHigh(i, se2_bounds.high[i]);
+    }
+    bounds.setLow(2, z_bounds.low[0]);
+    bounds.setHigh(2, z_bounds.high[0]);
+    state_space_->as<ompl::base::SE3StateSpace>()->setBounds(bounds);
+  } else {
+    state_space_->as<ompl::base::SE2StateSpace>()->setBounds(se2_bounds);
+  }
+  return (se2_bounds.high[0] - se2_bounds.low[0]) *
+         (se2_bounds.high[1] - se2_bounds.low[1]);
+}
+
+std::vector<BenchmarkRunResult>
+PlannerBenchmarkHeadless::runPlanner(const std::string &planner_name) {
+  // Worker processes share nothing, so planners may use all of their memory
+  // and a crash of one planner does not take others down, it fails the gate
+  ompl::RNG::setSeed(seed_ + 1);
+  state_space_ = allocateStateSpace();
+  ompl::geometric::SimpleSetup ss(state_space_);
+  auto si = ss.getSpaceInformation();
+
+  uint64_t validity_checks = 0;
+  ss.setStateValidityChecker(
+      [this, &validity_checks](const ompl::base::State *state) {
+        validity_checks++;
+        return isStateValid(state);
+      });
+  auto objective =
+      std::make_shared<ompl::base::PathLengthOptimizationObjective>(si);
+  ss.setOptimizationObjective(objective);
+
+  std::vector<BenchmarkRunResult> results;
+  for (auto &&margin : adaptive_bounds_margins_) {
+    for (auto &&scenario : scenarios_) {
+      BenchmarkRunResult result;
+      result.planner = planner_name;
+      result.scenario_id = scenario.id;
+      result.bounds_margin = margin;
+
+      ss.clear();
+      // validity checking resolution is a fraction of the extent, keep the
+      // metric step the same for all bounds sizes
+      result.bounds_area = setBoundsForScenario(scenario, margin);
+      si->setStateValidityCheckingResolution(1.0 /
+                                             state_space_->getMaximumExtent());
+      setStartAndGoal(scenario, ss);
+      ompl::base::PlannerPtr planner;
+      initializeSelectedPlanner(planner, planner_name, si, this->get_logger());
+      ss.setPlanner(planner);
+      ss.setup();
+
+      auto t0 = std::chrono::steady_clock::now();
+      double time_to_first_solution = -1.0;
+      ss.getProblemDefinition()->setIntermediateSolutionCallback(
+          [&](const ompl::base::Planner *,
+              const std::vector<const ompl::base::State *> &,
+              const ompl::base::Cost) {
+            if (time_to_first_solution < 0.0) {
+              std::chrono::duration<double> elapsed =
+                  std::chrono::steady_clock::now() - t0;
+              time_to_first_solution = elapsed.count();
+            }
+          });
+
+      validity_checks = 0;
+      ompl::base::PlannerStatus status = ss.solve(planner_timeout_);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - t0;
+
+      result.total_time = elapsed.count();
+      result.validity_checks = validity_checks;
+      result.success = status == ompl::base::PlannerStatus::EXACT_SOLUTION;
+      if (result.success) {
+        result.cost = ss.getSolutionPath().cost(objective).value();
+        // non optimizing planners do not report intermediate solutions, they
+        // return as soon as the first one is found
+        result.time_to_first_solution = time_to_first_solution >= 0.0
+                                            ? time_to_first_solution
+                                            : ss.getLastPlanComputationTime();
+      }
+      results.push_back(result);
+    }
+  }
+  return results;
+}
+
+void PlannerBenchmarkHeadless::writeRunResults(
+    const std::string &file, const std::vector<BenchmarkRunResult> &results) {
+  std::ofstream out(file);
+  out << "planner,scenario_id,success,time_to_first_solution,total_time,cost,"
+         "validity_checks,bounds_margin,bounds_area\n";
+  out << std::setprecision(10);
+  for (auto &&i : results) {
+    out << i.planner << "," << i.scenario_id << "," << i.success << ","
+        << i.time_to_first_solution << "," << i.total_time << "," << i.cost
+        << "," << i.validity_checks << "," << i.bounds_margin << ","
+        << i.bounds_area << "\n";
+  }
+}
+
+bool PlannerBenchmarkHeadless::readRunResults(
+    const std::string &file, std::vector<BenchmarkRunResult> &results) {
+  std::ifstream in(file);
+  if (!in.good()) {
+    return false;
+  }
+  std::string line;
+  std::getline(in, line); // header
+  int line_number = 1;
+  while (std::getline(in, line)) {
+    line_number++;
+    if (line.empty()) {
+      continue;
+    }
+    std::stringstream ss(line);
+    BenchmarkRunResult result;
+    std::string field;
+    auto next_field = [&ss, &field]() -> const std::string & {
+      if (!std::getline(ss, field, ',')) {
+        throw std::invalid_argument("missing field");
+      }
+      return field;
+    };
+    try {
+      result.planner = next_field();
+      result.scenario_id = std::stoi(next_field());
+      result.success = std::stoi(next_field());
+      result.time_to_first_solution = std::stod(next_field());
+      result.total_time = std::stod(next_field());
+      result.cost = std::stod(next_field());
+      result.validity_checks = std::stoull(next_field());
+      result.bounds_margin = std::stod(next_field());
+      result.bounds_area = std::stod(next_field());
+    } catch (const std::exception &e) {
+      RCLCPP_WARN(this->get_logger(), "Skipping malformed row %d of %s: %s",
+                  line_number, file.c_str(), e.what());
+      continue;
+    }
+    results.push_back(result);
+  }
+  return true;
+}
+
+bool PlannerBenchmarkHeadless::writeSummary(
+    const std::string &file, const std::vector<BenchmarkRunResult> &results) {
+  bool passed = true;
+  std::ofstream out(file);
+  out << std::setprecision(10);
+  out << "{\n  \"seed\": " << seed_
+      << ",\n  \"num_scenarios\": " << scenarios_.size()
+      << ",\n  \"planner_timeout\": " << planner_timeout_
+      << ",\n  \"planners\": [";
+  for (size_t p = 0; p < selected_planners_.size(); p++) {
+    const auto &planner = selected_planners_[p];
+    int runs = 0, successes = 0;
+    double sum_first = 0.0, sum_cost = 0.0, sum_checks = 0.0;
+    for (auto &&i : results) {
+      if (i.planner != planner) {
+        continue;
+      }
+      runs++;
+      sum_checks += i.validity_checks;
+      if (i.success) {
+        successes++;
+        sum_first += i.time_to_first_solution;
+        sum_cost += i.cost;
+      }
+    }
+    double success_rate = runs ? static_cast<double>(successes) / runs : 0.0;
+    // a planner without any results did not run, whatever min_success_rate is
+    passed &= runs > 0 && success_rate >= min_success_rate_;
+    out << (p ? "," : "") << "\n    {\"name\": \"" << planner
+        << "\", \"runs\": " << runs << ", \"success_rate\": " << success_rate
+        << ", \"mean_time_to_first_solution\": "
+        << (successes ? sum_first / successes : -1.0)
+        << ", \"mean_cost\": " << (successes ? sum_cost / successes : -1.0)
+        << ", \"mean_validity_checks\": " << (runs ? sum_checks / runs : 0.0)
+        << "}";
+    RCLCPP_INFO(this->get_logger(),
+                "%s: success rate %.2f, mean time to first solution %.4f, "
+                "mean cost %.3f",
+                planner.c_str(), success_rate,
+                successes ? sum_first / successes : -1.0,
+                successes ? sum_cost / successes : -1.0);
+  }
+  out << "\n  ],\n  \"bounds\": [";
+  // time to solution vs. state space size, a negative margin is the static
+  // bounds baseline
+  for (size_t m = 0; m < adaptive_bounds_margins_.size(); m++) {
+    const double margin = adaptive_bounds_margins_[m];
+    int runs = 0, successes = 0;
+    double sum_first = 0.0, sum_area = 0.0;
+    for (auto &&i : results) {
+      if (i.bounds_margin != margin) {
+        continue;
+      }
+      runs++;
+      sum_area += i.bounds_area;
+      if (i.success) {
+        successes++;
+        sum_first += i.time_to_first_solution;
+      }
+    }
+    out << (m ? "," : "") << "\n    {\"margin\": " << margin
+        << ", \"runs\": " << runs << ", \"success_rate\": "
+        << (runs ? static_cast<double>(successes) / runs : 0.0)
+        << ", \"mean_time_to_first_solution\": "
+        << (successes ? sum_first / successes : -1.0)
+        << ", \"mean_bounds_area\": " << (runs ? sum_area / runs : 0.0)
+        << "}";
+  }
+  out << "\n  ]\n}\n";
+  return passed;
+}
+
+std::string
+PlannerBenchmarkHeadless::partFile(const std::string &planner) const {
+  return results_output_dir_ + "/" + planner + ".part.csv";
+}
+
+int PlannerBenchmarkHeadless::runWorker(const std::string &planner_name) {
+  writeRunResults(partFile(planner_name), runPlanner(planner_name));
+  return 0;
+}
+
+int PlannerBenchmarkHeadless::run(int argc, char **argv) {
+  std::map<pid_t, std::string> running_workers;
+  std::set<std::string> failed_planners;
+  size_t next_planner = 0;
+
+  // start workers, never more than num_workers at a time. This process
+  // already runs rclcpp and DDS threads, so a worker only execs a fresh
+  // instance of this binary in --worker mode after fork
+  while (next_planner < selected_planners_.size() ||
+         !running_workers.empty()) {
+    if (next_planner < selected_planners_.size() &&
+        static_cast<int>(running_workers.size()) < std::max(1, num_workers_)) {
+      const std::string planner = selected_planners_[next_planner++];
+      std::remove(partFile(planner).c_str());
+      std::vector<std::string> worker_args = {argv[0], "--worker", planner};
+      worker_args.insert(worker_args.end(), argv + 1, argv + argc);
+      std::vector<char *> worker_argv;
+      for (auto &&i : worker_args) {
+        worker_argv.push_back(const_cast<char *>(i.c_str()));
+      }
+      worker_argv.push_back(nullptr);
+
+      pid_t pid = fork();
+      if (pid == 0) {
+        execv("/proc/self/exe", worker_argv.data());
+        _exit(127);
+      } else if (pid < 0) {
+        RCLCPP_ERROR(this->get_logger(), "Could not fork a worker for %s",
+                     planner.c_str());
+        failed_planners.insert(planner);
+        continue;
+      }
+      running_workers[pid] = planner;
+      continue;
+    }
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0 && errno == EINTR) {
+      continue;
+    }
+    if (pid < 0) {
+      // ECHILD, workers are gone without being reaped here, their results
+      // can not be trusted
+      RCLCPP_ERROR(this->get_logger(), "Could not wait for workers: %s",
+                   std::strerror(errno));
+      for (auto &&worker : running_workers) {
+        failed_planners.insert(worker.second);
+      }
+      running_workers.clear();
+      for (; next_planner < selected_planners_.size(); next_planner++) {
+        failed_planners.insert(selected_planners_[next_planner]);
+      }
+      break;
+    }
+    if (running_workers.count(pid)) {
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        RCLCPP_ERROR(this->get_logger(), "Worker of %s did not exit cleanly",
+                     running_workers[pid].c_str());
+        failed_planners.insert(running_workers[pid]);
+      }
+      running_workers.erase(pid);
+    }
+  }
+
+  std::vector<BenchmarkRunResult> results;
+  for (auto &&planner : selected_planners_) {
+    if (failed_planners.count(planner)) {
+      std::remove(partFile(planner).c_str());
+      continue;
+    }
+    if (!readRunResults(partFile(planner), results)) {
+      RCLCPP_ERROR(this->get_logger(), "Worker of %s wrote no results",
+                   planner.c_str());
+      failed_planners.insert(planner);
+    }
+    std::remove(partFile(planner).c_str());
+  }
+  writeRunResults(results_output_dir_ + "/results.csv", results);
+  bool passed = writeSummary(results_output_dir_ + "/summary.json", results);
+  RCLCPP_INFO(this->get_logger(), "Benchmark results saved to %s",
+              results_output_dir_.c_str());
+  for (auto &&planner : failed_planners) {
+    RCLCPP_ERROR(this->get_logger(), "Planner %s failed to run",
+                 planner.c_str());
+  }
+  return passed && failed_planners.empty() ? 0 : 1;
+}
+
+} // namespace vox_nav_utilities
+
+int main(int argc, char **argv) {
+  // workers are started as: <this binary> --worker <planner> <arguments of parent>
+  std::string worker_planner;
+  if (argc > 2 && std::string(argv[1]) == "--worker") {
+    worker_planner = argv[2];
+    argv[2] = argv[0];
+    argv += 2;
+    argc -= 2;
+  }
+  rclcpp::init(argc, argv);
+  auto node = std::make_shared<vox_nav_utilities::PlannerBenchmarkHeadless>();
+  int exit_code = 1;
+  if (worker_planner.empty()) {
+    if (node->loadMap() && node->loadOrGenerateScenarios()) {
+      exit_code = node->run(argc, argv);
+    }
+  } else if (node->loadMap() && node->loadScenarios()) {
+    // scenarios were generated and saved by parent
+    exit_code = node->runWorker(worker_planner);
+  }
+  rclcpp::shutdown();
+  return exit_code;
+}
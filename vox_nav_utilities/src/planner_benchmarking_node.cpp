@@ -36,6 +36,14 @@ PlannerBenchMarking::PlannerBenchMarking()
   this->declare_parameter("results_file_regex", "SE2");
   this->declare_parameter("publish_a_sample_bencmark", true);
   this->declare_parameter("sample_bencmark_plans_topic", "benchmark_plan");
+  this->declare_parameter("esdf.enabled", true);
+  this->declare_parameter("esdf.max_distance", 2.0);
+  this->declare_parameter("esdf.resolution", 0.0);
+  this->declare_parameter("footprint_masks.enabled", true);
+  this->declare_parameter("footprint_masks.exact_confirmation", true);
+  this->declare_parameter("footprint_masks.yaw_bins", 36);
+  this->declare_parameter("footprint_masks.pitch_bins", 5);
+  this->declare_parameter("footprint_masks.max_pitch", 0.5);
 
   this->get_parameter("selected_planners", selected_planners_);
   this->get_parameter("planner_timeout", planner_timeout_);
@@ -67,6 +75,29 @@ PlannerBenchMarking::PlannerBenchMarking()
   this->get_parameter("publish_a_sample_bencmark", publish_a_sample_bencmark_);
   this->get_parameter("sample_bencmark_plans_topic",
                       sample_bencmark_plans_topic_);
+  this->get_parameter("esdf.enabled", esdf_enabled_);
+  this->get_parameter("esdf.max_distance", esdf_max_distance_);
+  this->get_parameter("esdf.resolution", esdf_resolution_);
+  this->get_parameter("footprint_masks.enabled", footprint_masks_enabled_);
+  this->get_parameter("footprint_masks.exact_confirmation",
+                      footprint_masks_exact_confirmation_);
+  this->get_parameter("footprint_masks.yaw_bins", footprint_masks_yaw_bins_);
+  this->get_parameter("footprint_masks.pitch_bins",
+                      footprint_masks_pitch_bins_);
+  this->get_parameter("footprint_masks.max_pitch", footprint_masks_max_pitch_);
+
+  // spheres used for the cheap ESDF test of robot box
+  robot_inscribed_radius_ =
+      std::min({robot_body_dimensions_.x, robot_body_dimensions_.y,
+                robot_body_dimensions_.z}) /
+      2.0;
+  robot_circumscribed_radius_ =
+      std::sqrt(std::pow(robot_body_dimensions_.x, 2) +
+                std::pow(robot_body_dimensions_.y, 2) +
+                std::pow(robot_body_dimensions_.z, 2)) /
+      2.0;
+  esdf_ = std::make_shared<ESDF>();
+  footprint_masks_ = std::make_shared<FootprintMasks>();
 
   typedef std::shared_ptr<fcl::CollisionGeometry> CollisionGeometryPtr_t;
   CollisionGeometryPtr_t robot_body_box(new fcl::Box(robot_body_dimensions_.x,
@@ -228,9 +259,26 @@ PlannerBenchMarking::doBenchMarking() {
           (selected_state_space_ == "DUBINS") ||
           (selected_state_space_ == "SE2")) {
         ss.setStartAndGoalStates(random_start, random_goal, goal_tolerance_);
-        ss.setStateValidityChecker([this](const ompl::base::State *state) {
-          return isStateValidSE2(state);
-        });
+        if (esdf_->isReady()) {
+          ss.setStateValidityChecker(
+              std::make_shared<ClearanceValidityChecker>(
+                  si, esdf_,
+                  [this](const ompl::base::State *state) {
+                    return isStateValidSE2(state);
+                  },
+                  [this](const ompl::base::State *state, double &x, double &y,
+                         double &z) {
+                    const auto *se2 =
+                        state->as<ompl::base::SE2StateSpace::StateType>();
+                    x = se2->getX();
+                    y = se2->getY();
+                    z = start_.z;
+                  }));
+        } else {
+          ss.setStateValidityChecker([this](const ompl::base::State *state) {
+            return isStateValidSE2(state);
+          });
+        }
 
       } else {
         ompl::base::ScopedState<ompl::base::SE3StateSpace> se3_start(
@@ -247,9 +295,28 @@ PlannerBenchMarking::doBenchMarking() {
 
         ss.setStartAndGoalStates(se3_start, se3_goal, goal_tolerance_);
 
-        ss.setStateValidityChecker([this](const ompl::base::State *state) {
-          return isStateValidSE3(state);
-        });
+        if (esdf_->isReady()) {
+          ss.setStateValidityChecker(
+              std::make_shared<ClearanceValidityChecker>(
+                  si, esdf_,
+                  [this](const ompl::base::State *state) {
+                    return isStateValidSE3(state);
+                  },
+                  [](const ompl::base::State *state, double &x, double &y,
+                     double &z) {
+                    const auto *pos =
+                        state->as<ompl::base::SE3StateSpace::StateType>()
+                            ->as<ompl::base::RealVectorStateSpace::StateType>(
+                                0);
+                    x = pos->values[0];
+                    y = pos->values[1];
+                    z = pos->values[2];
+                  }));
+        } else {
+          ss.setStateValidityChecker([this](const ompl::base::State *state) {
+            return isStateValidSE3(state);
+          });
+        }
       }
 
       si->setStateValidityCheckingResolution(1.0 /
@@ -363,6 +430,23 @@ bool PlannerBenchMarking::isStateValidSE2(const ompl::base::State *state) {
   // cast the abstract state type to the type we expect
   const ompl::base::SE2StateSpace::StateType *se2_state =
       state->as<ompl::base::SE2StateSpace::StateType>();
+  // a single distance lookup is enough when sphere test is conclusive
+  auto esdf_result = esdf_->checkClearance(
+      se2_state->getX(), se2_state->getY(), start_.z, robot_inscribed_radius_,
+      robot_circumscribed_radius_);
+  if (esdf_result != ESDF::ClearanceResult::UNKNOWN) {
+    return esdf_result == ESDF::ClearanceResult::FREE;
+  }
+  if (footprint_masks_->isReady()) {
+    if (footprint_masks_->isCollisionFree(se2_state->getX(), se2_state->getY(),
+                                          start_.z, se2_state->getYaw())) {
+      return true;
+    }
+    // masks are conservative, a hit is only confirmed by exact check
+    if (!footprint_masks_exact_confirmation_) {
+      return false;
+    }
+  }
   // check validity of state Fdefined by pos & rot
   fcl::Vec3f translation(se2_state->getX(), se2_state->getY(), start_.z);
 
@@ -389,6 +473,28 @@ bool PlannerBenchMarking::isStateValidSE3(const ompl::base::State *state) {
   // extract the second component of the state and cast it to what we expect
   const ompl::base::SO3StateSpace::StateType *rot =
       se3state->as<ompl::base::SO3StateSpace::StateType>(1);
+  auto esdf_result =
+      esdf_->checkClearance(pos->values[0], pos->values[1], pos->values[2],
+                            robot_inscribed_radius_,
+                            robot_circumscribed_radius_);
+  if (esdf_result != ESDF::ClearanceResult::UNKNOWN) {
+    return esdf_result == ESDF::ClearanceResult::FREE;
+  }
+  if (footprint_masks_->isReady()) {
+    double roll, pitch, yaw;
+    tf2::Matrix3x3(tf2::Quaternion(rot->x, rot->y, rot->z, rot->w))
+        .getRPY(roll, pitch, yaw);
+    // masks have no roll, larger pitches are not covered either
+    if (std::abs(roll) < 1e-3 && footprint_masks_->isPitchCovered(pitch)) {
+      if (footprint_masks_->isCollisionFree(pos->values[0], pos->values[1],
+                                            pos->values[2], yaw, pitch)) {
+        return true;
+      }
+      if (!footprint_masks_exact_confirmation_) {
+        return false;
+      }
+    }
+  }
   // check validity of state Fdefined by pos & rot
   fcl::Vec3f translation(pos->values[0], pos->values[1], pos->values[2]);
   fcl::Quaternion3f rotation(rot->w, rot->x, rot->y, rot->z);
@@ -551,6 +657,31 @@ void PlannerBenchMarking::setupMap() {
                 "will be created from this "
                 "octomap for state validity (aka collision check)",
                 original_octomap_octree_->size());
+
+    if (footprint_masks_enabled_) {
+      footprint_masks_->buildMasks(
+          robot_body_dimensions_.x, robot_body_dimensions_.y,
+          robot_body_dimensions_.z, original_octomap_octree_->getResolution(),
+          footprint_masks_yaw_bins_,
+          selected_state_space_ == "SE3" ? footprint_masks_pitch_bins_ : 1,
+          selected_state_space_ == "SE3" ? footprint_masks_max_pitch_ : 0.0);
+      footprint_masks_->setMap(original_octomap_octree_);
+      RCLCPP_INFO(this->get_logger(),
+                  "Built robot footprint masks with up to %d voxels",
+                  footprint_masks_->getMaxMaskSize());
+    }
+
+    if (esdf_enabled_) {
+      auto t1 = std::chrono::steady_clock::now();
+      esdf_->build(original_octomap_octree_, esdf_max_distance_,
+                   esdf_resolution_);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - t1;
+      RCLCPP_INFO(this->get_logger(),
+                  "Built ESDF of %d voxels in %.3f seconds, it will be used "
+                  "for clearance queries",
+                  esdf_->size(), elapsed.count());
+    }
   }
 }
 
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include "vox_nav_utilities/planner_helpers.hpp"
@@ -19,6 +20,32 @@
 namespace vox_nav_utilities
 {
 
+  ClearanceValidityChecker::ClearanceValidityChecker(
+    const ompl::base::SpaceInformationPtr & si,
+    const std::shared_ptr<ESDF> & esdf,
+    const std::function<bool(const ompl::base::State *)> & is_valid,
+    const std::function<void(const ompl::base::State *, double &, double &, double &)> &
+    get_position)
+  : ompl::base::StateValidityChecker(si),
+    esdf_(esdf),
+    is_valid_(is_valid),
+    get_position_(get_position)
+  {
+    specs_.clearanceComputationType = ompl::base::StateValidityCheckerSpecs::EXACT;
+  }
+
+  bool ClearanceValidityChecker::isValid(const ompl::base::State * state) const
+  {
+    return is_valid_(state);
+  }
+
+  double ClearanceValidityChecker::clearance(const ompl::base::State * state) const
+  {
+    double x, y, z;
+    get_position_(state, x, y, z);
+    return esdf_->getDistance(x, y, z);
+  }
+
   geometry_msgs::msg::PoseStamped getNearstNode(
     const geometry_msgs::msg::PoseStamped & state,
     const std::shared_ptr<octomap::OcTree> & nodes_octree)
@@ -92,6 +119,30 @@ namespace vox_nav_utilities
     }
   }
 
+  void initializeSelectedControlPlanner(
+    ompl::base::PlannerPtr & planner,
+    const std::string & selected_planner_name,
+    const ompl::control::SpaceInformationPtr & si,
+    const rclcpp::Logger logger)
+  {
+    if (selected_planner_name == std::string("SST")) {
+      planner = ompl::base::PlannerPtr(new ompl::control::SST(si));
+    } else if (selected_planner_name == std::string("RRT")) {
+      planner = ompl::base::PlannerPtr(new ompl::control::RRT(si));
+    } else if (selected_planner_name == std::string("EST")) {
+      planner = ompl::base::PlannerPtr(new ompl::control::EST(si));
+    } else if (selected_planner_name == std::string("KPIECE1")) {
+      planner = ompl::base::PlannerPtr(new ompl::control::KPIECE1(si));
+    } else if (selected_planner_name == std::string("PDST")) {
+      planner = ompl::base::PlannerPtr(new ompl::control::PDST(si));
+    } else {
+      RCLCPP_WARN(
+        logger,
+        "Selected control planner is not Found in available planners, using the default planner: SST");
+      planner = ompl::base::PlannerPtr(new ompl::control::SST(si));
+    }
+  }
+
 
   pcl::PointSurfel poseMsg2PCLSurfel(const geometry_msgs::msg::PoseStamped & pose_stamped)
   {
@@ -156,6 +207,41 @@ namespace vox_nav_utilities
     nearest_valid_goal = vox_nav_utilities::PCLSurfel2PoseMsg(goal_nearest_surfel);
   }
 
+  void determineAdaptiveBounds(
+    const geometry_msgs::msg::Point & start,
+    const geometry_msgs::msg::Point & goal,
+    const geometry_msgs::msg::Point & map_min,
+    const geometry_msgs::msg::Point & map_max,
+    double margin,
+    ompl::base::RealVectorBounds & se2_bounds,
+    ompl::base::RealVectorBounds & z_bounds)
+  {
+    auto axis_bounds = [margin](double s, double g, double map_lo, double map_hi,
+        double & lo, double & hi) {
+        lo = std::max(std::min(s, g) - margin, map_lo);
+        hi = std::min(std::max(s, g) + margin, map_hi);
+        // start or goal may be off the map, keep them inside anyway
+        lo = std::min(lo, std::min(s, g));
+        hi = std::max(hi, std::max(s, g));
+        double min_size = std::max(margin, 1.0);
+        if (hi - lo < min_size) {
+          double center = (lo + hi) / 2.0;
+          lo = center - min_size / 2.0;
+          hi = center + min_size / 2.0;
+        }
+      };
+    double lo, hi;
+    axis_bounds(start.x, goal.x, map_min.x, map_max.x, lo, hi);
+    se2_bounds.setLow(0, lo);
+    se2_bounds.setHigh(0, hi);
+    axis_bounds(start.y, goal.y, map_min.y, map_max.y, lo, hi);
+    se2_bounds.setLow(1, lo);
+    se2_bounds.setHigh(1, hi);
+    axis_bounds(start.z, goal.z, map_min.z, map_max.z, lo, hi);
+    z_bounds.setLow(0, lo);
+    z_bounds.setHigh(0, hi);
+  }
+
   void fillSurfelsfromMsgPoses(
     const geometry_msgs::msg::PoseArray & poses,
     pcl::PointCloud<pcl::PointSurfel>::Ptr & surfels)